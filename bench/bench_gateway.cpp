@@ -0,0 +1,343 @@
+// Gateway throughput over loopback: an in-process engine behind a TcpGateway,
+// driven by client connections that log in and stream NewOrder messages.
+//
+// Each client has a sender thread that writes orders in batches of --batch
+// messages and a reader thread that counts what comes back. Throughput is
+// orders acknowledged by the gateway per second, measured from the first
+// send to the last OrderAck; execution reports are counted alongside.
+//
+// The flow per client alternates resting limit orders a few ticks away from
+// the mid with IOC orders that cross it, so the books stay shallow and fills
+// flow back through the same sessions.
+//
+// Usage: mercury_gateway_bench [--clients=N] [--orders=N] [--markets=N]
+//                              [--batch=N] [--pin=CPU] [--io-uring | --shm]
+//
+// --io-uring runs the gateway on its io_uring backend instead of epoll.
+// --shm drives the same flow through a ShmOrderGateway instead: each client
+// attaches to its shared-memory channel and --batch is ignored.
+#include "TcpGateway.hpp"
+#include "ShmOrderGateway.hpp"
+#include "MatchingEngine.hpp"
+#include "MarketRegistry.hpp"
+#include "MarketDataPublisher.hpp"
+#include "ExecutionReportRouter.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace MercEx;
+
+namespace
+{
+    struct Config
+    {
+        int clients = 2;
+        std::uint64_t orders = 1'000'000; // per client
+        int markets = 2;
+        std::size_t batch = 256;          // messages per send()
+        int pin = -1;
+        GatewayBackend backend = GatewayBackend::Epoll;
+        bool shm = false;
+    };
+
+    Config parse_args(int argc, char **argv)
+    {
+        Config cfg;
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            auto value = [&](const char *key) -> const char *
+            {
+                std::size_t n = std::strlen(key);
+                return arg.compare(0, n, key) == 0 ? arg.c_str() + n : nullptr;
+            };
+            if (auto v = value("--clients="))
+                cfg.clients = std::atoi(v);
+            else if (auto v = value("--orders="))
+                cfg.orders = static_cast<std::uint64_t>(std::atoll(v));
+            else if (auto v = value("--markets="))
+                cfg.markets = std::atoi(v);
+            else if (auto v = value("--batch="))
+                cfg.batch = static_cast<std::size_t>(std::atoll(v));
+            else if (auto v = value("--pin="))
+                cfg.pin = std::atoi(v);
+            else if (arg == "--io-uring")
+                cfg.backend = GatewayBackend::IoUring;
+            else if (arg == "--shm")
+                cfg.shm = true;
+            else
+            {
+                std::cerr << "unknown argument: " << arg << "\n";
+                std::exit(2);
+            }
+        }
+        if (cfg.clients < 1 || cfg.markets < 1 || cfg.batch < 1)
+        {
+            std::cerr << "--clients, --markets and --batch must be positive\n";
+            std::exit(2);
+        }
+        return cfg;
+    }
+
+    void send_all(int fd, const void *data, std::size_t size)
+    {
+        const char *p = static_cast<const char *>(data);
+        while (size > 0)
+        {
+            ssize_t n = ::send(fd, p, size, MSG_NOSIGNAL);
+            if (n <= 0)
+                throw std::runtime_error(std::string("send: ") + std::strerror(errno));
+            p += n;
+            size -= static_cast<std::size_t>(n);
+        }
+    }
+
+    int connect_to(std::uint16_t port)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+            throw std::runtime_error(std::string("connect: ") + std::strerror(errno));
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return fd;
+    }
+
+    struct ClientStats
+    {
+        std::atomic<std::uint64_t> acks{0};
+        std::atomic<std::uint64_t> rejects{0};
+        std::atomic<std::uint64_t> executions{0};
+        Clock::time_point last_ack;
+    };
+
+    void count_reply(const MessageHeader &header, ClientStats &stats)
+    {
+        if (header.type == MessageType::OrderAck)
+        {
+            const auto &ack = reinterpret_cast<const OrderAckMessage &>(header);
+            if (ack.reason != RejectReason::None)
+                stats.rejects.fetch_add(1, std::memory_order_relaxed);
+            stats.acks.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (header.type == MessageType::Execution)
+        {
+            stats.executions.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Counts replies until every order has been acknowledged.
+    void read_replies(int fd, std::uint64_t orders, ClientStats &stats)
+    {
+        std::vector<std::uint64_t> words(1 << 13);
+        char *buffer = reinterpret_cast<char *>(words.data());
+        const std::size_t capacity = words.size() * sizeof(std::uint64_t);
+        std::size_t begin = 0, end = 0;
+        while (stats.acks.load(std::memory_order_relaxed) < orders)
+        {
+            ssize_t n = ::recv(fd, buffer + end, capacity - end, 0);
+            if (n <= 0)
+                return;
+            end += static_cast<std::size_t>(n);
+            while (end - begin >= sizeof(MessageHeader))
+            {
+                const auto &header = *reinterpret_cast<const MessageHeader *>(buffer + begin);
+                if (end - begin < header.length)
+                    break;
+                count_reply(header, stats);
+                begin += header.length;
+            }
+            std::memmove(buffer, buffer + begin, end - begin);
+            end -= begin;
+            begin = 0;
+        }
+        stats.last_ack = Clock::now();
+    }
+
+    NewOrderMessage make_order(const Config &cfg, int client, std::uint64_t sent)
+    {
+        constexpr std::int64_t kMidTicks = 10000;
+        auto msg = make_message<NewOrderMessage>(MessageType::NewOrder);
+        msg.market_id = static_cast<MarketID>(1 + (sent + client) % cfg.markets);
+        msg.side = (sent / cfg.markets) % 2 ? Side::Sell : Side::Buy;
+        msg.order_type = OrderType::Limit;
+        msg.quantity = 1 + static_cast<Quantity>(sent % 5);
+        msg.client_ref = sent;
+        msg.flags = NewOrderMessage::kHasPrice;
+
+        bool aggressive = (sent / (2 * cfg.markets)) % 4 == 3;
+        std::int64_t offset = aggressive ? -2 : 1 + static_cast<std::int64_t>(sent % 3);
+        std::int64_t ticks = msg.side == Side::Buy ? kMidTicks - offset : kMidTicks + offset;
+        msg.price = static_cast<double>(ticks) / 100.0;
+        msg.tif = aggressive ? TimeInForce::IOC : TimeInForce::Day;
+        return msg;
+    }
+
+    void send_orders(int fd, const Config &cfg, int client)
+    {
+        std::vector<NewOrderMessage> batch(cfg.batch);
+        for (std::uint64_t sent = 0; sent < cfg.orders;)
+        {
+            std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(cfg.batch, cfg.orders - sent));
+            for (std::size_t i = 0; i < n; ++i, ++sent)
+                batch[i] = make_order(cfg, client, sent);
+            send_all(fd, batch.data(), n * sizeof(NewOrderMessage));
+        }
+    }
+
+    // Shared-memory counterparts: the ring is the send buffer, and a full or
+    // empty ring yields the CPU rather than spinning against the gateway.
+    void shm_send_orders(ShmOrderClient &channel, const Config &cfg, int client)
+    {
+        for (std::uint64_t sent = 0; sent < cfg.orders; ++sent)
+        {
+            NewOrderMessage msg = make_order(cfg, client, sent);
+            while (!channel.submit(msg))
+                std::this_thread::yield();
+        }
+    }
+
+    void shm_read_replies(ShmOrderClient &channel, std::uint64_t orders, ClientStats &stats)
+    {
+        while (stats.acks.load(std::memory_order_relaxed) < orders)
+        {
+            if (channel.poll([&](const MessageHeader &header) { count_reply(header, stats); }) == 0)
+                std::this_thread::yield();
+        }
+        stats.last_ack = Clock::now();
+    }
+
+    int run_shm(const Config &cfg, MatchingEngine &engine, ExecutionReportRouter &reports)
+    {
+        ShmOrderGatewayConfig config;
+        config.placement.cpu = cfg.pin;
+        config.prefix = "/mercury-oe-bench";
+        ShmOrderGateway gateway(engine, reports, config);
+        std::vector<std::unique_ptr<ShmOrderClient>> channels;
+        for (int c = 0; c < cfg.clients; ++c)
+        {
+            auto client_id = static_cast<ClientID>(1 + c);
+            gateway.add_client(client_id);
+            channels.push_back(std::make_unique<ShmOrderClient>());
+            channels.back()->attach(client_id, config.prefix);
+        }
+        gateway.start();
+
+        auto start = Clock::now();
+        std::vector<ClientStats> stats(cfg.clients);
+        std::vector<std::thread> threads;
+        for (int c = 0; c < cfg.clients; ++c)
+        {
+            threads.emplace_back(shm_read_replies, std::ref(*channels[c]), cfg.orders, std::ref(stats[c]));
+            threads.emplace_back(shm_send_orders, std::ref(*channels[c]), std::cref(cfg), c);
+        }
+        for (auto &t : threads)
+            t.join();
+
+        Clock::time_point finish = start;
+        std::uint64_t acks = 0, rejects = 0, executions = 0;
+        for (auto &s : stats)
+        {
+            finish = std::max(finish, s.last_ack);
+            acks += s.acks.load();
+            rejects += s.rejects.load();
+            executions += s.executions.load();
+        }
+        double elapsed = std::chrono::duration<double>(finish - start).count();
+        gateway.stop();
+
+        std::cout << "shared memory, clients " << cfg.clients << ", orders " << acks << " acknowledged (" << rejects
+                  << " rejected), executions " << executions << "\n"
+                  << "elapsed " << elapsed << " s, " << (acks / (elapsed > 0 ? elapsed : 1))
+                  << " orders/s through the gateway\n"
+                  << "gateway messages in " << gateway.messages_in() << ", out " << gateway.messages_out()
+                  << ", protocol errors " << gateway.protocol_errors() << "\n";
+        return 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Config cfg = parse_args(argc, argv);
+
+    MarketDataPublisher publisher;
+    ExecutionReportRouter reports;
+    MarketRegistry registry(publisher, &reports);
+    for (int m = 0; m < cfg.markets; ++m)
+        registry.create_market("SYM" + std::to_string(m), 0.01, static_cast<MarketID>(1 + m));
+    MatchingEngine engine(registry);
+    if (cfg.shm)
+        return run_shm(cfg, engine, reports);
+
+    TcpGatewayConfig config;
+    config.placement.cpu = cfg.pin;
+    config.backend = cfg.backend;
+    TcpGateway gateway(engine, reports, config);
+    gateway.start();
+
+    std::vector<int> fds;
+    std::vector<ClientStats> stats(cfg.clients);
+    for (int c = 0; c < cfg.clients; ++c)
+    {
+        int fd = connect_to(gateway.port());
+        auto login = make_message<LoginMessage>(MessageType::Login);
+        login.client_id = static_cast<ClientID>(1 + c);
+        send_all(fd, &login, sizeof(login));
+        LoginResponseMessage response;
+        if (::recv(fd, &response, sizeof(response), MSG_WAITALL) != sizeof(response) ||
+            response.status != LoginResponseMessage::Accepted)
+        {
+            std::cerr << "login failed for client " << login.client_id << "\n";
+            return 1;
+        }
+        fds.push_back(fd);
+    }
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int c = 0; c < cfg.clients; ++c)
+    {
+        threads.emplace_back(read_replies, fds[c], cfg.orders, std::ref(stats[c]));
+        threads.emplace_back(send_orders, fds[c], std::cref(cfg), c);
+    }
+    for (auto &t : threads)
+        t.join();
+
+    Clock::time_point finish = start;
+    std::uint64_t acks = 0, rejects = 0, executions = 0;
+    for (auto &s : stats)
+    {
+        finish = std::max(finish, s.last_ack);
+        acks += s.acks.load();
+        rejects += s.rejects.load();
+        executions += s.executions.load();
+    }
+    double elapsed = std::chrono::duration<double>(finish - start).count();
+
+    for (int fd : fds)
+        ::close(fd);
+    gateway.stop();
+
+    std::cout << (cfg.backend == GatewayBackend::IoUring ? "io_uring" : "epoll") << " backend, clients " << cfg.clients << ", orders " << acks << " acknowledged (" << rejects << " rejected)"
+              << ", executions " << executions << "\n"
+              << "elapsed " << elapsed << " s, " << (acks / (elapsed > 0 ? elapsed : 1)) << " orders/s through the gateway\n"
+              << "gateway messages in " << gateway.messages_in() << ", out " << gateway.messages_out()
+              << ", protocol errors " << gateway.protocol_errors() << "\n";
+    return 0;
+}
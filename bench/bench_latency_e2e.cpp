@@ -0,0 +1,308 @@
+// End-to-end latency harness: MatchingEngine -> market worker threads ->
+// MarketDataPublisher -> IMarketDataListener, all on the real threads and queues.
+//
+// A single submitter replays a synthetic flow open-loop at a fixed offered
+// rate. Every order has an intended send time on a fixed schedule and latency
+// is measured from that time, not from when submit_order was actually called,
+// so a stall in the engine shows up in the histogram instead of silently
+// delaying the following sends (coordinated omission).
+//
+// The flow per market alternates passive limit orders, which rest and build
+// depth, with aggressive IOC orders of one lot that cross the spread. Only
+// aggressors produce market data on arrival, so they are the measured orders:
+// latency = on_market_events() seeing the aggressor's Trade - intended send.
+//
+// Usage: mercury_latency [--rate=N] [--duration=S] [--warmup=S] [--markets=N]
+//                        [--aggressive=F] [--depth=N] [--json]
+//                        [--pin=CPU,CPU,...] [--fifo=PRIO] [--arena-mb=N]
+//                        [--capacity=ORDERS]
+//
+// --pin assigns cores in order to the submitter, the publisher and then each
+// market worker; --fifo additionally runs those threads SCHED_FIFO. Give each
+// FIFO thread its own core: the workers spin, and a FIFO spinner starves
+// anything else queued on its core. --arena-mb gives each market its own
+// huge-page arena of N MB. --capacity warms each market up for ORDERS orders
+// before the run (see MarketCapacity.hpp); orders stay in the market's order
+// map for the whole session, so size it for the orders a market receives.
+// It also gives each market market data buffers for 10 ms of its share of
+// --rate, beyond which the market waits for the publisher.
+//
+// Built with -DMERCEX_ENABLE_TIMING=ON it also breaks the run down per
+// engine stage (see StageTimer.hpp).
+#include "MatchingEngine.hpp"
+#include "MarketRegistry.hpp"
+#include "MarketDataPublisher.hpp"
+#include "IMarketDataListener.hpp"
+#include "LatencyHistogram.hpp"
+#include "StageTimer.hpp"
+#include "ThreadPlacement.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace MercEx;
+
+namespace
+{
+    struct Config
+    {
+        double rate = 100000;     // offered orders per second, all markets
+        double duration = 5.0;    // measured seconds
+        double warmup = 1.0;      // seconds sent but not recorded
+        int markets = 2;
+        double aggressive = 0.3;  // fraction of orders that cross
+        int depth = 5;            // passive price levels per side
+        bool json = false;
+        std::vector<int> pin;     // submitter, publisher, markets...
+        int fifo = 0;
+        std::size_t arena_mb = 0;
+        std::size_t capacity = 0; // warmed-up orders per market
+    };
+
+    Config parse_args(int argc, char **argv)
+    {
+        Config cfg;
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            auto value = [&](const char *key) -> const char *
+            {
+                std::size_t n = std::strlen(key);
+                return arg.compare(0, n, key) == 0 ? arg.c_str() + n : nullptr;
+            };
+            if (auto v = value("--rate="))
+                cfg.rate = std::atof(v);
+            else if (auto v = value("--duration="))
+                cfg.duration = std::atof(v);
+            else if (auto v = value("--warmup="))
+                cfg.warmup = std::atof(v);
+            else if (auto v = value("--markets="))
+                cfg.markets = std::atoi(v);
+            else if (auto v = value("--aggressive="))
+                cfg.aggressive = std::atof(v);
+            else if (auto v = value("--depth="))
+                cfg.depth = std::atoi(v);
+            else if (arg == "--json")
+                cfg.json = true;
+            else if (auto v = value("--pin="))
+            {
+                for (const char *p = v; *p;)
+                {
+                    cfg.pin.push_back(std::atoi(p));
+                    p = std::strchr(p, ',');
+                    if (!p)
+                        break;
+                    ++p;
+                }
+            }
+            else if (auto v = value("--fifo="))
+                cfg.fifo = std::atoi(v);
+            else if (auto v = value("--arena-mb="))
+                cfg.arena_mb = static_cast<std::size_t>(std::atoll(v));
+            else if (auto v = value("--capacity="))
+                cfg.capacity = static_cast<std::size_t>(std::atoll(v));
+            else
+            {
+                std::cerr << "unknown argument: " << arg << "\n";
+                std::exit(2);
+            }
+        }
+        return cfg;
+    }
+
+    // Intended send times indexed by market slot and the order's sequence
+    // number within its market. Written by the submitter before the order is
+    // submitted, read by the publisher thread after its Trade comes back.
+    struct SendSchedule
+    {
+        std::vector<std::vector<TimePoint>> intended;
+        std::vector<std::vector<std::uint8_t>> measured;
+        MarketID first_market_id = 1;
+    };
+
+    class TimestampingListener : public IMarketDataListener
+    {
+    public:
+        explicit TimestampingListener(const SendSchedule &schedule) : schedule_(schedule) {}
+
+        void on_market_events(const std::vector<MarketEvent> &events) override
+        {
+            auto now = Clock::now();
+            for (const auto &ev : events)
+            {
+                if (ev.type != MarketEventType::Trade)
+                    continue;
+                std::size_t market = OrderIdGenerator::market_of(ev.order_id) - schedule_.first_market_id;
+                std::size_t seq = ev.order_id & OrderIdGenerator::kSequenceMask;
+                if (market >= schedule_.measured.size() || seq >= schedule_.measured[market].size() ||
+                    !schedule_.measured[market][seq])
+                    continue;
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - schedule_.intended[market][seq]).count();
+                histogram.record(ns > 0 ? static_cast<std::uint64_t>(ns) : 0);
+                received.fetch_add(1, std::memory_order_release);
+            }
+        }
+
+        LatencyHistogram histogram;
+        std::atomic<std::uint64_t> received{0};
+
+    private:
+        const SendSchedule &schedule_;
+    };
+}
+
+int main(int argc, char **argv)
+{
+    Config cfg = parse_args(argc, argv);
+    constexpr double kTick = 0.01;
+    constexpr std::int64_t kMidTicks = 10000;
+
+    const auto total = static_cast<std::uint64_t>(cfg.rate * (cfg.warmup + cfg.duration));
+    const auto warmup_orders = static_cast<std::uint64_t>(cfg.rate * cfg.warmup);
+    const auto interval = std::chrono::nanoseconds(static_cast<std::int64_t>(1e9 / cfg.rate));
+
+    SendSchedule schedule;
+    schedule.intended.assign(cfg.markets, std::vector<TimePoint>(total / cfg.markets + 1));
+    schedule.measured.assign(cfg.markets, std::vector<std::uint8_t>(total / cfg.markets + 1, 0));
+
+    // Placement for the n-th thread in --pin order.
+    auto placement = [&cfg](std::size_t n)
+    {
+        ThreadPlacement p;
+        if (n < cfg.pin.size())
+        {
+            p.cpu = cfg.pin[n];
+            p.realtime_priority = cfg.fifo;
+        }
+        return p;
+    };
+    apply_thread_placement(placement(0), "mx-submitter");
+
+    MarketDataPublisher publisher(ExecutionMode::Threaded, placement(1));
+    TimestampingListener listener(schedule);
+    publisher.subscribe(&listener);
+
+    MarketRegistry registry(publisher);
+    std::vector<std::string> symbols;
+    MarketCapacity capacity;
+    if (cfg.capacity)
+    {
+        capacity.orders = cfg.capacity;
+        capacity.price_levels = 4 * static_cast<std::size_t>(cfg.depth) + 64;
+        capacity.event_batches = std::max<std::size_t>(capacity.event_batches,
+                                                       static_cast<std::size_t>(cfg.rate / cfg.markets / 100));
+    }
+    for (int m = 0; m < cfg.markets; ++m)
+    {
+        symbols.push_back("SYM" + std::to_string(m));
+        registry.create_market(symbols.back(), kTick, static_cast<MarketID>(schedule.first_market_id + m),
+                               placement(2 + m), ArenaConfig{cfg.arena_mb << 20}, capacity);
+    }
+    MatchingEngine engine(registry);
+
+    // Deterministic flow: the aggressive/passive decision uses an error
+    // accumulator so the mix is exact over any window, not just on average.
+    double aggressive_credit = 0;
+    std::vector<std::uint64_t> per_market_count(cfg.markets, 0);
+    std::uint64_t sent_measured = 0;
+    std::uint64_t late_sends = 0;
+
+    auto start = Clock::now() + std::chrono::milliseconds(10);
+    for (std::uint64_t i = 0; i < total; ++i)
+    {
+        int m = static_cast<int>(i % cfg.markets);
+        std::uint64_t seq = per_market_count[m]++;
+        bool buy = (seq / 2) % 2 == 0;
+
+        OrderRequest req{};
+        req.client_id = 1;
+        req.symbol = symbols[m];
+        req.side = buy ? Side::Buy : Side::Sell;
+
+        aggressive_credit += cfg.aggressive;
+        bool aggressive = aggressive_credit >= 1.0;
+        if (aggressive)
+        {
+            aggressive_credit -= 1.0;
+            req.quantity = 1;
+            req.type = OrderType::Limit;
+            req.tif = TimeInForce::IOC;
+            req.price = (kMidTicks + (buy ? cfg.depth : -cfg.depth)) * kTick;
+        }
+        else
+        {
+            std::int64_t level = 1 + static_cast<std::int64_t>(seq % cfg.depth);
+            req.quantity = 10;
+            req.type = OrderType::Limit;
+            req.tif = TimeInForce::GTC;
+            req.price = (kMidTicks + (buy ? -level : level)) * kTick;
+        }
+
+        OrderID id = engine.reserve_order_ids(req.symbol, req.client_id, 1).take();
+        std::size_t slot = id & OrderIdGenerator::kSequenceMask;
+
+        auto intended = start + interval * static_cast<std::int64_t>(i);
+        schedule.intended[m][slot] = intended;
+        if (aggressive && i >= warmup_orders)
+        {
+            schedule.measured[m][slot] = 1;
+            ++sent_measured;
+        }
+
+        auto now = Clock::now();
+        if (now < intended)
+        {
+            while (Clock::now() < intended)
+                ;
+        }
+        else if (now - intended > interval)
+        {
+            ++late_sends;
+        }
+
+        engine.submit_order(id, req);
+    }
+    auto send_end = Clock::now();
+
+    // Aggressors that found no resting liquidity produce no Trade; wait for
+    // the pipeline to drain, then report what arrived.
+    auto deadline = Clock::now() + std::chrono::seconds(2);
+    while (listener.received.load(std::memory_order_acquire) < sent_measured && Clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    double elapsed = std::chrono::duration<double>(send_end - start).count();
+    if (cfg.json)
+    {
+        std::cout << "{\"offered_rate\":" << cfg.rate
+                  << ",\"achieved_rate\":" << total / elapsed
+                  << ",\"orders\":" << total
+                  << ",\"measured_sent\":" << sent_measured
+                  << ",\"late_sends\":" << late_sends
+                  << ",\"latency_ns\":";
+        listener.histogram.print_json(std::cout);
+        if (StageTimings::enabled)
+        {
+            std::cout << ",\"stage_timing\":";
+            StageTimings::print_json(std::cout);
+        }
+        std::cout << "}\n";
+    }
+    else
+    {
+        std::cout << "offered " << cfg.rate << " orders/s, achieved " << total / elapsed
+                  << " orders/s over " << cfg.markets << " markets\n"
+                  << "orders sent " << total << ", measured aggressors " << sent_measured
+                  << ", trades received " << listener.received.load() << ", late sends " << late_sends << "\n";
+        listener.histogram.print_summary(std::cout, "submit->publish");
+        if (StageTimings::enabled)
+            StageTimings::print_summary(std::cout);
+    }
+    return 0;
+}
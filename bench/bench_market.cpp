@@ -0,0 +1,266 @@
+// Microbenchmarks for the Market matching kernels. Every case drives
+// Market::process_order / Market::cancel_order directly on the calling thread
+// and reports ns/op plus heap allocations/op.
+#include "Market.hpp"
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace
+{
+    std::atomic<std::uint64_t> g_allocations{0};
+
+    // Every replaced operator new and delete goes through this pair, so each
+    // allocation is counted and released by the function matching the one
+    // that made it. Kept out of line: once a delete was inlined into its
+    // caller, g++ saw free() applied to operator new's result and warned.
+    __attribute__((noinline)) void *counted_alloc(std::size_t size, std::size_t align)
+    {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        size = size ? size : 1;
+        void *p = align > alignof(std::max_align_t) ? std::aligned_alloc(align, (size + align - 1) / align * align)
+                                                    : std::malloc(size);
+        if (!p)
+            throw std::bad_alloc();
+        return p;
+    }
+
+    __attribute__((noinline)) void counted_free(void *p) noexcept { std::free(p); }
+}
+
+void *operator new(std::size_t size) { return counted_alloc(size, 0); }
+void *operator new[](std::size_t size) { return counted_alloc(size, 0); }
+void *operator new(std::size_t size, std::align_val_t al) { return counted_alloc(size, static_cast<std::size_t>(al)); }
+void *operator new[](std::size_t size, std::align_val_t al) { return counted_alloc(size, static_cast<std::size_t>(al)); }
+void operator delete(void *p) noexcept { counted_free(p); }
+void operator delete[](void *p) noexcept { counted_free(p); }
+void operator delete(void *p, std::size_t) noexcept { counted_free(p); }
+void operator delete[](void *p, std::size_t) noexcept { counted_free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { counted_free(p); }
+
+using namespace MercEx;
+
+namespace
+{
+    constexpr double kTick = 0.01;
+    constexpr std::int64_t kMidTicks = 10000; // 100.00
+
+    Price px(std::int64_t ticks) { return static_cast<double>(ticks) / 100.0; }
+
+    // Owns the Order objects the book points at. Orders are created up front
+    // and recycled so the timed region only sees the matching kernel's own
+    // allocations.
+    class OrderPool
+    {
+    public:
+        explicit OrderPool(std::size_t n)
+        {
+            orders_.reserve(n);
+            for (std::size_t i = 0; i < n; ++i)
+                orders_.push_back(Order::make_order(i + 1, 1, "BENCH", 1, 1.0, std::nullopt,
+                                                    Side::Buy, OrderType::Limit, TimeInForce::GTC));
+        }
+
+        Order &limit(std::size_t i, Side side, Price price, Quantity qty, TimeInForce tif = TimeInForce::GTC)
+        {
+            Order &o = *orders_[i];
+            o.side = side;
+            o.type = OrderType::Limit;
+            o.tif = tif;
+            o.price = price;
+            o.quantity = qty;
+            o.remaining = qty;
+            o.status = OrderStatus::New;
+            o.book_it = {};
+            return o;
+        }
+
+        Order &market(std::size_t i, Side side, Quantity qty)
+        {
+            Order &o = limit(i, side, 0, qty, TimeInForce::IOC);
+            o.type = OrderType::Market;
+            o.price = std::nullopt;
+            return o;
+        }
+
+        Order &at(std::size_t i) { return *orders_[i]; }
+
+    private:
+        std::vector<std::unique_ptr<Order>> orders_;
+    };
+
+    // Rests `levels` sell levels of `per_level` orders each, starting one tick
+    // above mid. Uses pool slots [first, first + levels * per_level).
+    void build_asks(Market &m, OrderPool &pool, std::size_t first, int levels, int per_level, Quantity qty)
+    {
+        std::size_t slot = first;
+        for (int l = 0; l < levels; ++l)
+            for (int k = 0; k < per_level; ++k)
+                m.process_order(pool.limit(slot++, Side::Sell, px(kMidTicks + 1 + l), qty));
+    }
+
+    void build_bids(Market &m, OrderPool &pool, std::size_t first, int levels, int per_level, Quantity qty)
+    {
+        std::size_t slot = first;
+        for (int l = 0; l < levels; ++l)
+            for (int k = 0; k < per_level; ++k)
+                m.process_order(pool.limit(slot++, Side::Buy, px(kMidTicks - l), qty));
+    }
+
+    void report(benchmark::State &state, std::uint64_t allocs_before)
+    {
+        state.counters["allocs/op"] = benchmark::Counter(
+            static_cast<double>(g_allocations.load(std::memory_order_relaxed) - allocs_before),
+            benchmark::Counter::kAvgIterations);
+        state.SetItemsProcessed(state.iterations());
+    }
+}
+
+// Passive limit buys landing on an existing book of `depth` levels per side.
+// Prices cycle through the bid levels; every kBatch adds the new orders are
+// cancelled outside the timed region.
+static void BM_PassiveAdd(benchmark::State &state)
+{
+    const int depth = static_cast<int>(state.range(0));
+    constexpr std::size_t kBatch = 1024;
+
+    Market market("BENCH", kTick);
+    OrderPool pool(2 * depth + kBatch);
+    build_bids(market, pool, 0, depth, 1, 100);
+    build_asks(market, pool, depth, depth, 1, 100);
+
+    const std::size_t base = 2 * depth;
+    std::size_t n = 0;
+    std::uint64_t allocs = g_allocations.load(std::memory_order_relaxed);
+    for (auto _ : state)
+    {
+        auto events = market.process_order(pool.limit(base + n, Side::Buy, px(kMidTicks - static_cast<int>(n % depth)), 10));
+        benchmark::DoNotOptimize(events);
+        if (++n == kBatch)
+        {
+            state.PauseTiming();
+            std::uint64_t paused = g_allocations.load(std::memory_order_relaxed);
+            for (std::size_t i = 0; i < kBatch; ++i)
+                market.cancel_order(&pool.at(base + i));
+            n = 0;
+            allocs += g_allocations.load(std::memory_order_relaxed) - paused;
+            state.ResumeTiming();
+        }
+    }
+    report(state, allocs);
+}
+BENCHMARK(BM_PassiveAdd)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+
+// One aggressive limit buy sweeping `levels` ask levels of one order each.
+// The swept levels are rebuilt outside the timed region.
+static void BM_AggressiveSweep(benchmark::State &state)
+{
+    const int levels = static_cast<int>(state.range(0));
+    constexpr Quantity kQty = 10;
+
+    Market market("BENCH", kTick);
+    OrderPool pool(levels + 1);
+
+    std::uint64_t allocs = g_allocations.load(std::memory_order_relaxed);
+    std::uint64_t excluded = 0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        std::uint64_t paused = g_allocations.load(std::memory_order_relaxed);
+        build_asks(market, pool, 1, levels, 1, kQty);
+        Order &aggressor = pool.limit(0, Side::Buy, px(kMidTicks + levels), kQty * levels, TimeInForce::IOC);
+        excluded += g_allocations.load(std::memory_order_relaxed) - paused;
+        state.ResumeTiming();
+
+        auto events = market.process_order(aggressor);
+        benchmark::DoNotOptimize(events);
+    }
+    report(state, allocs + excluded);
+}
+BENCHMARK(BM_AggressiveSweep)->Arg(1)->Arg(5)->Arg(20)->Arg(100);
+
+// Steady-state churn: every iteration adds a passive order and cancels the
+// oldest resting one, keeping `resting` orders spread over 50 bid levels.
+static void BM_CancelHeavy(benchmark::State &state)
+{
+    const std::size_t resting = static_cast<std::size_t>(state.range(0));
+    constexpr int kLevels = 50;
+
+    Market market("BENCH", kTick);
+    OrderPool pool(resting + 1);
+    for (std::size_t i = 0; i < resting; ++i)
+        market.process_order(pool.limit(i, Side::Buy, px(kMidTicks - static_cast<int>(i % kLevels)), 10));
+
+    std::size_t oldest = 0;
+    std::size_t next = resting;
+    std::uint64_t allocs = g_allocations.load(std::memory_order_relaxed);
+    for (auto _ : state)
+    {
+        market.cancel_order(&pool.at(oldest));
+        auto events = market.process_order(pool.limit(next, Side::Buy, px(kMidTicks - static_cast<int>(next % kLevels)), 10));
+        benchmark::DoNotOptimize(events);
+        oldest = (oldest + 1) % (resting + 1);
+        next = (next + 1) % (resting + 1);
+    }
+    report(state, allocs);
+}
+BENCHMARK(BM_CancelHeavy)->Arg(100)->Arg(10000);
+
+// FOK buy for more than the book holds within its limit: the fulfilment check
+// walks `levels` ask levels of 4 orders each and the order is killed, so the
+// book is unchanged between iterations.
+static void BM_FokAtDepth(benchmark::State &state)
+{
+    const int levels = static_cast<int>(state.range(0));
+
+    Market market("BENCH", kTick);
+    OrderPool pool(4 * levels + 1);
+    build_asks(market, pool, 1, levels, 4, 10);
+
+    std::uint64_t allocs = g_allocations.load(std::memory_order_relaxed);
+    for (auto _ : state)
+    {
+        Order &fok = pool.limit(0, Side::Buy, px(kMidTicks + levels), 40 * levels + 1, TimeInForce::FOK);
+        auto events = market.process_order(fok);
+        benchmark::DoNotOptimize(events);
+    }
+    report(state, allocs);
+}
+BENCHMARK(BM_FokAtDepth)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+
+// Market buy into a thin book of `levels` single-order ask levels, taking the
+// whole book. The book is rebuilt outside the timed region.
+static void BM_MarketOrderThinBook(benchmark::State &state)
+{
+    const int levels = static_cast<int>(state.range(0));
+    constexpr Quantity kQty = 5;
+
+    Market market("BENCH", kTick);
+    OrderPool pool(levels + 1);
+
+    std::uint64_t allocs = g_allocations.load(std::memory_order_relaxed);
+    std::uint64_t excluded = 0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        std::uint64_t paused = g_allocations.load(std::memory_order_relaxed);
+        build_asks(market, pool, 1, levels, 1, kQty);
+        Order &aggressor = pool.market(0, Side::Buy, kQty * levels);
+        excluded += g_allocations.load(std::memory_order_relaxed) - paused;
+        state.ResumeTiming();
+
+        auto events = market.process_order(aggressor);
+        benchmark::DoNotOptimize(events);
+    }
+    report(state, allocs + excluded);
+}
+BENCHMARK(BM_MarketOrderThinBook)->Arg(1)->Arg(3)->Arg(10);
+
+BENCHMARK_MAIN();
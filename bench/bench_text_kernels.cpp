@@ -0,0 +1,230 @@
+// Microbenchmarks for the text kernels (TextKernels.hpp): every case runs at
+// each SIMD level the CPU supports, so the scalar row is the baseline the
+// SSE4.2 and AVX2 rows are read against. The last cases time whole FIX and
+// CSV records turned into order fields.
+#include "TextKernels.hpp"
+#include "FixProtocol.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace MercEx;
+
+namespace
+{
+    // Sets the level named by the benchmark's argument; false (and the run
+    // is skipped) when the CPU does not have it.
+    bool use_level(benchmark::State &state)
+    {
+        auto level = static_cast<SimdLevel>(state.range(0));
+        if (static_cast<int>(level) > static_cast<int>(detected_simd_level()))
+        {
+            state.SkipWithError("SIMD level not supported by this CPU");
+            return false;
+        }
+        set_simd_level(level);
+        state.SetLabel(simd_level_name(level));
+        return true;
+    }
+
+    std::string fix_new_order()
+    {
+        FixWriter w;
+        w.begin("D");
+        w.raw("49=CLIENT1\x01"
+              "56=MERCURY\x01");
+        w.field(FixTag::MsgSeqNum, std::uint64_t(123456));
+        w.field(FixTag::SendingTime, std::string_view("20260101-12:34:56.789"));
+        w.field(FixTag::ClOrdID, std::string_view("ORD-000000123456"));
+        w.field(FixTag::Symbol, std::string_view("AAPL"));
+        w.field(FixTag::Side, '1');
+        w.field(FixTag::OrderQty, 2500);
+        w.field(FixTag::OrdType, '2');
+        w.price(FixTag::Price, 187.35);
+        w.field(FixTag::TimeInForce, '0');
+        w.field(FixTag::TransactTime, std::string_view("20260101-12:34:56.789"));
+        return std::string(w.finish());
+    }
+
+    // Numbers of every width a protocol carries: quantities, IDs, sequence
+    // numbers, nanosecond timestamps.
+    std::vector<std::string> numbers()
+    {
+        std::mt19937_64 rng(42);
+        std::vector<std::string> out;
+        for (int i = 0; i < 1024; ++i)
+        {
+            int width = 1 + static_cast<int>(rng() % 19);
+            std::string s(1, static_cast<char>('1' + rng() % 9));
+            while (static_cast<int>(s.size()) < width)
+                s += static_cast<char>('0' + rng() % 10);
+            out.push_back(s);
+        }
+        return out;
+    }
+
+    std::vector<std::string> prices()
+    {
+        std::mt19937_64 rng(7);
+        std::vector<std::string> out;
+        for (int i = 0; i < 1024; ++i)
+        {
+            std::string s = std::to_string(1 + rng() % 5000);
+            if (rng() % 4)
+                s += "." + std::to_string(rng() % 100 + 100).substr(1);
+            out.push_back(s);
+        }
+        return out;
+    }
+}
+
+static void BM_ScanByte(benchmark::State &state)
+{
+    if (!use_level(state))
+        return;
+    std::string line(static_cast<std::size_t>(state.range(1)), 'x');
+    line.back() = kSoh;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(line);
+        benchmark::DoNotOptimize(scan_byte(line.data(), line.data() + line.size(), kSoh));
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * line.size()));
+}
+BENCHMARK(BM_ScanByte)->ArgNames({"simd", "bytes"})->ArgsProduct({{0, 1, 2}, {16, 64, 256}});
+
+static void BM_ScanAnyCsv(benchmark::State &state)
+{
+    if (!use_level(state))
+        return;
+    std::string line(256, 'x');
+    line.back() = '\n';
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(line);
+        benchmark::DoNotOptimize(scan_any(line.data(), line.data() + line.size(), ",\r\n"));
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * line.size()));
+}
+BENCHMARK(BM_ScanAnyCsv)->ArgName("simd")->DenseRange(0, 2);
+
+static void BM_IndexSoh(benchmark::State &state)
+{
+    if (!use_level(state))
+        return;
+    std::string msg = fix_new_order();
+    std::uint32_t offsets[FixMessage::kMaxFields];
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(msg);
+        benchmark::DoNotOptimize(index_byte(msg.data(), msg.size(), kSoh, offsets, FixMessage::kMaxFields));
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * msg.size()));
+}
+BENCHMARK(BM_IndexSoh)->ArgName("simd")->DenseRange(0, 2);
+
+static void BM_Checksum(benchmark::State &state)
+{
+    if (!use_level(state))
+        return;
+    std::string msg = fix_new_order();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(msg);
+        benchmark::DoNotOptimize(text_checksum(msg.data(), msg.size()));
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * msg.size()));
+}
+BENCHMARK(BM_Checksum)->ArgName("simd")->DenseRange(0, 2);
+
+static void BM_ParseDigits(benchmark::State &state)
+{
+    if (!use_level(state))
+        return;
+    auto values = numbers();
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        const std::string &s = values[i++ & 1023];
+        std::uint64_t v;
+        benchmark::DoNotOptimize(parse_digits(s.data(), s.size(), v));
+        benchmark::DoNotOptimize(v);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+}
+BENCHMARK(BM_ParseDigits)->ArgName("simd")->DenseRange(0, 2);
+
+static void BM_ParseDecimal(benchmark::State &state)
+{
+    if (!use_level(state))
+        return;
+    auto values = prices();
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        const std::string &s = values[i++ & 1023];
+        Decimal d;
+        benchmark::DoNotOptimize(parse_decimal(s.data(), s.size(), d));
+        benchmark::DoNotOptimize(d);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+}
+BENCHMARK(BM_ParseDecimal)->ArgName("simd")->DenseRange(0, 2);
+
+// A whole NewOrderSingle: framing, checksum, field index, then the order
+// fields converted the way FixGateway does it.
+static void BM_FixNewOrder(benchmark::State &state)
+{
+    if (!use_level(state))
+        return;
+    std::string msg = fix_new_order();
+    FixMessage parsed;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(msg);
+        FixParseResult r = fix_parse(msg.data(), msg.size(), parsed);
+        std::int64_t qty = 0;
+        double price = 0.0;
+        fix_to_int(parsed.get(FixTag::OrderQty), qty);
+        fix_to_price(parsed.get(FixTag::Price), price);
+        benchmark::DoNotOptimize(r);
+        benchmark::DoNotOptimize(qty);
+        benchmark::DoNotOptimize(price);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * msg.size()));
+}
+BENCHMARK(BM_FixNewOrder)->ArgName("simd")->DenseRange(0, 2);
+
+// One "symbol,side,quantity,price,client" line of a CSV order file.
+static void BM_CsvOrderLine(benchmark::State &state)
+{
+    if (!use_level(state))
+        return;
+    const std::string line = "AAPL,B,2500,187.35,1001\n";
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(line);
+        const char *p = line.data(), *end = line.data() + line.size();
+        const char *comma = scan_any(p, end, ",\n");
+        std::string_view symbol(p, static_cast<std::size_t>(comma - p));
+        char side = comma[1];
+        std::uint64_t qty = 0, client = 0;
+        p = parse_uint_prefix(comma + 3, end, qty);
+        comma = scan_any(p + 1, end, ",\n");
+        Decimal price;
+        parse_decimal(p + 1, static_cast<std::size_t>(comma - p - 1), price);
+        parse_uint_prefix(comma + 1, end, client);
+        benchmark::DoNotOptimize(symbol);
+        benchmark::DoNotOptimize(side);
+        benchmark::DoNotOptimize(qty);
+        benchmark::DoNotOptimize(price);
+        benchmark::DoNotOptimize(client);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+}
+BENCHMARK(BM_CsvOrderLine)->ArgName("simd")->DenseRange(0, 2);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include "concurrentqueue.h"
+
+#ifndef MERCEX_ALLOC_GUARD
+#define MERCEX_ALLOC_GUARD 0
+#endif
+
+namespace MercEx
+{
+
+    // Debug check that a thread's steady state does not allocate. Built with
+    // MERCEX_ALLOC_GUARD, the global operator new and the engine's queue
+    // allocator abort the process when called on an armed thread outside a
+    // Permit. Market workers arm themselves after warm-up. Without the build
+    // flag every call here is a no-op.
+    class AllocationGuard
+    {
+    public:
+        static constexpr bool enabled = MERCEX_ALLOC_GUARD != 0;
+
+        static void arm() noexcept;
+        static void disarm() noexcept;
+        static bool armed() noexcept;
+
+        // Called by allocation paths; aborts if the calling thread is armed.
+        static void check(std::size_t bytes) noexcept;
+
+        // Allows allocation on the current thread for its lifetime, for cold
+        // paths that may legitimately allocate after warm-up.
+        class Permit
+        {
+        public:
+            Permit() noexcept;
+            ~Permit();
+
+            Permit(const Permit &) = delete;
+            Permit &operator=(const Permit &) = delete;
+        };
+    };
+
+    // moodycamel traits for the engine's queues: block and producer
+    // allocations go through the guard like operator new does, and blocks
+    // a queue grew during warm-up are kept on its free list once emptied
+    // rather than freed, so the steady state reuses them.
+    struct GuardedQueueTraits : moodycamel::ConcurrentQueueDefaultTraits
+    {
+        static const bool RECYCLE_ALLOCATED_BLOCKS = true;
+
+        static inline void *malloc(std::size_t size)
+        {
+            AllocationGuard::check(size);
+            return std::malloc(size);
+        }
+        static inline void free(void *ptr) { std::free(ptr); }
+    };
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "BinaryProtocol.hpp"
+#include "MatchingEngine.hpp"
+
+namespace MercEx
+{
+
+    // The engine side of binary-protocol requests, shared by the gateways that
+    // speak it (TcpGateway, ShmOrderGateway). Each takes a message whose type
+    // and length the caller has checked and acts on it for client_id.
+    //
+    // Every order is answered by its OrderAck. A cancel or modify the engine
+    // takes is answered by the market, through the client's report channel;
+    // one it cannot route is answered here with a CancelRejected or
+    // ReplaceRejected report.
+
+    OrderAckMessage submit_new_order(MatchingEngine &engine, ClientID client_id, const NewOrderMessage &msg);
+
+    // False when the request was refused; reject then holds the report owed.
+    bool submit_cancel(MatchingEngine &engine, ClientID client_id, const CancelMessage &msg,
+                       ExecutionMessage &reject);
+    bool submit_modify(MatchingEngine &engine, ClientID client_id, const ModifyMessage &msg,
+                       ExecutionMessage &reject);
+
+}
@@ -0,0 +1,219 @@
+#pragma once
+#include "Order.hpp"
+#include "ExecutionReport.hpp"
+#include "RejectReason.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace MercEx
+{
+
+    // Binary order-entry protocol spoken by TcpGateway.
+    //
+    // Every message is a fixed-layout struct that starts with a MessageHeader,
+    // in host byte order (little-endian on every supported target). A message's
+    // length must be exactly the size of its type. Fields are laid out at
+    // their natural alignment, but the structs are packed so that a message
+    // can be used in place wherever it lands in a receive buffer: the gateway
+    // parses by pointing at the buffer, never by copying fields out.
+    //
+    // A session starts with Login; orders, cancels and modifies before it
+    // close the connection, as does any malformed message.
+
+    enum class MessageType : std::uint8_t
+    {
+        // client -> gateway
+        Login = 'L',
+        NewOrder = 'N',
+        Cancel = 'C',
+        Modify = 'M',
+        // gateway -> client
+        LoginResponse = 'l',
+        OrderAck = 'a',
+        Execution = 'e'
+    };
+
+#pragma pack(push, 1)
+
+    struct MessageHeader
+    {
+        std::uint16_t length; // whole message, header included
+        MessageType type;
+        std::uint8_t version;
+    };
+
+    inline constexpr std::uint8_t kProtocolVersion = 2;
+
+    struct LoginMessage
+    {
+        MessageHeader header;
+        ClientID client_id; // must not be 0
+    };
+
+    // order_type takes every OrderType. An Iceberg carries its display
+    // quantity in display_qty (0 for every other type); a Pegged order sets
+    // kHasPeg and carries its reference and offset in peg_reference and
+    // peg_offset.
+    struct NewOrderMessage
+    {
+        static constexpr std::uint8_t kHasPrice = 0x1;
+        static constexpr std::uint8_t kHasStopPrice = 0x2;
+        static constexpr std::uint8_t kHasPeg = 0x8;
+
+        MessageHeader header;
+        MarketID market_id;
+        Side side;
+        OrderType order_type;
+        TimeInForce tif;
+        std::uint8_t flags;
+        PegReference peg_reference;
+        std::uint8_t reserved;
+        Quantity quantity;
+        std::uint64_t client_ref; // echoed in the OrderAck
+        Price price;
+        Price stop_price;
+        Quantity display_qty;
+        std::uint32_t reserved2;
+        Price peg_offset;
+    };
+
+    struct CancelMessage
+    {
+        MessageHeader header;
+        MarketID market_id;
+        std::uint16_t reserved;
+        OrderID order_id;
+    };
+
+    // Cancel/replace of an open order: quantity is its new order quantity,
+    // fills included, and price its new limit when kHasPrice is set. Answered
+    // by a Replaced or ReplaceRejected execution.
+    struct ModifyMessage
+    {
+        static constexpr std::uint8_t kHasPrice = 0x1;
+
+        MessageHeader header;
+        MarketID market_id;
+        std::uint8_t flags;
+        std::uint8_t reserved;
+        Quantity quantity;
+        std::uint32_t reserved2;
+        OrderID order_id;
+        Price price;
+    };
+
+    struct LoginResponseMessage
+    {
+        enum Status : std::uint8_t
+        {
+            Accepted = 0,
+            InvalidClient = 1, // client 0 or beyond the router's capacity
+            AlreadyLoggedIn = 2
+        };
+
+        MessageHeader header;
+        Status status;
+        std::uint8_t reserved[3];
+    };
+
+    // Sent as soon as an order is handed to the engine: tells the client which
+    // order ID stands for its client_ref. reason is set when the gateway could
+    // not submit at all (unknown market); engine-side outcomes, rejects
+    // included, follow as Execution messages.
+    struct OrderAckMessage
+    {
+        MessageHeader header;
+        MarketID market_id;
+        RejectReason reason;
+        std::uint8_t reserved;
+        std::uint64_t client_ref;
+        OrderID order_id;
+    };
+
+    struct ExecutionMessage
+    {
+        MessageHeader header;
+        ExecType exec_type;
+        RejectReason reason;
+        Side side;
+        std::uint8_t reserved;
+        MarketID market_id;
+        std::uint16_t reserved2;
+        ClientID client_id;
+        OrderID order_id;
+        OrderID counterparty_id;
+        Quantity last_qty;
+        Quantity leaves_qty;
+        Price last_price;
+        std::int64_t timestamp_ns;
+    };
+
+#pragma pack(pop)
+
+    static_assert(sizeof(MessageHeader) == 4, "MessageHeader must stay 4 bytes");
+    static_assert(sizeof(LoginMessage) == 8, "LoginMessage must stay 8 bytes");
+    static_assert(sizeof(NewOrderMessage) == 56, "NewOrderMessage must stay 56 bytes");
+    static_assert(sizeof(CancelMessage) == 16, "CancelMessage must stay 16 bytes");
+    static_assert(sizeof(ModifyMessage) == 32, "ModifyMessage must stay 32 bytes");
+    static_assert(sizeof(LoginResponseMessage) == 8, "LoginResponseMessage must stay 8 bytes");
+    static_assert(sizeof(OrderAckMessage) == 24, "OrderAckMessage must stay 24 bytes");
+    static_assert(sizeof(ExecutionMessage) == 56, "ExecutionMessage must stay 56 bytes");
+    static_assert(alignof(NewOrderMessage) == 1, "wire messages must be usable at any offset");
+
+    // Largest message either side sends; receive buffers hold at least one.
+    inline constexpr std::size_t kMaxMessageSize = sizeof(ExecutionMessage);
+
+    // Length of the message type on the wire, or 0 for an unknown type.
+    inline constexpr std::size_t message_size(MessageType type)
+    {
+        switch (type)
+        {
+        case MessageType::Login:
+            return sizeof(LoginMessage);
+        case MessageType::NewOrder:
+            return sizeof(NewOrderMessage);
+        case MessageType::Cancel:
+            return sizeof(CancelMessage);
+        case MessageType::Modify:
+            return sizeof(ModifyMessage);
+        case MessageType::LoginResponse:
+            return sizeof(LoginResponseMessage);
+        case MessageType::OrderAck:
+            return sizeof(OrderAckMessage);
+        case MessageType::Execution:
+            return sizeof(ExecutionMessage);
+        }
+        return 0;
+    }
+
+    // Returns a zeroed message of type T with its header filled in.
+    template <typename T>
+    T make_message(MessageType type)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "wire messages must be trivially copyable");
+        T msg{};
+        msg.header.length = static_cast<std::uint16_t>(sizeof(T));
+        msg.header.type = type;
+        msg.header.version = kProtocolVersion;
+        return msg;
+    }
+
+    inline void encode(const ExecutionReport &report, ExecutionMessage &msg)
+    {
+        msg = make_message<ExecutionMessage>(MessageType::Execution);
+        msg.exec_type = report.type;
+        msg.reason = report.reason;
+        msg.side = report.side;
+        msg.market_id = report.market_id;
+        msg.client_id = report.client_id;
+        msg.order_id = report.order_id;
+        msg.counterparty_id = report.counterparty_id;
+        msg.last_qty = report.last_qty;
+        msg.leaves_qty = report.leaves_qty;
+        msg.last_price = report.last_price;
+        msg.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(report.timestamp.time_since_epoch()).count();
+    }
+
+}
@@ -2,22 +2,27 @@
 #pragma once
 #include <cstdint>
 #include <map>
+#include <memory_resource>
 #include <list>
 #include <optional>
 #include <functional>
-#include "order.hpp"
+#include "Order.hpp"
+#include "PriceLevel.hpp"
 
 namespace MercEx {
 
     class BuyBook {
     public:
-        BuyBook() = default;
+        using Levels = std::pmr::map<Price, PriceLevel, std::greater<>>;
 
-        std::list<Order*>::iterator add_order(Order& order);
-        bool cancel_order(OrderID id, Price price, std::list<Order*>::iterator it);
+        explicit BuyBook(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : orders_(resource) {}
 
-        std::map<Price, std::list<Order*>, std::greater<>>& get_orders() { return orders_; }
-        const std::map<Price, std::list<Order*>, std::greater<>>& get_orders() const { return orders_; }
+        OrderList::iterator add_order(Order& order);
+        bool cancel_order(OrderID id, Price price, OrderList::iterator it);
+
+        Levels& get_orders() { return orders_; }
+        const Levels& get_orders() const { return orders_; }
 
         std::optional<std::reference_wrapper<Order>> get_best_order();
         std::optional<Price> get_best_bid() const;
@@ -26,7 +31,7 @@ namespace MercEx {
         std::size_t size() const;
 
     private:
-        std::map<Price, std::list<Order*>, std::greater<>> orders_;
+        Levels orders_;
     };
 
 } // namespace MercEx
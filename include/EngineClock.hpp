@@ -0,0 +1,47 @@
+#pragma once
+#include "Order.hpp"
+#include <atomic>
+
+namespace MercEx
+{
+
+    class ClockSource
+    {
+    public:
+        virtual ~ClockSource() = default;
+        virtual TimePoint now() const = 0;
+    };
+
+    // Clock driven by the caller, e.g. a replay that sets it to each recorded
+    // order's original timestamp before submitting it.
+    class ManualClock : public ClockSource
+    {
+    public:
+        TimePoint now() const override { return now_; }
+        void set(TimePoint t) { now_ = t; }
+        void advance(Clock::duration d) { now_ += d; }
+
+    private:
+        TimePoint now_{};
+    };
+
+    // Every timestamp the engine stamps on orders, events and reports comes
+    // from here. With no source installed it is steady_clock; installing a
+    // ManualClock makes the engine's output independent of wall time.
+    class EngineClock
+    {
+    public:
+        static TimePoint now()
+        {
+            const ClockSource *source = source_.load(std::memory_order_relaxed);
+            return source ? source->now() : Clock::now();
+        }
+
+        // Install before the engine starts; pass nullptr to restore steady_clock.
+        static void set_source(const ClockSource *source) { source_.store(source, std::memory_order_relaxed); }
+
+    private:
+        static inline std::atomic<const ClockSource *> source_{nullptr};
+    };
+
+}
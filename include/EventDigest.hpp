@@ -0,0 +1,42 @@
+#pragma once
+#include "IMarketDataListener.hpp"
+#include <cstdint>
+
+namespace MercEx
+{
+
+    // Listener folding every field of every published event, in delivery
+    // order, into a 64-bit FNV-1a digest. Two runs produced the same event
+    // stream exactly when their digests and counts match, which makes it a
+    // cheap regression check for deterministic (inline, manual clock) replays.
+    class EventDigest : public IMarketDataListener
+    {
+    public:
+        void on_market_events(const std::vector<MarketEvent> &events) override;
+
+        std::uint64_t digest() const { return hash_; }
+        std::uint64_t event_count() const { return count_; }
+
+    private:
+        void mix(const void *data, std::size_t size);
+        template <typename T>
+        void mix(const T &value) { mix(&value, sizeof(value)); }
+        // Member by member: Peg has padding after its reference.
+        void mix(const Peg &peg)
+        {
+            mix(peg.reference);
+            mix(peg.offset);
+        }
+        template <typename T>
+        void mix(const std::optional<T> &value)
+        {
+            mix(value.has_value());
+            if (value)
+                mix(*value);
+        }
+
+        std::uint64_t hash_ = 14695981039346656037ULL;
+        std::uint64_t count_ = 0;
+    };
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+
+namespace MercEx
+{
+
+    enum class ExecutionMode : std::uint8_t
+    {
+        // Each market and the publisher run on their own thread behind a queue.
+        Threaded,
+        // No threads: submitting an event processes it and delivers its market
+        // data on the caller's thread before returning. Output depends only on
+        // the input sequence (and the EngineClock), so runs are reproducible.
+        // Listeners must not submit back into the engine from a callback.
+        Inline
+    };
+
+}
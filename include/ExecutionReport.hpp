@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "Order.hpp"
+#include "RejectReason.hpp"
+
+namespace MercEx
+{
+
+    enum class ExecType : std::uint8_t
+    {
+        New,
+        Rejected,
+        PartialFill,
+        Fill,
+        Canceled,
+        CancelRejected,
+        Replaced,       // a modify took effect; leaves_qty is the order's new leaves
+        ReplaceRejected // a modify was refused; the order is unchanged
+    };
+
+    std::string to_string(ExecType type);
+
+    // Fixed-size, trivially copyable report sent back to the order's owner.
+    // last_qty/last_price are set on fills; leaves_qty is what is still working.
+    struct ExecutionReport
+    {
+        ExecType type;
+        RejectReason reason;
+        Side side;
+        MarketID market_id;
+        ClientID client_id;
+        OrderID order_id;
+        OrderID counterparty_id;
+        Quantity last_qty;
+        Quantity leaves_qty;
+        Price last_price;
+        TimePoint timestamp;
+    };
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "ExecutionReport.hpp"
+#include "AllocationGuard.hpp"
+#include "concurrentqueue.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace MercEx
+{
+
+    // Per-session report queue. Each market worker that reports into it gets its
+    // own single-producer sub-queue, so pushes never contend with each other and
+    // the session's reader drains them without locks.
+    //
+    // A worker registered with the router pushes through a producer token the
+    // router created for it, with the channel's blocks allocated up front, so
+    // its steady state does not allocate while the reader keeps up. Any other
+    // thread gets an implicit sub-queue, created on its first push.
+    class ExecutionReportChannel
+    {
+    public:
+        // Reports the channel holds before a producer needs a new block.
+        static constexpr std::size_t kInitialCapacity = 32 * moodycamel::ConcurrentQueueDefaultTraits::BLOCK_SIZE;
+
+        explicit ExecutionReportChannel(std::size_t max_producers);
+
+        void push(const ExecutionReport &report) { queue_.enqueue(report); }
+        void push(std::size_t producer, const ExecutionReport &report) { queue_.enqueue(*producers_[producer], report); }
+        bool poll(ExecutionReport &report) { return queue_.try_dequeue(report); }
+        std::size_t poll(ExecutionReport *reports, std::size_t max) { return queue_.try_dequeue_bulk(reports, max); }
+        std::size_t size_approx() const { return queue_.size_approx(); }
+
+    private:
+        friend class ExecutionReportRouter;
+        void add_producer(std::size_t producer);
+
+        moodycamel::ConcurrentQueue<ExecutionReport, GuardedQueueTraits> queue_;
+        std::unique_ptr<std::unique_ptr<moodycamel::ProducerToken>[]> producers_;
+    };
+
+    class ExecutionReportRouter
+    {
+    public:
+        static constexpr std::size_t kNoProducer = static_cast<std::size_t>(-1);
+
+        explicit ExecutionReportRouter(std::size_t max_clients = 65536, std::size_t max_producers = 256);
+
+        // Opening an already open session returns the same channel.
+        ExecutionReportChannel &open_session(ClientID client_id);
+        void close_session(ClientID client_id);
+
+        // Gives the calling market worker a producer token in every channel,
+        // present and future, for deliver() to push through. Called during
+        // warm-up, since it allocates. Returns kNoProducer once max_producers
+        // workers have registered; such a worker pushes implicitly.
+        std::size_t register_producer();
+
+        // Returns false if the client has no open session; the report is dropped.
+        // producer is the caller's register_producer() slot, if it has one.
+        bool deliver(const ExecutionReport &report, std::size_t producer = kNoProducer);
+
+        std::uint64_t dropped_reports() const { return dropped_.load(std::memory_order_relaxed); }
+
+    private:
+        // Channels are never freed while the router lives, so a worker holding a
+        // pointer across a concurrent close_session stays valid.
+        std::vector<std::unique_ptr<ExecutionReportChannel>> channels_;
+        std::vector<std::atomic<ExecutionReportChannel *>> active_;
+        std::size_t max_producers_;
+        std::size_t producers_ = 0; // registered, under sessions_mutex_
+        std::mutex sessions_mutex_;
+        std::atomic<std::uint64_t> dropped_{0};
+    };
+
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include "Order.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace MercEx
+{
+
+    // Market data feed wire format, spoken by MarketDataFeed over UDP and by
+    // its TCP recovery service.
+    //
+    // A packet carries consecutive messages of one market: a FeedPacketHeader
+    // naming the market and the sequence number of its first message,
+    // followed by count messages. Every market numbers its messages from 1
+    // without gaps, so a receiver that sees a packet start past the number it
+    // expects next has missed messages and asks the recovery service for
+    // them. A packet without messages is a heartbeat announcing the next
+    // sequence number of a quiet market, so losses at the tail of a burst are
+    // noticed too.
+    //
+    // The recovery service answers a FeedRequest over TCP with packets in the
+    // same format: the stored packets that cover the requested range, or a
+    // snapshot of the market when the range is no longer held, then a packet
+    // flagged kEndOfResponse.
+    //
+    // The feed carries what the engine publishes: trades and fills, not order
+    // book updates. A snapshot is therefore the market's trading state (last
+    // trade, volume, trade count), not a book.
+    //
+    // Host byte order (little-endian on every supported target). The structs
+    // are packed so that messages can be read in place wherever they land.
+
+    enum class FeedMessageType : std::uint8_t
+    {
+        Filled = 'F',
+        Trade = 'T',
+        Snapshot = 'Y' // recovery only: market state as of the packet's sequence
+    };
+
+    enum class FeedRequestType : std::uint8_t
+    {
+        Retransmit = 'R',
+        Snapshot = 'Q'
+    };
+
+    inline constexpr std::uint8_t kFeedVersion = 1;
+
+#pragma pack(push, 1)
+
+    struct FeedPacketHeader
+    {
+        static constexpr std::uint8_t kRetransmit = 0x1;    // sent by the recovery service
+        static constexpr std::uint8_t kSnapshot = 0x2;      // one Snapshot message
+        static constexpr std::uint8_t kEndOfResponse = 0x4; // last packet of a recovery response
+
+        std::uint16_t length; // whole packet, header included
+        MarketID market_id;
+        std::uint16_t count; // messages that follow
+        std::uint8_t version;
+        std::uint8_t flags;
+        // Of the first message; for heartbeats, snapshots and end-of-response
+        // packets, the number the market's next message will carry.
+        std::uint64_t sequence;
+        std::int64_t send_time_ns; // EngineClock
+    };
+
+    struct FeedMessageHeader
+    {
+        std::uint8_t length; // whole message, header included
+        FeedMessageType type;
+    };
+
+    struct FeedFilledMessage
+    {
+        FeedMessageHeader header;
+        std::uint8_t reserved[6];
+        std::int64_t timestamp_ns;
+        OrderID order_id;
+    };
+
+    struct FeedTradeMessage
+    {
+        FeedMessageHeader header;
+        std::uint16_t reserved;
+        Quantity quantity;
+        std::int64_t timestamp_ns;
+        OrderID order_id;        // the incoming order
+        OrderID counterparty_id; // the resting order it matched
+        Price price;
+    };
+
+    struct FeedSnapshotMessage
+    {
+        FeedMessageHeader header;
+        std::uint8_t reserved[6];
+        std::int64_t last_trade_ns; // 0 before the first trade
+        Price last_price;
+        std::uint64_t volume; // traded quantity since the feed started
+        std::uint64_t trades;
+    };
+
+    struct FeedRequest
+    {
+        std::uint16_t length; // sizeof(FeedRequest)
+        FeedRequestType type;
+        std::uint8_t version;
+        MarketID market_id;
+        std::uint16_t count; // Retransmit: messages wanted from from_sequence
+        std::uint64_t from_sequence;
+    };
+
+#pragma pack(pop)
+
+    static_assert(sizeof(FeedPacketHeader) == 24, "FeedPacketHeader must stay 24 bytes");
+    static_assert(sizeof(FeedFilledMessage) == 24, "FeedFilledMessage must stay 24 bytes");
+    static_assert(sizeof(FeedTradeMessage) == 40, "FeedTradeMessage must stay 40 bytes");
+    static_assert(sizeof(FeedSnapshotMessage) == 40, "FeedSnapshotMessage must stay 40 bytes");
+    static_assert(sizeof(FeedRequest) == 16, "FeedRequest must stay 16 bytes");
+
+    inline constexpr std::size_t kFeedMaxMessageSize = sizeof(FeedTradeMessage);
+
+    // Length of the message type on the wire, or 0 for an unknown type.
+    inline constexpr std::size_t feed_message_size(FeedMessageType type)
+    {
+        switch (type)
+        {
+        case FeedMessageType::Filled:
+            return sizeof(FeedFilledMessage);
+        case FeedMessageType::Trade:
+            return sizeof(FeedTradeMessage);
+        case FeedMessageType::Snapshot:
+            return sizeof(FeedSnapshotMessage);
+        }
+        return 0;
+    }
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "FeedProtocol.hpp"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace MercEx
+{
+
+    struct FeedReceiverConfig
+    {
+        std::string address = "239.255.0.1"; // multicast group to join, or a local unicast address
+        std::uint16_t port = 30001;
+        std::string interface = "127.0.0.1"; // interface to join the group on
+        std::string recovery_address = "127.0.0.1";
+        std::uint16_t recovery_port = 0; // 0: gaps are counted, not recovered
+        double simulated_loss = 0.0;     // fraction of feed packets dropped on arrival, to exercise recovery
+    };
+
+    struct FeedReceiverStats
+    {
+        std::uint64_t packets = 0;    // feed packets taken, heartbeats included
+        std::uint64_t messages = 0;   // delivered to the handler, recovered ones included
+        std::uint64_t gaps = 0;       // times a market's sequence jumped ahead
+        std::uint64_t recovered = 0;  // messages delivered from retransmissions
+        std::uint64_t snapshots = 0;  // snapshots a recovery fell back to
+        std::uint64_t lost = 0;       // messages neither received nor retransmitted
+        std::uint64_t duplicates = 0; // messages seen before, skipped
+        std::uint64_t dropped = 0;    // packets discarded by simulated_loss
+        std::uint64_t malformed = 0;  // packets that failed validation
+    };
+
+    // Consumer side of MarketDataFeed. Receives the feed's packets with
+    // recvmmsg, checks every market's sequence numbers and hands each message
+    // to the handler once and in order. When a market's sequence jumps ahead
+    // it asks the recovery service for the missing messages before going on,
+    // synchronously, over a TCP connection kept open between gaps; if they
+    // are no longer held, the handler gets the market's Snapshot message
+    // instead and the market resumes from its sequence number.
+    //
+    // Single-threaded: the handler runs inside poll().
+    class FeedReceiver
+    {
+    public:
+        using Handler = std::function<void(MarketID market_id, std::uint64_t sequence, const FeedMessageHeader &msg)>;
+
+        FeedReceiver(FeedReceiverConfig config, Handler handler);
+        ~FeedReceiver();
+
+        FeedReceiver(const FeedReceiver &) = delete;
+        FeedReceiver &operator=(const FeedReceiver &) = delete;
+
+        // Binds the feed port and joins the group. Throws if the socket cannot
+        // be set up.
+        void open();
+
+        // Waits up to timeout for packets and handles whatever has arrived.
+        // Returns the number of packets read.
+        std::size_t poll(std::chrono::milliseconds timeout);
+
+        const FeedReceiverStats &stats() const { return stats_; }
+        // Next sequence number expected of a market; 1 before its first message.
+        std::uint64_t expected(MarketID market_id) const { return expected_[market_id]; }
+
+    private:
+        bool valid(const char *data, std::size_t size) const;
+        void handle_packet(const char *data, std::size_t size);
+        // Delivers a packet's messages not seen yet; returns how many.
+        std::uint64_t deliver(const FeedPacketHeader &header, const char *data);
+        void recover(MarketID market_id, std::uint64_t to);
+        bool request(MarketID market_id, std::uint64_t from, std::uint16_t count);
+        bool connect_recovery();
+        bool read_exact(char *out, std::size_t size);
+
+        FeedReceiverConfig config_;
+        Handler handler_;
+        int udp_fd_ = -1;
+        int recovery_fd_ = -1;
+
+        std::vector<std::uint64_t> expected_;
+        std::vector<char> buffers_;
+        std::vector<char> response_;
+        std::mt19937_64 random_{42};
+        std::bernoulli_distribution drop_;
+        FeedReceiverStats stats_;
+    };
+
+}
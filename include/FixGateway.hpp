@@ -0,0 +1,190 @@
+#pragma once
+#include "MatchingEngine.hpp"
+#include "ExecutionReportRouter.hpp"
+#include "FixProtocol.hpp"
+#include "MarketMetrics.hpp"
+#include "ThreadPlacement.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace MercEx
+{
+
+    // A counterparty allowed to log on: its SenderCompID and the client its
+    // orders are entered for.
+    struct FixCounterparty
+    {
+        std::string comp_id;
+        ClientID client_id;
+    };
+
+    // Symbol (tag 55) to market.
+    struct FixSymbol
+    {
+        std::string symbol;
+        MarketID market_id;
+    };
+
+    struct FixGatewayConfig
+    {
+        std::string address = "127.0.0.1";
+        std::uint16_t port = 0; // 0 binds a free port; see FixGateway::port()
+        int backlog = 256;
+        std::string comp_id = "MERCURY"; // ours: TargetCompID of every logon
+        std::vector<FixCounterparty> counterparties;
+        std::vector<FixSymbol> symbols;
+        std::size_t max_sessions = 256;
+        std::size_t receive_buffer = 64 << 10;   // bytes per session
+        std::size_t send_buffer = 256 << 10;     // bytes per session
+        std::size_t max_open_orders = 16384;     // per session; orders beyond it are rejected
+        std::size_t resend_messages = 4096;      // per counterparty, kept for ResendRequests
+        std::chrono::seconds logon_timeout{10};  // from connect to Logon
+        std::chrono::seconds max_heartbeat{300}; // largest HeartBtInt accepted
+        ThreadPlacement placement;               // for the event loop thread
+    };
+
+    // FIX 4.4 acceptor: order entry for clients that speak FIX rather than
+    // the binary protocol of TcpGateway, from one edge-triggered epoll thread.
+    //
+    // Session layer: Logon (with or without ResetSeqNumFlag), Heartbeat,
+    // TestRequest, ResendRequest, SequenceReset and Logout, with heartbeats
+    // and test requests on a timer. Sequence numbers carry over from one
+    // connection of a counterparty to the next and start again at 1 only on
+    // a Logon with ResetSeqNumFlag. A gap in the inbound numbers is answered
+    // with a ResendRequest and the messages past it are dropped until the
+    // resend fills it. The latest resend_messages application messages sent
+    // to each counterparty are kept, and a ResendRequest from the client
+    // replays them with PossDupFlag and OrigSendingTime; session messages,
+    // and anything no longer kept, are covered by SequenceReset-GapFill.
+    //
+    // Application layer: NewOrderSingle (D), OrderCancelRequest (F) and
+    // OrderCancelReplaceRequest (G) are mapped onto the engine's
+    // MarketID-based calls, and the session's execution reports come back as
+    // ExecutionReport (8) or, for failed cancels and replaces,
+    // OrderCancelReject (9). ClOrdIDs live in a fixed per-session table of
+    // open orders, so cancels and replaces can name the order by OrderID or
+    // OrigClOrdID and reports carry the ClOrdID the client chose; a replace
+    // changes OrderQty and, when it carries one, Price. A limit
+    // order with MaxFloor (111) is entered as an iceberg; OrdType P is a
+    // pegged order, ExecInst (18) R, P or M with PegOffsetValue (211).
+    //
+    // Once a session is logged on nothing on the order path allocates (a
+    // counterparty's resend store is set up on its first Logon):
+    // messages are parsed in place in the receive buffer (FixProtocol.hpp)
+    // and written from pre-serialized pieces, the session's header and each
+    // symbol's tag 55 among them, into the send buffer, which goes out with
+    // one send per loop iteration.
+    //
+    // Client IDs served here must not also log in through another gateway:
+    // each report channel has one reader.
+    class FixGateway
+    {
+    public:
+        FixGateway(MatchingEngine &engine, ExecutionReportRouter &reports, FixGatewayConfig config);
+        ~FixGateway();
+
+        FixGateway(const FixGateway &) = delete;
+        FixGateway &operator=(const FixGateway &) = delete;
+
+        // Binds and listens, then starts the event loop. Throws if the socket
+        // cannot be set up.
+        void start();
+        // Stops the event loop and closes every session without a Logout.
+        void stop();
+
+        std::uint16_t port() const { return port_; }
+
+        std::size_t sessions() const { return session_count_.load(std::memory_order_relaxed); }
+        std::uint64_t messages_in() const { return messages_in_.value(); }
+        std::uint64_t messages_out() const { return messages_out_.value(); }
+        // Garbled messages skipped, and sessions closed for breaking the
+        // protocol.
+        std::uint64_t protocol_errors() const { return protocol_errors_.value(); }
+
+    private:
+        struct Session;
+        class OrderTable;
+        class OutboundStore;
+        struct CounterpartyState;
+
+        void open_listener();
+        Session &open_slot(int fd);
+
+        void run();
+        bool accept_sessions();
+        bool read_session(Session &session);
+        std::size_t parse_messages(Session &session);
+        void handle_message(Session &session, const FixMessage &msg);
+        void handle_logon(Session &session, const FixMessage &msg);
+        bool check_sequence(Session &session, const FixMessage &msg);
+        void handle_admin(Session &session, const FixMessage &msg);
+        bool resend(Session &session);
+        void handle_new_order(Session &session, const FixMessage &msg);
+        void handle_cancel(Session &session, const FixMessage &msg);
+        void handle_replace(Session &session, const FixMessage &msg);
+        bool drain_reports(Session &session);
+        void send_report(Session &session, const ExecutionReport &report);
+        void check_timers(Session &session);
+        void flush(Session &session);
+        void close_session(Session &session);
+
+        void start_message(Session &session, std::string_view msg_type);
+        void start_message(Session &session, std::string_view msg_type, std::uint64_t seq_num);
+        void send(Session &session);
+        void send_logout(Session &session, std::string_view text);
+        void send_reject(Session &session, const FixMessage &msg, int ref_tag, int reason);
+        void send_order_reject(Session &session, const FixMessage &msg, int reason, std::string_view text);
+        // response_to is CxlRejResponseTo (434): '1' a cancel, '2' a cancel/replace.
+        void send_cancel_reject(Session &session, std::string_view cl_ord_id, std::string_view orig_cl_ord_id,
+                                OrderID order_id, char status, int reason, std::string_view text,
+                                char response_to = '1');
+        bool reserve(Session &session, std::size_t bytes);
+
+        const FixSymbol *find_symbol(std::string_view symbol) const;
+        const FixCounterparty *find_counterparty(std::string_view comp_id) const;
+
+        MatchingEngine &engine_;
+        ExecutionReportRouter &reports_;
+        FixGatewayConfig config_;
+
+        // config_.symbols is sorted by symbol; each one's "55=<symbol><SOH>"
+        // is kept ready to copy into reports.
+        std::vector<std::string> symbol_fields_;
+
+        // Indexed like config_.counterparties; each is created on the
+        // counterparty's first Logon and outlives its connections.
+        std::vector<std::unique_ptr<CounterpartyState>> counterparty_states_;
+
+        int listen_fd_ = -1;
+        int epoll_fd_ = -1;
+        std::uint16_t port_ = 0;
+
+        // Indexed by slot; a slot's session is reused once it is closed.
+        std::vector<std::unique_ptr<Session>> sessions_;
+        std::vector<Session *> live_;
+        std::vector<std::uint32_t> free_slots_;
+
+        // Event loop state: one message is parsed and one written at a time.
+        FixMessage inbound_;
+        FixWriter writer_;
+        std::chrono::steady_clock::time_point now_;
+        FixTimestamp now_text_; // SendingTime of everything written this iteration
+        std::uint64_t sending_seq_ = 0; // MsgSeqNum of the message being written
+        bool sending_kept_ = false;     // and whether send() stores it for resends
+        std::uint64_t next_exec_id_ = 1;
+
+        std::atomic<std::size_t> session_count_{0};
+        SingleWriterCounter messages_in_;
+        SingleWriterCounter messages_out_;
+        SingleWriterCounter protocol_errors_;
+
+        std::atomic<bool> running_{false};
+        std::thread worker_;
+    };
+
+}
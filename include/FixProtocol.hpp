@@ -0,0 +1,187 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace MercEx
+{
+
+    // FIX 4.4 tag=value encoding, as spoken by FixGateway: a parser that
+    // indexes a message in place and a writer that builds one in a fixed
+    // buffer. Neither allocates.
+    //
+    // The field scan is the hot loop of any FIX gateway. fix_parse indexes
+    // every SOH of the body in one vector pass and takes the checksum the
+    // same way, and numbers are converted sixteen digits at a time, all with
+    // the kernels of TextKernels.hpp.
+
+    inline constexpr char kSoh = '\x01';
+    inline constexpr std::string_view kFixBeginString = "FIX.4.4";
+
+    namespace FixTag
+    {
+        enum : int
+        {
+            AvgPx = 6,
+            BeginSeqNo = 7,
+            BeginString = 8,
+            BodyLength = 9,
+            CheckSum = 10,
+            ClOrdID = 11,
+            CumQty = 14,
+            EndSeqNo = 16,
+            ExecID = 17,
+            ExecInst = 18,
+            LastPx = 31,
+            LastQty = 32,
+            MsgSeqNum = 34,
+            MsgType = 35,
+            NewSeqNo = 36,
+            OrderID = 37,
+            OrderQty = 38,
+            OrdStatus = 39,
+            OrdType = 40,
+            OrigClOrdID = 41,
+            PossDupFlag = 43,
+            Price = 44,
+            RefSeqNum = 45,
+            SenderCompID = 49,
+            SendingTime = 52,
+            Side = 54,
+            Symbol = 55,
+            TargetCompID = 56,
+            Text = 58,
+            TimeInForce = 59,
+            TransactTime = 60,
+            EncryptMethod = 98,
+            StopPx = 99,
+            CxlRejReason = 102,
+            OrdRejReason = 103,
+            HeartBtInt = 108,
+            MaxFloor = 111,
+            TestReqID = 112,
+            OrigSendingTime = 122,
+            GapFillFlag = 123,
+            ResetSeqNumFlag = 141,
+            ExecType = 150,
+            LeavesQty = 151,
+            PegOffsetValue = 211,
+            RefTagID = 371,
+            RefMsgType = 372,
+            SessionRejectReason = 373,
+            CxlRejResponseTo = 434
+        };
+    }
+
+    struct FixField
+    {
+        int tag;
+        std::uint32_t offset; // of the value, from the start of the message
+        std::uint32_t length;
+    };
+
+    enum class FixParseStatus : std::uint8_t
+    {
+        Complete,   // a message of `consumed` bytes was parsed
+        Incomplete, // need more bytes
+        Garbled,    // framed, but a bad checksum or field: skip `consumed` bytes
+        Invalid     // framing lost; the stream cannot be resynchronized
+    };
+
+    struct FixParseResult
+    {
+        FixParseStatus status;
+        std::size_t consumed;
+    };
+
+    // One parsed message: fields point into the buffer it was parsed from,
+    // which must outlive the view.
+    class FixMessage
+    {
+    public:
+        static constexpr std::size_t kMaxFields = 96;
+
+        // The value of the first field with this tag; empty if absent.
+        std::string_view get(int tag) const;
+        bool has(int tag) const;
+        std::string_view msg_type() const { return msg_type_; }
+        std::uint64_t seq_num() const { return seq_num_; }
+        const FixField *begin() const { return fields_; }
+        const FixField *end() const { return fields_ + count_; }
+
+    private:
+        friend FixParseResult fix_parse(const char *data, std::size_t size, FixMessage &out);
+
+        const char *data_ = nullptr;
+        std::size_t count_ = 0;
+        std::string_view msg_type_;
+        std::uint64_t seq_num_ = 0;
+        FixField fields_[kMaxFields];
+    };
+
+    // Parses the message at the start of data. Checks BeginString, BodyLength
+    // and CheckSum, and that MsgType leads the body; seq_num() is 0 when
+    // MsgSeqNum is missing or not a number.
+    FixParseResult fix_parse(const char *data, std::size_t size, FixMessage &out);
+
+    // First SOH in [p, end), or end.
+    const char *fix_find_soh(const char *p, const char *end);
+    // Sum of the bytes in [p, p + size), modulo 256.
+    std::uint8_t fix_checksum(const char *p, std::size_t size);
+
+    // Strict decimal conversions of field values; false on anything else.
+    bool fix_to_uint(std::string_view s, std::uint64_t &out);
+    bool fix_to_int(std::string_view s, std::int64_t &out);
+    bool fix_to_price(std::string_view s, double &out);
+
+    // Builds one message at a time in its own buffer: begin(), fields, then
+    // finish(), which puts BeginString and BodyLength in front of the body
+    // and the CheckSum after it. Values that would overflow the buffer are
+    // dropped and make finish() return an empty view.
+    class FixWriter
+    {
+    public:
+        static constexpr std::size_t kCapacity = 1024;
+
+        void begin(std::string_view msg_type);
+        // Pre-serialized bytes: whole "tag=value<SOH>" runs.
+        void raw(std::string_view bytes);
+        void field(int tag, std::string_view value);
+        void field(int tag, char value);
+        void field(int tag, std::int64_t value);
+        void field(int tag, std::uint64_t value);
+        void field(int tag, int value) { field(tag, static_cast<std::int64_t>(value)); }
+        // Up to eight decimals, trailing zeros trimmed.
+        void price(int tag, double value);
+
+        std::string_view finish();
+
+    private:
+        // Room for "8=FIX.4.4<SOH>9=NNNN<SOH>" in front of the body.
+        static constexpr std::size_t kHeadroom = 32;
+
+        void put_tag(int tag);
+        void put_uint(std::uint64_t value);
+        bool room(std::size_t n) const { return pos_ + n <= kHeadroom + kCapacity; }
+
+        char buf_[kHeadroom + kCapacity + 8];
+        std::size_t pos_ = kHeadroom;
+        bool overflow_ = false;
+    };
+
+    // SendingTime/TransactTime as "YYYYMMDD-HH:MM:SS.sss" (UTC), reformatted
+    // only as far as the time moved since the last refresh.
+    class FixTimestamp
+    {
+    public:
+        void refresh(std::chrono::system_clock::time_point now);
+        std::string_view view() const { return {text_, sizeof(text_)}; }
+
+    private:
+        char text_[21] = {};
+        std::int64_t second_ = -1;
+        std::int64_t millis_ = -1;
+    };
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+
+namespace MercEx
+{
+
+    enum class PageBacking
+    {
+        Huge1GB,     // explicit hugetlbfs pages
+        Huge2MB,
+        Transparent, // regular mapping with MADV_HUGEPAGE; the kernel may use 2MB pages
+        Normal
+    };
+
+    const char *to_string(PageBacking backing);
+
+    struct ArenaConfig
+    {
+        std::size_t bytes = 0;                      // 0: no arena, use the global heap
+        PageBacking pages = PageBacking::Huge2MB;   // largest backing to try
+        bool prefault = true;                       // touch every page up front
+        bool lock = true;                           // mlock so pages are never reclaimed
+        int numa_node = -1;                         // preferred node for the pages
+    };
+
+    // One contiguous region reserved up front and handed out by bumping a
+    // pointer. Backing falls back from the requested huge page size to smaller
+    // ones, then to transparent huge pages, then to normal pages, so an arena
+    // is always obtained. Deallocation is a no-op: put a pool resource on top
+    // to recycle blocks. Requests beyond the region go to the upstream
+    // resource rather than failing. Not thread-safe.
+    class HugePageArena : public std::pmr::memory_resource
+    {
+    public:
+        explicit HugePageArena(const ArenaConfig &config,
+                               std::pmr::memory_resource *upstream = std::pmr::new_delete_resource());
+        ~HugePageArena() override;
+
+        HugePageArena(const HugePageArena &) = delete;
+        HugePageArena &operator=(const HugePageArena &) = delete;
+
+        PageBacking backing() const { return backing_; }
+        bool locked() const { return locked_; }
+        std::size_t capacity() const { return size_; }
+        std::size_t used() const { return static_cast<std::size_t>(next_ - base_); }
+        std::size_t overflow_bytes() const { return overflow_bytes_; }
+
+    private:
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+        void map_region(const ArenaConfig &config);
+
+        std::pmr::memory_resource *upstream_;
+        char *base_ = nullptr;
+        char *next_ = nullptr;
+        std::size_t size_ = 0;
+        std::size_t overflow_bytes_ = 0;
+        PageBacking backing_ = PageBacking::Normal;
+        bool locked_ = false;
+    };
+
+    // Memory for one market: an arena with a node pool over it, so books, stop
+    // levels and orders reuse freed nodes and stay within the arena's pages.
+    // Used only by the market's worker thread.
+    class MarketMemory
+    {
+    public:
+        explicit MarketMemory(const ArenaConfig &config) : arena_(config), pool_(&arena_) {}
+
+        std::pmr::memory_resource *resource() { return &pool_; }
+        const HugePageArena &arena() const { return arena_; }
+
+    private:
+        HugePageArena arena_;
+        std::pmr::unsynchronized_pool_resource pool_;
+    };
+
+}
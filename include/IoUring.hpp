@@ -0,0 +1,126 @@
+#pragma once
+// Thin io_uring wrapper on the raw system calls; liburing is not required.
+// Linux only: everything here is compiled out on other platforms.
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace MercEx
+{
+
+    // One io_uring instance: a submission and a completion ring shared with
+    // the kernel. Entries are queued with next_sqe() and handed over in a
+    // batch by submit(), one io_uring_enter per call. Owned and driven by a
+    // single thread.
+    class IoUring
+    {
+    public:
+        // Throws std::runtime_error if the kernel has no io_uring or refuses
+        // to set one up (e.g. kernel.io_uring_disabled).
+        explicit IoUring(unsigned entries, unsigned flags = 0);
+        ~IoUring();
+
+        IoUring(const IoUring &) = delete;
+        IoUring &operator=(const IoUring &) = delete;
+
+        // Zeroed submission entry at the tail of the queue. When the queue is
+        // full, what is queued is submitted first.
+        io_uring_sqe &next_sqe();
+
+        // Submits every queued entry and waits for wait_nr completions, or
+        // until timeout passes when it is non-zero. Returns the number of
+        // entries the kernel took, or -errno.
+        int submit(unsigned wait_nr = 0, std::chrono::nanoseconds timeout = std::chrono::nanoseconds::zero());
+
+        // Calls fn(const io_uring_cqe &) on every completion available now and
+        // releases them. fn may queue new entries. Returns how many it saw.
+        template <typename Fn>
+        unsigned drain_completions(Fn &&fn)
+        {
+            unsigned head = *cq_head_;
+            unsigned seen = 0;
+            for (;;)
+            {
+                unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+                if (head == tail)
+                    break;
+                for (; head != tail; ++head, ++seen)
+                    fn(cqes_[head & cq_mask_]);
+                __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+            }
+            return seen;
+        }
+
+        // Registers a table of count empty buffer slots, filled by update_buffer().
+        void register_sparse_buffers(unsigned count);
+        void update_buffer(unsigned index, void *base, std::size_t size);
+        void register_buffers(const iovec *buffers, unsigned count);
+
+        int fd() const { return fd_; }
+        // Raw io_uring_register; returns -errno on failure.
+        int register_raw(unsigned opcode, const void *arg, unsigned nr_args);
+
+    private:
+        void release();
+
+        int fd_ = -1;
+        unsigned features_ = 0;
+
+        void *sq_map_ = nullptr;
+        std::size_t sq_map_size_ = 0;
+        void *cq_map_ = nullptr;
+        std::size_t cq_map_size_ = 0;
+        io_uring_sqe *sqes_ = nullptr;
+        std::size_t sqes_size_ = 0;
+
+        unsigned *sq_head_ = nullptr;
+        unsigned *sq_tail_ = nullptr;
+        unsigned sq_mask_ = 0;
+        unsigned sq_entries_ = 0;
+        unsigned sqe_tail_ = 0; // next entry to fill; published on submit()
+
+        unsigned *cq_head_ = nullptr;
+        unsigned *cq_tail_ = nullptr;
+        unsigned cq_mask_ = 0;
+        io_uring_cqe *cqes_ = nullptr;
+    };
+
+    // A group of equal-sized buffers a recv with IOSQE_BUFFER_SELECT picks
+    // from (IORING_OP_PROVIDE_BUFFERS). Each completion names the buffer its
+    // data landed in; the consumer hands the buffer back with recycle() once
+    // it is done with the bytes. Handing buffers over is itself a request:
+    // its completion carries user_data and only needs looking at on error.
+    class ProvidedBuffers
+    {
+    public:
+        ProvidedBuffers(IoUring &ring, std::uint16_t group, unsigned count, std::size_t buffer_size,
+                        std::uint64_t user_data);
+        ~ProvidedBuffers();
+
+        ProvidedBuffers(const ProvidedBuffers &) = delete;
+        ProvidedBuffers &operator=(const ProvidedBuffers &) = delete;
+
+        std::uint16_t group() const { return group_; }
+        char *buffer(unsigned id) { return buffers_ + static_cast<std::size_t>(id) * buffer_size_; }
+        // Buffer id of a completion that carries IORING_CQE_F_BUFFER.
+        static unsigned buffer_id(const io_uring_cqe &cqe) { return cqe.flags >> IORING_CQE_BUFFER_SHIFT; }
+
+        void recycle(unsigned id) { provide(id, 1); }
+
+    private:
+        void provide(unsigned first, unsigned count);
+
+        IoUring &ring_;
+        std::uint16_t group_;
+        unsigned count_;
+        std::size_t buffer_size_;
+        std::uint64_t user_data_;
+        char *buffers_ = nullptr;
+    };
+
+}
+
+#endif
@@ -0,0 +1,50 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace MercEx
+{
+
+    // Log-linear histogram of nanosecond samples, in the style of HdrHistogram:
+    // values below 128 are exact and each power-of-two range above is split
+    // into 64 linear sub-buckets, giving better than 1.6% relative precision up
+    // to 2^40ns (~18 minutes) with a fixed footprint. Recording is O(1) and allocation-free. A histogram has a
+    // single writer; merge() combines histograms from different threads.
+    class LatencyHistogram
+    {
+    public:
+        static constexpr unsigned kSubBucketBits = 7;
+        static constexpr unsigned kMaxExponent = 40;
+
+        void record(std::uint64_t value_ns);
+        void merge(const LatencyHistogram &other);
+        void reset();
+
+        std::uint64_t count() const { return count_; }
+        std::uint64_t min() const { return count_ ? min_ : 0; }
+        std::uint64_t max() const { return max_; }
+        double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+
+        // Upper bound of the bucket holding the given percentile (0..100).
+        std::uint64_t percentile(double p) const;
+
+        void print_summary(std::ostream &os, const std::string &label) const;
+        void print_json(std::ostream &os) const;
+
+    private:
+        static constexpr std::size_t kSubBuckets = std::size_t(1) << kSubBucketBits;
+        static constexpr std::size_t kBuckets = kSubBuckets + (kMaxExponent - kSubBucketBits) * (kSubBuckets / 2);
+
+        static std::size_t index_of(std::uint64_t value);
+        static std::uint64_t upper_bound_of(std::size_t index);
+
+        std::array<std::uint64_t, kBuckets> counts_{};
+        std::uint64_t count_ = 0;
+        std::uint64_t sum_ = 0;
+        std::uint64_t min_ = UINT64_MAX;
+        std::uint64_t max_ = 0;
+    };
+
+}
@@ -2,6 +2,8 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <map>
+#include <tuple>
 #include "BuyBook.hpp"
 #include "SellBook.hpp"
 #include "Trade.hpp"
@@ -14,17 +16,32 @@ namespace MercEx
     class Market
     {
     public:
-        Market(const std::string &symbol, double price_tick);
+        // The books allocate their price levels and order lists from resource.
+        Market(const std::string &symbol, double price_tick, MarketID market_id = 0,
+               std::pmr::memory_resource *resource = std::pmr::get_default_resource());
 
         bool is_valid_price(double price) const;
         bool validate_fulfillment(const Order &order, Side side);
+        // Expects an order that passed the engine's pre-trade stage (see
+        // normalize_order): prices on tick, no price on market orders.
         std::vector<MarketEvent> process_order(Order &order);
-        std::vector<MarketEvent> process_limit_buy_order(Order &order);
-        std::vector<MarketEvent> process_limit_sell_order(Order &order);
-        std::vector<MarketEvent> process_market_buy_order(Order &order);
-        std::vector<MarketEvent> process_market_sell_order(Order &order);
+        // Appends the resulting events to events, so a caller reusing one
+        // buffer matches without allocating once its capacity has grown.
+        void process_order(Order &order, std::vector<MarketEvent> &events);
+        void process_limit_buy_order(Order &order, std::vector<MarketEvent> &events);
+        void process_limit_sell_order(Order &order, std::vector<MarketEvent> &events);
+        void process_market_buy_order(Order &order, std::vector<MarketEvent> &events);
+        void process_market_sell_order(Order &order, std::vector<MarketEvent> &events);
+        void process_pegged_order(Order &order);
 
         bool cancel_order(Order *order);
+        // Modifies of a resting order the caller has checked the change
+        // against. reduce_order shrinks it where it stands and keeps its time
+        // priority; replace_order takes it out of its book and enters it again
+        // with the new quantity and price, matching whatever it now crosses.
+        void reduce_order(Order &order, Quantity quantity, Quantity remaining);
+        void replace_order(Order &order, Quantity quantity, Quantity remaining, std::optional<Price> price,
+                           std::vector<MarketEvent> &events);
 
         const std::string &get_symbol() const;
         double get_price_tick() const;
@@ -43,9 +60,29 @@ namespace MercEx
         std::optional<Price> get_bid_price() const;
         std::optional<Price> get_ask_price() const;
 
+        // Best bid and ask among orders that are not pegged: the prices pegs
+        // follow. A level holding only pegs is skipped.
+        std::optional<Price> get_reference_bid() const;
+        std::optional<Price> get_reference_ask() const;
+        // Sets a pegged order's price from its reference; false when the
+        // reference is empty and the order cannot be priced.
+        bool price_peg(Order &order);
+        std::size_t pegged_orders() const;
+
         MarketID get_market_id() const;
 
     private:
+        // Matches order against the queue at one level of the opposite book.
+        void match_level(Order &order, Price price, PriceLevel &level, std::vector<MarketEvent> &events);
+
+        std::optional<Price> peg_price(Side side, const Peg &peg) const;
+        void add_peg(Order &order);
+        void remove_peg(Order &order);
+        // Runs after every change to the books: when a reference has moved,
+        // reprices the pegs that follow it.
+        void reprice_pegs();
+        void reprice_group(PegReference reference, Side side);
+
         std::string symbol;
         MarketID market_id;
         double price_tick;
@@ -53,5 +90,18 @@ namespace MercEx
         BuyBook buybook;
         SellBook sellbook;
         std::optional<double> last_price;
+
+        // Resting pegged orders grouped by (reference, side, offset): a move of
+        // one reference reprices its own groups and nothing else, and every
+        // order of a group moves to the same new price, in queue order.
+        using PegKey = std::tuple<PegReference, Side, Price>;
+        std::pmr::map<PegKey, OrderList> pegs;
+        std::size_t peg_count;
+        // The references the pegs were last priced from, and the bests, pegs
+        // included, that capped them.
+        std::optional<Price> peg_bid;
+        std::optional<Price> peg_ask;
+        std::optional<Price> peg_best_bid;
+        std::optional<Price> peg_best_ask;
     };
 }
@@ -0,0 +1,31 @@
+#pragma once
+#include "Order.hpp"
+#include <cstddef>
+
+namespace MercEx
+{
+
+    // Capacity hints for one market. A market given hints sizes and touches
+    // its structures during warm-up, before its first event, so its steady
+    // state does not allocate while the hints hold.
+    struct MarketCapacity
+    {
+        std::size_t orders = 0;           // orders the market holds over the session
+        std::size_t price_levels = 0;     // distinct prices per book side and per stop side
+        std::size_t queue_events = 0;     // inbound events that may be queued at once
+        std::size_t event_batches = 64;   // market data batches in flight to the publisher
+        std::size_t events_per_batch = 64; // market data events a single order can produce
+
+        bool empty() const { return orders == 0 && price_levels == 0 && queue_events == 0; }
+
+        // Arena size that holds the hinted orders and levels with room for the
+        // node pool's slack.
+        std::size_t arena_bytes() const
+        {
+            constexpr std::size_t kOrderBytes = sizeof(Order) + 96; // map node, bucket, book list node
+            constexpr std::size_t kLevelBytes = 128;                // map node holding a PriceLevel
+            return 2 * (orders * kOrderBytes + 4 * price_levels * kLevelBytes) + (std::size_t(2) << 20);
+        }
+    };
+
+}
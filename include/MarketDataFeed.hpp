@@ -0,0 +1,122 @@
+#pragma once
+#include "IMarketDataListener.hpp"
+#include "FeedProtocol.hpp"
+#include "MarketMetrics.hpp"
+#include "ThreadPlacement.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct mmsghdr;
+struct iovec;
+
+namespace MercEx
+{
+
+    struct MarketDataFeedConfig
+    {
+        std::string address = "239.255.0.1"; // multicast group, or a unicast destination
+        std::uint16_t port = 30001;
+        std::string interface = "127.0.0.1"; // outgoing interface for multicast
+        int ttl = 1;                          // multicast hops
+        std::size_t max_packet = 1472;        // UDP payload: a 1500-byte MTU less IP and UDP headers
+        std::size_t history_packets = 8192;   // kept for retransmission, all markets together
+        std::string recovery_address = "127.0.0.1";
+        std::uint16_t recovery_port = 0; // 0 binds a free port; see MarketDataFeed::recovery_port()
+        std::chrono::milliseconds heartbeat{1000};
+        ThreadPlacement placement; // for the recovery thread
+    };
+
+    // Network market data for consumers outside the process. Subscribed to a
+    // MarketDataPublisher like any listener, it encodes each batch's trades
+    // and fills into FeedProtocol packets, one market per packet and as many
+    // messages as fit in max_packet, numbers every market's messages from 1,
+    // and sends the batch's packets to the feed address with one sendmmsg.
+    //
+    // Sent packets are also kept in a history ring. A recovery thread serves
+    // FeedRequests over TCP from it: retransmissions of what is still held,
+    // and otherwise a snapshot of the market's trading state as of its latest
+    // sequence number, from which a late or far-behind receiver resumes. The
+    // same thread sends heartbeats for markets that have been quiet for a
+    // heartbeat interval.
+    //
+    // on_market_events runs on the publisher's dispatch thread (or the
+    // market's, inline); the history and the per-market sequence state the
+    // recovery thread reads are shared under a mutex taken once per packet.
+    class MarketDataFeed : public IMarketDataListener
+    {
+    public:
+        explicit MarketDataFeed(MarketDataFeedConfig config = {});
+        ~MarketDataFeed() override;
+
+        MarketDataFeed(const MarketDataFeed &) = delete;
+        MarketDataFeed &operator=(const MarketDataFeed &) = delete;
+
+        // Opens the UDP socket and the recovery listener and starts the
+        // recovery thread. Throws if a socket cannot be set up. Events that
+        // arrive before start() are not sent.
+        void start();
+        void stop();
+
+        void on_market_events(const std::vector<MarketEvent> &events) override;
+
+        std::uint16_t recovery_port() const { return recovery_port_; }
+
+        std::uint64_t packets_sent() const { return packets_sent_.value(); }
+        std::uint64_t messages_sent() const { return messages_sent_.value(); }
+        std::uint64_t send_errors() const { return send_errors_.value(); }
+        std::uint64_t recovery_requests() const { return recovery_requests_.value(); }
+        std::uint64_t snapshots_sent() const { return snapshots_sent_.value(); }
+
+    private:
+        struct MarketState;
+        struct RecoveryClient;
+
+        MarketState &market(MarketID market_id);
+        void finish_packet(MarketID market_id, MarketState &state);
+        void send_pending();
+
+        void open_sockets();
+        void run_recovery();
+        void send_heartbeats();
+        bool serve(RecoveryClient &client);
+        void respond(const FeedRequest &request, std::vector<char> &out);
+        void append_snapshot(MarketID market_id, const MarketState *state, std::vector<char> &out);
+
+        MarketDataFeedConfig config_;
+        int udp_fd_ = -1;
+        int listen_fd_ = -1;
+        std::uint16_t recovery_port_ = 0;
+        std::vector<char> destination_; // sockaddr_in
+
+        // Publisher side. Markets are indexed by MarketID and created on
+        // their first event.
+        std::vector<std::unique_ptr<MarketState>> markets_;
+        std::vector<MarketID> touched_; // markets with a packet open in this batch
+        std::vector<mmsghdr> pending_;
+        std::vector<iovec> pending_iov_;
+        std::size_t pending_count_ = 0;
+
+        // Shared with the recovery thread under mutex_.
+        std::mutex mutex_;
+        std::vector<char> history_;
+        std::vector<std::uint16_t> history_lengths_;
+        std::uint64_t history_stored_ = 0; // packets ever stored; slot = n % history_packets
+        std::vector<MarketID> active_;     // markets with state, in creation order
+
+        SingleWriterCounter packets_sent_;
+        SingleWriterCounter messages_sent_;
+        SingleWriterCounter send_errors_;
+        SingleWriterCounter recovery_requests_;
+        SingleWriterCounter snapshots_sent_;
+
+        std::atomic<bool> running_{false};
+        std::thread worker_;
+    };
+
+}
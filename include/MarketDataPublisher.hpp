@@ -1,7 +1,11 @@
 #pragma once
 #include "IMarketDataListener.hpp"
 #include "MarketEvent.hpp"
+#include "ExecutionMode.hpp"
+#include "ThreadPlacement.hpp"
+#include "AllocationGuard.hpp"
 #include "blockingconcurrentqueue.h"
+#include <chrono>
 #include <vector>
 #include <thread>
 #include <atomic>
@@ -9,21 +13,82 @@
 
 namespace MercEx {
 
+// Batch buffers owned by one producer. They go out with publish() and come
+// back here once dispatched, so a producer that filled its pool up front
+// always gets a buffer with the capacity it reserved, never one another
+// producer left behind or a fresh empty one that would allocate on first use.
+class EventBufferPool {
+public:
+    EventBufferPool(std::size_t count, std::size_t capacity);
+
+    // False while every buffer is in flight to the publisher.
+    bool try_acquire(std::vector<MarketEvent>& buffer);
+    // Called by the publisher once the buffer's batch has been dispatched.
+    void release(std::vector<MarketEvent>&& buffer);
+
+private:
+    moodycamel::ConcurrentQueue<std::vector<MarketEvent>, GuardedQueueTraits> free_;
+};
+
+// A producer's own sub-queue in the publish queue (see
+// MarketDataPublisher::prepare_producer()).
+using PublishToken = moodycamel::ProducerToken;
+
 class MarketDataPublisher {
 public:
-    MarketDataPublisher();
+    explicit MarketDataPublisher(ExecutionMode mode = ExecutionMode::Threaded,
+                                 ThreadPlacement placement = {});
     ~MarketDataPublisher();
 
     void publish(const std::vector<MarketEvent>& events);
+    // Hands the batch over without copying. The vector is left empty, and in
+    // threaded mode its storage comes back once the batch has been
+    // dispatched: to pool when one is given, otherwise through
+    // acquire_buffer(). Inline mode leaves the storage in place. A producer
+    // with a token from prepare_producer() publishes through it.
+    void publish(std::vector<MarketEvent>&& events, EventBufferPool* pool = nullptr,
+                 PublishToken* token = nullptr);
+
+    // An empty batch buffer, recycled from earlier publishes without a pool
+    // when one is free. Producers that must not allocate use an
+    // EventBufferPool instead.
+    std::vector<MarketEvent> acquire_buffer();
+    // Creates a producer's own sub-queue in the publish queue, in token, and
+    // grows it to hold batches unconsumed batches, which its publishes would
+    // otherwise allocate. Growing it takes a round of empty batches through
+    // the publisher thread; false if they were not all dispatched within
+    // timeout, as when the thread has stopped, and the sub-queue may then
+    // still allocate. Inline publishers have no queue: token stays empty.
+    bool prepare_producer(std::unique_ptr<PublishToken>& token, std::size_t batches = 1,
+                          std::chrono::milliseconds timeout = std::chrono::seconds(1));
 
     void subscribe(IMarketDataListener* listener);
 
+    // Batches published but not yet dispatched to listeners: the publisher's lag.
+    std::size_t pending_batches() const { return event_queue_.size_approx(); }
+    uint64_t dispatched_events() const { return dispatched_events_.load(std::memory_order_relaxed); }
+
 private:
+    struct Batch {
+        std::vector<MarketEvent> events;
+        EventBufferPool* pool = nullptr; // where the storage goes after dispatch
+        std::shared_ptr<std::atomic<bool>> drained; // set when dequeued (see prepare_producer())
+    };
+
     void run();
+    void dispatch(const std::vector<MarketEvent>& events);
+    void recycle(Batch&& batch);
+
+    // Buffers kept for reuse beyond this are released instead.
+    static constexpr std::size_t kMaxRecycledBuffers = 4096;
 
     std::vector<IMarketDataListener*> listeners_;
-    moodycamel::BlockingConcurrentQueue<std::vector<MarketEvent>> event_queue_;
+    moodycamel::BlockingConcurrentQueue<Batch, GuardedQueueTraits> event_queue_;
+    moodycamel::ConcurrentQueue<std::vector<MarketEvent>, GuardedQueueTraits> recycled_;
     
+    ExecutionMode mode_;
+    ThreadPlacement placement_;
+    std::atomic<uint64_t> dispatched_events_{0};
     std::atomic<bool> running_{false};
     std::thread worker_;
 };
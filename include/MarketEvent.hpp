@@ -2,6 +2,7 @@
 #include <cstdint>
 #include <optional>
 #include "Order.hpp"
+#include "EngineClock.hpp"
 #include <iostream>
 namespace MercEx
 {
@@ -12,7 +13,9 @@ namespace MercEx
         FilledOrder,
         CancelOrder,
         Trade,
-        StopTriggered
+        StopTriggered,
+        ModifyOrder, // inbound only: quantity is the new order quantity, price the new limit if set
+        Replenish    // an iceberg showed its next slice, quantity, and went to the back of its level
     };
 
     struct MarketEvent
@@ -21,7 +24,7 @@ namespace MercEx
 
         TimePoint timestamp;
         OrderID order_id;
-        ClientID client_id;
+        ClientID client_id = 0; // 0: the operator, or no client
         std::string symbol;
         Quantity quantity;
         Side side;
@@ -29,53 +32,70 @@ namespace MercEx
         std::optional<Price> stop_price;
         std::optional<OrderType> order_type;
         std::optional<TimeInForce> tif;
+        Quantity display_qty = 0; // icebergs: size of the displayed slice
 
         std::optional<OrderID> counterparty_id;
         std::optional<Price> executed_price;
         std::optional<Quantity> executed_qty;
 
+        std::optional<Peg> peg = std::nullopt; // pegged orders: what the price follows
+
+        MarketID market_id = 0; // published events: set by the market that published them
+
         static MarketEvent make_add(OrderID id, ClientID client_id, const std::string &symbol,
                                     Quantity quantity, Side side,
                                     std::optional<Price> price = std::nullopt,
                                     std::optional<Price> stop_price = std::nullopt,
                                     OrderType type = OrderType::Limit,
-                                    TimeInForce tif = TimeInForce::Day)
+                                    TimeInForce tif = TimeInForce::Day,
+                                    Quantity display_qty = 0)
         {
-            return {MarketEventType::AddOrder, std::chrono::steady_clock::now(), id, client_id, symbol, quantity, side,
-                    price, stop_price, type, tif,
+            return {MarketEventType::AddOrder, EngineClock::now(), id, client_id, symbol, quantity, side,
+                    price, stop_price, type, tif, display_qty,
                     std::nullopt, std::nullopt, std::nullopt};
         }
 
         static MarketEvent make_filled(OrderID id, const std::string &symbol)
         {
-            return {MarketEventType::FilledOrder, std::chrono::steady_clock::now(), id, 0, symbol, 0, Side::Buy,
-                    std::nullopt, std::nullopt, std::nullopt, std::nullopt,
+            return {MarketEventType::FilledOrder, EngineClock::now(), id, 0, symbol, 0, Side::Buy,
+                    std::nullopt, std::nullopt, std::nullopt, std::nullopt, 0,
                     std::nullopt, std::nullopt, std::nullopt};
         }
 
         static MarketEvent make_cancel(OrderID id, const std::string &symbol)
         {
-            return {MarketEventType::CancelOrder, std::chrono::steady_clock::now(), id, 0, symbol, 0, Side::Buy,
-                    std::nullopt, std::nullopt, std::nullopt, std::nullopt,
+            return {MarketEventType::CancelOrder, EngineClock::now(), id, 0, symbol, 0, Side::Buy,
+                    std::nullopt, std::nullopt, std::nullopt, std::nullopt, 0,
                     std::nullopt, std::nullopt, std::nullopt};
         }
 
+        // quantity is what the resting order still shows after the trade: an
+        // iceberg's hidden reserve is never published, and execution reports
+        // work out its leaves from the order itself.
         static MarketEvent make_trade(OrderID id, OrderID counterparty_id,
-                                      Price trade_price, Quantity trade_qty)
+                                      Price trade_price, Quantity trade_qty, Quantity resting_shown)
         {
-            return {MarketEventType::Trade, std::chrono::steady_clock::now(), id, 0, "", 0, Side::Buy,
-                    std::nullopt, std::nullopt, std::nullopt, std::nullopt,
+            return {MarketEventType::Trade, EngineClock::now(), id, 0, "", resting_shown, Side::Buy,
+                    std::nullopt, std::nullopt, std::nullopt, std::nullopt, 0,
                     counterparty_id, trade_price, trade_qty};
         }
 
+        static MarketEvent make_replenish(OrderID id, const std::string &symbol, Quantity slice, Side side,
+                                          Price price)
+        {
+            return {MarketEventType::Replenish, EngineClock::now(), id, 0, symbol, slice, side,
+                    price, std::nullopt, OrderType::Iceberg, std::nullopt, 0,
+                    std::nullopt, std::nullopt, std::nullopt};
+        }
+
         static MarketEvent make_stop_triggered(OrderID id, ClientID client_id, const std::string &symbol,
                                                Quantity quantity, Side side,
                                                Price stop_price,
                                                OrderType type = OrderType::Stop,
                                                TimeInForce tif = TimeInForce::Day)
         {
-            return {MarketEventType::StopTriggered, std::chrono::steady_clock::now(), id, client_id, symbol, quantity, side,
-                    std::nullopt, stop_price, type, tif,
+            return {MarketEventType::StopTriggered, EngineClock::now(), id, client_id, symbol, quantity, side,
+                    std::nullopt, stop_price, type, tif, 0,
                     std::nullopt, std::nullopt, std::nullopt};
         }
 
@@ -92,8 +112,12 @@ namespace MercEx
                           << ", Price=" << (event.price ? std::to_string(*event.price) : "MKT")
                           << ", StopPrice=" << (event.stop_price ? std::to_string(*event.stop_price) : "N/A")
                           << ", Type=" << (event.order_type ? to_string(*event.order_type) : "N/A")
-                          << ", TIF=" << (event.tif ? to_string(*event.tif) : "N/A")
-                          << std::endl;
+                          << ", TIF=" << (event.tif ? to_string(*event.tif) : "N/A");
+                if (event.display_qty)
+                    std::cout << ", Display=" << event.display_qty;
+                if (event.peg)
+                    std::cout << ", Peg=" << to_string(event.peg->reference) << "%+" << event.peg->offset;
+                std::cout << std::endl;
                 break;
             case MarketEventType::FilledOrder:
                 std::cout << "[EVENT] Order Filled: ID=" << event.order_id
@@ -123,6 +147,22 @@ namespace MercEx
                           << ", TIF=" << (event.tif ? to_string(*event.tif) : "N/A")
                           << std::endl;
                 break;
+            case MarketEventType::ModifyOrder:
+                std::cout << "[EVENT] Modify Order: ID=" << event.order_id
+                          << ", ClientID=" << event.client_id
+                          << ", Symbol=" << event.symbol
+                          << ", Qty=" << event.quantity
+                          << ", Price=" << (event.price ? std::to_string(*event.price) : "unchanged")
+                          << std::endl;
+                break;
+            case MarketEventType::Replenish:
+                std::cout << "[EVENT] Iceberg Replenished: ID=" << event.order_id
+                          << ", Symbol=" << event.symbol
+                          << ", Qty=" << event.quantity
+                          << ", Side=" << to_string(event.side)
+                          << ", Price=" << (event.price ? std::to_string(*event.price) : "N/A")
+                          << std::endl;
+                break;
             default:
                 std::cout << "[EVENT] Unknown event type" << std::endl;
                 break;
@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace MercEx
+{
+
+    // Counter with a single writing thread: add() is a relaxed load and store
+    // rather than a locked read-modify-write, so it costs the same as bumping a
+    // plain integer. Any thread may read it.
+    class SingleWriterCounter
+    {
+    public:
+        void add(std::uint64_t n = 1) noexcept
+        {
+            value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+        std::uint64_t value() const noexcept { return value_.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<std::uint64_t> value_{0};
+    };
+
+    // Counters and gauges of one market, written only by the thread that
+    // processes the market's events and read by metrics scrapers.
+    struct alignas(64) MarketMetrics
+    {
+        SingleWriterCounter orders_in;      // AddOrder events processed
+        SingleWriterCounter trades;
+        SingleWriterCounter cancels;
+        SingleWriterCounter cancel_rejects;
+        SingleWriterCounter modifies;
+        SingleWriterCounter modify_rejects;
+        SingleWriterCounter rejects;        // orders rejected by the market itself
+        SingleWriterCounter publish_stalls; // waits for the publisher to return a batch buffer
+
+        std::atomic<std::uint64_t> bid_levels{0};
+        std::atomic<std::uint64_t> ask_levels{0};
+        std::atomic<std::uint64_t> stop_levels{0};
+    };
+
+}
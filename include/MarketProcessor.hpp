@@ -3,6 +3,13 @@
 #include "Market.hpp"
 #include "MarketEvent.hpp"
 #include "MarketDataPublisher.hpp"
+#include "ExecutionReportRouter.hpp"
+#include "ExecutionMode.hpp"
+#include "MarketMetrics.hpp"
+#include "ThreadPlacement.hpp"
+#include "HugePageArena.hpp"
+#include "MarketCapacity.hpp"
+#include "AllocationGuard.hpp"
 #include <unordered_map>
 #include <list>
 #include <map>
@@ -17,14 +24,23 @@ namespace MercEx
     class MarketProcessor
     {
     public:
-        explicit MarketProcessor(std::unique_ptr<Market> m, MarketDataPublisher& publisher);
+        MarketProcessor(std::unique_ptr<Market> m, MarketDataPublisher& publisher,
+                        ExecutionReportRouter* reports = nullptr,
+                        ExecutionMode mode = ExecutionMode::Threaded,
+                        ThreadPlacement placement = {},
+                        std::unique_ptr<MarketMemory> memory = nullptr,
+                        const MarketCapacity &capacity = {});
         ~MarketProcessor();
 
         void start();
         void stop();
+        // AddOrder and ModifyOrder events must already be normalized;
+        // MatchingEngine does this.
         void submit_event(const MarketEvent &ev);
+        void submit_events(std::vector<MarketEvent> &events);
 
         Market &get_market();
+        const Market &get_market() const;
         MarketID get_market_id() const;
 
         double get_average_latency_ms() const
@@ -34,26 +50,69 @@ namespace MercEx
             return (total_latency_ns / 1e6) / processed_orders; // convert ns → ms
         }
 
+        uint64_t get_rejected_orders() const { return metrics_.rejects.value(); }
+
+        const MarketMetrics &metrics() const { return metrics_; }
+        // Events waiting in the market queue; approximate while producers run.
+        std::size_t queue_depth() const { return queue.size_approx(); }
+
     private:
         void run();
-        void handle_event(MarketEvent &ev);
+        void process(const MarketEvent &ev);
+        void handle_event(const MarketEvent &ev);
+        // An AddOrder carrying every field its order type needs.
+        static bool is_well_formed(const MarketEvent &ev);
         void check_stop_orders();
-        void handle_market_events(const std::vector<MarketEvent> &events);
+        void handle_market_events();
+        void next_event_buffer();
+        void update_depth_gauges();
+        // True when the market is ready to run allocation-free.
+        bool warm_up();
+        void execute(Order &order, bool acknowledge = true);
+        bool cancel_stop_order(Order *order);
+        RejectReason check_modify(const Order &order, const MarketEvent &ev) const;
+        void modify(Order &order, Quantity quantity, std::optional<Price> price);
+
+        void report(ExecType type, const Order &order, RejectReason reason = RejectReason::None);
+        void report(ExecType type, OrderID order_id, ClientID client_id, RejectReason reason);
+        // acknowledge, when set, is reported first with leaves_before: New for
+        // an order entering, Replaced for one a modify moved.
+        void report_execution(const Order &order, std::optional<ExecType> acknowledge, Quantity leaves_before,
+                              const std::vector<MarketEvent> &events);
 
+        // Declared first so it outlives everything allocated from it. When
+        // null the market uses the global heap.
+        std::unique_ptr<MarketMemory> memory_;
         std::unique_ptr<Market> market;
 
-        moodycamel::ConcurrentQueue<MarketEvent> queue;
+        moodycamel::ConcurrentQueue<MarketEvent, GuardedQueueTraits> queue;
         std::atomic<bool> running{false};
         std::thread worker;
 
-        std::unordered_map<OrderID, std::unique_ptr<Order>> orders_local_;
+        std::pmr::memory_resource *resource();
+
+        std::pmr::unordered_map<OrderID, Order> orders_local_;
 
         uint64_t total_latency_ns = 0;
         size_t processed_orders = 0;
+        MarketMetrics metrics_;
+
+        std::pmr::map<Price, OrderList, std::greater<>> stop_buy_orders_;
+        std::pmr::map<Price, OrderList, std::less<>> stop_sell_orders_;
 
-        std::map<Price, std::list<Order *>, std::greater<>> stop_buy_orders_;
-        std::map<Price, std::list<Order *>, std::less<>> stop_sell_orders_;
+        // Events of the order being executed; handed to the publisher after
+        // each execution and replaced by a recycled buffer. A warmed-up
+        // threaded market takes them from its own pool, sized by the
+        // capacity hints, so publishing never leaves it without capacity.
+        std::vector<MarketEvent> events_;
+        std::unique_ptr<EventBufferPool> event_buffers_;
+        std::unique_ptr<PublishToken> publish_token_; // set by warm_up() when threaded
 
         MarketDataPublisher& publisher_;
+        ExecutionReportRouter* reports_;
+        std::size_t report_producer_ = ExecutionReportRouter::kNoProducer; // set by warm_up()
+        ExecutionMode mode_;
+        ThreadPlacement placement_;
+        MarketCapacity capacity_;
     };
 } // namespace MercEx
@@ -1,5 +1,8 @@
 #pragma once
 #include "MarketProcessor.hpp"
+#include "OrderIdGenerator.hpp"
+#include <atomic>
+#include <functional>
 #include <unordered_map>
 #include <memory>
 #include <string>
@@ -8,15 +11,44 @@ namespace MercEx {
 
 class MarketRegistry {
 public:
-    explicit MarketRegistry(MarketDataPublisher& publisher);
-    MarketProcessor& create_market(const std::string& symbol, double price_tick, uint16_t market_id);
+    explicit MarketRegistry(MarketDataPublisher& publisher, ExecutionReportRouter* reports = nullptr,
+                            ExecutionMode mode = ExecutionMode::Threaded);
+    // placement applies to the market's worker thread (ignored in inline mode).
+    // A non-zero memory.bytes gives the market its own huge-page arena for
+    // books, stop levels and orders, placed on the worker's NUMA node unless
+    // memory.numa_node says otherwise.
+    // Capacity hints make the market warm up before its first event and, in
+    // threaded mode, run allocation-free after that (see MarketCapacity.hpp);
+    // with hints and no memory.bytes the arena is sized from the hints.
+    // Throws std::invalid_argument for a symbol or ID already in use, or a
+    // symbol longer than CaptureRecord::kSymbolSize (16 bytes).
+    MarketProcessor& create_market(const std::string& symbol, double price_tick, uint16_t market_id,
+                                   const ThreadPlacement& placement = {}, const ArenaConfig& memory = {},
+                                   const MarketCapacity& capacity = {});
     MarketProcessor* get_market_processor(const std::string& symbol);
+    // Safe to call from gateway threads while markets are being created: a
+    // market is published here only once it is fully constructed and started.
+    MarketProcessor* get_market_processor(MarketID market_id);
+    // Unpublishes the market before destroying it; callers must still stop
+    // submitting to it first, since a pointer they already hold dangles.
     bool remove_market(const std::string& symbol);
     void print_markets() const;
 
+    // Markets are created and removed during setup only; looking one up by
+    // symbol or visiting them while that happens on another thread is not safe.
+    void for_each_market(const std::function<void(const MarketProcessor&)>& fn) const;
+
+    OrderIdGenerator& order_ids() { return order_ids_; }
+    ExecutionReportRouter* get_report_router() const { return reports_; }
+
 private:
     std::unordered_map<std::string, std::unique_ptr<MarketProcessor>> processors_;
+    // Indexed by MarketID and read without a lock by the order path.
+    std::unique_ptr<std::atomic<MarketProcessor*>[]> by_id_;
+    OrderIdGenerator order_ids_;
     MarketDataPublisher& publisher_;
+    ExecutionReportRouter* reports_;
+    ExecutionMode mode_;
 };
 
 } // namespace MercEx
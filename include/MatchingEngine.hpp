@@ -1,37 +1,148 @@
 #pragma once
 #include "MarketRegistry.hpp"
 #include "MarketEvent.hpp"
+#include "OrderIdGenerator.hpp"
+#include "OrderRequest.hpp"
+#include "OrderCapture.hpp"
+#include "RejectReason.hpp"
 #include <atomic>
-#include <unordered_map>
+#include <map>
 #include <memory>
+#include <shared_mutex>
+#include <vector>
 
 namespace MercEx
 {
 
+    // What the engine did with a submitted order. An order that reaches its
+    // market's pre-trade stage gets an ID even when that stage rejects it; the
+    // Rejected report carries the ID and the reason. reason is set here only
+    // when the order never got that far: no such market.
+    struct SubmitResult
+    {
+        OrderID order_id = 0;
+        RejectReason reason = RejectReason::None;
+
+        explicit operator bool() const { return reason == RejectReason::None; }
+    };
+
     class MatchingEngine
     {
     public:
         explicit MatchingEngine(MarketRegistry &registry);
 
-        OrderID submit_order(ClientID client_id,
-                             const std::string &symbol,
-                             Quantity quantity,
-                             Side side,
-                             std::optional<Price> price,
-                             OrderType type,
-                             TimeInForce tif,
-                             std::optional<Price> stop_price = std::nullopt);
+        SubmitResult submit_order(ClientID client_id,
+                                  const std::string &symbol,
+                                  Quantity quantity,
+                                  Side side,
+                                  std::optional<Price> price,
+                                  OrderType type,
+                                  TimeInForce tif,
+                                  std::optional<Price> stop_price = std::nullopt,
+                                  Quantity display_qty = 0,
+                                  std::optional<Peg> peg = std::nullopt);
+
+        // Submits an order under an ID request.client_id took from
+        // reserve_order_ids(). An ID outside that client's blocks for this
+        // market is refused as InvalidOrder, and so, by the market, is one
+        // already in use.
+        SubmitResult submit_order(OrderID id, const OrderRequest &request);
+
+        // Submits an order under the ID it was captured with, for replay
+        // tools re-running a capture into a fresh engine. The ID is taken as
+        // issued: the market's counter moves past it so it is never issued
+        // again. A repeated ID is still refused by the market.
+        SubmitResult replay_order(OrderID id, const OrderRequest &request);
+
+        // The cancel or modify only reaches orders owned by client_id, and its
+        // CancelRejected or ReplaceRejected report goes to that client. Client 0
+        // is the operator: it may cancel or modify any order.
+        bool cancel_order(OrderID id, const std::string &symbol, ClientID client_id);
+
+        // Cancel/replace in one event. quantity is the new order quantity,
+        // fills included; price, when set, the new limit price. A reduction at
+        // the same price keeps the order's place in the queue; a new price or
+        // a larger quantity sends it to the back of its new level, matching
+        // whatever it now crosses. The outcome is reported as Replaced or
+        // ReplaceRejected.
+        bool modify_order(OrderID id, const std::string &symbol, ClientID client_id, Quantity quantity,
+                          std::optional<Price> price = std::nullopt);
 
-        bool cancel_order(OrderID id, const std::string &symbol);
+        // Market-ID variants for gateways, whose wire protocols carry the
+        // numeric ID rather than the symbol.
+        SubmitResult submit_order(MarketID market_id,
+                                  ClientID client_id,
+                                  Quantity quantity,
+                                  Side side,
+                                  std::optional<Price> price,
+                                  OrderType type,
+                                  TimeInForce tif,
+                                  std::optional<Price> stop_price = std::nullopt,
+                                  Quantity display_qty = 0,
+                                  std::optional<Peg> peg = std::nullopt);
+        bool cancel_order(OrderID id, MarketID market_id, ClientID client_id);
+        bool modify_order(OrderID id, MarketID market_id, ClientID client_id, Quantity quantity,
+                          std::optional<Price> price = std::nullopt);
+
+        // Batch variants: requests are grouped by market and handed to each market
+        // queue with a single bulk enqueue. Orders for the same market receive a
+        // contiguous ID range; results are returned in request order, and a
+        // request for an unknown market fails alone as UnknownMarket.
+        std::vector<SubmitResult> submit_orders(const std::vector<OrderRequest> &requests);
+        std::size_t cancel_orders(const std::vector<CancelRequest> &requests);
+
+        // Reserves a block of IDs for a market so a gateway can number its
+        // orders locally instead of hitting the shared counter per order. Only
+        // client_id may submit under them. The block is empty when there is
+        // no such market.
+        OrderIdBlock reserve_order_ids(const std::string &symbol, ClientID client_id, uint64_t count);
+
+        // Taps every inbound order, cancel and modify, before validation, into a
+        // capture file. Set before submitting; nullptr turns capture off.
+        void set_capture(CaptureWriter *capture) { capture_ = capture; }
+
+        // Orders rejected by pre-trade validation before reaching a market queue.
+        uint64_t rejected_orders() const { return rejected_orders_.value.load(std::memory_order_relaxed); }
 
         //const Order *get_order(OrderID id, const std::string &symbol) const;
 
     private:
         MarketRegistry &registry_;
 
-        std::unordered_map<uint16_t, std::atomic<uint64_t>> market_counters_;
+        struct alignas(64) Counter
+        {
+            std::atomic<uint64_t> value{0};
+        };
+        Counter rejected_orders_;
+        CaptureWriter *capture_ = nullptr;
+
+        // Blocks handed out by reserve_order_ids(), keyed by first ID. A block
+        // that continues its owner's previous one extends it, so a caller
+        // reserving one ID at a time keeps a single entry.
+        struct ReservedBlock
+        {
+            OrderID end;
+            ClientID client_id;
+        };
+        mutable std::shared_mutex blocks_mutex_;
+        std::map<OrderID, ReservedBlock> blocks_;
+
+        bool is_reserved(OrderID id, ClientID client_id) const;
+
+        OrderID generate_order_id(MarketID market_id);
 
-        OrderID generate_order_id(uint16_t market_id);
+        // Pre-trade stage, run on the submitting thread: validates and normalizes
+        // the event in place, or rejects it. Only events that pass are enqueued.
+        SubmitResult submit_new(MarketProcessor &processor, OrderID id, ClientID client_id, Quantity quantity,
+                                Side side, std::optional<Price> price, OrderType type, TimeInForce tif,
+                                std::optional<Price> stop_price, Quantity display_qty, std::optional<Peg> peg);
+        bool pre_trade(MarketProcessor &processor, MarketEvent &ev);
+        void submit_cancel(MarketProcessor &processor, OrderID id, ClientID client_id);
+        void submit_modify(MarketProcessor &processor, OrderID id, ClientID client_id, Quantity quantity,
+                           std::optional<Price> price);
+        void capture(const MarketProcessor &processor, const MarketEvent &ev);
+        void reject(OrderID id, ClientID client_id, Side side, RejectReason reason,
+                    ExecType type = ExecType::Rejected);
     };
 
 } // namespace MercEx
@@ -0,0 +1,50 @@
+#pragma once
+#include "MetricsRegistry.hpp"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace MercEx
+{
+
+    struct MetricsExporterConfig
+    {
+        // Rewritten atomically (write then rename) every interval, for the
+        // node exporter's textfile collector or anything that tails it.
+        std::string file_path;
+        // Unix domain socket; each connection receives a fresh scrape and is
+        // closed. Not supported on Windows.
+        std::string socket_path;
+        std::chrono::milliseconds interval{1000};
+    };
+
+    // Scraper thread that periodically collects a MetricsRegistry and serves
+    // the result. Collection only reads atomics, so the engine's threads are
+    // never blocked by it.
+    class MetricsExporter
+    {
+    public:
+        MetricsExporter(const MetricsRegistry &metrics, MetricsExporterConfig config);
+        ~MetricsExporter();
+
+        MetricsExporter(const MetricsExporter &) = delete;
+        MetricsExporter &operator=(const MetricsExporter &) = delete;
+
+        void start();
+        void stop();
+
+    private:
+        void run();
+        void write_file(const std::string &text) const;
+        void open_socket();
+        void serve_client(int client) const;
+
+        const MetricsRegistry &metrics_;
+        MetricsExporterConfig config_;
+        int listen_fd_ = -1;
+        std::atomic<bool> running_{false};
+        std::thread worker_;
+    };
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace MercEx
+{
+
+    class MarketRegistry;
+    class MatchingEngine;
+    class MarketDataPublisher;
+    class ExecutionReportRouter;
+
+    enum class MetricType
+    {
+        Counter,
+        Gauge
+    };
+
+    // Writes samples in the Prometheus text exposition format. Each family is
+    // announced once with family(), followed by its samples.
+    class MetricsWriter
+    {
+    public:
+        explicit MetricsWriter(std::ostream &os) : os_(os) {}
+
+        void family(const std::string &name, MetricType type, const std::string &help);
+        // labels is the inside of the braces, e.g. market="AAPL",side="bid".
+        void sample(const std::string &name, std::uint64_t value, const std::string &labels = "");
+        void sample(const std::string &name, double value, const std::string &labels = "");
+
+    private:
+        void write_name(const std::string &name, const std::string &labels);
+
+        std::ostream &os_;
+    };
+
+    using MetricsCollector = std::function<void(MetricsWriter &)>;
+
+    // Collectors read the engine's counters and gauges, which are all atomics
+    // updated by their owning threads, so a scrape never blocks the hot path.
+    class MetricsRegistry
+    {
+    public:
+        void add_collector(MetricsCollector collector);
+
+        void collect(std::ostream &os) const;
+        std::string scrape() const;
+
+    private:
+        mutable std::mutex mutex_;
+        std::vector<MetricsCollector> collectors_;
+    };
+
+    // Registers the standard engine metrics: per-market order, trade, cancel
+    // and reject counters, queue depth and book levels, pre-trade rejects,
+    // publisher lag and dropped execution reports. Any pointer may be null.
+    void register_engine_metrics(MetricsRegistry &metrics, const MarketRegistry &markets,
+                                 const MatchingEngine *engine = nullptr,
+                                 const MarketDataPublisher *publisher = nullptr,
+                                 const ExecutionReportRouter *reports = nullptr);
+
+}
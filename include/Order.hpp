@@ -5,6 +5,8 @@
 #include <chrono>
 #include <memory>
 #include <list>
+#include <memory_resource>
+#include "RejectReason.hpp"
 
 namespace MercEx
 {
@@ -27,7 +29,9 @@ namespace MercEx
         Limit,
         Market,
         Stop,
-        StopLimit
+        StopLimit,
+        Iceberg, // limit order showing display_qty at a time
+        Pegged   // limit order whose price follows a reference (see Peg)
     };
     enum class TimeInForce : std::uint8_t
     {
@@ -36,20 +40,44 @@ namespace MercEx
         FOK,
         GTC
     };
+    // Price a pegged order follows. The references are the best bid and ask
+    // set by orders that are not pegged themselves, so pegs never follow one
+    // another.
+    enum class PegReference : std::uint8_t
+    {
+        BestBid,
+        BestAsk,
+        Mid
+    };
+
+    // A pegged order rests at reference + offset, rounded away from the
+    // opposite side onto the tick grid and never locking or crossing it.
+    struct Peg
+    {
+        PegReference reference;
+        Price offset; // on tick, either sign
+    };
+
     enum class OrderStatus : std::uint8_t
     {
         New,
         PartiallyFilled,
         Filled,
         Canceled,
-        Expired
+        Expired,
+        Rejected
     };
 
     struct Order;
 
+    // FIFO of orders resting at one price level. Allocator-aware so a market
+    // can keep its book nodes in its own arena.
+    using OrderList = std::pmr::list<Order *>;
+
     std::string to_string(Side side);
     std::string to_string(OrderType type);
     std::string to_string(TimeInForce tif);
+    std::string to_string(PegReference reference);
     std::string to_string(OrderStatus status);
     std::string to_string(const Order &order);
 
@@ -71,8 +99,30 @@ namespace MercEx
         OrderStatus status;
         OrderType type;
         TimeInForce tif;
-        std::list<Order*>::iterator book_it = {};
-        
+        OrderList::iterator book_it = {};
+        // Icebergs only: the size of each displayed slice, and what is left of
+        // the current one. The rest of remaining is hidden.
+        Quantity display_qty = 0;
+        Quantity visible = 0;
+
+        // Pegged orders only: what the price follows, and the order's place
+        // in the market's index of pegs.
+        std::optional<Peg> peg;
+        OrderList::iterator peg_it = {};
+
+        bool is_iceberg() const { return display_qty > 0; }
+        // What the book shows of the order.
+        Quantity shown() const { return is_iceberg() ? visible : remaining; }
+
+        // Builds an order of any type without validating it; callers that have
+        // already run check_order() use this to skip the throwing validate().
+        // make() returns it by value for callers that own the storage.
+        static Order make(OrderID id, ClientID client_id, const std::string &symbol,
+                          Quantity quantity, std::optional<Price> price, std::optional<Price> stop_price,
+                          Side side, OrderType type, TimeInForce tif);
+        static std::unique_ptr<Order> make_order(OrderID id, ClientID client_id, const std::string &symbol,
+                                Quantity quantity, std::optional<Price> price, std::optional<Price> stop_price,
+                                Side side, OrderType type, TimeInForce tif);
         static std::unique_ptr<Order> make_limit_order(OrderID id, ClientID client_id, const std::string &symbol,
                                       Quantity quantity, Price price, Side side, TimeInForce tif);
         static std::unique_ptr<Order> make_market_order(OrderID id, ClientID client_id, const std::string &symbol,
@@ -82,6 +132,7 @@ namespace MercEx
         static std::unique_ptr<Order> make_stop_limit_order(OrderID id, ClientID client_id, const std::string &symbol,
                                       Quantity quantity, Price price, Price stop_price, Side side, TimeInForce tif);
 
+        RejectReason check() const noexcept;
         void validate() const;
     };
 
@@ -0,0 +1,138 @@
+#pragma once
+#include "OrderRequest.hpp"
+#include "MarketEvent.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace MercEx
+{
+
+    // Capture file layout (host byte order, little-endian on every supported
+    // target): one 64-byte CaptureFileHeader followed by fixed 64-byte
+    // CaptureRecords. A market is described by a DefineMarket record before
+    // its first order, so a capture is self-contained and a replay can build
+    // the same registry without any side configuration.
+
+    enum class CaptureRecordType : std::uint8_t
+    {
+        DefineMarket = 1, // price = tick size, symbol/market_id define the market
+        Submit = 2,
+        Cancel = 3,
+        Modify = 4 // quantity = new order quantity; price = new limit when kHasPrice
+    };
+
+    struct CaptureRecord
+    {
+        static constexpr std::uint8_t kHasPrice = 0x1;
+        static constexpr std::uint8_t kHasStopPrice = 0x2;
+        static constexpr std::uint8_t kHasDisplayQty = 0x4; // iceberg: stop_price holds the display quantity
+        static constexpr std::uint8_t kHasPeg = 0x8;        // pegged: price holds the offset, peg_reference the reference
+        static constexpr std::size_t kSymbolSize = 16;
+
+        std::int64_t timestamp_ns; // EngineClock time when the engine received it
+        std::uint64_t order_id;
+        double price;
+        double stop_price;
+        std::int32_t quantity;
+        std::uint32_t client_id;
+        std::uint16_t market_id;
+        CaptureRecordType type;
+        Side side;
+        OrderType order_type;
+        TimeInForce tif;
+        std::uint8_t flags;
+        PegReference peg_reference;
+        char symbol[kSymbolSize]; // NUL-padded
+
+        std::string get_symbol() const;
+        // False for a Submit record that cannot be an order: a display
+        // quantity that is not a whole Quantity.
+        bool to_request(OrderRequest &out) const;
+    };
+    static_assert(sizeof(CaptureRecord) == 64, "CaptureRecord must stay 64 bytes");
+
+    struct CaptureFileHeader
+    {
+        static constexpr char kMagic[8] = {'M', 'E', 'R', 'C', 'A', 'P', '\0', '\0'};
+        static constexpr std::uint32_t kVersion = 1;
+
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t record_size;
+        std::uint8_t reserved[48];
+    };
+    static_assert(sizeof(CaptureFileHeader) == 64, "CaptureFileHeader must stay 64 bytes");
+
+    class UringJournal;
+
+    enum class CaptureBackend : std::uint8_t
+    {
+        Stdio,         // buffered fwrite
+        IoUring,       // UringJournal: asynchronous writes from registered buffers (Linux)
+        IoUringDurable // as IoUring, each write followed by an fdatasync
+    };
+
+    // Appends records to a capture file. Calls from several gateway threads
+    // are serialized so the file order is one total order of arrivals.
+    class CaptureWriter
+    {
+    public:
+        explicit CaptureWriter(const std::string &path, CaptureBackend backend = CaptureBackend::Stdio);
+        ~CaptureWriter();
+
+        CaptureWriter(const CaptureWriter &) = delete;
+        CaptureWriter &operator=(const CaptureWriter &) = delete;
+
+        // Records an inbound AddOrder, CancelOrder or ModifyOrder event as the engine
+        // received it, defining its market first if this is its first record.
+        void record(const MarketEvent &ev, MarketID market_id, double price_tick);
+        // Appends a record as is; used by generators that build records directly.
+        void append(const CaptureRecord &record);
+        // Hands everything appended so far to the OS; with
+        // CaptureBackend::IoUringDurable, returns once it is on stable storage.
+        void flush();
+
+        std::uint64_t records_written() const { return records_; }
+
+    private:
+        void define_market_locked(MarketID market_id, double price_tick, const std::string &symbol, TimePoint ts);
+        void write_locked(const CaptureRecord &record);
+
+        std::FILE *file_ = nullptr;
+        std::unique_ptr<UringJournal> journal_; // replaces file_ on the io_uring backends
+        std::mutex mutex_;
+        std::vector<bool> defined_;
+        std::uint64_t records_ = 0;
+    };
+
+    // Read-only view of a capture file, memory-mapped where available.
+    class CaptureReader
+    {
+    public:
+        explicit CaptureReader(const std::string &path);
+        ~CaptureReader();
+
+        CaptureReader(const CaptureReader &) = delete;
+        CaptureReader &operator=(const CaptureReader &) = delete;
+
+        const CaptureRecord *begin() const { return records_; }
+        const CaptureRecord *end() const { return records_ + count_; }
+        std::size_t size() const { return count_; }
+
+    private:
+        void *mapping_ = nullptr;
+        std::size_t mapping_size_ = 0;
+        std::vector<unsigned char> buffer_;
+        const CaptureRecord *records_ = nullptr;
+        std::size_t count_ = 0;
+    };
+
+    // symbol fits the record: MarketRegistry refuses longer ones.
+    CaptureRecord make_capture_record(CaptureRecordType type, OrderID id, MarketID market_id,
+                                      const std::string &symbol, TimePoint ts);
+
+}
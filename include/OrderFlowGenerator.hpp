@@ -0,0 +1,122 @@
+#pragma once
+#include "OrderCapture.hpp"
+#include "OrderIdGenerator.hpp"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace MercEx
+{
+
+    struct SymbolFlow
+    {
+        std::string symbol;
+        MarketID market_id;
+        double price_tick;
+        double mid_price;
+        double weight = 1.0; // share of the aggregate arrival rate, resolved to 1/4096
+    };
+
+    // Relative weights of the order types among adds.
+    struct FlowMix
+    {
+        double limit = 0.85;
+        double market = 0.05;
+        double stop = 0.05;
+        double stop_limit = 0.05;
+    };
+
+    struct OrderFlowConfig
+    {
+        std::vector<SymbolFlow> symbols;
+        double orders_per_second = 1e6;   // mean aggregate arrival rate, adds and cancels
+        FlowMix mix;
+        double cancel_to_add = 1.0;       // cancels per add
+        double modify_to_add = 0.0;       // modifies per add: a new quantity, half of them a new passive price
+        double aggressive_fraction = 0.1; // limit orders priced through the mid
+        double depth_ticks = 5.0;         // mean distance of passive limits from the mid
+        double mid_move_probability = 0.01;
+        Quantity max_quantity = 100;
+        ClientID clients = 100;           // client IDs drawn from [1, clients]
+
+        // Bursts: each order starts a burst with this probability; for the next
+        // burst_length orders the arrival rate is multiplied.
+        double burst_probability = 0.0;
+        double burst_rate_multiplier = 10.0;
+        std::uint32_t burst_length = 1000;
+
+        std::uint64_t seed = 1;
+        std::int64_t start_ns = 0;
+    };
+
+    // Produces a synthetic order stream as capture records, so the same output
+    // feeds a capture file, mercury_replay or a live MatchingEngine. Arrivals
+    // are Poisson, prices are whole ticks around a per-symbol mid doing a
+    // random walk, and cancels and modifies target orders this generator
+    // placed earlier.
+    // Generation is table driven and allocation free, so it stays far ahead
+    // of the engine it is loading.
+    class OrderFlowGenerator
+    {
+    public:
+        explicit OrderFlowGenerator(OrderFlowConfig config);
+
+        // DefineMarket records for every configured symbol; emit these first.
+        std::vector<CaptureRecord> market_definitions() const;
+
+        // Fills out[0, count) with the next records of the stream.
+        void generate(CaptureRecord *out, std::size_t count);
+
+    private:
+        static constexpr std::size_t kTableSize = 4096;
+        static constexpr std::size_t kLiveOrders = 1 << 16;
+
+        struct LiveOrder
+        {
+            OrderID order_id;
+            ClientID client_id; // cancels and modifies come from the owner
+            Side side;
+        };
+
+        struct SymbolState
+        {
+            CaptureRecord prototype; // symbol, market_id preset
+            double price_tick;
+            double ticks_per_unit;   // > 0 when 1/tick is integral
+            std::int64_t mid_ticks;
+            std::uint64_t next_seq = 0;
+            std::vector<LiveOrder> live; // ring of cancellable orders
+            std::size_t live_count = 0;
+        };
+
+        // xorshift64* on a caller-held state: generate() keeps it in a local,
+        // where the record stores cannot force it back to memory.
+        static std::uint64_t next_random(std::uint64_t &state);
+        double price_of(const SymbolState &s, std::int64_t ticks) const;
+        void make_add(SymbolState &s, CaptureRecord &r, std::uint64_t bits, std::uint64_t aux);
+        bool make_cancel(SymbolState &s, CaptureRecord &r, std::uint64_t bits);
+        bool make_modify(SymbolState &s, CaptureRecord &r, std::uint64_t bits);
+
+        OrderFlowConfig config_;
+        std::vector<SymbolState> symbols_;
+
+        std::array<double, kTableSize> exponential_{};
+        std::array<std::uint16_t, kTableSize> depth_{};
+        std::array<std::uint16_t, kTableSize> symbol_table_{};
+
+        std::uint32_t cancel_threshold_;
+        std::uint32_t modify_threshold_;
+        std::uint32_t type_thresholds_[3];
+        std::uint32_t aggressive_threshold_;
+        std::uint32_t mid_move_threshold_;
+        std::uint32_t burst_threshold_;
+
+        std::uint64_t rng_;
+        double now_ns_;
+        double mean_gap_ns_;
+        double burst_gap_ns_;
+        std::uint32_t burst_remaining_ = 0;
+    };
+
+}
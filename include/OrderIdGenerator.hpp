@@ -0,0 +1,65 @@
+#pragma once
+#include "Order.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+namespace MercEx
+{
+
+    // A contiguous range [next, end) of order IDs reserved for one market.
+    // A gateway thread can hand these out locally without touching shared state.
+    struct OrderIdBlock
+    {
+        OrderID next = 0;
+        OrderID end = 0;
+
+        bool empty() const { return next == end; }
+        std::uint64_t size() const { return end - next; }
+        OrderID take() { return next++; }
+    };
+
+    class OrderIdGenerator
+    {
+    public:
+        static constexpr std::size_t kMaxMarkets = std::size_t(std::numeric_limits<MarketID>::max()) + 1;
+        static constexpr unsigned kSequenceBits = 48;
+        static constexpr std::uint64_t kSequenceMask = (std::uint64_t(1) << kSequenceBits) - 1;
+
+        OrderIdGenerator();
+        ~OrderIdGenerator();
+        OrderIdGenerator(const OrderIdGenerator &) = delete;
+        OrderIdGenerator &operator=(const OrderIdGenerator &) = delete;
+
+        // Called once per market at registration, before any ID is generated for it.
+        // The counter is published with a release store, so a thread that sees the
+        // market registered also sees its counter; registrations themselves must
+        // not race each other.
+        void register_market(MarketID market_id);
+        bool is_registered(MarketID market_id) const;
+
+        OrderID next(MarketID market_id);
+        OrderIdBlock reserve(MarketID market_id, std::uint64_t count);
+
+        // Marks an ID issued elsewhere, such as one read back from a capture,
+        // as taken: its market's counter moves past it if it has not already.
+        void claim(OrderID id);
+
+        static MarketID market_of(OrderID id) { return static_cast<MarketID>(id >> kSequenceBits); }
+
+    private:
+        struct alignas(64) Counter
+        {
+            std::atomic<std::uint64_t> value{0};
+        };
+
+        Counter &counter(MarketID market_id);
+
+        // One slot per MarketID, written once at registration and read by every
+        // submitting thread.
+        std::unique_ptr<std::atomic<Counter *>[]> counters_;
+    };
+
+} // namespace MercEx
@@ -0,0 +1,30 @@
+#pragma once
+#include "Order.hpp"
+#include <optional>
+#include <string>
+
+namespace MercEx
+{
+
+    struct OrderRequest
+    {
+        ClientID client_id;
+        std::string symbol;
+        Quantity quantity;
+        Side side;
+        std::optional<Price> price;
+        OrderType type;
+        TimeInForce tif;
+        std::optional<Price> stop_price;
+        Quantity display_qty = 0; // icebergs only
+        std::optional<Peg> peg;   // pegged orders only
+    };
+
+    struct CancelRequest
+    {
+        OrderID order_id;
+        std::string symbol;
+        ClientID client_id = 0; // receives the CancelRejected report if the order is unknown
+    };
+
+}
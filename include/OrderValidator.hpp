@@ -0,0 +1,45 @@
+#pragma once
+#include "OrderRequest.hpp"
+#include "MarketEvent.hpp"
+#include "RejectReason.hpp"
+
+namespace MercEx
+{
+
+    // Non-throwing, allocation-free pre-trade checks. These run on the
+    // submitting thread so malformed orders never reach a market queue.
+
+    bool is_on_tick(Price price, double price_tick) noexcept;
+
+    // Snaps an on-tick price to the canonical double for its tick index, so the
+    // same level always maps to the same book key whatever the client sent.
+    Price snap_to_tick(Price price, double price_tick) noexcept;
+
+    // display_qty is only looked at for icebergs, which need 0 < display_qty <= quantity,
+    // and peg for pegged orders, which need one with an on-tick offset and no price.
+    // Stop prices must be on tick like limit prices; an off-tick one is an
+    // InvalidStopPrice.
+    RejectReason check_order(Quantity quantity, std::optional<Price> price, std::optional<Price> stop_price,
+                             OrderType type, double price_tick, Quantity display_qty = 0,
+                             const std::optional<Peg> &peg = std::nullopt) noexcept;
+
+    inline RejectReason check_order(const OrderRequest &request, double price_tick) noexcept
+    {
+        return check_order(request.quantity, request.price, request.stop_price, request.type, price_tick,
+                           request.display_qty, request.peg);
+    }
+
+    // Pre-trade stage for an AddOrder event: validates it, then rewrites it into
+    // the form the market worker assumes without re-checking. Limit and stop
+    // prices are snapped to the tick grid, a stop price on a non-stop order, a
+    // display quantity on a non-iceberg and a peg on an unpegged order are
+    // dropped, and market orders, which never rest, are made IOC. Pegged orders
+    // must rest: IOC and FOK are rejected.
+    RejectReason normalize_order(MarketEvent &ev, double price_tick) noexcept;
+
+    // Pre-trade stage for a ModifyOrder event: the new quantity must be
+    // positive and a new price valid and on tick; the price is snapped. What
+    // the order itself allows is checked by the market worker, which owns it.
+    RejectReason normalize_modify(MarketEvent &ev, double price_tick) noexcept;
+
+}
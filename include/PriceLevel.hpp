@@ -0,0 +1,72 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+#include "Order.hpp"
+
+namespace MercEx
+{
+
+    // One price level of a book: its FIFO of resting orders and the totals
+    // the level shows and holds back. visible is what market participants can
+    // see at the price (the current slice of an iceberg, all of any other
+    // order); hidden is the iceberg reserve behind it. Both are kept up to
+    // date on every add, fill, replenish, reduction and cancel, so depth
+    // queries and FOK checks never walk the queue. pegged counts the pegged
+    // orders in the queue: a level holding nothing else does not set a peg
+    // reference.
+    //
+    // Allocator-aware, so the book's map hands its memory resource on to the
+    // order list.
+    struct PriceLevel
+    {
+        using allocator_type = std::pmr::polymorphic_allocator<Order *>;
+
+        OrderList orders;
+        Quantity visible = 0;
+        Quantity hidden = 0;
+        std::uint32_t pegged = 0;
+
+        explicit PriceLevel(const allocator_type &alloc = {}) : orders(alloc) {}
+        PriceLevel(const PriceLevel &other, const allocator_type &alloc)
+            : orders(other.orders, alloc), visible(other.visible), hidden(other.hidden), pegged(other.pegged) {}
+        PriceLevel(PriceLevel &&other, const allocator_type &alloc)
+            : orders(std::move(other.orders), alloc), visible(other.visible), hidden(other.hidden), pegged(other.pegged) {}
+
+        Quantity total() const { return visible + hidden; }
+        bool empty() const { return orders.empty(); }
+        bool only_pegged() const { return orders.size() == pegged; }
+
+        void push_back(Order &order)
+        {
+            orders.push_back(&order);
+            order.book_it = std::prev(orders.end());
+            visible += order.shown();
+            hidden += order.remaining - order.shown();
+            pegged += order.type == OrderType::Pegged;
+        }
+
+        // Shrinks a queued order to remaining, keeping its place; an iceberg's
+        // slice shrinks with it when the rest no longer covers it.
+        void reduce(Order &order, Quantity remaining)
+        {
+            visible -= order.shown();
+            hidden -= order.remaining - order.shown();
+            order.remaining = remaining;
+            if (order.is_iceberg())
+                order.visible = std::min(order.visible, remaining);
+            visible += order.shown();
+            hidden += order.remaining - order.shown();
+        }
+
+        void erase(OrderList::iterator it)
+        {
+            const Order &order = **it;
+            visible -= order.shown();
+            hidden -= order.remaining - order.shown();
+            pegged -= order.type == OrderType::Pegged;
+            orders.erase(it);
+        }
+    };
+
+}
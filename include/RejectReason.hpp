@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace MercEx
+{
+
+    enum class RejectReason : std::uint8_t
+    {
+        None,
+        InvalidOrder,
+        UnknownMarket,
+        MarketInactive,
+        InvalidQuantity,
+        MissingPrice,
+        UnexpectedPrice,
+        InvalidPrice,
+        OffTickPrice,
+        MissingStopPrice,
+        InvalidStopPrice,
+        UnknownOrder,
+        TooLateToCancel,
+        InvalidDisplayQuantity,
+        InvalidPegOffset,
+        NoReferencePrice // pegged order entered while its reference is empty
+    };
+
+    std::string to_string(RejectReason reason);
+
+}
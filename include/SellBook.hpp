@@ -2,22 +2,27 @@
 #pragma once
 #include <cstdint>
 #include <map>
+#include <memory_resource>
 #include <list>
 #include <optional>
 #include <functional>
-#include "order.hpp"
+#include "Order.hpp"
+#include "PriceLevel.hpp"
 
 namespace MercEx {
 
     class SellBook {
     public:
-        SellBook() = default;
+        using Levels = std::pmr::map<Price, PriceLevel, std::less<>>;
 
-        std::list<Order*>::iterator add_order(Order& order);
-        bool cancel_order(OrderID id, Price price, std::list<Order*>::iterator it);
+        explicit SellBook(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : orders_(resource) {}
 
-        std::map<Price, std::list<Order*>, std::less<>>& get_orders() { return orders_; }
-        const std::map<Price, std::list<Order*>, std::less<>>& get_orders() const { return orders_; }
+        OrderList::iterator add_order(Order& order);
+        bool cancel_order(OrderID id, Price price, OrderList::iterator it);
+
+        Levels& get_orders() { return orders_; }
+        const Levels& get_orders() const { return orders_; }
 
         std::optional<std::reference_wrapper<Order>> get_best_order();
         std::optional<Price> get_best_ask() const;
@@ -26,7 +31,7 @@ namespace MercEx {
         std::size_t size() const;
 
     private:
-        std::map<Price, std::list<Order*>, std::less<>> orders_;
+        Levels orders_;
     };
 
 } // namespace MercEx
@@ -0,0 +1,57 @@
+#pragma once
+#include "IMarketDataListener.hpp"
+#include "MarketMetrics.hpp"
+#include "mercury_shm.h"
+#include <cstdint>
+#include <string>
+
+namespace MercEx
+{
+
+    struct ShmMarketDataFeedConfig
+    {
+        std::string name = "/mercury-md"; // shm_open name; the ring appears as /dev/shm/mercury-md
+        std::size_t capacity = 1 << 20;    // events held; rounded up to a power of two (64 bytes each)
+        bool unlink_on_close = true;       // remove the name when the feed is destroyed
+    };
+
+    // Market data for consumers on the same host: a listener that copies every
+    // event into a single-writer, many-reader ring in shared memory (layout in
+    // mercury_shm.h, which readers include on their own, from C or C++).
+    //
+    // The writer never waits for readers. Each reader keeps its own cursor
+    // and is told by the slot stamps when it has fallen more than capacity
+    // events behind; the ring has no idea who is attached. Size the ring for
+    // the longest stall a reader must survive.
+    //
+    // on_market_events runs on the publisher's dispatch thread, so the feed
+    // must outlive the publisher's dispatching.
+    class ShmMarketDataFeed : public IMarketDataListener
+    {
+    public:
+        // Creates (or replaces) the shared-memory object and maps it. Throws if
+        // it cannot.
+        explicit ShmMarketDataFeed(ShmMarketDataFeedConfig config = {});
+        ~ShmMarketDataFeed() override;
+
+        ShmMarketDataFeed(const ShmMarketDataFeed &) = delete;
+        ShmMarketDataFeed &operator=(const ShmMarketDataFeed &) = delete;
+
+        void on_market_events(const std::vector<MarketEvent> &events) override;
+
+        const std::string &name() const { return config_.name; }
+        std::size_t capacity() const { return capacity_; }
+        std::uint64_t events_written() const { return events_written_.value(); }
+
+    private:
+        ShmMarketDataFeedConfig config_;
+        std::size_t capacity_ = 0;
+        void *map_ = nullptr;
+        std::size_t map_size_ = 0;
+        mx_shm_header *header_ = nullptr;
+        mx_shm_event *slots_ = nullptr;
+        std::uint64_t next_ = 0; // sequence number of the next event
+        SingleWriterCounter events_written_;
+    };
+
+}
@@ -0,0 +1,172 @@
+#pragma once
+#include "BinaryProtocol.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace MercEx
+{
+
+    // Shared-memory order entry for co-located clients: one channel per
+    // client, created by ShmOrderGateway as a POSIX shared-memory object named
+    // <prefix>-<client id> (e.g. /dev/shm/mercury-oe-7).
+    //
+    // A channel is two single-producer, single-consumer rings of 64-byte
+    // slots, each slot holding one BinaryProtocol message: requests (NewOrder,
+    // Cancel, Modify) from the client to the gateway, and responses (OrderAck,
+    // Execution) back. There is no Login: the channel is the session, and
+    // one process at a time attaches to it.
+
+    inline constexpr std::uint64_t kShmOrderMagic = 0x4e4e414843454f4dULL; // "MOECHANN"
+    inline constexpr std::uint32_t kShmOrderVersion = 1;
+    inline constexpr std::size_t kShmOrderSlot = 64;
+
+    static_assert(kMaxMessageSize <= kShmOrderSlot, "every message must fit a slot");
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "ring indices are shared between processes");
+
+    struct ShmOrderChannelHeader
+    {
+        std::uint64_t magic;
+        std::uint32_t version;
+        std::uint32_t slot_size;
+        std::uint64_t capacity; // slots per ring; a power of two
+        ClientID client_id;
+
+        // Each index on its own cache line: the producer writes head, the
+        // consumer writes tail.
+        alignas(64) std::atomic<std::uint32_t> attached;
+        alignas(64) std::atomic<std::uint64_t> request_head;
+        alignas(64) std::atomic<std::uint64_t> request_tail;
+        alignas(64) std::atomic<std::uint64_t> response_head;
+        alignas(64) std::atomic<std::uint64_t> response_tail;
+    };
+
+    inline std::size_t shm_order_channel_size(std::uint64_t capacity)
+    {
+        return sizeof(ShmOrderChannelHeader) + 2 * capacity * kShmOrderSlot;
+    }
+
+    inline std::string shm_order_channel_name(const std::string &prefix, ClientID client_id)
+    {
+        return prefix + "-" + std::to_string(client_id);
+    }
+
+    // One direction of a channel, seen from one side. Each side caches the
+    // other's index and rereads the shared one only when its cached view says
+    // the ring is full (producer) or empty (consumer), so in a steady stream
+    // the two sides rarely touch the same cache line.
+    class ShmSpscRing
+    {
+    public:
+        ShmSpscRing() = default;
+        ShmSpscRing(std::atomic<std::uint64_t> *head, std::atomic<std::uint64_t> *tail, char *slots,
+                    std::uint64_t capacity)
+            : head_(head), tail_(tail), slots_(slots), mask_(capacity - 1),
+              cached_head_(head->load(std::memory_order_acquire)), cached_tail_(tail->load(std::memory_order_acquire))
+        {
+        }
+
+        // Producer side.
+        bool full()
+        {
+            std::uint64_t head = head_->load(std::memory_order_relaxed);
+            if (head - cached_tail_ <= mask_)
+                return false;
+            cached_tail_ = tail_->load(std::memory_order_acquire);
+            return head - cached_tail_ > mask_;
+        }
+
+        template <typename T>
+        bool push(const T &msg)
+        {
+            static_assert(sizeof(T) <= kShmOrderSlot, "message does not fit a slot");
+            if (full())
+                return false;
+            std::uint64_t head = head_->load(std::memory_order_relaxed);
+            std::memcpy(slots_ + (head & mask_) * kShmOrderSlot, &msg, sizeof(T));
+            head_->store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side: copies the oldest message into out, which must hold
+        // kShmOrderSlot bytes. The copy is taken before the slot is released,
+        // so a producer cannot change it under the reader.
+        bool pop(void *out)
+        {
+            std::uint64_t tail = tail_->load(std::memory_order_relaxed);
+            if (tail == cached_head_)
+            {
+                cached_head_ = head_->load(std::memory_order_acquire);
+                if (tail == cached_head_)
+                    return false;
+            }
+            std::memcpy(out, slots_ + (tail & mask_) * kShmOrderSlot, kShmOrderSlot);
+            tail_->store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Producer side: slots free right now.
+        std::uint64_t space()
+        {
+            cached_tail_ = tail_->load(std::memory_order_acquire);
+            std::uint64_t used = head_->load(std::memory_order_relaxed) - cached_tail_;
+            return used > mask_ ? 0 : mask_ + 1 - used;
+        }
+        std::uint64_t capacity() const { return mask_ + 1; }
+
+    private:
+        std::atomic<std::uint64_t> *head_ = nullptr;
+        std::atomic<std::uint64_t> *tail_ = nullptr;
+        char *slots_ = nullptr;
+        std::uint64_t mask_ = 0;
+        std::uint64_t cached_head_ = 0;
+        std::uint64_t cached_tail_ = 0;
+    };
+
+    // Client side of a channel. A producer thread may submit while another
+    // thread polls for responses; each direction has one user.
+    class ShmOrderClient
+    {
+    public:
+        ShmOrderClient() = default;
+        ~ShmOrderClient();
+
+        ShmOrderClient(const ShmOrderClient &) = delete;
+        ShmOrderClient &operator=(const ShmOrderClient &) = delete;
+
+        // Attaches to the channel the gateway created for client_id. Throws if
+        // there is none, or if another process is attached; take_over claims
+        // the channel anyway, after a client died without detaching.
+        void attach(ClientID client_id, const std::string &prefix = "/mercury-oe", bool take_over = false);
+        void detach();
+
+        // Queue a request; false if the request ring is full.
+        bool submit(const NewOrderMessage &msg) { return requests_.push(msg); }
+        bool cancel(const CancelMessage &msg) { return requests_.push(msg); }
+        bool modify(const ModifyMessage &msg) { return requests_.push(msg); }
+
+        // Calls handler(const MessageHeader &) for up to max responses and
+        // returns how many there were.
+        template <typename Handler>
+        std::size_t poll(Handler &&handler, std::size_t max = 64)
+        {
+            alignas(8) char slot[kShmOrderSlot];
+            std::size_t n = 0;
+            while (n < max && responses_.pop(slot))
+            {
+                handler(*reinterpret_cast<const MessageHeader *>(slot));
+                ++n;
+            }
+            return n;
+        }
+
+    private:
+        ShmOrderChannelHeader *header_ = nullptr;
+        void *map_ = nullptr;
+        std::size_t map_size_ = 0;
+        ShmSpscRing requests_;
+        ShmSpscRing responses_;
+    };
+
+}
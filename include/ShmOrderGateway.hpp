@@ -0,0 +1,91 @@
+#pragma once
+#include "MatchingEngine.hpp"
+#include "ExecutionReportRouter.hpp"
+#include "ShmOrderChannel.hpp"
+#include "MarketMetrics.hpp"
+#include "ThreadPlacement.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace MercEx
+{
+
+    struct ShmOrderGatewayConfig
+    {
+        std::string prefix = "/mercury-oe"; // channels are named <prefix>-<client id>
+        std::size_t capacity = 4096;         // slots per ring; rounded up to a power of two, at least 64
+        std::chrono::nanoseconds idle_sleep{0}; // 0 spins when every channel is idle
+        bool unlink_on_close = true;
+        ThreadPlacement placement; // for the polling thread
+    };
+
+    // Order entry for co-located clients over shared memory (see
+    // ShmOrderChannel.hpp): no sockets, no parsing beyond checking each
+    // message, and orders go to the engine's MarketID-based submit_order.
+    //
+    // One thread polls every client's request ring, hands orders, cancels and
+    // modifies to the market queues and writes the OrderAck of each order to
+    // the client's response ring, along with the execution reports drained
+    // from its ExecutionReportChannel. Like TcpGateway it applies backpressure:
+    // a request is only taken when its ack has room, and reports wait in the
+    // channel while the response ring is full.
+    //
+    // The rings live in memory the client can write, so everything read from
+    // them is copied before it is checked, and a client that sends an invalid
+    // message is cut off. Ring indices only ever select slots within the
+    // ring: a misbehaving client can stall its own channel, nothing more.
+    //
+    // Client IDs served here must not also log in through a TcpGateway: each
+    // report channel has one reader.
+    class ShmOrderGateway
+    {
+    public:
+        ShmOrderGateway(MatchingEngine &engine, ExecutionReportRouter &reports, ShmOrderGatewayConfig config = {});
+        ~ShmOrderGateway();
+
+        ShmOrderGateway(const ShmOrderGateway &) = delete;
+        ShmOrderGateway &operator=(const ShmOrderGateway &) = delete;
+
+        // Creates the client's channel and opens its report session; returns
+        // the channel's name. Call before start(). Throws if the shared-memory
+        // object cannot be created or the client is already added.
+        std::string add_client(ClientID client_id);
+
+        void start();
+        void stop();
+
+        std::uint64_t messages_in() const { return messages_in_.value(); }
+        std::uint64_t messages_out() const { return messages_out_.value(); }
+        // Clients cut off for an invalid message or a corrupted ring.
+        std::uint64_t protocol_errors() const { return protocol_errors_.value(); }
+
+    private:
+        struct Channel;
+
+        void run();
+        bool serve(Channel &channel);
+        bool handle_request(Channel &channel, const MessageHeader &header);
+        bool drain_reports(Channel &channel);
+        template <typename T>
+        void respond(Channel &channel, const T &msg);
+
+        MatchingEngine &engine_;
+        ExecutionReportRouter &reports_;
+        ShmOrderGatewayConfig config_;
+        std::size_t capacity_;
+        std::vector<std::unique_ptr<Channel>> channels_;
+
+        SingleWriterCounter messages_in_;
+        SingleWriterCounter messages_out_;
+        SingleWriterCounter protocol_errors_;
+
+        std::atomic<bool> running_{false};
+        std::thread worker_;
+    };
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "LatencyHistogram.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define MERCEX_HAS_RDTSC 1
+#endif
+
+#ifndef MERCEX_ENABLE_TIMING
+#define MERCEX_ENABLE_TIMING 0
+#endif
+
+namespace MercEx
+{
+
+    // Stages of an order's life on the engine's hot path.
+    enum class TimingStage : std::uint8_t
+    {
+        Enqueue,   // MarketProcessor::submit_event(s) onto the market queue
+        Dequeue,   // successful try_dequeue in the worker loop
+        Construct, // building and indexing the Order in handle_event
+        Match,     // Market::process_order
+        StopCheck, // check_stop_orders after a last-price change
+        Publish,   // handing the resulting events to the publisher
+    };
+    constexpr std::size_t kTimingStages = 6;
+
+    const char *to_string(TimingStage stage);
+
+    namespace Tsc
+    {
+        // Raw timestamp counter; steady_clock nanoseconds where there is no TSC.
+        inline std::uint64_t now() noexcept
+        {
+#ifdef MERCEX_HAS_RDTSC
+            return __rdtsc();
+#else
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                  std::chrono::steady_clock::now().time_since_epoch())
+                                                  .count());
+#endif
+        }
+
+        // Nanoseconds per tick, measured against steady_clock at startup when
+        // timing is compiled in. calibrate() re-measures over the given window.
+        double ns_per_tick();
+        double calibrate(std::chrono::milliseconds window = std::chrono::milliseconds(10));
+    }
+
+    // Per-stage latency histograms. Every thread records into its own set, so
+    // recording never contends; collect() merges them. Threads write their
+    // histograms without synchronisation, so collect() and reset() give exact
+    // results only while the engine is quiescent (e.g. after a run).
+    class StageTimings
+    {
+    public:
+        static constexpr bool enabled = MERCEX_ENABLE_TIMING != 0;
+
+        static void record(TimingStage stage, std::uint64_t start_tick) noexcept;
+        // Creates the calling thread's histograms now rather than on its first
+        // record(), for threads that must not allocate once running.
+        static void prepare_thread();
+
+        static std::array<LatencyHistogram, kTimingStages> collect();
+        static void reset();
+
+        static void print_summary(std::ostream &os);
+        static void print_json(std::ostream &os);
+    };
+
+    class ScopedStageTimer
+    {
+    public:
+        explicit ScopedStageTimer(TimingStage stage) noexcept : stage_(stage), start_(Tsc::now()) {}
+        ~ScopedStageTimer() { StageTimings::record(stage_, start_); }
+
+        ScopedStageTimer(const ScopedStageTimer &) = delete;
+        ScopedStageTimer &operator=(const ScopedStageTimer &) = delete;
+
+    private:
+        TimingStage stage_;
+        std::uint64_t start_;
+    };
+
+}
+
+// Instrumentation points. Built without MERCEX_ENABLE_TIMING they expand to
+// nothing, so the hot path carries no trace of them.
+//   MERCEX_TIME_SCOPE(stage)        times the rest of the enclosing scope
+//   MERCEX_TIME_BEGIN(var)          starts a timer named var
+//   MERCEX_TIME_END(stage, var)     records the time since MERCEX_TIME_BEGIN(var)
+#if MERCEX_ENABLE_TIMING
+#define MERCEX_TIMING_CONCAT_(a, b) a##b
+#define MERCEX_TIMING_CONCAT(a, b) MERCEX_TIMING_CONCAT_(a, b)
+#define MERCEX_TIME_SCOPE(stage) \
+    ::MercEx::ScopedStageTimer MERCEX_TIMING_CONCAT(mercex_stage_timer_, __LINE__)(::MercEx::TimingStage::stage)
+#define MERCEX_TIME_BEGIN(var) const std::uint64_t var = ::MercEx::Tsc::now()
+#define MERCEX_TIME_END(stage, var) ::MercEx::StageTimings::record(::MercEx::TimingStage::stage, var)
+#else
+#define MERCEX_TIME_SCOPE(stage) ((void)0)
+#define MERCEX_TIME_BEGIN(var) ((void)0)
+#define MERCEX_TIME_END(stage, var) ((void)0)
+#endif
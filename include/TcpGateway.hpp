@@ -0,0 +1,141 @@
+#pragma once
+#include "MatchingEngine.hpp"
+#include "ExecutionReportRouter.hpp"
+#include "BinaryProtocol.hpp"
+#include "MarketMetrics.hpp"
+#include "ThreadPlacement.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+struct io_uring_cqe;
+
+namespace MercEx
+{
+
+    class IoUring;
+    class ProvidedBuffers;
+
+    enum class GatewayBackend : std::uint8_t
+    {
+        Epoll,  // edge-triggered epoll with recv(2) and sendmsg(2)
+        IoUring // multishot accept and recv, sends from registered buffers
+    };
+
+    struct TcpGatewayConfig
+    {
+        GatewayBackend backend = GatewayBackend::Epoll;
+        std::string address = "127.0.0.1";
+        std::uint16_t port = 0;                // 0 binds a free port; see TcpGateway::port()
+        int backlog = 256;
+        std::size_t max_sessions = 1024;
+        std::size_t receive_buffer = 64 << 10; // bytes per session
+        std::size_t send_buffer = 256 << 10;   // bytes per session
+        ThreadPlacement placement;             // for the event loop thread
+    };
+
+    // Order-entry front door: accepts client TCP sessions speaking the binary
+    // protocol of BinaryProtocol.hpp and feeds the engine from one event loop
+    // thread. Two Linux backends drive the sockets:
+    //
+    //  - Epoll: edge-triggered epoll over non-blocking sockets.
+    //  - IoUring: one io_uring carries a multishot accept and a multishot recv
+    //    per session that draws from a shared group of provided buffers; sends
+    //    come from per-session buffers registered with the ring. Everything
+    //    queued in a loop iteration is submitted with one io_uring_enter.
+    //
+    // Inbound messages are parsed in place, in the session's receive buffer
+    // or in the provided buffer a completion names, and submitted straight to
+    // the market queues. Everything a session is owed in one loop iteration,
+    // gateway acks and the execution reports drained from its
+    // ExecutionReportChannel, is staged in its send buffer and written with a
+    // single writev (or one send request per contiguous run) at the end of
+    // the iteration. A session whose send buffer is full is not read from,
+    // and its reports wait in the channel, until the client catches up.
+    class TcpGateway
+    {
+    public:
+        TcpGateway(MatchingEngine &engine, ExecutionReportRouter &reports, TcpGatewayConfig config = {});
+        ~TcpGateway();
+
+        TcpGateway(const TcpGateway &) = delete;
+        TcpGateway &operator=(const TcpGateway &) = delete;
+
+        // Binds and listens, then starts the event loop. Throws if the socket
+        // cannot be set up.
+        void start();
+        // Stops the event loop and closes every session.
+        void stop();
+
+        std::uint16_t port() const { return port_; }
+
+        std::size_t sessions() const { return session_count_.load(std::memory_order_relaxed); }
+        std::uint64_t messages_in() const { return messages_in_.value(); }
+        std::uint64_t messages_out() const { return messages_out_.value(); }
+        // Sessions closed for sending something that is not a valid message.
+        std::uint64_t protocol_errors() const { return protocol_errors_.value(); }
+
+    private:
+        struct Session;
+
+        void open_listener();
+        void open_uring();
+        Session &open_slot(int fd);
+        std::size_t parse_messages(Session &session, const char *data, std::size_t size);
+        void stash(Session &session, const char *data, std::size_t size);
+
+        void run_epoll();
+        bool accept_sessions();
+        bool read_session(Session &session);
+        bool handle_message(Session &session, const MessageHeader &header);
+        void handle_login(Session &session, const LoginMessage &msg);
+        void handle_new_order(Session &session, const NewOrderMessage &msg);
+        void handle_cancel(Session &session, const CancelMessage &msg);
+        void handle_modify(Session &session, const ModifyMessage &msg);
+        bool drain_reports(Session &session);
+        void flush(Session &session);
+        void close_session(Session &session);
+
+        void run_uring();
+        void on_completion(const io_uring_cqe &cqe);
+        void on_data(Session &session, const char *data, std::size_t size);
+        bool resume_session(Session &session);
+        void arm_accept();
+        void arm_recv(Session &session);
+        void cancel_recv(Session &session);
+        void submit_send(Session &session);
+
+        template <typename T>
+        void send(Session &session, const T &msg);
+
+        MatchingEngine &engine_;
+        ExecutionReportRouter &reports_;
+        TcpGatewayConfig config_;
+
+        int listen_fd_ = -1;
+        int epoll_fd_ = -1;
+        std::unique_ptr<IoUring> ring_;
+        std::unique_ptr<ProvidedBuffers> recv_buffers_;
+        bool fixed_sends_ = true; // cleared if the kernel rejects registered-buffer sends
+        std::uint16_t port_ = 0;
+
+        // Indexed by slot; a slot's session is reused once it is closed.
+        std::vector<std::unique_ptr<Session>> sessions_;
+        std::vector<Session *> live_;
+        std::vector<std::uint32_t> free_slots_;
+        std::unordered_set<ClientID> logged_in_;
+
+        std::atomic<std::size_t> session_count_{0};
+        SingleWriterCounter messages_in_;
+        SingleWriterCounter messages_out_;
+        SingleWriterCounter protocol_errors_;
+
+        std::atomic<bool> running_{false};
+        std::thread worker_;
+    };
+
+}
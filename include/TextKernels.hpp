@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace MercEx
+{
+
+    // Kernels for turning ASCII protocol text (FIX tag=value, CSV order
+    // files) into numbers: delimiter search, decimal integers, fixed-point
+    // prices and the FIX checksum.
+    //
+    // Each kernel has a scalar version and x86 versions for SSE4.2 and AVX2,
+    // compiled with per-function target attributes so the library itself
+    // needs no -m flags. The widest level the CPU supports, as CPUID reports
+    // it, is picked on first use; set_simd_level() picks another, for
+    // benchmarks and for checking one level against another.
+    //
+    // Digits are converted sixteen at a time (pmaddubsw/pmaddwd), which is
+    // the width of any FIX number, so AVX2 shares the SSE4.2 integer kernels
+    // and widens only the byte scans and the checksum. SIMD loads may read
+    // up to fifteen bytes past a field but never cross into the next page.
+
+    enum class SimdLevel : std::uint8_t
+    {
+        Scalar,
+        Sse42,
+        Avx2
+    };
+
+    const char *simd_level_name(SimdLevel level);
+
+    // Widest level this CPU runs.
+    SimdLevel detected_simd_level();
+    SimdLevel active_simd_level();
+    // Selects the kernels, capped at the detected level; returns the level
+    // selected. Not safe while other threads are using the kernels.
+    SimdLevel set_simd_level(SimdLevel level);
+
+    // First byte equal to c in [p, end), or end.
+    const char *scan_byte(const char *p, const char *end, char c);
+    // First byte in [p, end) that is one of set (at most 16 bytes), or end.
+    const char *scan_any(const char *p, const char *end, std::string_view set);
+    // Offsets from p of the bytes equal to c in [p, p + size), in order, for
+    // up to max of them; returns how many were written.
+    std::size_t index_byte(const char *p, std::size_t size, char c, std::uint32_t *out, std::size_t max);
+    // Sum of the bytes in [p, p + size), modulo 256.
+    std::uint8_t text_checksum(const char *p, std::size_t size);
+
+    // Exactly `size` decimal digits (1 to 19); false on anything else.
+    bool parse_digits(const char *p, std::size_t size, std::uint64_t &out);
+    // The run of digits at p; returns the first byte after it, or p if there
+    // is none or it is longer than 19 digits.
+    const char *parse_uint_prefix(const char *p, const char *end, std::uint64_t &out);
+
+    // A fixed-point decimal, "[-]digits[.digits]" with at least one digit
+    // and at most 18 in all: value = mantissa / 10^decimals.
+    struct Decimal
+    {
+        std::int64_t mantissa;
+        std::uint32_t decimals;
+    };
+    bool parse_decimal(const char *p, std::size_t size, Decimal &out);
+    double to_double(const Decimal &d);
+
+}
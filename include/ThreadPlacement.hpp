@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+
+namespace MercEx
+{
+
+    // Where an engine thread runs. Defaults leave the thread to the OS.
+    struct ThreadPlacement
+    {
+        int cpu = -1;               // pin to this core
+        int numa_node = -1;         // preferred memory node; -1 follows cpu when pinned
+        int realtime_priority = 0;  // > 0 runs the thread SCHED_FIFO at this priority
+
+        bool is_default() const { return cpu < 0 && numa_node < 0 && realtime_priority <= 0; }
+    };
+
+    // Applies placement to the calling thread and names it (visible in top and
+    // perf). Memory the thread touches afterwards is allocated on the chosen
+    // node. Each step is attempted independently; failures, such as missing
+    // CAP_SYS_NICE for SCHED_FIFO, are logged and reported by returning false.
+    bool apply_thread_placement(const ThreadPlacement &placement, const std::string &name);
+
+    // NUMA node of a CPU, or -1 if unknown.
+    int numa_node_of_cpu(int cpu);
+
+}
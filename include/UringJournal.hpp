@@ -0,0 +1,62 @@
+#pragma once
+// Linux only: needs io_uring (see IoUring.hpp).
+#ifdef __linux__
+#include "IoUring.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace MercEx
+{
+
+    // Append-only file writer on io_uring. Appends are staged in a few
+    // buffers registered with the ring; a full buffer goes to the kernel as
+    // one IORING_OP_WRITE_FIXED at its file offset while the caller carries
+    // on filling the next, so the appending thread never blocks on the disk
+    // unless every buffer is still in flight.
+    //
+    // Durable journals link every write to an fdatasync
+    // (IORING_FSYNC_DATASYNC): a buffer is free again only once its bytes
+    // are on stable storage, and flush() returns only then.
+    //
+    // Not thread-safe; callers serialize appends (CaptureWriter does).
+    class UringJournal
+    {
+    public:
+        // Creates or truncates path. Throws std::runtime_error if the file
+        // or the ring cannot be set up.
+        UringJournal(const std::string &path, bool durable, std::size_t buffer_size = 1 << 20, unsigned buffers = 4);
+        ~UringJournal();
+
+        UringJournal(const UringJournal &) = delete;
+        UringJournal &operator=(const UringJournal &) = delete;
+
+        // Throws std::runtime_error if an earlier write or sync failed.
+        void append(const void *data, std::size_t size);
+        // Writes out the staged bytes and waits for every write in flight
+        // (and its sync, when durable).
+        void flush();
+
+        std::uint64_t bytes_written() const { return offset_; }
+
+    private:
+        void submit_current();
+        void reap(bool wait);
+
+        IoUring ring_;
+        int fd_ = -1;
+        bool durable_;
+        std::size_t buffer_size_;
+        char *memory_ = nullptr;
+        std::vector<unsigned> pending_; // completions outstanding per buffer
+        std::vector<std::size_t> lengths_;
+        unsigned current_ = 0;
+        std::size_t fill_ = 0;
+        std::uint64_t offset_ = 0; // file offset of the current buffer
+        int error_ = 0;            // first failure, reported by the next call
+    };
+
+}
+
+#endif
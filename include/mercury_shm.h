@@ -0,0 +1,236 @@
+/*
+ * Shared-memory market data ring written by MercEx::ShmMarketDataFeed.
+ *
+ * Plain C (C11 with GCC/Clang atomic builtins) and header-only, so that
+ * co-located consumers can attach without linking mercury_core:
+ *
+ *     mx_shm_reader reader;
+ *     if (mx_shm_reader_open(&reader, "/mercury-md", 0) != 0) ...
+ *     mx_shm_event ev;
+ *     for (;;) {
+ *         int rc = mx_shm_reader_poll(&reader, &ev);
+ *         if (rc == MX_SHM_EVENT) handle(&ev);
+ *         else if (rc == MX_SHM_LAPPED) lost += mx_shm_reader_resync(&reader);
+ *     }
+ *
+ * The object under /dev/shm holds an mx_shm_header followed by a power of
+ * two of 64-byte slots, one event each. There is one writer and any number
+ * of readers; the writer never waits. Event n goes to slot n % capacity
+ * and each slot is stamped like a seqlock: 2n+1 while event n is being
+ * written, 2n+2 once it is complete. A reader keeps its own cursor, the
+ * sequence number of the next event it wants, and knows from the stamp
+ * whether that event is not written yet, complete, or already overwritten
+ * because the reader fell more than capacity events behind (lapped).
+ *
+ * Times are CLOCK_MONOTONIC nanoseconds, the engine's steady clock.
+ */
+#ifndef MERCURY_SHM_H
+#define MERCURY_SHM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MX_SHM_MAGIC 0x474e52484d53584dULL /* "MXSHMRNG" */
+/* 2: REPLENISH events, and ICEBERG and PEGGED orders */
+#define MX_SHM_VERSION 2u
+
+/* mx_shm_event.type: the engine's MarketEventType (5 is inbound only) */
+enum
+{
+    MX_SHM_ADD_ORDER = 0,
+    MX_SHM_FILLED_ORDER = 1,
+    MX_SHM_CANCEL_ORDER = 2,
+    MX_SHM_TRADE = 3,
+    MX_SHM_STOP_TRIGGERED = 4,
+    MX_SHM_REPLENISH = 6 /* an iceberg showed its next slice and lost its time priority */
+};
+
+/* mx_shm_event.side, .order_type and .tif use the engine's enumerators. */
+enum { MX_SHM_BUY = 0, MX_SHM_SELL = 1 };
+enum
+{
+    MX_SHM_LIMIT = 0,
+    MX_SHM_MARKET = 1,
+    MX_SHM_STOP = 2,
+    MX_SHM_STOP_LIMIT = 3,
+    MX_SHM_ICEBERG = 4,
+    MX_SHM_PEGGED = 5
+};
+enum { MX_SHM_DAY = 0, MX_SHM_IOC = 1, MX_SHM_FOK = 2, MX_SHM_GTC = 3 };
+
+/* mx_shm_reader_poll results */
+enum
+{
+    MX_SHM_EMPTY = 0,  /* nothing new yet */
+    MX_SHM_EVENT = 1,  /* *out holds the event at the cursor, which moved on */
+    MX_SHM_LAPPED = -1 /* the event at the cursor was overwritten; see mx_shm_reader_resync */
+};
+
+typedef struct mx_shm_header
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t slot_size;  /* sizeof(mx_shm_event) */
+    uint64_t capacity;   /* slots; a power of two */
+    uint64_t header_size; /* offset of the first slot */
+    int64_t created_ns;  /* when the writer created the ring */
+    uint8_t reserved0[24];
+
+    /* Own cache line: events below it are complete. Advanced once per batch. */
+    uint64_t write_seq;
+    uint8_t reserved1[56];
+} mx_shm_header;
+
+typedef struct mx_shm_event
+{
+    uint64_t stamp; /* see above; readers never need it */
+    int64_t timestamp_ns; /* engine time of the event */
+    int64_t publish_ns;   /* when the writer put it in the ring */
+    uint64_t order_id;
+    union
+    {
+        uint64_t counterparty_id; /* TRADE: the resting order */
+        double stop_price;        /* ADD_ORDER, STOP_TRIGGERED */
+    } u;
+    double price;     /* ADD_ORDER, REPLENISH: limit; TRADE: executed */
+    int32_t quantity; /* TRADE: executed; REPLENISH: the new slice */
+    uint32_t client_id;
+    uint16_t market_id;
+    uint8_t type;
+    uint8_t side;
+    uint8_t order_type;
+    uint8_t tif;
+    uint16_t reserved;
+} mx_shm_event;
+
+#ifdef __cplusplus
+static_assert(sizeof(mx_shm_header) == 128, "mx_shm_header must stay 128 bytes");
+static_assert(sizeof(mx_shm_event) == 64, "mx_shm_event must stay one cache line");
+#else
+_Static_assert(sizeof(mx_shm_header) == 128, "mx_shm_header must stay 128 bytes");
+_Static_assert(sizeof(mx_shm_event) == 64, "mx_shm_event must stay one cache line");
+#endif
+
+typedef struct mx_shm_reader
+{
+    const mx_shm_header *header;
+    const mx_shm_event *slots;
+    uint64_t mask;
+    uint64_t cursor; /* sequence number of the next event to read */
+    void *map;
+    size_t map_size;
+} mx_shm_reader;
+
+/* Events the writer has completed so far. */
+static inline uint64_t mx_shm_write_seq(const mx_shm_reader *r)
+{
+    return __atomic_load_n(&r->header->write_seq, __ATOMIC_ACQUIRE);
+}
+
+/* Reads the event at the cursor into *out. Never blocks. */
+static inline int mx_shm_reader_poll(mx_shm_reader *r, mx_shm_event *out)
+{
+    const mx_shm_event *slot = &r->slots[r->cursor & r->mask];
+    uint64_t want = 2 * r->cursor + 2;
+    uint64_t stamp = __atomic_load_n(&slot->stamp, __ATOMIC_ACQUIRE);
+    if (stamp < want)
+        return MX_SHM_EMPTY;
+    if (stamp > want)
+        return MX_SHM_LAPPED;
+    memcpy(out, slot, sizeof(*out));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->stamp, __ATOMIC_RELAXED) != want)
+        return MX_SHM_LAPPED; /* overwritten while being copied */
+    ++r->cursor;
+    return MX_SHM_EVENT;
+}
+
+/* After MX_SHM_LAPPED: moves the cursor up to half a ring behind the
+ * writer, so the reader has room to catch up, and returns the number of
+ * events skipped. */
+static inline uint64_t mx_shm_reader_resync(mx_shm_reader *r)
+{
+    uint64_t written = mx_shm_write_seq(r);
+    uint64_t capacity = r->mask + 1;
+    uint64_t oldest = written > capacity / 2 ? written - capacity / 2 : 0;
+    uint64_t skipped = oldest > r->cursor ? oldest - r->cursor : 0;
+    if (oldest > r->cursor)
+        r->cursor = oldest;
+    return skipped;
+}
+
+#ifdef __linux__
+
+/* Maps the ring named name (as given to shm_open, e.g. "/mercury-md").
+ * With from_start the cursor is the oldest event still held, otherwise the
+ * next event to be written. Returns 0, or a negative errno. */
+static inline int mx_shm_reader_open(mx_shm_reader *r, const char *name, int from_start)
+{
+    struct stat st;
+    const mx_shm_header *header;
+    void *map;
+    int fd;
+    memset(r, 0, sizeof(*r));
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return -errno;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(mx_shm_header))
+    {
+        close(fd);
+        return -EINVAL;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -errno;
+
+    header = (const mx_shm_header *)map;
+    if (header->magic != MX_SHM_MAGIC || header->version != MX_SHM_VERSION ||
+        header->slot_size != sizeof(mx_shm_event) || header->capacity == 0 ||
+        (header->capacity & (header->capacity - 1)) != 0 ||
+        header->header_size + header->capacity * sizeof(mx_shm_event) > (uint64_t)st.st_size)
+    {
+        munmap(map, (size_t)st.st_size);
+        return -EPROTO;
+    }
+
+    r->header = header;
+    r->slots = (const mx_shm_event *)((const char *)map + header->header_size);
+    r->mask = header->capacity - 1;
+    r->map = map;
+    r->map_size = (size_t)st.st_size;
+    r->cursor = mx_shm_write_seq(r);
+    if (from_start)
+        r->cursor = r->cursor > header->capacity ? r->cursor - header->capacity : 0;
+    return 0;
+}
+
+static inline void mx_shm_reader_close(mx_shm_reader *r)
+{
+    if (r->map)
+        munmap(r->map, r->map_size);
+    r->map = NULL;
+    r->header = NULL;
+    r->slots = NULL;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,94 @@
+#include "AllocationGuard.hpp"
+#include <new>
+
+#if MERCEX_ALLOC_GUARD
+#include <cstdio>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#endif
+
+namespace MercEx
+{
+
+    namespace
+    {
+        // Plain thread_locals with constant initialisation, so reading them
+        // from inside operator new cannot itself allocate.
+        thread_local bool t_armed = false;
+        thread_local unsigned t_permits = 0;
+    }
+
+    void AllocationGuard::arm() noexcept { t_armed = enabled; }
+    void AllocationGuard::disarm() noexcept { t_armed = false; }
+    bool AllocationGuard::armed() noexcept { return t_armed; }
+
+    AllocationGuard::Permit::Permit() noexcept { ++t_permits; }
+    AllocationGuard::Permit::~Permit() { --t_permits; }
+
+    void AllocationGuard::check(std::size_t bytes) noexcept
+    {
+#if MERCEX_ALLOC_GUARD
+        if (!t_armed || t_permits != 0)
+            return;
+        t_armed = false; // let the report itself run
+        char msg[128];
+        int n = std::snprintf(msg, sizeof(msg),
+                              "[AllocationGuard] %zu-byte allocation on an armed thread after warm-up\n", bytes);
+#ifndef _WIN32
+        if (n > 0)
+            (void)::write(2, msg, static_cast<std::size_t>(n));
+#else
+        std::fputs(msg, stderr);
+#endif
+        std::abort();
+#else
+        (void)bytes;
+#endif
+    }
+
+}
+
+#if MERCEX_ALLOC_GUARD
+// Global replacements: every C++ heap allocation in the process is checked.
+// The nothrow forms default to these.
+
+namespace
+{
+    void *guarded_alloc(std::size_t size)
+    {
+        MercEx::AllocationGuard::check(size);
+        if (void *p = std::malloc(size ? size : 1))
+            return p;
+        throw std::bad_alloc();
+    }
+}
+
+void *operator new(std::size_t size) { return guarded_alloc(size); }
+void *operator new[](std::size_t size) { return guarded_alloc(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+#ifndef _WIN32
+namespace
+{
+    void *guarded_aligned_alloc(std::size_t size, std::align_val_t alignment)
+    {
+        MercEx::AllocationGuard::check(size);
+        auto align = static_cast<std::size_t>(alignment);
+        if (void *p = std::aligned_alloc(align, ((size ? size : 1) + align - 1) / align * align))
+            return p;
+        throw std::bad_alloc();
+    }
+}
+
+void *operator new(std::size_t size, std::align_val_t al) { return guarded_aligned_alloc(size, al); }
+void *operator new[](std::size_t size, std::align_val_t al) { return guarded_aligned_alloc(size, al); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+#endif
+#endif
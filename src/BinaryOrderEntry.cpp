@@ -0,0 +1,78 @@
+#include "BinaryOrderEntry.hpp"
+#include "EngineClock.hpp"
+
+namespace MercEx
+{
+
+    namespace
+    {
+        void make_reject(ExecType type, ClientID client_id, MarketID market_id, OrderID order_id,
+                         ExecutionMessage &out)
+        {
+            ExecutionReport r{};
+            r.type = type;
+            r.reason = RejectReason::UnknownMarket;
+            r.market_id = market_id;
+            r.client_id = client_id;
+            r.order_id = order_id;
+            r.timestamp = EngineClock::now();
+            encode(r, out);
+        }
+    }
+
+    OrderAckMessage submit_new_order(MatchingEngine &engine, ClientID client_id, const NewOrderMessage &msg)
+    {
+        auto ack = make_message<OrderAckMessage>(MessageType::OrderAck);
+        ack.market_id = msg.market_id;
+        ack.client_ref = msg.client_ref;
+
+        // Prices, quantities and whether the order type has what it needs
+        // are the engine's pre-trade checks; the enums it trusts its callers
+        // with are checked here.
+        if (static_cast<std::uint8_t>(msg.side) > static_cast<std::uint8_t>(Side::Sell) ||
+            static_cast<std::uint8_t>(msg.order_type) > static_cast<std::uint8_t>(OrderType::Pegged) ||
+            static_cast<std::uint8_t>(msg.tif) > static_cast<std::uint8_t>(TimeInForce::GTC) ||
+            ((msg.flags & NewOrderMessage::kHasPeg) &&
+             static_cast<std::uint8_t>(msg.peg_reference) > static_cast<std::uint8_t>(PegReference::Mid)))
+        {
+            ack.reason = RejectReason::InvalidOrder;
+            return ack;
+        }
+
+        std::optional<Price> price, stop_price;
+        std::optional<Peg> peg;
+        if (msg.flags & NewOrderMessage::kHasPrice)
+            price = Price{msg.price};
+        if (msg.flags & NewOrderMessage::kHasStopPrice)
+            stop_price = Price{msg.stop_price};
+        if (msg.flags & NewOrderMessage::kHasPeg)
+            peg = Peg{msg.peg_reference, msg.peg_offset};
+        SubmitResult result = engine.submit_order(msg.market_id, client_id, msg.quantity, msg.side, price,
+                                                  msg.order_type, msg.tif, stop_price, msg.display_qty, peg);
+        ack.order_id = result.order_id;
+        ack.reason = result.reason;
+        return ack;
+    }
+
+    bool submit_cancel(MatchingEngine &engine, ClientID client_id, const CancelMessage &msg,
+                       ExecutionMessage &reject)
+    {
+        if (engine.cancel_order(msg.order_id, msg.market_id, client_id))
+            return true;
+        make_reject(ExecType::CancelRejected, client_id, msg.market_id, msg.order_id, reject);
+        return false;
+    }
+
+    bool submit_modify(MatchingEngine &engine, ClientID client_id, const ModifyMessage &msg,
+                       ExecutionMessage &reject)
+    {
+        std::optional<Price> price;
+        if (msg.flags & ModifyMessage::kHasPrice)
+            price = Price{msg.price};
+        if (engine.modify_order(msg.order_id, msg.market_id, client_id, msg.quantity, price))
+            return true;
+        make_reject(ExecType::ReplaceRejected, client_id, msg.market_id, msg.order_id, reject);
+        return false;
+    }
+
+}
@@ -5,14 +5,12 @@
 
 namespace MercEx {
 
-    std::list<Order*>::iterator BuyBook::add_order(Order& order) {
-        auto& q = orders_[order.price.value()];
-        q.push_back(&order);
-        order.book_it = std::prev(q.end());
+    OrderList::iterator BuyBook::add_order(Order& order) {
+        orders_[order.price.value()].push_back(order);
         return order.book_it;
     }
 
-    bool BuyBook::cancel_order(OrderID id, Price price, std::list<Order*>::iterator it) {
+    bool BuyBook::cancel_order(OrderID id, Price price, OrderList::iterator it) {
         auto price_it = orders_.find(price);
         if (price_it != orders_.end()) {
             price_it->second.erase(it);
@@ -26,12 +24,12 @@ namespace MercEx {
 
     std::optional<std::reference_wrapper<Order>> BuyBook::get_best_order() {
         if (orders_.empty()) return std::nullopt;
-        return *(orders_.begin()->second.front());
+        return *(orders_.begin()->second.orders.front());
     }
 
     std::optional<Price> BuyBook::get_best_bid() const {
         if (orders_.empty()) return std::nullopt;
-        return orders_.begin()->second.front()->price;
+        return orders_.begin()->second.orders.front()->price;
     }
 
     bool BuyBook::empty() const {
@@ -40,8 +38,8 @@ namespace MercEx {
 
     std::size_t BuyBook::size() const {
         std::size_t count = 0;
-        for (const auto& [price, order_list] : orders_)
-            count += order_list.size();
+        for (const auto& [price, level] : orders_)
+            count += level.orders.size();
         return count;
     }
 
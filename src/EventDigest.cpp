@@ -0,0 +1,44 @@
+#include "EventDigest.hpp"
+
+namespace MercEx
+{
+
+    void EventDigest::mix(const void *data, std::size_t size)
+    {
+        const auto *bytes = static_cast<const unsigned char *>(data);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            hash_ ^= bytes[i];
+            hash_ *= 1099511628211ULL;
+        }
+    }
+
+    void EventDigest::on_market_events(const std::vector<MarketEvent> &events)
+    {
+        for (const auto &ev : events)
+        {
+            // Field by field rather than the raw struct: padding bytes and the
+            // string's heap pointer would otherwise leak into the digest.
+            mix(ev.type);
+            mix(ev.timestamp.time_since_epoch().count());
+            mix(ev.order_id);
+            mix(ev.client_id);
+            mix(ev.symbol.size());
+            mix(ev.symbol.data(), ev.symbol.size());
+            mix(ev.quantity);
+            mix(ev.side);
+            mix(ev.price);
+            mix(ev.stop_price);
+            mix(ev.order_type);
+            mix(ev.tif);
+            mix(ev.display_qty);
+            mix(ev.counterparty_id);
+            mix(ev.executed_price);
+            mix(ev.executed_qty);
+            mix(ev.peg);
+            mix(ev.market_id);
+            ++count_;
+        }
+    }
+
+}
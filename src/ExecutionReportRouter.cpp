@@ -0,0 +1,101 @@
+#include "ExecutionReportRouter.hpp"
+#include <stdexcept>
+
+namespace MercEx
+{
+
+    std::string to_string(ExecType type)
+    {
+        switch (type)
+        {
+        case ExecType::New:
+            return "New";
+        case ExecType::Rejected:
+            return "Rejected";
+        case ExecType::PartialFill:
+            return "PartialFill";
+        case ExecType::Fill:
+            return "Fill";
+        case ExecType::Canceled:
+            return "Canceled";
+        case ExecType::CancelRejected:
+            return "CancelRejected";
+        case ExecType::Replaced:
+            return "Replaced";
+        case ExecType::ReplaceRejected:
+            return "ReplaceRejected";
+        default:
+            throw std::invalid_argument("Invalid ExecType value");
+        }
+    }
+
+    ExecutionReportChannel::ExecutionReportChannel(std::size_t max_producers)
+        : queue_(kInitialCapacity), producers_(new std::unique_ptr<moodycamel::ProducerToken>[max_producers]) {}
+
+    void ExecutionReportChannel::add_producer(std::size_t producer)
+    {
+        producers_[producer] = std::make_unique<moodycamel::ProducerToken>(queue_);
+    }
+
+    ExecutionReportRouter::ExecutionReportRouter(std::size_t max_clients, std::size_t max_producers)
+        : channels_(max_clients), active_(max_clients), max_producers_(max_producers) {}
+
+    ExecutionReportChannel &ExecutionReportRouter::open_session(ClientID client_id)
+    {
+        if (client_id >= active_.size())
+            throw std::out_of_range("ClientID exceeds router capacity");
+
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        if (!channels_[client_id])
+        {
+            channels_[client_id] = std::make_unique<ExecutionReportChannel>(max_producers_);
+            for (std::size_t p = 0; p < producers_; ++p)
+                channels_[client_id]->add_producer(p);
+        }
+        active_[client_id].store(channels_[client_id].get(), std::memory_order_release);
+        return *channels_[client_id];
+    }
+
+    void ExecutionReportRouter::close_session(ClientID client_id)
+    {
+        if (client_id >= active_.size())
+            return;
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        active_[client_id].store(nullptr, std::memory_order_release);
+    }
+
+    std::size_t ExecutionReportRouter::register_producer()
+    {
+        // The worker's token in a channel is written here or, for channels
+        // opened later, before the channel is published in active_; either
+        // way before the worker can reach it.
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        if (producers_ == max_producers_)
+            return kNoProducer;
+        std::size_t producer = producers_++;
+        for (auto &channel : channels_)
+        {
+            if (channel)
+                channel->add_producer(producer);
+        }
+        return producer;
+    }
+
+    bool ExecutionReportRouter::deliver(const ExecutionReport &report, std::size_t producer)
+    {
+        ExecutionReportChannel *channel = report.client_id < active_.size()
+                                              ? active_[report.client_id].load(std::memory_order_acquire)
+                                              : nullptr;
+        if (!channel)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (producer != kNoProducer)
+            channel->push(producer, report);
+        else
+            channel->push(report);
+        return true;
+    }
+
+}
@@ -0,0 +1,330 @@
+#include "FeedReceiver.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace MercEx
+{
+
+    namespace
+    {
+        constexpr std::size_t kBatch = 16;
+        constexpr std::size_t kMaxPacket = 65536;
+    }
+
+    FeedReceiver::FeedReceiver(FeedReceiverConfig config, Handler handler)
+        : config_(std::move(config)), handler_(std::move(handler)),
+          expected_(std::size_t(std::numeric_limits<MarketID>::max()) + 1, 1), buffers_(kBatch * kMaxPacket),
+          response_(kMaxPacket), drop_(std::clamp(config_.simulated_loss, 0.0, 1.0))
+    {
+    }
+
+    FeedReceiver::~FeedReceiver()
+    {
+#ifdef __linux__
+        if (udp_fd_ >= 0)
+            ::close(udp_fd_);
+        if (recovery_fd_ >= 0)
+            ::close(recovery_fd_);
+#endif
+    }
+
+    bool FeedReceiver::valid(const char *data, std::size_t size) const
+    {
+        if (size < sizeof(FeedPacketHeader))
+            return false;
+        FeedPacketHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.version != kFeedVersion || header.length != size)
+            return false;
+
+        std::size_t offset = sizeof(header);
+        for (std::uint16_t i = 0; i < header.count; ++i)
+        {
+            if (offset + sizeof(FeedMessageHeader) > size)
+                return false;
+            const auto &msg = *reinterpret_cast<const FeedMessageHeader *>(data + offset);
+            std::size_t length = feed_message_size(msg.type);
+            if (length == 0 || msg.length != length || offset + length > size)
+                return false;
+            offset += length;
+        }
+        return offset == size;
+    }
+
+    void FeedReceiver::handle_packet(const char *data, std::size_t size)
+    {
+        if (drop_(random_))
+        {
+            ++stats_.dropped;
+            return;
+        }
+        if (!valid(data, size))
+        {
+            ++stats_.malformed;
+            return;
+        }
+        ++stats_.packets;
+
+        FeedPacketHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.sequence > expected_[header.market_id])
+        {
+            ++stats_.gaps;
+            recover(header.market_id, header.sequence);
+        }
+        stats_.messages += deliver(header, data);
+    }
+
+    std::uint64_t FeedReceiver::deliver(const FeedPacketHeader &header, const char *data)
+    {
+        std::uint64_t &expected = expected_[header.market_id];
+        std::uint64_t delivered = 0;
+        const char *p = data + sizeof(FeedPacketHeader);
+        for (std::uint16_t i = 0; i < header.count; ++i)
+        {
+            const auto &msg = *reinterpret_cast<const FeedMessageHeader *>(p);
+            p += msg.length;
+            std::uint64_t sequence = header.sequence + i;
+            if (sequence < expected)
+            {
+                ++stats_.duplicates;
+                continue;
+            }
+            if (sequence > expected)
+                stats_.lost += sequence - expected;
+            handler_(header.market_id, sequence, msg);
+            expected = sequence + 1;
+            ++delivered;
+        }
+        return delivered;
+    }
+
+    void FeedReceiver::recover(MarketID market_id, std::uint64_t to)
+    {
+        std::uint64_t &expected = expected_[market_id];
+        if (config_.recovery_port != 0 && connect_recovery())
+        {
+            while (expected < to)
+            {
+                std::uint64_t from = expected;
+                auto count = static_cast<std::uint16_t>(std::min<std::uint64_t>(to - from, 0xffff));
+                if (!request(market_id, from, count) || expected == from)
+                    break;
+            }
+        }
+        if (expected < to)
+        {
+            stats_.lost += to - expected;
+            expected = to;
+        }
+    }
+
+#ifdef __linux__
+
+    void FeedReceiver::open()
+    {
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_port = htons(config_.port);
+        if (::inet_pton(AF_INET, config_.address.c_str(), &local.sin_addr) != 1)
+            throw std::invalid_argument("FeedReceiver address is not IPv4: " + config_.address);
+
+        int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        auto fail = [&](const std::string &what)
+        {
+            int err = errno;
+            if (fd >= 0)
+                ::close(fd);
+            throw std::runtime_error("Feed " + what + ": " + std::strerror(err));
+        };
+        if (fd < 0)
+            fail("socket");
+
+        int one = 1;
+        int rcvbuf = 8 << 20;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        // Bound to the group itself, the socket only sees that group's traffic.
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0)
+            fail("bind " + config_.address + ":" + std::to_string(config_.port));
+        if (IN_MULTICAST(ntohl(local.sin_addr.s_addr)))
+        {
+            ip_mreq membership{};
+            membership.imr_multiaddr = local.sin_addr;
+            if (::inet_pton(AF_INET, config_.interface.c_str(), &membership.imr_interface) != 1)
+            {
+                errno = EINVAL;
+                fail("interface " + config_.interface);
+            }
+            if (::setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0)
+                fail("join " + config_.address);
+        }
+        udp_fd_ = fd;
+    }
+
+    std::size_t FeedReceiver::poll(std::chrono::milliseconds timeout)
+    {
+        pollfd ready{udp_fd_, POLLIN, 0};
+        if (::poll(&ready, 1, static_cast<int>(timeout.count())) <= 0)
+            return 0;
+
+        mmsghdr msgs[kBatch]{};
+        iovec iovs[kBatch];
+        for (std::size_t i = 0; i < kBatch; ++i)
+        {
+            iovs[i] = {buffers_.data() + i * kMaxPacket, kMaxPacket};
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        std::size_t total = 0;
+        for (;;)
+        {
+            int n = ::recvmmsg(udp_fd_, msgs, kBatch, MSG_DONTWAIT, nullptr);
+            if (n <= 0)
+                break;
+            for (int i = 0; i < n; ++i)
+            {
+                if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+                    ++stats_.malformed;
+                else
+                    handle_packet(buffers_.data() + i * kMaxPacket, msgs[i].msg_len);
+            }
+            total += static_cast<std::size_t>(n);
+            if (static_cast<std::size_t>(n) < kBatch)
+                break;
+        }
+        return total;
+    }
+
+    bool FeedReceiver::connect_recovery()
+    {
+        if (recovery_fd_ >= 0)
+            return true;
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(config_.recovery_port);
+        if (::inet_pton(AF_INET, config_.recovery_address.c_str(), &addr.sin_addr) != 1)
+        {
+            std::cerr << "[Feed] recovery address is not IPv4: " << config_.recovery_address << std::endl;
+            return false;
+        }
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return false;
+        timeval timeout{2, 0};
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+        {
+            std::cerr << "[Feed] recovery connect: " << std::strerror(errno) << std::endl;
+            ::close(fd);
+            return false;
+        }
+        recovery_fd_ = fd;
+        return true;
+    }
+
+    bool FeedReceiver::read_exact(char *out, std::size_t size)
+    {
+        for (std::size_t got = 0; got < size;)
+        {
+            ssize_t n = ::recv(recovery_fd_, out + got, size - got, 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+            {
+                ::close(recovery_fd_);
+                recovery_fd_ = -1;
+                return false;
+            }
+            got += static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    bool FeedReceiver::request(MarketID market_id, std::uint64_t from, std::uint16_t count)
+    {
+        FeedRequest req{};
+        req.length = sizeof(FeedRequest);
+        req.type = FeedRequestType::Retransmit;
+        req.version = kFeedVersion;
+        req.market_id = market_id;
+        req.count = count;
+        req.from_sequence = from;
+        if (::send(recovery_fd_, &req, sizeof(req), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(req)))
+        {
+            ::close(recovery_fd_);
+            recovery_fd_ = -1;
+            return false;
+        }
+
+        for (;;)
+        {
+            FeedPacketHeader header;
+            if (!read_exact(response_.data(), sizeof(header)))
+                return false;
+            std::memcpy(&header, response_.data(), sizeof(header));
+            if (header.length < sizeof(header) ||
+                !read_exact(response_.data() + sizeof(header), header.length - sizeof(header)) ||
+                !valid(response_.data(), header.length) || header.market_id != market_id)
+            {
+                std::cerr << "[Feed] malformed recovery response for market " << market_id << std::endl;
+                if (recovery_fd_ >= 0)
+                    ::close(recovery_fd_);
+                recovery_fd_ = -1;
+                return false;
+            }
+
+            if (header.flags & FeedPacketHeader::kEndOfResponse)
+                return true;
+            if (header.flags & FeedPacketHeader::kSnapshot)
+            {
+                // What lies between here and the snapshot is gone for good.
+                std::uint64_t &expected = expected_[market_id];
+                ++stats_.snapshots;
+                if (header.sequence > expected)
+                    stats_.lost += header.sequence - expected;
+                expected = std::max(expected, header.sequence);
+                if (header.count == 1)
+                    handler_(market_id, header.sequence,
+                             *reinterpret_cast<const FeedMessageHeader *>(response_.data() + sizeof(header)));
+                continue;
+            }
+            std::uint64_t delivered = deliver(header, response_.data());
+            stats_.recovered += delivered;
+            stats_.messages += delivered;
+        }
+    }
+
+#else
+
+    void FeedReceiver::open()
+    {
+        throw std::runtime_error("FeedReceiver requires Linux");
+    }
+
+    std::size_t FeedReceiver::poll(std::chrono::milliseconds) { return 0; }
+    bool FeedReceiver::connect_recovery() { return false; }
+    bool FeedReceiver::read_exact(char *, std::size_t) { return false; }
+    bool FeedReceiver::request(MarketID, std::uint64_t, std::uint16_t) { return false; }
+
+#endif
+
+}
@@ -0,0 +1,1707 @@
+#include "FixGateway.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace MercEx
+{
+
+    namespace
+    {
+        constexpr std::uint64_t kListenerTag = ~std::uint64_t(0);
+        constexpr int kMaxEpollEvents = 256;
+        constexpr std::size_t kReportBatch = 64;
+
+        // Largest message the gateway writes; each inbound message is answered
+        // by at most two of them (a Logon and a ResendRequest).
+        constexpr std::size_t kMaxOutbound = FixWriter::kCapacity + 64;
+        constexpr std::size_t kReplyRoom = 2 * kMaxOutbound;
+
+        constexpr std::size_t kMaxCompID = 32;
+        constexpr std::size_t kMaxClOrdID = 32;
+
+        // ExecType and OrdStatus of each report, pre-serialized.
+        constexpr std::string_view kStatusNew = "150=0\x01"
+                                                "39=0\x01";
+        constexpr std::string_view kStatusPartial = "150=F\x01"
+                                                    "39=1\x01";
+        constexpr std::string_view kStatusFilled = "150=F\x01"
+                                                   "39=2\x01";
+        constexpr std::string_view kStatusCanceled = "150=4\x01"
+                                                     "39=4\x01";
+        constexpr std::string_view kStatusRejected = "150=8\x01"
+                                                     "39=8\x01";
+
+        // SessionRejectReason (373)
+        constexpr int kRequiredTagMissing = 1;
+        constexpr int kValueIncorrect = 5;
+        constexpr int kIncorrectFormat = 6;
+        constexpr int kInvalidMsgType = 11;
+
+        // OrdRejReason (103) and CxlRejReason (102)
+        constexpr int kUnknownSymbol = 1;
+        constexpr int kExchangeClosed = 2;
+        constexpr int kUnknownOrder = 5;
+        constexpr int kDuplicateOrder = 6;
+        constexpr int kIncorrectQuantity = 13;
+        constexpr int kOtherReason = 99;
+        constexpr int kTooLateToCancel = 0;
+        constexpr int kCancelUnknownOrder = 1;
+        constexpr int kAlreadyPendingCancel = 3;
+
+        int ord_rej_reason(RejectReason reason)
+        {
+            switch (reason)
+            {
+            case RejectReason::UnknownMarket:
+                return kUnknownSymbol;
+            case RejectReason::MarketInactive:
+                return kExchangeClosed;
+            case RejectReason::InvalidQuantity:
+                return kIncorrectQuantity;
+            case RejectReason::UnknownOrder:
+                return kUnknownOrder;
+            default:
+                return kOtherReason;
+            }
+        }
+
+        std::string_view reject_text(RejectReason reason)
+        {
+            switch (reason)
+            {
+            case RejectReason::InvalidOrder:
+                return "Invalid order";
+            case RejectReason::UnknownMarket:
+                return "Unknown symbol";
+            case RejectReason::MarketInactive:
+                return "Market closed";
+            case RejectReason::InvalidQuantity:
+                return "Invalid quantity";
+            case RejectReason::MissingPrice:
+                return "Price required";
+            case RejectReason::UnexpectedPrice:
+                return "Price not allowed for order type";
+            case RejectReason::InvalidPrice:
+                return "Invalid price";
+            case RejectReason::OffTickPrice:
+                return "Price not on tick";
+            case RejectReason::MissingStopPrice:
+                return "Stop price required";
+            case RejectReason::InvalidStopPrice:
+                return "Invalid stop price";
+            case RejectReason::UnknownOrder:
+                return "Unknown order";
+            case RejectReason::TooLateToCancel:
+                return "Too late to cancel";
+            case RejectReason::InvalidDisplayQuantity:
+                return "Invalid display quantity";
+            case RejectReason::InvalidPegOffset:
+                return "Invalid peg offset";
+            case RejectReason::NoReferencePrice:
+                return "No reference price to peg to";
+            default:
+                return "Rejected";
+            }
+        }
+
+        std::uint64_t hash_id(OrderID id)
+        {
+            std::uint64_t x = id * 0x9e3779b97f4a7c15ULL;
+            return x ^ (x >> 29);
+        }
+
+        std::uint64_t hash_text(std::string_view s)
+        {
+            std::uint64_t h = 0xcbf29ce484222325ULL; // FNV-1a
+            for (char c : s)
+                h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+            return h;
+        }
+
+        bool is_yes(std::string_view flag)
+        {
+            return flag.size() == 1 && flag[0] == 'Y';
+        }
+
+        // Session messages are gap-filled on a resend; everything else the
+        // gateway sends (ExecutionReport, OrderCancelReject, Reject) is
+        // replayed.
+        bool is_replayed(std::string_view msg_type)
+        {
+            return msg_type.size() != 1 || std::string_view("01245A").find(msg_type[0]) == std::string_view::npos;
+        }
+    }
+
+    // Open orders of one session, found by OrderID for reports and by
+    // ClOrdID for cancels and replaces. Entries sit in a fixed array; two open-addressing
+    // indexes, each at least twice the array's size, point into it, and
+    // erasing shifts later probes back instead of leaving tombstones.
+    class FixGateway::OrderTable
+    {
+    public:
+        struct Entry
+        {
+            OrderID order_id;
+            std::uint64_t cl_hash;
+            Quantity order_qty;
+            Quantity cum_qty;
+            double notional; // sum of fill qty * price, for AvgPx
+            std::uint32_t symbol;
+            MarketID market_id;
+            Side side;
+            char status;    // last OrdStatus sent
+            bool terminal;  // kept only until a pending cancel is answered
+            bool replacing; // the pending request is a cancel/replace
+            std::uint8_t cl_length;
+            std::uint8_t cancel_length;
+            char cl_ord_id[kMaxClOrdID];
+            char cancel_cl_ord_id[kMaxClOrdID]; // of the pending cancel or replace
+
+            std::string_view cl() const { return {cl_ord_id, cl_length}; }
+            std::string_view cancel() const { return {cancel_cl_ord_id, cancel_length}; }
+            bool cancel_pending() const { return cancel_length > 0; }
+        };
+
+        explicit OrderTable(std::size_t capacity) : entries_(capacity)
+        {
+            std::size_t slots = 16;
+            while (slots < 2 * capacity)
+                slots <<= 1;
+            mask_ = slots - 1;
+            by_id_.assign(slots, kEmpty);
+            by_cl_.assign(slots, kEmpty);
+            free_.reserve(capacity);
+            clear();
+        }
+
+        void clear()
+        {
+            std::fill(by_id_.begin(), by_id_.end(), kEmpty);
+            std::fill(by_cl_.begin(), by_cl_.end(), kEmpty);
+            free_.clear();
+            for (std::size_t i = entries_.size(); i-- > 0;)
+                free_.push_back(static_cast<std::uint32_t>(i));
+        }
+
+        bool full() const { return free_.empty(); }
+
+        // The caller has checked that the table is not full and that no open
+        // order uses the ClOrdID.
+        Entry &insert(OrderID id, std::string_view cl_ord_id)
+        {
+            std::uint32_t index = free_.back();
+            free_.pop_back();
+            Entry &e = entries_[index];
+            e = Entry{};
+            e.order_id = id;
+            e.cl_hash = hash_text(cl_ord_id);
+            e.cl_length = static_cast<std::uint8_t>(cl_ord_id.size());
+            std::memcpy(e.cl_ord_id, cl_ord_id.data(), cl_ord_id.size());
+
+            std::size_t i = hash_id(id) & mask_;
+            while (by_id_[i] != kEmpty)
+                i = (i + 1) & mask_;
+            by_id_[i] = index;
+            i = e.cl_hash & mask_;
+            while (by_cl_[i] != kEmpty)
+                i = (i + 1) & mask_;
+            by_cl_[i] = index;
+            return e;
+        }
+
+        Entry *find(OrderID id)
+        {
+            for (std::size_t i = hash_id(id) & mask_; by_id_[i] != kEmpty; i = (i + 1) & mask_)
+            {
+                if (entries_[by_id_[i]].order_id == id)
+                    return &entries_[by_id_[i]];
+            }
+            return nullptr;
+        }
+
+        Entry *find(std::string_view cl_ord_id)
+        {
+            std::uint64_t h = hash_text(cl_ord_id);
+            for (std::size_t i = h & mask_; by_cl_[i] != kEmpty; i = (i + 1) & mask_)
+            {
+                Entry &e = entries_[by_cl_[i]];
+                if (e.cl_hash == h && e.cl() == cl_ord_id)
+                    return &e;
+            }
+            return nullptr;
+        }
+
+        // A replace gives the order the ClOrdID of the request; the caller has
+        // checked that no open order uses it.
+        void rekey(Entry &e, std::string_view cl_ord_id)
+        {
+            auto index = static_cast<std::uint32_t>(&e - entries_.data());
+            unlink(by_cl_, index, [](const Entry &x) { return x.cl_hash; });
+            e.cl_hash = hash_text(cl_ord_id);
+            e.cl_length = static_cast<std::uint8_t>(cl_ord_id.size());
+            std::memcpy(e.cl_ord_id, cl_ord_id.data(), cl_ord_id.size());
+            std::size_t i = e.cl_hash & mask_;
+            while (by_cl_[i] != kEmpty)
+                i = (i + 1) & mask_;
+            by_cl_[i] = index;
+        }
+
+        void erase(Entry &e)
+        {
+            auto index = static_cast<std::uint32_t>(&e - entries_.data());
+            unlink(by_id_, index, [](const Entry &x) { return hash_id(x.order_id); });
+            unlink(by_cl_, index, [](const Entry &x) { return x.cl_hash; });
+            free_.push_back(index);
+        }
+
+    private:
+        static constexpr std::uint32_t kEmpty = ~std::uint32_t(0);
+
+        template <typename Hash>
+        void unlink(std::vector<std::uint32_t> &slots, std::uint32_t index, Hash hash)
+        {
+            std::size_t hole = hash(entries_[index]) & mask_;
+            while (slots[hole] != index)
+                hole = (hole + 1) & mask_;
+            // Pull back every later entry of the run whose home lies at or
+            // before the hole, so no probe stops short of it.
+            for (std::size_t j = (hole + 1) & mask_; slots[j] != kEmpty; j = (j + 1) & mask_)
+            {
+                std::size_t home = hash(entries_[slots[j]]) & mask_;
+                if (((j - home) & mask_) >= ((j - hole) & mask_))
+                {
+                    slots[hole] = slots[j];
+                    hole = j;
+                }
+            }
+            slots[hole] = kEmpty;
+        }
+
+        std::vector<Entry> entries_;
+        std::vector<std::uint32_t> free_;
+        std::vector<std::uint32_t> by_id_;
+        std::vector<std::uint32_t> by_cl_;
+        std::size_t mask_ = 0;
+    };
+
+    // Application messages sent to one counterparty, oldest first, for
+    // ResendRequests. Each slot keeps a message's type, MsgSeqNum and
+    // SendingTime and its fields after them; once every slot is used the
+    // oldest message is dropped, and a resend of it becomes a gap fill.
+    class FixGateway::OutboundStore
+    {
+    public:
+        static constexpr std::size_t kTimeSize = 21; // see FixTimestamp
+        // What a replay adds to the original: "43=Y<SOH>122=<time><SOH>".
+        static constexpr std::size_t kReplayExtra = 5 + 5 + kTimeSize;
+
+        struct Message
+        {
+            std::uint64_t seq_num = 0;
+            char msg_type = 0;
+            std::uint16_t body_size = 0;
+            char sending_time[kTimeSize];
+            char body[FixWriter::kCapacity];
+
+            std::string_view type() const { return {&msg_type, 1}; }
+            std::string_view original_time() const { return {sending_time, kTimeSize}; }
+            std::string_view fields() const { return {body, body_size}; }
+        };
+
+        explicit OutboundStore(std::size_t capacity) : slots_(capacity) {}
+
+        void clear() { head_ = count_ = 0; }
+
+        // bytes is the message as sent, from "8=" to the checksum. One too
+        // long to replay within FixWriter::kCapacity is not kept.
+        void add(std::uint64_t seq_num, std::string_view bytes)
+        {
+            if (slots_.empty())
+                return;
+            std::size_t type = bytes.find("\x01"
+                                          "35=");
+            std::size_t time = bytes.find("\x01"
+                                          "52=");
+            std::size_t trailer = bytes.rfind("\x01"
+                                              "10=");
+            if (type == std::string_view::npos || time == std::string_view::npos ||
+                trailer == std::string_view::npos)
+                return;
+            type += 4;
+            time += 4;
+            std::size_t fields = time + kTimeSize + 1;
+            ++trailer;
+            // Body length counts from "35=" up to the checksum.
+            if (bytes[type + 1] != kSoh || fields > trailer ||
+                trailer - (type - 3) + kReplayExtra > FixWriter::kCapacity)
+                return;
+
+            Message *m;
+            if (count_ < slots_.size())
+            {
+                m = &at(count_++);
+            }
+            else
+            {
+                m = &slots_[head_];
+                head_ = (head_ + 1) % slots_.size();
+            }
+            m->seq_num = seq_num;
+            m->msg_type = bytes[type];
+            m->body_size = static_cast<std::uint16_t>(trailer - fields);
+            std::memcpy(m->sending_time, bytes.data() + time, kTimeSize);
+            std::memcpy(m->body, bytes.data() + fields, m->body_size);
+        }
+
+        // The oldest message numbered seq_num or later, or null.
+        const Message *find(std::uint64_t seq_num) const
+        {
+            std::size_t lo = 0, hi = count_;
+            while (lo < hi)
+            {
+                std::size_t mid = lo + (hi - lo) / 2;
+                if (at(mid).seq_num < seq_num)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return lo < count_ ? &at(lo) : nullptr;
+        }
+
+    private:
+        Message &at(std::size_t i) { return slots_[(head_ + i) % slots_.size()]; }
+        const Message &at(std::size_t i) const { return slots_[(head_ + i) % slots_.size()]; }
+
+        std::vector<Message> slots_;
+        std::size_t head_ = 0; // oldest message
+        std::size_t count_ = 0;
+    };
+
+    // A counterparty's sequence numbers and sent messages, kept between its
+    // connections.
+    struct FixGateway::CounterpartyState
+    {
+        explicit CounterpartyState(std::size_t resend_messages) : sent(resend_messages) {}
+
+        void reset()
+        {
+            expected_in = next_out = 1;
+            sent.clear();
+        }
+
+        std::uint64_t expected_in = 1;
+        std::uint64_t next_out = 1;
+        OutboundStore sent;
+    };
+
+    struct FixGateway::Session
+    {
+        Session(std::uint32_t slot, std::size_t receive_bytes, std::size_t send_bytes, std::size_t max_orders)
+            : slot(slot), rx(receive_bytes), tx(send_bytes), orders(max_orders)
+        {
+            header.reserve(2 * kMaxCompID + 16);
+        }
+
+        void reset(int socket, std::chrono::steady_clock::time_point now)
+        {
+            fd = socket;
+            counterparty = nullptr;
+            state = nullptr;
+            channel = nullptr;
+            header.clear();
+            expected_in = next_out = 1;
+            resend_from = 0;
+            resend_next = resend_end = 0;
+            heartbeat = std::chrono::seconds(0);
+            connected = last_rx = last_tx = now;
+            test_pending = false;
+            rx_begin = rx_end = 0;
+            tx_begin = tx_end = 0;
+            writable = true;
+            read_blocked = false;
+            logging_out = false;
+            closing = false;
+            orders.clear();
+        }
+
+        std::size_t tx_pending() const { return tx_end - tx_begin; }
+
+        std::uint32_t slot;
+        int fd = -1;
+        const FixCounterparty *counterparty = nullptr; // set once logged on
+        CounterpartyState *state = nullptr;            // likewise
+        ExecutionReportChannel *channel = nullptr;
+
+        // "49=<ours><SOH>56=<theirs><SOH>", copied into every message.
+        std::string header;
+        std::uint64_t expected_in = 1;
+        std::uint64_t next_out = 1;
+        std::uint64_t resend_from = 0; // expected_in when the last ResendRequest went out
+        // The client's ResendRequest being answered: resend_next is the next
+        // MsgSeqNum to replay, 0 when there is none, up to resend_end.
+        std::uint64_t resend_next = 0;
+        std::uint64_t resend_end = 0;
+
+        std::chrono::seconds heartbeat{0}; // 0 until logged on, or if the client wants none
+        std::chrono::steady_clock::time_point connected;
+        std::chrono::steady_clock::time_point last_rx;
+        std::chrono::steady_clock::time_point last_tx;
+        std::chrono::steady_clock::time_point test_sent;
+        bool test_pending = false;
+
+        // Unparsed bytes are [rx_begin, rx_end); unsent ones [tx_begin, tx_end).
+        std::vector<char> rx;
+        std::size_t rx_begin = 0;
+        std::size_t rx_end = 0;
+        std::vector<char> tx;
+        std::size_t tx_begin = 0;
+        std::size_t tx_end = 0;
+
+        bool writable = true;      // false from EAGAIN until the next EPOLLOUT
+        bool read_blocked = false; // parsing paused until the send buffer drains
+        bool logging_out = false;  // a Logout has been sent
+        bool closing = false;      // closed at the end of the loop iteration, after a last flush
+
+        OrderTable orders;
+    };
+
+    FixGateway::FixGateway(MatchingEngine &engine, ExecutionReportRouter &reports, FixGatewayConfig config)
+        : engine_(engine), reports_(reports), config_(std::move(config))
+    {
+        if (config_.max_sessions == 0)
+            throw std::invalid_argument("FixGateway needs at least one session");
+        if (config_.max_open_orders == 0)
+            throw std::invalid_argument("FixGateway needs room for at least one open order");
+        if (config_.receive_buffer < kMaxOutbound || config_.send_buffer < 2 * kReplyRoom)
+            throw std::invalid_argument("FixGateway buffers are too small for a FIX message");
+        auto valid_id = [](const std::string &id) {
+            return !id.empty() && id.size() <= kMaxCompID && id.find(kSoh) == std::string::npos;
+        };
+        if (!valid_id(config_.comp_id))
+            throw std::invalid_argument("FixGateway comp ID is empty, too long or not text: " + config_.comp_id);
+        for (const auto &cp : config_.counterparties)
+        {
+            if (!valid_id(cp.comp_id) || cp.client_id == 0)
+                throw std::invalid_argument("FixGateway counterparty is not valid: " + cp.comp_id);
+        }
+
+        std::sort(config_.symbols.begin(), config_.symbols.end(),
+                  [](const FixSymbol &a, const FixSymbol &b) { return a.symbol < b.symbol; });
+        for (const auto &s : config_.symbols)
+        {
+            if (s.symbol.empty() || s.symbol.find(kSoh) != std::string::npos)
+                throw std::invalid_argument("FixGateway symbol is not valid: " + s.symbol);
+            symbol_fields_.push_back("55=" + s.symbol + kSoh);
+        }
+        counterparty_states_.resize(config_.counterparties.size());
+    }
+
+    FixGateway::~FixGateway()
+    {
+        stop();
+    }
+
+    void FixGateway::start()
+    {
+#ifndef __linux__
+        throw std::runtime_error("FixGateway requires Linux epoll");
+#else
+        if (running_.load(std::memory_order_acquire))
+            return;
+        open_listener();
+        running_.store(true, std::memory_order_release);
+        worker_ = std::thread(&FixGateway::run, this);
+#endif
+    }
+
+    void FixGateway::stop()
+    {
+        running_.store(false, std::memory_order_release);
+        if (worker_.joinable())
+            worker_.join();
+#ifdef __linux__
+        for (Session *session : live_)
+            close_session(*session);
+        live_.clear();
+        session_count_.store(0, std::memory_order_relaxed);
+        if (epoll_fd_ >= 0)
+            ::close(epoll_fd_);
+        if (listen_fd_ >= 0)
+            ::close(listen_fd_);
+        epoll_fd_ = listen_fd_ = -1;
+#endif
+    }
+
+    const FixSymbol *FixGateway::find_symbol(std::string_view symbol) const
+    {
+        auto it = std::lower_bound(config_.symbols.begin(), config_.symbols.end(), symbol,
+                                   [](const FixSymbol &s, std::string_view key) { return s.symbol < key; });
+        return it != config_.symbols.end() && it->symbol == symbol ? &*it : nullptr;
+    }
+
+    const FixCounterparty *FixGateway::find_counterparty(std::string_view comp_id) const
+    {
+        for (const auto &cp : config_.counterparties)
+        {
+            if (cp.comp_id == comp_id)
+                return &cp;
+        }
+        return nullptr;
+    }
+
+#ifdef __linux__
+
+    void FixGateway::open_listener()
+    {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(config_.port);
+        if (::inet_pton(AF_INET, config_.address.c_str(), &addr.sin_addr) != 1)
+            throw std::invalid_argument("FixGateway address is not IPv4: " + config_.address);
+
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            throw std::runtime_error(std::string("FixGateway socket: ") + std::strerror(errno));
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        socklen_t len = sizeof(addr);
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+            ::listen(fd, config_.backlog) != 0 ||
+            ::getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) != 0)
+        {
+            int err = errno;
+            ::close(fd);
+            throw std::runtime_error("FixGateway " + config_.address + ":" + std::to_string(config_.port) + ": " +
+                                     std::strerror(err));
+        }
+
+        int ep = ::epoll_create1(EPOLL_CLOEXEC);
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.u64 = kListenerTag;
+        if (ep < 0 || ::epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev) != 0)
+        {
+            int err = errno;
+            if (ep >= 0)
+                ::close(ep);
+            ::close(fd);
+            throw std::runtime_error(std::string("FixGateway epoll: ") + std::strerror(err));
+        }
+        listen_fd_ = fd;
+        epoll_fd_ = ep;
+        port_ = ntohs(addr.sin_port);
+    }
+
+    FixGateway::Session &FixGateway::open_slot(int fd)
+    {
+        std::uint32_t slot;
+        if (!free_slots_.empty())
+        {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+        }
+        else
+        {
+            slot = static_cast<std::uint32_t>(sessions_.size());
+            sessions_.push_back(std::make_unique<Session>(slot, config_.receive_buffer, config_.send_buffer,
+                                                          config_.max_open_orders));
+        }
+        Session &session = *sessions_[slot];
+        session.reset(fd, now_);
+        return session;
+    }
+
+    void FixGateway::run()
+    {
+        apply_thread_placement(config_.placement, "mx-fix-gw");
+
+        epoll_event events[kMaxEpollEvents];
+        bool busy = false;
+        while (running_.load(std::memory_order_acquire))
+        {
+            // Reports arrive without waking epoll, so block only while no
+            // session is open; otherwise poll like TcpGateway does.
+            int n = ::epoll_wait(epoll_fd_, events, kMaxEpollEvents, busy || !live_.empty() ? 0 : 1);
+            busy = n > 0;
+            now_ = std::chrono::steady_clock::now();
+            now_text_.refresh(std::chrono::system_clock::now());
+
+            for (int i = 0; i < n; ++i)
+            {
+                if (events[i].data.u64 == kListenerTag)
+                {
+                    accept_sessions();
+                    continue;
+                }
+                Session &session = *sessions_[events[i].data.u64];
+                if (session.closing)
+                    continue;
+                std::uint32_t flags = events[i].events;
+                if (flags & (EPOLLERR | EPOLLHUP))
+                {
+                    session.closing = true;
+                    continue;
+                }
+                if (flags & EPOLLOUT)
+                    session.writable = true;
+                if (flags & (EPOLLIN | EPOLLRDHUP))
+                    read_session(session);
+            }
+
+            for (std::size_t i = 0; i < live_.size();)
+            {
+                Session &session = *live_[i];
+                if (!session.closing)
+                {
+                    // A resend goes out whole before anything newer: requests
+                    // and reports wait for it.
+                    if (session.resend_next != 0)
+                        busy |= resend(session);
+                    if (session.read_blocked && session.resend_next == 0 && reserve(session, kReplyRoom))
+                        busy |= read_session(session);
+                    if (session.channel && !session.closing && session.resend_next == 0)
+                        busy |= drain_reports(session);
+                    if (!session.closing)
+                        check_timers(session);
+                }
+                // A closing session still gets its last messages, a Logout
+                // among them, if the socket takes them.
+                if (session.tx_pending() > 0 && session.writable)
+                    flush(session);
+                if (session.closing)
+                {
+                    close_session(session);
+                    live_[i] = live_.back();
+                    live_.pop_back();
+                    session_count_.store(live_.size(), std::memory_order_relaxed);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+
+            if (!busy && !live_.empty())
+                std::this_thread::sleep_for(std::chrono::nanoseconds(100));
+        }
+    }
+
+    bool FixGateway::accept_sessions()
+    {
+        bool accepted = false;
+        for (;;)
+        {
+            int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    std::cerr << "[FixGateway] accept: " << std::strerror(errno) << std::endl;
+                return accepted;
+            }
+            if (live_.size() >= config_.max_sessions)
+            {
+                ::close(fd);
+                continue;
+            }
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            Session &session = open_slot(fd);
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            ev.data.u64 = session.slot;
+            if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0)
+            {
+                std::cerr << "[FixGateway] epoll_ctl: " << std::strerror(errno) << std::endl;
+                ::close(fd);
+                session.fd = -1;
+                free_slots_.push_back(session.slot);
+                continue;
+            }
+            live_.push_back(&session);
+            session_count_.store(live_.size(), std::memory_order_relaxed);
+            accepted = true;
+        }
+    }
+
+    bool FixGateway::read_session(Session &session)
+    {
+        session.read_blocked = false;
+        bool progressed = false;
+        for (;;)
+        {
+            std::size_t consumed = parse_messages(session);
+            progressed |= consumed > 0;
+            if (session.closing || session.read_blocked)
+                return progressed;
+
+            if (session.rx_begin == session.rx_end)
+            {
+                session.rx_begin = session.rx_end = 0;
+            }
+            else if (session.rx_end == session.rx.size())
+            {
+                if (session.rx_begin == 0)
+                {
+                    // One message larger than the whole buffer.
+                    protocol_errors_.add();
+                    session.closing = true;
+                    return progressed;
+                }
+                std::memmove(session.rx.data(), session.rx.data() + session.rx_begin,
+                             session.rx_end - session.rx_begin);
+                session.rx_end -= session.rx_begin;
+                session.rx_begin = 0;
+            }
+
+            ssize_t n = ::recv(session.fd, session.rx.data() + session.rx_end, session.rx.size() - session.rx_end, 0);
+            if (n > 0)
+            {
+                session.rx_end += static_cast<std::size_t>(n);
+                progressed = true;
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                session.closing = true;
+            return progressed;
+        }
+    }
+
+    void FixGateway::flush(Session &session)
+    {
+        while (session.tx_pending() > 0)
+        {
+            ssize_t n = ::send(session.fd, session.tx.data() + session.tx_begin, session.tx_pending(), MSG_NOSIGNAL);
+            if (n > 0)
+            {
+                session.tx_begin += static_cast<std::size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                session.writable = false;
+            else
+                session.closing = true;
+            return;
+        }
+        session.tx_begin = session.tx_end = 0;
+    }
+
+    void FixGateway::close_session(Session &session)
+    {
+        if (epoll_fd_ >= 0)
+            ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, session.fd, nullptr);
+        ::close(session.fd);
+        session.fd = -1;
+        if (session.channel)
+        {
+            reports_.close_session(session.counterparty->client_id);
+            session.channel = nullptr;
+        }
+        if (session.state)
+        {
+            // Where the counterparty's next Logon picks up.
+            session.state->expected_in = session.expected_in;
+            session.state->next_out = session.next_out;
+            session.state = nullptr;
+        }
+        session.counterparty = nullptr;
+        free_slots_.push_back(session.slot);
+    }
+
+#else
+
+    void FixGateway::open_listener() {}
+    void FixGateway::run() {}
+    bool FixGateway::accept_sessions() { return false; }
+    bool FixGateway::read_session(Session &) { return false; }
+    void FixGateway::flush(Session &) {}
+    void FixGateway::close_session(Session &) {}
+
+#endif
+
+    std::size_t FixGateway::parse_messages(Session &session)
+    {
+        std::size_t consumed = 0;
+        while (!session.closing && !session.logging_out && session.rx_begin < session.rx_end)
+        {
+            if (session.resend_next != 0 || !reserve(session, kReplyRoom))
+            {
+                session.read_blocked = true;
+                break;
+            }
+            FixParseResult r = fix_parse(session.rx.data() + session.rx_begin, session.rx_end - session.rx_begin,
+                                         inbound_);
+            if (r.status == FixParseStatus::Incomplete)
+                break;
+            if (r.status == FixParseStatus::Invalid)
+            {
+                protocol_errors_.add();
+                session.closing = true;
+                break;
+            }
+            session.rx_begin += r.consumed;
+            consumed += r.consumed;
+            messages_in_.add();
+            session.last_rx = now_;
+            session.test_pending = false;
+            // Garbled messages are skipped without a sequence number.
+            if (r.status == FixParseStatus::Garbled)
+            {
+                protocol_errors_.add();
+                continue;
+            }
+            handle_message(session, inbound_);
+        }
+        return consumed;
+    }
+
+    void FixGateway::handle_message(Session &session, const FixMessage &msg)
+    {
+        std::string_view type = msg.msg_type();
+        if (!session.counterparty)
+        {
+            if (type == "A")
+            {
+                handle_logon(session, msg);
+                return;
+            }
+            // Nothing but a Logon before the session exists.
+            protocol_errors_.add();
+            session.closing = true;
+            return;
+        }
+        if (type == "A")
+        {
+            send_logout(session, "Already logged on");
+            return;
+        }
+        if (!check_sequence(session, msg))
+            return;
+
+        if (type.size() == 1)
+        {
+            switch (type[0])
+            {
+            case 'D':
+                handle_new_order(session, msg);
+                return;
+            case 'F':
+                handle_cancel(session, msg);
+                return;
+            case 'G':
+                handle_replace(session, msg);
+                return;
+            case '0':
+            case '1':
+            case '2':
+            case '4':
+            case '5':
+                handle_admin(session, msg);
+                return;
+            default:
+                break;
+            }
+        }
+        send_reject(session, msg, 0, kInvalidMsgType);
+    }
+
+    void FixGateway::handle_logon(Session &session, const FixMessage &msg)
+    {
+        std::string_view sender = msg.get(FixTag::SenderCompID);
+        session.header.clear();
+        session.header.append("49=").append(config_.comp_id).append(1, kSoh);
+        session.header.append("56=").append(sender.substr(0, kMaxCompID)).append(1, kSoh);
+
+        std::uint64_t heartbeat = 0;
+        const FixCounterparty *cp = find_counterparty(sender);
+        std::string_view encrypt = msg.get(FixTag::EncryptMethod);
+        if (msg.seq_num() == 0)
+        {
+            send_logout(session, "MsgSeqNum missing");
+            return;
+        }
+        if (!cp || msg.get(FixTag::TargetCompID) != config_.comp_id)
+        {
+            send_logout(session, "Unknown SenderCompID or TargetCompID");
+            return;
+        }
+        if (!fix_to_uint(msg.get(FixTag::HeartBtInt), heartbeat) ||
+            heartbeat > static_cast<std::uint64_t>(config_.max_heartbeat.count()))
+        {
+            send_logout(session, "HeartBtInt missing or out of range");
+            return;
+        }
+        if (!encrypt.empty() && encrypt != "0")
+        {
+            send_logout(session, "EncryptMethod not supported");
+            return;
+        }
+        for (const Session *other : live_)
+        {
+            if (other->counterparty == cp)
+            {
+                send_logout(session, "Already logged on");
+                return;
+            }
+        }
+        auto &state = counterparty_states_[static_cast<std::size_t>(cp - config_.counterparties.data())];
+        if (!state)
+            state = std::make_unique<CounterpartyState>(config_.resend_messages);
+        bool reset = is_yes(msg.get(FixTag::ResetSeqNumFlag));
+        if (!reset && msg.seq_num() < state->expected_in)
+        {
+            send_logout(session, "MsgSeqNum too low");
+            return;
+        }
+        try
+        {
+            session.channel = &reports_.open_session(cp->client_id);
+        }
+        catch (const std::out_of_range &)
+        {
+            send_logout(session, "Client not accepted");
+            return;
+        }
+        if (reset)
+            state->reset();
+        session.counterparty = cp;
+        session.state = state.get();
+        session.expected_in = state->expected_in;
+        session.next_out = state->next_out;
+        session.heartbeat = std::chrono::seconds(heartbeat);
+
+        start_message(session, "A");
+        writer_.field(FixTag::EncryptMethod, '0');
+        writer_.field(FixTag::HeartBtInt, heartbeat);
+        if (reset)
+            writer_.field(FixTag::ResetSeqNumFlag, 'Y');
+        send(session);
+
+        // The Logon itself may open a gap, if the client sent messages that
+        // never arrived before its last connection ended.
+        check_sequence(session, msg);
+    }
+
+    bool FixGateway::check_sequence(Session &session, const FixMessage &msg)
+    {
+        // A SequenceReset in reset mode carries no sequence number that counts.
+        if (msg.msg_type() == "4" && !is_yes(msg.get(FixTag::GapFillFlag)))
+            return true;
+
+        std::uint64_t seq = msg.seq_num();
+        if (seq == session.expected_in)
+        {
+            ++session.expected_in;
+            return true;
+        }
+        if (seq > session.expected_in)
+        {
+            // Ask once for everything from the gap on; what arrives past it is
+            // dropped and comes back with the resend.
+            if (session.resend_from != session.expected_in)
+            {
+                session.resend_from = session.expected_in;
+                start_message(session, "2");
+                writer_.field(FixTag::BeginSeqNo, session.expected_in);
+                writer_.field(FixTag::EndSeqNo, 0);
+                send(session);
+            }
+            if (msg.msg_type() == "5")
+                send_logout(session, {});
+            return false;
+        }
+        if (seq > 0 && is_yes(msg.get(FixTag::PossDupFlag)))
+            return false; // a resend of something already processed
+        send_logout(session, seq == 0 ? "MsgSeqNum missing" : "MsgSeqNum too low");
+        return false;
+    }
+
+    void FixGateway::handle_admin(Session &session, const FixMessage &msg)
+    {
+        switch (msg.msg_type()[0])
+        {
+        case '0':
+            return;
+        case '1':
+            start_message(session, "0");
+            writer_.field(FixTag::TestReqID, msg.get(FixTag::TestReqID));
+            send(session);
+            return;
+        case '2':
+        {
+            std::uint64_t begin = 0, end = 0;
+            if (!fix_to_uint(msg.get(FixTag::BeginSeqNo), begin) || begin == 0 || begin >= session.next_out)
+            {
+                send_reject(session, msg, FixTag::BeginSeqNo, kValueIncorrect);
+                return;
+            }
+            if (msg.has(FixTag::EndSeqNo) && !fix_to_uint(msg.get(FixTag::EndSeqNo), end))
+            {
+                send_reject(session, msg, FixTag::EndSeqNo, kIncorrectFormat);
+                return;
+            }
+            // EndSeqNo 0 asks for everything sent.
+            if (end == 0 || end >= session.next_out)
+                end = session.next_out - 1;
+            if (end < begin)
+            {
+                send_reject(session, msg, FixTag::EndSeqNo, kValueIncorrect);
+                return;
+            }
+            session.resend_next = begin;
+            session.resend_end = end;
+            resend(session);
+            return;
+        }
+        case '4':
+        {
+            std::uint64_t next = 0;
+            if (!fix_to_uint(msg.get(FixTag::NewSeqNo), next))
+            {
+                send_reject(session, msg, FixTag::NewSeqNo,
+                            msg.has(FixTag::NewSeqNo) ? kIncorrectFormat : kRequiredTagMissing);
+                return;
+            }
+            if (next < session.expected_in)
+            {
+                send_reject(session, msg, FixTag::NewSeqNo, kValueIncorrect);
+                return;
+            }
+            session.expected_in = next;
+            return;
+        }
+        case '5':
+            if (!session.logging_out)
+                send_logout(session, {});
+            session.closing = true;
+            return;
+        }
+    }
+
+    bool FixGateway::resend(Session &session)
+    {
+        bool progressed = false;
+        while (session.resend_next != 0 && !session.closing)
+        {
+            if (!reserve(session, kMaxOutbound))
+                return progressed;
+            const OutboundStore::Message *kept = session.state->sent.find(session.resend_next);
+            if (kept && kept->seq_num == session.resend_next)
+            {
+                writer_.begin(kept->type());
+                writer_.raw(session.header);
+                writer_.field(FixTag::MsgSeqNum, kept->seq_num);
+                writer_.field(FixTag::PossDupFlag, 'Y');
+                writer_.field(FixTag::SendingTime, now_text_.view());
+                writer_.field(FixTag::OrigSendingTime, kept->original_time());
+                writer_.raw(kept->fields());
+                sending_kept_ = false;
+                send(session);
+                ++session.resend_next;
+            }
+            else
+            {
+                // Session messages, and whatever is no longer kept, up to the
+                // next message that is.
+                std::uint64_t next = kept && kept->seq_num <= session.resend_end ? kept->seq_num
+                                                                                 : session.resend_end + 1;
+                start_message(session, "4", session.resend_next);
+                writer_.field(FixTag::PossDupFlag, 'Y');
+                writer_.field(FixTag::OrigSendingTime, now_text_.view());
+                writer_.field(FixTag::GapFillFlag, 'Y');
+                writer_.field(FixTag::NewSeqNo, next);
+                send(session);
+                session.resend_next = next;
+            }
+            if (session.resend_next > session.resend_end)
+                session.resend_next = 0;
+            progressed = true;
+        }
+        return progressed;
+    }
+
+    void FixGateway::handle_new_order(Session &session, const FixMessage &msg)
+    {
+        static constexpr int kRequired[] = {FixTag::ClOrdID, FixTag::Symbol, FixTag::Side, FixTag::OrderQty,
+                                            FixTag::OrdType};
+        for (int tag : kRequired)
+        {
+            if (msg.get(tag).empty())
+            {
+                send_reject(session, msg, tag, kRequiredTagMissing);
+                return;
+            }
+        }
+
+        std::string_view cl_ord_id = msg.get(FixTag::ClOrdID);
+        if (cl_ord_id.size() > kMaxClOrdID)
+        {
+            send_reject(session, msg, FixTag::ClOrdID, kValueIncorrect);
+            return;
+        }
+
+        Side side;
+        std::string_view side_text = msg.get(FixTag::Side);
+        if (side_text == "1")
+            side = Side::Buy;
+        else if (side_text == "2")
+            side = Side::Sell;
+        else
+        {
+            send_reject(session, msg, FixTag::Side, kValueIncorrect);
+            return;
+        }
+
+        // Sign and size are the engine's to judge; the value must fit a Quantity.
+        std::int64_t quantity = 0;
+        if (!fix_to_int(msg.get(FixTag::OrderQty), quantity) || quantity > INT32_MAX || quantity < INT32_MIN)
+        {
+            send_reject(session, msg, FixTag::OrderQty, kIncorrectFormat);
+            return;
+        }
+
+        OrderType type;
+        std::string_view type_text = msg.get(FixTag::OrdType);
+        if (type_text == "1")
+            type = OrderType::Market;
+        else if (type_text == "2")
+            type = OrderType::Limit;
+        else if (type_text == "3")
+            type = OrderType::Stop;
+        else if (type_text == "4")
+            type = OrderType::StopLimit;
+        else if (type_text == "P")
+            type = OrderType::Pegged;
+        else
+        {
+            send_reject(session, msg, FixTag::OrdType, kValueIncorrect);
+            return;
+        }
+
+        // MaxFloor makes a limit order an iceberg showing that much at a time.
+        std::int64_t display_qty = 0;
+        if (msg.has(FixTag::MaxFloor))
+        {
+            if (type != OrderType::Limit)
+            {
+                send_reject(session, msg, FixTag::MaxFloor, kValueIncorrect);
+                return;
+            }
+            if (!fix_to_int(msg.get(FixTag::MaxFloor), display_qty) || display_qty > INT32_MAX || display_qty < INT32_MIN)
+            {
+                send_reject(session, msg, FixTag::MaxFloor, kIncorrectFormat);
+                return;
+            }
+            type = OrderType::Iceberg;
+        }
+
+        // A pegged order names its peg in ExecInst: R (primary) follows its own
+        // side of the book, P (market) the opposite side, M the midpoint.
+        std::optional<Peg> peg;
+        if (type == OrderType::Pegged)
+        {
+            std::string_view inst = msg.get(FixTag::ExecInst);
+            if (inst == "R")
+                peg = Peg{side == Side::Buy ? PegReference::BestBid : PegReference::BestAsk, 0.0};
+            else if (inst == "P")
+                peg = Peg{side == Side::Buy ? PegReference::BestAsk : PegReference::BestBid, 0.0};
+            else if (inst == "M")
+                peg = Peg{PegReference::Mid, 0.0};
+            else
+            {
+                send_reject(session, msg, FixTag::ExecInst, inst.empty() ? kRequiredTagMissing : kValueIncorrect);
+                return;
+            }
+            if (msg.has(FixTag::PegOffsetValue) && !fix_to_price(msg.get(FixTag::PegOffsetValue), peg->offset))
+            {
+                send_reject(session, msg, FixTag::PegOffsetValue, kIncorrectFormat);
+                return;
+            }
+        }
+
+        TimeInForce tif = TimeInForce::Day;
+        std::string_view tif_text = msg.get(FixTag::TimeInForce);
+        if (tif_text == "1")
+            tif = TimeInForce::GTC;
+        else if (tif_text == "3")
+            tif = TimeInForce::IOC;
+        else if (tif_text == "4")
+            tif = TimeInForce::FOK;
+        else if (!tif_text.empty() && tif_text != "0")
+        {
+            send_reject(session, msg, FixTag::TimeInForce, kValueIncorrect);
+            return;
+        }
+
+        // Which order types want which prices is checked by the engine.
+        std::optional<Price> price, stop_price;
+        for (int tag : {FixTag::Price, FixTag::StopPx})
+        {
+            if (!msg.has(tag))
+                continue;
+            double value = 0.0;
+            if (!fix_to_price(msg.get(tag), value))
+            {
+                send_reject(session, msg, tag, kIncorrectFormat);
+                return;
+            }
+            (tag == FixTag::Price ? price : stop_price) = value;
+        }
+
+        const FixSymbol *symbol = find_symbol(msg.get(FixTag::Symbol));
+        if (!symbol)
+        {
+            send_order_reject(session, msg, kUnknownSymbol, "Unknown symbol");
+            return;
+        }
+        if (session.orders.find(cl_ord_id))
+        {
+            send_order_reject(session, msg, kDuplicateOrder, "Duplicate ClOrdID");
+            return;
+        }
+        if (session.orders.full())
+        {
+            send_order_reject(session, msg, kOtherReason, "Too many open orders");
+            return;
+        }
+
+        SubmitResult result = engine_.submit_order(symbol->market_id, session.counterparty->client_id,
+                                                   static_cast<Quantity>(quantity), side, price, type, tif,
+                                                   stop_price, static_cast<Quantity>(display_qty), peg);
+        if (!result)
+        {
+            send_order_reject(session, msg, kUnknownSymbol, "Unknown symbol");
+            return;
+        }
+        OrderID id = result.order_id;
+        // The engine's reports for the order are read on this thread, after
+        // this returns: the entry is always there first.
+        auto &entry = session.orders.insert(id, cl_ord_id);
+        entry.order_qty = static_cast<Quantity>(quantity);
+        entry.symbol = static_cast<std::uint32_t>(symbol - config_.symbols.data());
+        entry.market_id = symbol->market_id;
+        entry.side = side;
+        entry.status = '0';
+    }
+
+    void FixGateway::handle_cancel(Session &session, const FixMessage &msg)
+    {
+        for (int tag : {FixTag::ClOrdID, FixTag::OrigClOrdID})
+        {
+            if (msg.get(tag).empty())
+            {
+                send_reject(session, msg, tag, kRequiredTagMissing);
+                return;
+            }
+        }
+        std::string_view cl_ord_id = msg.get(FixTag::ClOrdID);
+        std::string_view orig = msg.get(FixTag::OrigClOrdID);
+        if (cl_ord_id.size() > kMaxClOrdID)
+        {
+            send_reject(session, msg, FixTag::ClOrdID, kValueIncorrect);
+            return;
+        }
+
+        // OrderID when the client has one, OrigClOrdID otherwise.
+        OrderTable::Entry *entry = nullptr;
+        std::uint64_t order_id = 0;
+        if (fix_to_uint(msg.get(FixTag::OrderID), order_id))
+            entry = session.orders.find(order_id);
+        if (!entry)
+            entry = session.orders.find(orig);
+        if (!entry || entry->terminal)
+        {
+            send_cancel_reject(session, cl_ord_id, orig, 0, '8', kCancelUnknownOrder, "Unknown order");
+            return;
+        }
+        if (entry->cancel_pending())
+        {
+            send_cancel_reject(session, cl_ord_id, orig, entry->order_id, entry->status, kAlreadyPendingCancel,
+                               "Order already pending cancel");
+            return;
+        }
+        if (!engine_.cancel_order(entry->order_id, entry->market_id, session.counterparty->client_id))
+        {
+            send_cancel_reject(session, cl_ord_id, orig, entry->order_id, entry->status, kCancelUnknownOrder,
+                               "Unknown order");
+            return;
+        }
+        // The market answers with Canceled or CancelRejected.
+        entry->cancel_length = static_cast<std::uint8_t>(cl_ord_id.size());
+        std::memcpy(entry->cancel_cl_ord_id, cl_ord_id.data(), cl_ord_id.size());
+    }
+
+    void FixGateway::handle_replace(Session &session, const FixMessage &msg)
+    {
+        for (int tag : {FixTag::ClOrdID, FixTag::OrigClOrdID, FixTag::OrderQty})
+        {
+            if (msg.get(tag).empty())
+            {
+                send_reject(session, msg, tag, kRequiredTagMissing);
+                return;
+            }
+        }
+        std::string_view cl_ord_id = msg.get(FixTag::ClOrdID);
+        std::string_view orig = msg.get(FixTag::OrigClOrdID);
+        if (cl_ord_id.size() > kMaxClOrdID)
+        {
+            send_reject(session, msg, FixTag::ClOrdID, kValueIncorrect);
+            return;
+        }
+        std::int64_t quantity = 0;
+        if (!fix_to_int(msg.get(FixTag::OrderQty), quantity) || quantity > INT32_MAX || quantity < INT32_MIN)
+        {
+            send_reject(session, msg, FixTag::OrderQty, kIncorrectFormat);
+            return;
+        }
+        // Without a Price the limit stays as it is.
+        std::optional<Price> price;
+        if (msg.has(FixTag::Price))
+        {
+            double value = 0.0;
+            if (!fix_to_price(msg.get(FixTag::Price), value))
+            {
+                send_reject(session, msg, FixTag::Price, kIncorrectFormat);
+                return;
+            }
+            price = value;
+        }
+
+        OrderTable::Entry *entry = nullptr;
+        std::uint64_t order_id = 0;
+        if (fix_to_uint(msg.get(FixTag::OrderID), order_id))
+            entry = session.orders.find(order_id);
+        if (!entry)
+            entry = session.orders.find(orig);
+        if (!entry || entry->terminal)
+        {
+            send_cancel_reject(session, cl_ord_id, orig, 0, '8', kCancelUnknownOrder, "Unknown order", '2');
+            return;
+        }
+        if (entry->cancel_pending())
+        {
+            send_cancel_reject(session, cl_ord_id, orig, entry->order_id, entry->status, kAlreadyPendingCancel,
+                               entry->replacing ? "Order already pending replace" : "Order already pending cancel", '2');
+            return;
+        }
+        if (session.orders.find(cl_ord_id))
+        {
+            send_cancel_reject(session, cl_ord_id, orig, entry->order_id, entry->status, kDuplicateOrder,
+                               "Duplicate ClOrdID", '2');
+            return;
+        }
+        if (!engine_.modify_order(entry->order_id, entry->market_id, session.counterparty->client_id,
+                                  static_cast<Quantity>(quantity), price))
+        {
+            send_cancel_reject(session, cl_ord_id, orig, entry->order_id, entry->status, kCancelUnknownOrder,
+                               "Unknown order", '2');
+            return;
+        }
+        // The market answers with Replaced or ReplaceRejected.
+        entry->replacing = true;
+        entry->cancel_length = static_cast<std::uint8_t>(cl_ord_id.size());
+        std::memcpy(entry->cancel_cl_ord_id, cl_ord_id.data(), cl_ord_id.size());
+    }
+
+    bool FixGateway::drain_reports(Session &session)
+    {
+        ExecutionReport batch[kReportBatch];
+        bool drained = false;
+        for (;;)
+        {
+            // Compacts the send buffer first, so the division sees all its room.
+            if (!reserve(session, kMaxOutbound))
+                return drained;
+            std::size_t room = std::min((session.tx.size() - session.tx_end) / kMaxOutbound, kReportBatch);
+            std::size_t n = session.channel->poll(batch, room);
+            for (std::size_t i = 0; i < n; ++i)
+                send_report(session, batch[i]);
+            drained |= n > 0;
+            if (n < room)
+                return drained;
+        }
+    }
+
+    void FixGateway::send_report(Session &session, const ExecutionReport &r)
+    {
+        OrderTable::Entry *entry = session.orders.find(r.order_id);
+        if (!entry)
+            return; // not entered by this session
+
+        if (r.type == ExecType::CancelRejected || r.type == ExecType::ReplaceRejected)
+        {
+            int reason = r.reason == RejectReason::TooLateToCancel ? kTooLateToCancel : kCancelUnknownOrder;
+            send_cancel_reject(session, entry->cancel(), entry->cl(), entry->order_id, entry->status, reason,
+                               reject_text(r.reason), r.type == ExecType::ReplaceRejected ? '2' : '1');
+            entry->cancel_length = 0;
+            entry->replacing = false;
+            if (entry->terminal)
+                session.orders.erase(*entry);
+            return;
+        }
+
+        if (r.type == ExecType::Replaced)
+        {
+            // The engine's order quantity is what has filled, all of which has
+            // been reported by now, plus the new leaves.
+            entry->order_qty = entry->cum_qty + r.leaves_qty;
+
+            start_message(session, "8");
+            writer_.field(FixTag::OrderID, entry->order_id);
+            writer_.field(FixTag::ClOrdID, entry->cancel());
+            writer_.field(FixTag::OrigClOrdID, entry->cl());
+            writer_.field(FixTag::ExecID, next_exec_id_++);
+            writer_.field(FixTag::ExecType, '5');
+            writer_.field(FixTag::OrdStatus, entry->status);
+            writer_.raw(symbol_fields_[entry->symbol]);
+            writer_.field(FixTag::Side, entry->side == Side::Buy ? '1' : '2');
+            writer_.field(FixTag::OrderQty, static_cast<std::int64_t>(entry->order_qty));
+            writer_.field(FixTag::LeavesQty, static_cast<std::int64_t>(r.leaves_qty));
+            writer_.field(FixTag::CumQty, static_cast<std::int64_t>(entry->cum_qty));
+            writer_.price(FixTag::AvgPx, entry->cum_qty > 0 ? entry->notional / entry->cum_qty : 0.0);
+            writer_.field(FixTag::TransactTime, now_text_.view());
+            send(session);
+
+            // From here on the order goes by the replace's ClOrdID.
+            session.orders.rekey(*entry, entry->cancel());
+            entry->cancel_length = 0;
+            entry->replacing = false;
+            return;
+        }
+
+        std::string_view status;
+        bool fill = false;
+        switch (r.type)
+        {
+        case ExecType::New:
+            status = kStatusNew;
+            break;
+        case ExecType::PartialFill:
+            status = kStatusPartial;
+            fill = true;
+            break;
+        case ExecType::Fill:
+            status = kStatusFilled;
+            fill = true;
+            break;
+        case ExecType::Canceled:
+            status = kStatusCanceled;
+            break;
+        case ExecType::Rejected:
+            status = kStatusRejected;
+            break;
+        default:
+            return;
+        }
+        if (fill)
+        {
+            entry->cum_qty += r.last_qty;
+            entry->notional += static_cast<double>(r.last_qty) * r.last_price;
+        }
+        bool terminal = r.type == ExecType::Fill || r.type == ExecType::Canceled || r.type == ExecType::Rejected;
+        entry->status = status[status.size() - 2];
+
+        start_message(session, "8");
+        writer_.field(FixTag::OrderID, entry->order_id);
+        if (r.type == ExecType::Canceled && entry->cancel_pending() && !entry->replacing)
+        {
+            writer_.field(FixTag::ClOrdID, entry->cancel());
+            writer_.field(FixTag::OrigClOrdID, entry->cl());
+        }
+        else
+        {
+            writer_.field(FixTag::ClOrdID, entry->cl());
+        }
+        writer_.field(FixTag::ExecID, next_exec_id_++);
+        writer_.raw(status);
+        writer_.raw(symbol_fields_[entry->symbol]);
+        writer_.field(FixTag::Side, entry->side == Side::Buy ? '1' : '2');
+        writer_.field(FixTag::OrderQty, static_cast<std::int64_t>(entry->order_qty));
+        if (fill)
+        {
+            writer_.field(FixTag::LastQty, static_cast<std::int64_t>(r.last_qty));
+            writer_.price(FixTag::LastPx, r.last_price);
+        }
+        writer_.field(FixTag::LeavesQty, static_cast<std::int64_t>(terminal ? 0 : r.leaves_qty));
+        writer_.field(FixTag::CumQty, static_cast<std::int64_t>(entry->cum_qty));
+        writer_.price(FixTag::AvgPx, entry->cum_qty > 0 ? entry->notional / entry->cum_qty : 0.0);
+        if (r.type == ExecType::Rejected)
+        {
+            writer_.field(FixTag::OrdRejReason, ord_rej_reason(r.reason));
+            writer_.field(FixTag::Text, reject_text(r.reason));
+        }
+        writer_.field(FixTag::TransactTime, now_text_.view());
+        send(session);
+
+        if (terminal)
+        {
+            // Held until a pending cancel gets its answer, which needs the
+            // cancel's ClOrdID.
+            entry->terminal = true;
+            if (!entry->cancel_pending() || r.type == ExecType::Canceled)
+                session.orders.erase(*entry);
+        }
+    }
+
+    void FixGateway::check_timers(Session &session)
+    {
+        if (!session.counterparty)
+        {
+            if (now_ - session.connected >= config_.logon_timeout)
+                session.closing = true;
+            return;
+        }
+        // A resend under way holds the timers too: nothing newer may go out
+        // before it ends.
+        if (session.heartbeat.count() == 0 || session.logging_out || session.resend_next != 0 ||
+            !reserve(session, kReplyRoom))
+            return;
+
+        if (now_ - session.last_tx >= session.heartbeat)
+        {
+            start_message(session, "0");
+            send(session);
+        }
+        // Silence for a heartbeat and a fifth gets a TestRequest; another
+        // heartbeat without an answer ends the session.
+        if (!session.test_pending && now_ - session.last_rx >= session.heartbeat + session.heartbeat / 5)
+        {
+            start_message(session, "1");
+            writer_.field(FixTag::TestReqID, now_text_.view());
+            send(session);
+            session.test_pending = true;
+            session.test_sent = now_;
+        }
+        else if (session.test_pending && now_ - session.test_sent >= session.heartbeat)
+        {
+            send_logout(session, "Heartbeat timeout");
+            session.closing = true;
+        }
+    }
+
+    bool FixGateway::reserve(Session &session, std::size_t bytes)
+    {
+        if (session.tx.size() - session.tx_end >= bytes)
+            return true;
+        if (session.tx_begin > 0)
+        {
+            std::memmove(session.tx.data(), session.tx.data() + session.tx_begin, session.tx_pending());
+            session.tx_end -= session.tx_begin;
+            session.tx_begin = 0;
+        }
+        return session.tx.size() - session.tx_end >= bytes;
+    }
+
+    void FixGateway::start_message(Session &session, std::string_view msg_type)
+    {
+        start_message(session, msg_type, session.next_out++);
+    }
+
+    void FixGateway::start_message(Session &session, std::string_view msg_type, std::uint64_t seq_num)
+    {
+        writer_.begin(msg_type);
+        writer_.raw(session.header);
+        writer_.field(FixTag::MsgSeqNum, seq_num);
+        writer_.field(FixTag::SendingTime, now_text_.view());
+        sending_seq_ = seq_num;
+        sending_kept_ = is_replayed(msg_type);
+    }
+
+    void FixGateway::send(Session &session)
+    {
+        std::string_view bytes = writer_.finish();
+        // Callers reserve room before producing a message.
+        if (bytes.empty() || !reserve(session, bytes.size()))
+        {
+            std::cerr << "[FixGateway] message does not fit; closing the session" << std::endl;
+            session.closing = true;
+            return;
+        }
+        std::memcpy(session.tx.data() + session.tx_end, bytes.data(), bytes.size());
+        session.tx_end += bytes.size();
+        session.last_tx = now_;
+        messages_out_.add();
+        if (sending_kept_ && session.state)
+            session.state->sent.add(sending_seq_, bytes);
+    }
+
+    void FixGateway::send_logout(Session &session, std::string_view text)
+    {
+        start_message(session, "5");
+        if (!text.empty())
+            writer_.field(FixTag::Text, text);
+        send(session);
+        // Nothing is read after a Logout; the socket closes once it is flushed.
+        session.logging_out = true;
+        session.closing = true;
+    }
+
+    void FixGateway::send_reject(Session &session, const FixMessage &msg, int ref_tag, int reason)
+    {
+        start_message(session, "3");
+        writer_.field(FixTag::RefSeqNum, msg.seq_num());
+        if (ref_tag != 0)
+            writer_.field(FixTag::RefTagID, ref_tag);
+        writer_.field(FixTag::RefMsgType, msg.msg_type());
+        writer_.field(FixTag::SessionRejectReason, reason);
+        send(session);
+    }
+
+    void FixGateway::send_order_reject(Session &session, const FixMessage &msg, int reason, std::string_view text)
+    {
+        // Rejected before reaching the engine: there is no OrderID.
+        start_message(session, "8");
+        writer_.field(FixTag::OrderID, std::string_view("NONE"));
+        writer_.field(FixTag::ClOrdID, msg.get(FixTag::ClOrdID));
+        writer_.field(FixTag::ExecID, next_exec_id_++);
+        writer_.raw(kStatusRejected);
+        writer_.field(FixTag::Symbol, msg.get(FixTag::Symbol));
+        writer_.field(FixTag::Side, msg.get(FixTag::Side));
+        writer_.field(FixTag::OrderQty, msg.get(FixTag::OrderQty));
+        writer_.field(FixTag::LeavesQty, 0);
+        writer_.field(FixTag::CumQty, 0);
+        writer_.field(FixTag::AvgPx, 0);
+        writer_.field(FixTag::OrdRejReason, reason);
+        writer_.field(FixTag::Text, text);
+        writer_.field(FixTag::TransactTime, now_text_.view());
+        send(session);
+    }
+
+    void FixGateway::send_cancel_reject(Session &session, std::string_view cl_ord_id, std::string_view orig_cl_ord_id,
+                                        OrderID order_id, char status, int reason, std::string_view text,
+                                        char response_to)
+    {
+        start_message(session, "9");
+        if (order_id)
+            writer_.field(FixTag::OrderID, order_id);
+        else
+            writer_.field(FixTag::OrderID, std::string_view("NONE"));
+        writer_.field(FixTag::ClOrdID, cl_ord_id);
+        writer_.field(FixTag::OrigClOrdID, orig_cl_ord_id);
+        writer_.field(FixTag::OrdStatus, status);
+        writer_.field(FixTag::CxlRejResponseTo, response_to);
+        writer_.field(FixTag::CxlRejReason, reason);
+        writer_.field(FixTag::Text, text);
+        send(session);
+    }
+
+}
@@ -0,0 +1,368 @@
+#include "FixProtocol.hpp"
+#include "TextKernels.hpp"
+#include <cmath>
+#include <cstring>
+#include <ctime>
+
+namespace MercEx
+{
+
+    namespace
+    {
+        // "8=FIX.4.4<SOH>9=": every message starts with these bytes.
+        constexpr char kPrefix[] = "8=FIX.4.4\x01"
+                                   "9=";
+        constexpr std::size_t kPrefixSize = sizeof(kPrefix) - 1;
+        // "10=NNN<SOH>"
+        constexpr std::size_t kTrailerSize = 7;
+        // BodyLength digits accepted; far beyond any message a session reads.
+        constexpr std::size_t kMaxLengthDigits = 6;
+
+        constexpr char kDigitPairs[] = "00010203040506070809"
+                                       "10111213141516171819"
+                                       "20212223242526272829"
+                                       "30313233343536373839"
+                                       "40414243444546474849"
+                                       "50515253545556575859"
+                                       "60616263646566676869"
+                                       "70717273747576777879"
+                                       "80818283848586878889"
+                                       "90919293949596979899";
+
+        bool is_digit(char c)
+        {
+            return static_cast<unsigned char>(c - '0') < 10;
+        }
+
+        // Writes value right-aligned ending at end; returns where it starts.
+        char *format_uint(std::uint64_t value, char *end)
+        {
+            while (value >= 100)
+            {
+                std::size_t pair = static_cast<std::size_t>(value % 100) * 2;
+                value /= 100;
+                *--end = kDigitPairs[pair + 1];
+                *--end = kDigitPairs[pair];
+            }
+            if (value >= 10)
+            {
+                std::size_t pair = static_cast<std::size_t>(value) * 2;
+                *--end = kDigitPairs[pair + 1];
+                *--end = kDigitPairs[pair];
+            }
+            else
+            {
+                *--end = static_cast<char>('0' + value);
+            }
+            return end;
+        }
+
+        void format_two(char *out, int value)
+        {
+            out[0] = kDigitPairs[value * 2];
+            out[1] = kDigitPairs[value * 2 + 1];
+        }
+    }
+
+    std::string_view FixMessage::get(int tag) const
+    {
+        for (std::size_t i = 0; i < count_; ++i)
+        {
+            if (fields_[i].tag == tag)
+                return {data_ + fields_[i].offset, fields_[i].length};
+        }
+        return {};
+    }
+
+    bool FixMessage::has(int tag) const
+    {
+        for (std::size_t i = 0; i < count_; ++i)
+        {
+            if (fields_[i].tag == tag)
+                return true;
+        }
+        return false;
+    }
+
+    FixParseResult fix_parse(const char *data, std::size_t size, FixMessage &out)
+    {
+        // A prefix that cannot become a message fails as early as possible,
+        // so a peer speaking something else is dropped on its first bytes.
+        if (std::memcmp(data, kPrefix, size < kPrefixSize ? size : kPrefixSize) != 0)
+            return {FixParseStatus::Invalid, 0};
+        if (size < kPrefixSize)
+            return {FixParseStatus::Incomplete, 0};
+
+        std::size_t pos = kPrefixSize;
+        std::size_t body_length = 0;
+        for (;; ++pos)
+        {
+            if (pos == size)
+                return {FixParseStatus::Incomplete, 0};
+            if (data[pos] == kSoh)
+                break;
+            if (!is_digit(data[pos]) || pos - kPrefixSize == kMaxLengthDigits)
+                return {FixParseStatus::Invalid, 0};
+            body_length = body_length * 10 + static_cast<std::size_t>(data[pos] - '0');
+        }
+        if (pos == kPrefixSize)
+            return {FixParseStatus::Invalid, 0};
+
+        const std::size_t body = pos + 1;
+        const std::size_t trailer = body + body_length;
+        const std::size_t total = trailer + kTrailerSize;
+        if (size < total)
+            return {FixParseStatus::Incomplete, 0};
+
+        const char *t = data + trailer;
+        if (t[0] != '1' || t[1] != '0' || t[2] != '=' || !is_digit(t[3]) || !is_digit(t[4]) || !is_digit(t[5]) ||
+            t[6] != kSoh)
+            return {FixParseStatus::Invalid, 0};
+        // From here on the framing holds: whatever is wrong with the message,
+        // the next one starts at total.
+        unsigned expected = static_cast<unsigned>((t[3] - '0') * 100 + (t[4] - '0') * 10 + (t[5] - '0'));
+        if (fix_checksum(data, trailer) != expected)
+            return {FixParseStatus::Garbled, total};
+        if (body_length == 0 || data[trailer - 1] != kSoh)
+            return {FixParseStatus::Garbled, total};
+
+        // Every delimiter of the body in one pass; one more than fit is
+        // enough to know there are too many fields.
+        std::uint32_t soh[FixMessage::kMaxFields + 1];
+        std::size_t fields = index_byte(data + body, body_length, kSoh, soh, FixMessage::kMaxFields + 1);
+        if (fields > FixMessage::kMaxFields)
+            return {FixParseStatus::Garbled, total};
+
+        out.data_ = data;
+        out.count_ = 0;
+        bool ok = true;
+        std::size_t start = body;
+        for (std::size_t n = 0; n < fields && ok; ++n)
+        {
+            std::size_t end = body + soh[n];
+            int tag = 0;
+            std::size_t i = start;
+            for (; i < end && is_digit(data[i]) && i - start < 9; ++i)
+                tag = tag * 10 + (data[i] - '0');
+            ok = i != start && i != end && data[i] == '=' && tag != 0;
+            FixField &f = out.fields_[out.count_++];
+            f.tag = tag;
+            f.offset = static_cast<std::uint32_t>(i + 1);
+            f.length = static_cast<std::uint32_t>(end - i - 1);
+            start = end + 1;
+        }
+        if (!ok || out.count_ == 0 || out.fields_[0].tag != FixTag::MsgType || out.fields_[0].length == 0)
+            return {FixParseStatus::Garbled, total};
+
+        out.msg_type_ = {data + out.fields_[0].offset, out.fields_[0].length};
+        std::uint64_t seq = 0;
+        out.seq_num_ = fix_to_uint(out.get(FixTag::MsgSeqNum), seq) ? seq : 0;
+        return {FixParseStatus::Complete, total};
+    }
+
+    const char *fix_find_soh(const char *p, const char *end)
+    {
+        return scan_byte(p, end, kSoh);
+    }
+
+    std::uint8_t fix_checksum(const char *p, std::size_t size)
+    {
+        return text_checksum(p, size);
+    }
+
+    bool fix_to_uint(std::string_view s, std::uint64_t &out)
+    {
+        return parse_digits(s.data(), s.size(), out);
+    }
+
+    bool fix_to_int(std::string_view s, std::int64_t &out)
+    {
+        bool negative = !s.empty() && s[0] == '-';
+        std::uint64_t value = 0;
+        if (!parse_digits(s.data() + negative, s.size() - negative, value) ||
+            value > static_cast<std::uint64_t>(INT64_MAX))
+            return false;
+        out = negative ? -static_cast<std::int64_t>(value) : static_cast<std::int64_t>(value);
+        return true;
+    }
+
+    bool fix_to_price(std::string_view s, double &out)
+    {
+        // Mantissa and decimal places as integers, then one division: no
+        // locale or strtod involved.
+        Decimal d;
+        if (!parse_decimal(s.data(), s.size(), d))
+            return false;
+        out = to_double(d);
+        return true;
+    }
+
+    void FixWriter::begin(std::string_view msg_type)
+    {
+        pos_ = kHeadroom;
+        overflow_ = false;
+        field(FixTag::MsgType, msg_type);
+    }
+
+    void FixWriter::raw(std::string_view bytes)
+    {
+        if (!room(bytes.size()))
+        {
+            overflow_ = true;
+            return;
+        }
+        std::memcpy(buf_ + pos_, bytes.data(), bytes.size());
+        pos_ += bytes.size();
+    }
+
+    void FixWriter::put_tag(int tag)
+    {
+        char digits[12];
+        char *end = digits + sizeof(digits);
+        *--end = '=';
+        char *begin = format_uint(static_cast<std::uint64_t>(tag), end);
+        raw({begin, static_cast<std::size_t>(digits + sizeof(digits) - begin)});
+    }
+
+    void FixWriter::put_uint(std::uint64_t value)
+    {
+        char digits[20];
+        char *begin = format_uint(value, digits + sizeof(digits));
+        raw({begin, static_cast<std::size_t>(digits + sizeof(digits) - begin)});
+    }
+
+    void FixWriter::field(int tag, std::string_view value)
+    {
+        put_tag(tag);
+        raw(value);
+        raw({&kSoh, 1});
+    }
+
+    void FixWriter::field(int tag, char value)
+    {
+        put_tag(tag);
+        raw({&value, 1});
+        raw({&kSoh, 1});
+    }
+
+    void FixWriter::field(int tag, std::int64_t value)
+    {
+        put_tag(tag);
+        if (value < 0)
+        {
+            raw("-");
+            put_uint(0 - static_cast<std::uint64_t>(value));
+        }
+        else
+        {
+            put_uint(static_cast<std::uint64_t>(value));
+        }
+        raw({&kSoh, 1});
+    }
+
+    void FixWriter::field(int tag, std::uint64_t value)
+    {
+        put_tag(tag);
+        put_uint(value);
+        raw({&kSoh, 1});
+    }
+
+    void FixWriter::price(int tag, double value)
+    {
+        constexpr double kScale = 1e8;
+        put_tag(tag);
+        if (!std::isfinite(value))
+            value = 0.0;
+        if (value < 0)
+        {
+            raw("-");
+            value = -value;
+        }
+        // Prices the engine holds fit eight decimals with room to spare;
+        // anything too large to scale is written as a whole number.
+        if (value >= 9e10)
+        {
+            put_uint(static_cast<std::uint64_t>(std::llround(value)));
+        }
+        else
+        {
+            std::uint64_t scaled = static_cast<std::uint64_t>(std::llround(value * kScale));
+            std::uint64_t whole = scaled / static_cast<std::uint64_t>(kScale);
+            std::uint64_t frac = scaled % static_cast<std::uint64_t>(kScale);
+            put_uint(whole);
+            if (frac)
+            {
+                char digits[9];
+                digits[0] = '.';
+                for (int i = 8; i >= 1; --i, frac /= 10)
+                    digits[i] = static_cast<char>('0' + frac % 10);
+                std::size_t n = 9;
+                while (digits[n - 1] == '0')
+                    --n;
+                raw({digits, n});
+            }
+        }
+        raw({&kSoh, 1});
+    }
+
+    std::string_view FixWriter::finish()
+    {
+        if (overflow_)
+            return {};
+        std::size_t body_length = pos_ - kHeadroom;
+
+        char length[12];
+        char *end = length + sizeof(length);
+        *--end = kSoh;
+        char *digits = format_uint(body_length, end);
+        std::size_t length_size = static_cast<std::size_t>(length + sizeof(length) - digits);
+        std::size_t start = kHeadroom - length_size - kPrefixSize;
+        std::memcpy(buf_ + start, kPrefix, kPrefixSize);
+        std::memcpy(buf_ + start + kPrefixSize, digits, length_size);
+
+        // The trailer has its own room past kCapacity.
+        unsigned sum = fix_checksum(buf_ + start, pos_ - start);
+        char *t = buf_ + pos_;
+        t[0] = '1';
+        t[1] = '0';
+        t[2] = '=';
+        t[3] = static_cast<char>('0' + sum / 100);
+        t[4] = static_cast<char>('0' + sum / 10 % 10);
+        t[5] = static_cast<char>('0' + sum % 10);
+        t[6] = kSoh;
+        return {buf_ + start, pos_ + kTrailerSize - start};
+    }
+
+    void FixTimestamp::refresh(std::chrono::system_clock::time_point now)
+    {
+        std::int64_t millis =
+            std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+        if (millis == millis_)
+            return;
+        millis_ = millis;
+        std::int64_t second = millis / 1000;
+        if (second != second_)
+        {
+            second_ = second;
+            std::time_t t = static_cast<std::time_t>(second);
+            std::tm tm{};
+            ::gmtime_r(&t, &tm);
+            int year = tm.tm_year + 1900;
+            format_two(text_, year / 100);
+            format_two(text_ + 2, year % 100);
+            format_two(text_ + 4, tm.tm_mon + 1);
+            format_two(text_ + 6, tm.tm_mday);
+            text_[8] = '-';
+            format_two(text_ + 9, tm.tm_hour);
+            text_[11] = ':';
+            format_two(text_ + 12, tm.tm_min);
+            text_[14] = ':';
+            format_two(text_ + 15, tm.tm_sec);
+            text_[17] = '.';
+        }
+        int ms = static_cast<int>(millis % 1000);
+        text_[18] = static_cast<char>('0' + ms / 100);
+        format_two(text_ + 19, ms % 100);
+    }
+
+}
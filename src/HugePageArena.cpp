@@ -0,0 +1,168 @@
+#include "HugePageArena.hpp"
+#include "AllocationGuard.hpp"
+#include <cstdint>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace MercEx
+{
+
+    const char *to_string(PageBacking backing)
+    {
+        switch (backing)
+        {
+        case PageBacking::Huge1GB:
+            return "1GB";
+        case PageBacking::Huge2MB:
+            return "2MB";
+        case PageBacking::Transparent:
+            return "THP";
+        case PageBacking::Normal:
+            return "4KB";
+        }
+        return "unknown";
+    }
+
+    namespace
+    {
+        constexpr std::size_t k2MB = std::size_t(2) << 20;
+        constexpr std::size_t k1GB = std::size_t(1) << 30;
+
+        std::size_t round_up(std::size_t n, std::size_t to) { return (n + to - 1) / to * to; }
+    }
+
+    HugePageArena::HugePageArena(const ArenaConfig &config, std::pmr::memory_resource *upstream)
+        : upstream_(upstream)
+    {
+        if (config.bytes == 0)
+            throw std::invalid_argument("HugePageArena size must be positive");
+        map_region(config);
+        next_ = base_;
+    }
+
+    void HugePageArena::map_region(const ArenaConfig &config)
+    {
+#ifdef _WIN32
+        size_ = config.bytes;
+        base_ = static_cast<char *>(upstream_->allocate(size_, alignof(std::max_align_t)));
+        backing_ = PageBacking::Normal;
+#else
+        void *p = MAP_FAILED;
+
+        std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+        // Explicit huge pages come from the hugetlbfs pool and are reserved
+        // at mmap time, so success here means the pages exist.
+        auto try_huge = [&](PageBacking backing, std::size_t huge_page, int log2)
+        {
+            std::size_t size = round_up(config.bytes, huge_page);
+            p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (log2 << MAP_HUGE_SHIFT), -1, 0);
+            if (p != MAP_FAILED)
+            {
+                size_ = size;
+                page = huge_page;
+                backing_ = backing;
+            }
+        };
+        if (config.pages == PageBacking::Huge1GB)
+            try_huge(PageBacking::Huge1GB, k1GB, 30);
+        if (p == MAP_FAILED && (config.pages == PageBacking::Huge1GB || config.pages == PageBacking::Huge2MB))
+            try_huge(PageBacking::Huge2MB, k2MB, 21);
+#endif
+
+        if (p == MAP_FAILED)
+        {
+            size_ = round_up(config.bytes, k2MB);
+            p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED)
+                throw std::bad_alloc();
+            backing_ = PageBacking::Normal;
+#ifdef MADV_HUGEPAGE
+            if (config.pages != PageBacking::Normal && ::madvise(p, size_, MADV_HUGEPAGE) == 0)
+                backing_ = PageBacking::Transparent;
+#endif
+        }
+        base_ = static_cast<char *>(p);
+
+#ifdef __linux__
+        // Bind before the first touch so the pages are placed on the node.
+        if (config.numa_node >= 0 && config.numa_node < 64)
+        {
+            unsigned long mask = 1UL << config.numa_node;
+            if (::syscall(SYS_mbind, base_, size_, MPOL_PREFERRED, &mask, 65, 0) != 0)
+                std::cerr << "[Arena] mbind to node " << config.numa_node << " failed: " << std::strerror(errno) << std::endl;
+        }
+#endif
+
+        if (config.prefault)
+        {
+            for (std::size_t off = 0; off < size_; off += page)
+                base_[off] = 0;
+        }
+
+        if (config.lock)
+        {
+            locked_ = ::mlock(base_, size_) == 0;
+            if (!locked_)
+                std::cerr << "[Arena] mlock of " << size_ << " bytes failed: " << std::strerror(errno)
+                          << " (check RLIMIT_MEMLOCK)" << std::endl;
+        }
+#endif
+    }
+
+    HugePageArena::~HugePageArena()
+    {
+#ifdef _WIN32
+        upstream_->deallocate(base_, size_, alignof(std::max_align_t));
+#else
+        if (locked_)
+            ::munlock(base_, size_);
+        ::munmap(base_, size_);
+#endif
+    }
+
+    void *HugePageArena::do_allocate(std::size_t bytes, std::size_t alignment)
+    {
+        // The pool above only comes here once its free blocks are used up, so
+        // on an armed worker this means the capacity hints were exceeded.
+        AllocationGuard::check(bytes);
+        auto current = reinterpret_cast<std::uintptr_t>(next_);
+        auto aligned = (current + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+        if (aligned + bytes <= reinterpret_cast<std::uintptr_t>(base_ + size_))
+        {
+            next_ = reinterpret_cast<char *>(aligned + bytes);
+            return reinterpret_cast<void *>(aligned);
+        }
+        overflow_bytes_ += bytes;
+        return upstream_->allocate(bytes, alignment);
+    }
+
+    void HugePageArena::do_deallocate(void *p, std::size_t bytes, std::size_t alignment)
+    {
+        char *c = static_cast<char *>(p);
+        if (c >= base_ && c < base_ + size_)
+            return;
+        overflow_bytes_ -= bytes;
+        upstream_->deallocate(p, bytes, alignment);
+    }
+
+    bool HugePageArena::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+    {
+        return this == &other;
+    }
+
+}
@@ -0,0 +1,215 @@
+#include "IoUring.hpp"
+
+#ifdef __linux__
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace MercEx
+{
+
+    namespace
+    {
+        int sys_setup(unsigned entries, io_uring_params *params)
+        {
+            return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+        }
+
+        int sys_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, const void *arg, std::size_t argsz)
+        {
+            return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz));
+        }
+
+        int sys_register(int fd, unsigned opcode, const void *arg, unsigned nr_args)
+        {
+            return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+        }
+
+        void *map_ring(int fd, std::size_t size, off_t offset)
+        {
+            void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+            return p == MAP_FAILED ? nullptr : p;
+        }
+
+        template <typename T>
+        T *at(void *base, std::uint32_t offset)
+        {
+            return reinterpret_cast<T *>(static_cast<char *>(base) + offset);
+        }
+    }
+
+    IoUring::IoUring(unsigned entries, unsigned flags)
+    {
+        io_uring_params params{};
+        params.flags = flags | IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 4; // multishot requests complete many times per entry
+        fd_ = sys_setup(entries, &params);
+        if (fd_ < 0)
+            throw std::runtime_error(std::string("io_uring_setup: ") + std::strerror(errno));
+        features_ = params.features;
+
+        sq_map_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_map_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (features_ & IORING_FEAT_SINGLE_MMAP)
+            sq_map_size_ = cq_map_size_ = std::max(sq_map_size_, cq_map_size_);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+
+        sq_map_ = map_ring(fd_, sq_map_size_, IORING_OFF_SQ_RING);
+        cq_map_ = (features_ & IORING_FEAT_SINGLE_MMAP) ? sq_map_ : map_ring(fd_, cq_map_size_, IORING_OFF_CQ_RING);
+        sqes_ = static_cast<io_uring_sqe *>(map_ring(fd_, sqes_size_, IORING_OFF_SQES));
+        if (!sq_map_ || !cq_map_ || !sqes_)
+        {
+            int err = errno;
+            release();
+            throw std::runtime_error(std::string("io_uring mmap: ") + std::strerror(err));
+        }
+
+        sq_head_ = at<unsigned>(sq_map_, params.sq_off.head);
+        sq_tail_ = at<unsigned>(sq_map_, params.sq_off.tail);
+        sq_mask_ = *at<unsigned>(sq_map_, params.sq_off.ring_mask);
+        sq_entries_ = *at<unsigned>(sq_map_, params.sq_off.ring_entries);
+        sqe_tail_ = *sq_tail_;
+        // Submission slots map one to one onto entries, so the indirection
+        // array is filled once.
+        unsigned *array = at<unsigned>(sq_map_, params.sq_off.array);
+        for (unsigned i = 0; i < sq_entries_; ++i)
+            array[i] = i;
+
+        cq_head_ = at<unsigned>(cq_map_, params.cq_off.head);
+        cq_tail_ = at<unsigned>(cq_map_, params.cq_off.tail);
+        cq_mask_ = *at<unsigned>(cq_map_, params.cq_off.ring_mask);
+        cqes_ = at<io_uring_cqe>(cq_map_, params.cq_off.cqes);
+    }
+
+    IoUring::~IoUring()
+    {
+        release();
+    }
+
+    void IoUring::release()
+    {
+        if (sqes_)
+            ::munmap(sqes_, sqes_size_);
+        if (cq_map_ && cq_map_ != sq_map_)
+            ::munmap(cq_map_, cq_map_size_);
+        if (sq_map_)
+            ::munmap(sq_map_, sq_map_size_);
+        if (fd_ >= 0)
+            ::close(fd_);
+        sqes_ = nullptr;
+        sq_map_ = cq_map_ = nullptr;
+        fd_ = -1;
+    }
+
+    io_uring_sqe &IoUring::next_sqe()
+    {
+        while (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_)
+            submit();
+        io_uring_sqe &sqe = sqes_[sqe_tail_ & sq_mask_];
+        std::memset(&sqe, 0, sizeof(sqe));
+        ++sqe_tail_;
+        return sqe;
+    }
+
+    int IoUring::submit(unsigned wait_nr, std::chrono::nanoseconds timeout)
+    {
+        __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+        unsigned to_submit = sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (to_submit == 0 && wait_nr == 0)
+            return 0;
+
+        unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+        __kernel_timespec ts{};
+        io_uring_getevents_arg arg{};
+        const void *argp = nullptr;
+        std::size_t argsz = 0;
+        if (wait_nr && timeout > std::chrono::nanoseconds::zero())
+        {
+            ts.tv_sec = timeout.count() / 1'000'000'000;
+            ts.tv_nsec = timeout.count() % 1'000'000'000;
+            arg.sigmask_sz = _NSIG / 8;
+            arg.ts = reinterpret_cast<std::uint64_t>(&ts);
+            argp = &arg;
+            argsz = sizeof(arg);
+            flags |= IORING_ENTER_EXT_ARG;
+        }
+
+        int ret = sys_enter(fd_, to_submit, wait_nr, flags, argp, argsz);
+        if (ret < 0)
+            return errno == ETIME || errno == EINTR ? 0 : -errno;
+        return ret;
+    }
+
+    int IoUring::register_raw(unsigned opcode, const void *arg, unsigned nr_args)
+    {
+        int ret = sys_register(fd_, opcode, arg, nr_args);
+        return ret < 0 ? -errno : ret;
+    }
+
+    void IoUring::register_sparse_buffers(unsigned count)
+    {
+        io_uring_rsrc_register reg{};
+        reg.nr = count;
+        reg.flags = IORING_RSRC_REGISTER_SPARSE;
+        if (int ret = register_raw(IORING_REGISTER_BUFFERS2, &reg, sizeof(reg)); ret < 0)
+            throw std::runtime_error(std::string("io_uring buffer table: ") + std::strerror(-ret));
+    }
+
+    void IoUring::update_buffer(unsigned index, void *base, std::size_t size)
+    {
+        iovec iov{base, size};
+        io_uring_rsrc_update2 update{};
+        update.offset = index;
+        update.data = reinterpret_cast<std::uint64_t>(&iov);
+        update.nr = 1;
+        if (int ret = register_raw(IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update)); ret < 0)
+            throw std::runtime_error(std::string("io_uring buffer update: ") + std::strerror(-ret));
+    }
+
+    void IoUring::register_buffers(const iovec *buffers, unsigned count)
+    {
+        if (int ret = register_raw(IORING_REGISTER_BUFFERS, buffers, count); ret < 0)
+            throw std::runtime_error(std::string("io_uring buffers: ") + std::strerror(-ret));
+    }
+
+    ProvidedBuffers::ProvidedBuffers(IoUring &ring, std::uint16_t group, unsigned count, std::size_t buffer_size,
+                                     std::uint64_t user_data)
+        : ring_(ring), group_(group), count_(count), buffer_size_(buffer_size), user_data_(user_data)
+    {
+        if (count == 0 || count > 65536 || buffer_size == 0 || buffer_size > 0xffffffffu)
+            throw std::invalid_argument("ProvidedBuffers: bad count or buffer size");
+        void *buffers = ::mmap(nullptr, count * buffer_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buffers == MAP_FAILED)
+            throw std::runtime_error("ProvidedBuffers: out of memory");
+        buffers_ = static_cast<char *>(buffers);
+        provide(0, count);
+    }
+
+    ProvidedBuffers::~ProvidedBuffers()
+    {
+        // Whatever the group still holds dies with the ring; nothing can
+        // pick from it once the ring's owner stops submitting.
+        ::munmap(buffers_, count_ * buffer_size_);
+    }
+
+    void ProvidedBuffers::provide(unsigned first, unsigned count)
+    {
+        io_uring_sqe &sqe = ring_.next_sqe();
+        sqe.opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe.fd = static_cast<int>(count);
+        sqe.addr = reinterpret_cast<std::uint64_t>(buffer(first));
+        sqe.len = static_cast<std::uint32_t>(buffer_size_);
+        sqe.off = first;
+        sqe.buf_group = group_;
+        sqe.user_data = user_data_;
+    }
+
+}
+
+#endif
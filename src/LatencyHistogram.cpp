@@ -0,0 +1,112 @@
+#include "LatencyHistogram.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace MercEx
+{
+
+    std::size_t LatencyHistogram::index_of(std::uint64_t value)
+    {
+        if (value < kSubBuckets)
+            return static_cast<std::size_t>(value);
+
+        unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(value));
+        if (msb >= kMaxExponent)
+            return kBuckets - 1;
+
+        // Values with their top bit at msb are bucketed by their leading
+        // kSubBucketBits bits; shift is how many low bits that discards.
+        unsigned shift = msb - (kSubBucketBits - 1);
+        std::size_t group = shift;
+        std::size_t sub = static_cast<std::size_t>(value >> shift) - (kSubBuckets / 2);
+        return kSubBuckets + (group - 1) * (kSubBuckets / 2) + sub;
+    }
+
+    std::uint64_t LatencyHistogram::upper_bound_of(std::size_t index)
+    {
+        if (index < kSubBuckets)
+            return index;
+        std::size_t rel = index - kSubBuckets;
+        std::size_t group = rel / (kSubBuckets / 2) + 1;
+        std::size_t sub = rel % (kSubBuckets / 2) + (kSubBuckets / 2);
+        return ((static_cast<std::uint64_t>(sub) + 1) << group) - 1;
+    }
+
+    void LatencyHistogram::record(std::uint64_t value_ns)
+    {
+        ++counts_[index_of(value_ns)];
+        ++count_;
+        sum_ += value_ns;
+        min_ = std::min(min_, value_ns);
+        max_ = std::max(max_, value_ns);
+    }
+
+    void LatencyHistogram::merge(const LatencyHistogram &other)
+    {
+        for (std::size_t i = 0; i < kBuckets; ++i)
+            counts_[i] += other.counts_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void LatencyHistogram::reset()
+    {
+        *this = LatencyHistogram{};
+    }
+
+    std::uint64_t LatencyHistogram::percentile(double p) const
+    {
+        if (count_ == 0)
+            return 0;
+        auto target = static_cast<std::uint64_t>(std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * count_));
+        target = std::max<std::uint64_t>(target, 1);
+
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBuckets; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= target)
+                return std::min(upper_bound_of(i), max_);
+        }
+        return max_;
+    }
+
+    void LatencyHistogram::print_summary(std::ostream &os, const std::string &label) const
+    {
+        auto flags = os.flags();
+        auto precision = os.precision();
+        os << std::left << std::setw(20) << label << std::right
+           << " count=" << count_
+           << " min=" << min()
+           << " mean=" << std::fixed << std::setprecision(1) << mean()
+           << " p50=" << percentile(50)
+           << " p90=" << percentile(90)
+           << " p99=" << percentile(99)
+           << " p99.9=" << percentile(99.9)
+           << " p99.99=" << percentile(99.99)
+           << " max=" << max_ << " (ns)\n";
+        os.flags(flags);
+        os.precision(precision);
+    }
+
+    void LatencyHistogram::print_json(std::ostream &os) const
+    {
+        auto flags = os.flags();
+        auto precision = os.precision();
+        os << "{\"count\":" << count_
+           << ",\"min\":" << min()
+           << ",\"mean\":" << std::fixed << std::setprecision(1) << mean()
+           << ",\"p50\":" << percentile(50)
+           << ",\"p90\":" << percentile(90)
+           << ",\"p99\":" << percentile(99)
+           << ",\"p999\":" << percentile(99.9)
+           << ",\"p9999\":" << percentile(99.99)
+           << ",\"max\":" << max_ << "}";
+        os.flags(flags);
+        os.precision(precision);
+    }
+
+}
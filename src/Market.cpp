@@ -1,88 +1,95 @@
 #include "Market.hpp"
 #include "Trade.hpp"
 #include "MarketEvent.hpp"
+#include "OrderValidator.hpp"
 #include <cmath>
 #include <stdexcept>
 #include <iostream>
+#include <limits>
 
 namespace MercEx
 {
 
-    Market::Market(const std::string &symbol, double price_tick)
-        : symbol(symbol), price_tick(price_tick), is_active(true), buybook(), sellbook(), last_price(std::nullopt) {}
+    Market::Market(const std::string &symbol, double price_tick, MarketID market_id, std::pmr::memory_resource *resource)
+        : symbol(symbol), market_id(market_id), price_tick(price_tick), is_active(true), buybook(resource), sellbook(resource), last_price(std::nullopt),
+          pegs(resource), peg_count(0) {}
 
     bool Market::is_valid_price(double price) const
     {
-        return std::fmod(price * 100, price_tick * 100) == 0.0;
+        return is_on_tick(price, price_tick);
     }
 
     bool Market::validate_fulfillment(const Order &order, Side side)
     {
-        int total_matched_quantity = 0;
+        // Hidden quantity counts: an aggressor takes an iceberg's slices one
+        // after another until it is filled.
+        Quantity available = 0;
         if (side == Side::Buy)
         {
-            for (const auto &[price, orders] : sellbook.get_orders())
+            for (const auto &[price, level] : sellbook.get_orders())
             {
-                if (order.price < price)
+                if (order.price < price || available >= order.quantity)
                     break;
-
-                for (const auto &o : orders)
-                    total_matched_quantity += o->quantity;
+                available += level.total();
             }
         }
         else if (side == Side::Sell)
         {
-            for (const auto &[price, orders] : buybook.get_orders())
+            for (const auto &[price, level] : buybook.get_orders())
             {
-                if (order.price > price)
+                if (order.price > price || available >= order.quantity)
                     break;
-                for (const auto &o : orders)
-                    total_matched_quantity += o->quantity;
+                available += level.total();
             }
         }
-        return total_matched_quantity >= order.quantity;
+        return available >= order.quantity;
     }
 
     std::vector<MarketEvent> Market::process_order(Order &order)
+    {
+        std::vector<MarketEvent> events;
+        process_order(order, events);
+        return events;
+    }
+
+    void Market::process_order(Order &order, std::vector<MarketEvent> &events)
     {
         if (!is_active)
             throw std::runtime_error("Market is inactive");
 
-        if (order.type == OrderType::Limit)
+        if (order.type == OrderType::Limit || order.type == OrderType::Iceberg)
         {
-            if (!order.price.has_value() || !is_valid_price(order.price.value()))
-            {
-                std::cout << "Invalid price for limit order: " << (order.price.has_value() ? std::to_string(order.price.value()) : "N/A") << std::endl;
-                throw std::invalid_argument("Invalid price for limit order");
-            }
             if (order.side == Side::Buy)
-                return process_limit_buy_order(order);
+                process_limit_buy_order(order, events);
             else if (order.side == Side::Sell)
-                return process_limit_sell_order(order);
+                process_limit_sell_order(order, events);
             else
                 throw std::invalid_argument("Invalid order side");
         }
         else if (order.type == OrderType::Market)
         {
             if (order.side == Side::Buy)
-                return process_market_buy_order(order);
+                process_market_buy_order(order, events);
             else if (order.side == Side::Sell)
-                return process_market_sell_order(order);
+                process_market_sell_order(order, events);
             else
                 throw std::invalid_argument("Invalid order side");
         }
+        else if (order.type == OrderType::Pegged)
+        {
+            process_pegged_order(order);
+        }
         else
         {
             throw std::invalid_argument("Unsupported order type");
         }
+        reprice_pegs();
     }
 
-    std::vector<MarketEvent> Market::process_limit_buy_order(Order &order)
+    void Market::process_limit_buy_order(Order &order, std::vector<MarketEvent> &events)
     {
         if (order.tif == TimeInForce::FOK && !validate_fulfillment(order, Side::Buy))
-            return {};
-
-        std::vector<MarketEvent> events;
+            return;
 
         for (auto price_it = sellbook.get_orders().begin(); price_it != sellbook.get_orders().end();)
         {
@@ -90,38 +97,9 @@ namespace MercEx
             if (order.price < price_it->first)
                 break;
 
-            auto &orders = price_it->second;
+            match_level(order, price_it->first, price_it->second, events);
 
-            for (auto it = orders.begin(); it != orders.end();)
-            {
-                if (order.remaining <= 0)
-                    break;
-
-                Order *match = *it;
-
-                int trade_quantity = std::min(order.remaining, match->remaining);
-                order.remaining -= trade_quantity;
-                match->remaining -= trade_quantity;
-
-                update_last_price(price_it->first);
-
-                events.push_back(MarketEvent::make_trade(order.id, match->id, price_it->first, trade_quantity));
-
-                if (match->remaining == 0)
-                {
-                    match->status = OrderStatus::Filled;
-                    match->book_it = {};
-                    events.push_back(MarketEvent::make_filled(match->id, match->symbol));
-                    it = orders.erase(it);
-                }
-                else
-                {
-                    match->status = OrderStatus::PartiallyFilled;
-                    break;
-                }
-            }
-
-            if (orders.empty())
+            if (price_it->second.empty())
             {
                 price_it = sellbook.get_orders().erase(price_it);
             }
@@ -148,17 +126,16 @@ namespace MercEx
         }
         else if (order.tif != TimeInForce::IOC)
         {
-            auto it = buybook.add_order(order);
+            if (order.is_iceberg())
+                order.visible = std::min(order.display_qty, order.remaining);
+            buybook.add_order(order);
         }
-        return events;
     }
     
-    std::vector<MarketEvent> Market::process_limit_sell_order(Order &order)
+    void Market::process_limit_sell_order(Order &order, std::vector<MarketEvent> &events)
     {
         if (order.tif == TimeInForce::FOK && !validate_fulfillment(order, Side::Sell))
-            return {};
-
-        std::vector<MarketEvent> events;
+            return;
 
         for (auto price_it = buybook.get_orders().begin(); price_it != buybook.get_orders().end();)
         {
@@ -166,37 +143,9 @@ namespace MercEx
             if (order.price > price_it->first)
                 break;
 
-            auto &orders = price_it->second;
+            match_level(order, price_it->first, price_it->second, events);
 
-            for (auto it = orders.begin(); it != orders.end();)
-            {
-                if (order.remaining <= 0)
-                    break;
-
-                Order *match = *it;
-                int trade_quantity = std::min(order.remaining, match->remaining);
-                order.remaining -= trade_quantity;
-                match->remaining -= trade_quantity;
-
-                update_last_price(price_it->first);
-
-                events.push_back(MarketEvent::make_trade(order.id, match->id, price_it->first, trade_quantity));
-
-                if (match->remaining == 0)
-                {
-                    match->status = OrderStatus::Filled;
-                    match->book_it = {};
-                    events.push_back(MarketEvent::make_filled(match->id, match->symbol));
-                    it = orders.erase(it);
-                }
-                else
-                {
-                    match->status = OrderStatus::PartiallyFilled;
-                    break;
-                }
-            }
-
-            if (orders.empty())
+            if (price_it->second.empty())
             {
                 price_it = buybook.get_orders().erase(price_it);
             }
@@ -224,52 +173,20 @@ namespace MercEx
         }
         else if (order.tif != TimeInForce::IOC)
         {
-            auto it = sellbook.add_order(order);
+            if (order.is_iceberg())
+                order.visible = std::min(order.display_qty, order.remaining);
+            sellbook.add_order(order);
         }
-        return events;
     }
 
-    std::vector<MarketEvent> Market::process_market_buy_order(Order &order)
+    void Market::process_market_buy_order(Order &order, std::vector<MarketEvent> &events)
     {
-        if (order.price.has_value())
-            throw std::invalid_argument("Market order should not have a price");
-
-        std::vector<MarketEvent> events;
-
         for (auto price_it = sellbook.get_orders().begin(); price_it != sellbook.get_orders().end();)
         {
 
-            auto &orders = price_it->second;
+            match_level(order, price_it->first, price_it->second, events);
 
-            for (auto it = orders.begin(); it != orders.end();)
-            {
-                if (order.remaining <= 0)
-                    break;
-
-                Order *match = *it;
-                int trade_quantity = std::min(order.remaining, match->remaining);
-                order.remaining -= trade_quantity;
-                match->remaining -= trade_quantity;
-
-                update_last_price(price_it->first);
-
-                events.push_back(MarketEvent::make_trade(order.id, match->id, price_it->first, trade_quantity));
-
-                if (match->remaining == 0)
-                {
-                    match->status = OrderStatus::Filled;
-                    match->book_it = {};
-                    events.push_back(MarketEvent::make_filled(match->id, match->symbol));
-                    it = orders.erase(it);
-                }
-                else
-                {
-                    match->status = OrderStatus::PartiallyFilled;
-                    break;
-                }
-            }
-
-            if (orders.empty())
+            if (price_it->second.empty())
             {
                 price_it = sellbook.get_orders().erase(price_it);
             }
@@ -285,57 +202,23 @@ namespace MercEx
         if (order.remaining > 0)
         {
             order.status = OrderStatus::PartiallyFilled;
-            return events;
+            return;
         }
         else if (order.remaining == 0)
         {
             order.status = OrderStatus::Filled;
             events.push_back(MarketEvent::make_filled(order.id, order.symbol));
         }
-        return events;
     }
 
-    std::vector<MarketEvent> Market::process_market_sell_order(Order &order)
+    void Market::process_market_sell_order(Order &order, std::vector<MarketEvent> &events)
     {
-        if (order.price.has_value())
-            throw std::invalid_argument("Market order should not have a price");
-
-        std::vector<MarketEvent> events;
-
         for (auto price_it = buybook.get_orders().begin(); price_it != buybook.get_orders().end();)
         {
 
-            auto &orders = price_it->second;
+            match_level(order, price_it->first, price_it->second, events);
 
-            for (auto it = orders.begin(); it != orders.end();)
-            {
-                if (order.remaining <= 0)
-                    break;
-
-                Order *match = *it;
-                int trade_quantity = std::min(order.remaining, match->remaining);
-                order.remaining -= trade_quantity;
-                match->remaining -= trade_quantity;
-
-                update_last_price(price_it->first);
-
-                events.push_back(MarketEvent::make_trade(order.id, match->id, price_it->first, trade_quantity));
-
-                if (match->remaining == 0)
-                {
-                    match->status = OrderStatus::Filled;
-                    match->book_it = {};
-                    events.push_back(MarketEvent::make_filled(match->id, match->symbol));
-                    it = orders.erase(it);
-                }
-                else
-                {
-                    match->status = OrderStatus::PartiallyFilled;
-                    break;
-                }
-            }
-
-            if (orders.empty())
+            if (price_it->second.empty())
             {
                 price_it = buybook.get_orders().erase(price_it);
             }
@@ -351,40 +234,140 @@ namespace MercEx
         if (order.remaining > 0)
         {
             order.status = OrderStatus::PartiallyFilled;
-            return events;
+            return;
         }
         else if (order.remaining == 0)
         {
             order.status = OrderStatus::Filled;
             events.push_back(MarketEvent::make_filled(order.id, order.symbol));
         }
-        return events;
+    }
+
+    void Market::process_pegged_order(Order &order)
+    {
+        // A peg is priced clear of the opposite side, so it only ever rests.
+        if (!order.price && !price_peg(order))
+        {
+            order.status = OrderStatus::Rejected;
+            return;
+        }
+        order.status = order.remaining < order.quantity ? OrderStatus::PartiallyFilled : OrderStatus::New;
+        if (order.side == Side::Buy)
+            buybook.add_order(order);
+        else
+            sellbook.add_order(order);
+        add_peg(order);
+    }
+
+    void Market::match_level(Order &order, Price price, PriceLevel &level, std::vector<MarketEvent> &events)
+    {
+        auto &orders = level.orders;
+        for (auto it = orders.begin(); it != orders.end() && order.remaining > 0;)
+        {
+            Order *match = *it;
+            Quantity trade_quantity = std::min(order.remaining, match->shown());
+            order.remaining -= trade_quantity;
+            match->remaining -= trade_quantity;
+            if (match->is_iceberg())
+                match->visible -= trade_quantity;
+            level.visible -= trade_quantity;
+
+            update_last_price(price);
+
+            events.push_back(MarketEvent::make_trade(order.id, match->id, price, trade_quantity, match->shown()));
+
+            if (match->remaining == 0)
+            {
+                match->status = OrderStatus::Filled;
+                match->visible = 0;
+                match->book_it = {};
+                if (match->peg)
+                {
+                    remove_peg(*match);
+                    --level.pegged;
+                }
+                events.push_back(MarketEvent::make_filled(match->id, match->symbol));
+                it = orders.erase(it);
+                continue;
+            }
+
+            match->status = OrderStatus::PartiallyFilled;
+            if (!match->is_iceberg() || match->visible > 0)
+                break;
+
+            // The slice is gone: show the next one from the reserve and move
+            // to the back of the queue. Splicing keeps book_it valid. An order
+            // already last stays where it is and is matched again.
+            Quantity slice = std::min(match->display_qty, match->remaining);
+            match->visible = slice;
+            level.hidden -= slice;
+            level.visible += slice;
+            events.push_back(MarketEvent::make_replenish(match->id, match->symbol, slice, match->side, price));
+            auto next = std::next(it);
+            if (next != orders.end())
+            {
+                orders.splice(orders.end(), orders, it);
+                it = next;
+            }
+        }
     }
 
     bool Market::cancel_order(Order *order)
     {
         if (order->type == OrderType::Market)
             return true;
-        bool success;
-        if (order->side == Side::Buy)
+        bool success = order->side == Side::Buy
+                           ? buybook.cancel_order(order->id, order->price.value(), order->book_it)
+                           : sellbook.cancel_order(order->id, order->price.value(), order->book_it);
+        if (!success)
+            return false;
+        order->status = OrderStatus::Canceled;
+        order->book_it = {};
+        order->remaining = 0;
+        order->visible = 0;
+        if (order->peg)
+            remove_peg(*order);
+        reprice_pegs();
+        return true;
+    }
+
+    void Market::reduce_order(Order &order, Quantity quantity, Quantity remaining)
+    {
+        auto reduce = [&](auto &levels)
         {
-            success = buybook.cancel_order(order->id, order->price.value(), order->book_it);
-            if (!success)
-                return false;
-            order->status = OrderStatus::Canceled;
-            order->book_it = {};
-            order->remaining = 0;
-        }
+            auto level = levels.find(order.price.value());
+            if (level != levels.end())
+                level->second.reduce(order, remaining);
+        };
+        if (order.side == Side::Buy)
+            reduce(buybook.get_orders());
         else
+            reduce(sellbook.get_orders());
+        order.quantity = quantity;
+        // Every level keeps its orders, so no peg reference moves.
+    }
+
+    void Market::replace_order(Order &order, Quantity quantity, Quantity remaining, std::optional<Price> price,
+                               std::vector<MarketEvent> &events)
+    {
+        bool unlinked = order.side == Side::Buy
+                            ? buybook.cancel_order(order.id, order.price.value(), order.book_it)
+                            : sellbook.cancel_order(order.id, order.price.value(), order.book_it);
+        if (!unlinked)
+            throw std::logic_error("Replaced order is not in the book");
+        order.book_it = {};
+        order.visible = 0;
+        order.quantity = quantity;
+        order.remaining = remaining;
+        if (price)
+            order.price = price;
+        if (order.peg)
         {
-            success = sellbook.cancel_order(order->id, order->price.value(), order->book_it);
-            if (!success)
-                return false;
-            order->status = OrderStatus::Canceled;
-            order->book_it = {};
-            order->remaining = 0;
+            // Priced afresh; with its reference gone it keeps its last price.
+            remove_peg(order);
+            price_peg(order);
         }
-        return success;
+        process_order(order, events);
     }
 
     const std::string &Market::get_symbol() const { return symbol; }
@@ -398,23 +381,25 @@ namespace MercEx
 
     void Market::print_order_books() const
     {
-        std::cout << "Buy Orders:\n";
-        for (const auto &[price, orders] : buybook.get_orders())
+        auto print_level = [](Price price, const PriceLevel &level)
         {
-            for (const auto &order : orders)
+            std::cout << "Price: " << price << ", Visible: " << level.visible << ", Hidden: " << level.hidden << "\n";
+            for (const auto &order : level.orders)
             {
-                std::cout << "Price: " << price << ", OrderID: " << order->id << ", Quantity: " << order->quantity << ", Remaining: " << order->remaining << "\n";
+                std::cout << "  OrderID: " << order->id << ", Quantity: " << order->quantity << ", Remaining: " << order->remaining;
+                if (order->is_iceberg())
+                    std::cout << ", Shown: " << order->visible;
+                std::cout << "\n";
             }
-        }
+        };
+
+        std::cout << "Buy Orders:\n";
+        for (const auto &[price, level] : buybook.get_orders())
+            print_level(price, level);
 
         std::cout << "Sell Orders:\n";
-        for (const auto &[price, orders] : sellbook.get_orders())
-        {
-            for (const auto &order : orders)
-            {
-                std::cout << "Price: " << price << ", OrderID: " << order->id << ", Quantity: " << order->quantity << ", Remaining: " << order->remaining << "\n";
-            }
-        }
+        for (const auto &[price, level] : sellbook.get_orders())
+            print_level(price, level);
     }
     std::optional<double> Market::get_last_price() const { return last_price; }
     void Market::update_last_price(double price) { last_price = price; }
@@ -423,4 +408,167 @@ namespace MercEx
     std::optional<Price> Market::get_ask_price() const { return sellbook.get_best_ask(); }
 
     MarketID Market::get_market_id() const { return market_id; }
+
+    std::optional<Price> Market::get_reference_bid() const
+    {
+        for (const auto &[price, level] : buybook.get_orders())
+        {
+            if (!level.only_pegged())
+                return price;
+        }
+        return std::nullopt;
+    }
+
+    std::optional<Price> Market::get_reference_ask() const
+    {
+        for (const auto &[price, level] : sellbook.get_orders())
+        {
+            if (!level.only_pegged())
+                return price;
+        }
+        return std::nullopt;
+    }
+
+    std::size_t Market::pegged_orders() const { return peg_count; }
+
+    bool Market::price_peg(Order &order)
+    {
+        // With no pegs resting the cached references are not kept up to date.
+        if (peg_count == 0)
+        {
+            peg_bid = get_reference_bid();
+            peg_ask = get_reference_ask();
+            peg_best_bid = buybook.get_best_bid();
+            peg_best_ask = sellbook.get_best_ask();
+        }
+        auto price = peg_price(order.side, *order.peg);
+        if (!price)
+            return false;
+        order.price = price;
+        return true;
+    }
+
+    std::optional<Price> Market::peg_price(Side side, const Peg &peg) const
+    {
+        std::optional<Price> reference;
+        switch (peg.reference)
+        {
+        case PegReference::BestBid:
+            reference = peg_bid;
+            break;
+        case PegReference::BestAsk:
+            reference = peg_ask;
+            break;
+        case PegReference::Mid:
+            if (peg_bid && peg_ask)
+                reference = (*peg_bid + *peg_ask) / 2;
+            break;
+        }
+        if (!reference)
+            return std::nullopt;
+
+        // Round away from the opposite side (a mid can fall between ticks),
+        // then stay a tick clear of it so that a reprice never trades.
+        double ticks = (*reference + peg.offset) / price_tick;
+        auto index = static_cast<long long>(side == Side::Buy ? std::floor(ticks + 1e-9) : std::ceil(ticks - 1e-9));
+        if (side == Side::Buy)
+        {
+            if (auto ask = sellbook.get_best_ask())
+                index = std::min(index, std::llround(*ask / price_tick) - 1);
+        }
+        else
+        {
+            if (auto bid = buybook.get_best_bid())
+                index = std::max(index, std::llround(*bid / price_tick) + 1);
+        }
+        if (index <= 0)
+            return std::nullopt;
+        return snap_to_tick(static_cast<double>(index) * price_tick, price_tick);
+    }
+
+    void Market::add_peg(Order &order)
+    {
+        auto &group = pegs[PegKey{order.peg->reference, order.side, order.peg->offset}];
+        group.push_back(&order);
+        order.peg_it = std::prev(group.end());
+        ++peg_count;
+    }
+
+    void Market::remove_peg(Order &order)
+    {
+        auto group = pegs.find(PegKey{order.peg->reference, order.side, order.peg->offset});
+        if (group == pegs.end())
+            return;
+        group->second.erase(order.peg_it);
+        if (group->second.empty())
+            pegs.erase(group);
+        order.peg_it = {};
+        --peg_count;
+    }
+
+    void Market::reprice_pegs()
+    {
+        if (peg_count == 0)
+            return;
+        auto bid = get_reference_bid();
+        auto ask = get_reference_ask();
+        auto best_bid = buybook.get_best_bid();
+        auto best_ask = sellbook.get_best_ask();
+        bool bid_moved = bid != peg_bid;
+        bool ask_moved = ask != peg_ask;
+        // A peg held a tick clear of the opposite best follows that best too,
+        // whatever its reference: a buy pegged to the bid and capped under
+        // the ask moves up when the ask does.
+        bool buy_cap_moved = best_ask != peg_best_ask;
+        bool sell_cap_moved = best_bid != peg_best_bid;
+        if (!bid_moved && !ask_moved && !buy_cap_moved && !sell_cap_moved)
+            return;
+        peg_bid = bid;
+        peg_ask = ask;
+
+        for (Side side : {Side::Buy, Side::Sell})
+        {
+            bool cap_moved = side == Side::Buy ? buy_cap_moved : sell_cap_moved;
+            if (bid_moved || cap_moved)
+                reprice_group(PegReference::BestBid, side);
+            if (ask_moved || cap_moved)
+                reprice_group(PegReference::BestAsk, side);
+            reprice_group(PegReference::Mid, side);
+        }
+        // The bests as the pegs left them, their own moves included.
+        peg_best_bid = buybook.get_best_bid();
+        peg_best_ask = sellbook.get_best_ask();
+    }
+
+    void Market::reprice_group(PegReference reference, Side side)
+    {
+        const PegKey first{reference, side, std::numeric_limits<Price>::lowest()};
+        for (auto group = pegs.lower_bound(first);
+             group != pegs.end() && std::get<0>(group->first) == reference && std::get<1>(group->first) == side;
+             ++group)
+        {
+            // An empty reference leaves the group where it is.
+            auto price = peg_price(side, Peg{reference, std::get<2>(group->first)});
+            if (!price)
+                continue;
+            for (Order *order : group->second)
+            {
+                if (*order->price == *price)
+                    continue;
+                // Moved to the back of its new level, like any price change.
+                if (side == Side::Buy)
+                {
+                    buybook.cancel_order(order->id, *order->price, order->book_it);
+                    order->price = price;
+                    buybook.add_order(*order);
+                }
+                else
+                {
+                    sellbook.cancel_order(order->id, *order->price, order->book_it);
+                    order->price = price;
+                    sellbook.add_order(*order);
+                }
+            }
+        }
+    }
 } // namespace MercEx
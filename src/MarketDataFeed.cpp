@@ -0,0 +1,535 @@
+#include "MarketDataFeed.hpp"
+#include "OrderIdGenerator.hpp"
+#include "EngineClock.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace MercEx
+{
+
+    namespace
+    {
+        // Packets queued before a sendmmsg is forced mid-batch.
+        constexpr std::size_t kSendBurst = 64;
+        constexpr std::size_t kMaxDatagram = 65507;
+
+        std::int64_t to_ns(TimePoint ts)
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(ts.time_since_epoch()).count();
+        }
+
+        template <typename T>
+        std::size_t put(char *out, T &msg, FeedMessageType type)
+        {
+            msg.header.length = static_cast<std::uint8_t>(sizeof(T));
+            msg.header.type = type;
+            std::memcpy(out, &msg, sizeof(T));
+            return sizeof(T);
+        }
+
+        // Writes the feed message for ev to out; returns its size, or 0 for
+        // events the feed does not carry.
+        std::size_t encode(const MarketEvent &ev, char *out)
+        {
+            switch (ev.type)
+            {
+            case MarketEventType::FilledOrder:
+            {
+                FeedFilledMessage msg{};
+                msg.timestamp_ns = to_ns(ev.timestamp);
+                msg.order_id = ev.order_id;
+                return put(out, msg, FeedMessageType::Filled);
+            }
+            case MarketEventType::Trade:
+            {
+                FeedTradeMessage msg{};
+                msg.quantity = ev.executed_qty.value_or(0);
+                msg.timestamp_ns = to_ns(ev.timestamp);
+                msg.order_id = ev.order_id;
+                msg.counterparty_id = ev.counterparty_id.value_or(0);
+                msg.price = ev.executed_price.value_or(0.0);
+                return put(out, msg, FeedMessageType::Trade);
+            }
+            case MarketEventType::AddOrder:
+            case MarketEventType::CancelOrder:
+            case MarketEventType::StopTriggered:
+            case MarketEventType::ModifyOrder:
+                break; // not published by the engine
+            case MarketEventType::Replenish:
+                break; // a book change; the feed carries no book
+            }
+            return 0;
+        }
+
+        FeedPacketHeader make_header(MarketID market_id, std::uint64_t sequence, std::uint8_t flags)
+        {
+            FeedPacketHeader header{};
+            header.length = sizeof(FeedPacketHeader);
+            header.market_id = market_id;
+            header.version = kFeedVersion;
+            header.flags = flags;
+            header.sequence = sequence;
+            header.send_time_ns = to_ns(EngineClock::now());
+            return header;
+        }
+
+        void append(std::vector<char> &out, const void *data, std::size_t size)
+        {
+            const char *bytes = static_cast<const char *>(data);
+            out.insert(out.end(), bytes, bytes + size);
+        }
+    }
+
+    struct MarketDataFeed::MarketState
+    {
+        explicit MarketState(std::size_t max_packet) : packet(max_packet) {}
+
+        // Publisher side: the packet being filled and the running state.
+        std::vector<char> packet;
+        std::size_t fill = 0;
+        std::uint16_t count = 0;
+        std::uint64_t first_sequence = 0;
+        std::uint64_t next_sequence = 1;
+        FeedSnapshotMessage stats{};
+
+        // Under mutex_: as of the last packet stored in the history.
+        std::uint64_t published_sequence = 1;
+        FeedSnapshotMessage published{};
+        Clock::time_point last_sent{};
+    };
+
+    struct MarketDataFeed::RecoveryClient
+    {
+        int fd = -1;
+        std::vector<char> rx = std::vector<char>(64 * sizeof(FeedRequest));
+        std::size_t fill = 0;
+    };
+
+    MarketDataFeed::MarketDataFeed(MarketDataFeedConfig config)
+        : config_(std::move(config)), markets_(OrderIdGenerator::kMaxMarkets)
+    {
+        if (config_.max_packet < sizeof(FeedPacketHeader) + kFeedMaxMessageSize || config_.max_packet > kMaxDatagram)
+            throw std::invalid_argument("MarketDataFeed max_packet must hold a message and fit a datagram");
+        if (config_.history_packets < 2 * kSendBurst)
+            throw std::invalid_argument("MarketDataFeed history must hold at least " + std::to_string(2 * kSendBurst) +
+                                        " packets");
+        history_.resize(config_.history_packets * config_.max_packet);
+        history_lengths_.resize(config_.history_packets);
+        touched_.reserve(64);
+    }
+
+    MarketDataFeed::~MarketDataFeed()
+    {
+        stop();
+    }
+
+    void MarketDataFeed::start()
+    {
+#ifndef __linux__
+        throw std::runtime_error("MarketDataFeed requires Linux");
+#else
+        if (running_.load(std::memory_order_acquire))
+            return;
+        open_sockets();
+        running_.store(true, std::memory_order_release);
+        worker_ = std::thread(&MarketDataFeed::run_recovery, this);
+#endif
+    }
+
+    void MarketDataFeed::stop()
+    {
+        running_.store(false, std::memory_order_release);
+        if (worker_.joinable())
+            worker_.join();
+#ifdef __linux__
+        if (udp_fd_ >= 0)
+            ::close(udp_fd_);
+        if (listen_fd_ >= 0)
+            ::close(listen_fd_);
+        udp_fd_ = listen_fd_ = -1;
+#endif
+    }
+
+    MarketDataFeed::MarketState &MarketDataFeed::market(MarketID market_id)
+    {
+        auto &slot = markets_[market_id];
+        if (!slot)
+        {
+            auto state = std::make_unique<MarketState>(config_.max_packet);
+            std::lock_guard<std::mutex> lock(mutex_);
+            slot = std::move(state);
+            active_.push_back(market_id);
+        }
+        return *slot;
+    }
+
+    void MarketDataFeed::on_market_events(const std::vector<MarketEvent> &events)
+    {
+        if (!running_.load(std::memory_order_acquire))
+            return;
+
+        char msg[kFeedMaxMessageSize];
+        for (const auto &ev : events)
+        {
+            std::size_t size = encode(ev, msg);
+            if (size == 0)
+                continue;
+            MarketID market_id = ev.market_id;
+            MarketState &state = market(market_id);
+
+            if (state.count > 0 && (state.fill + size > config_.max_packet || state.count == 0xffff))
+                finish_packet(market_id, state);
+            if (state.count == 0)
+            {
+                state.first_sequence = state.next_sequence;
+                state.fill = sizeof(FeedPacketHeader);
+                touched_.push_back(market_id);
+            }
+            std::memcpy(state.packet.data() + state.fill, msg, size);
+            state.fill += size;
+            ++state.count;
+            ++state.next_sequence;
+
+            if (ev.type == MarketEventType::Trade)
+            {
+                state.stats.last_trade_ns = to_ns(ev.timestamp);
+                state.stats.last_price = ev.executed_price.value_or(0.0);
+                state.stats.volume += static_cast<std::uint64_t>(ev.executed_qty.value_or(0));
+                ++state.stats.trades;
+            }
+        }
+
+        // Each batch goes out whole: nothing waits for a packet to fill.
+        for (MarketID market_id : touched_)
+        {
+            MarketState &state = *markets_[market_id];
+            if (state.count > 0)
+                finish_packet(market_id, state);
+        }
+        touched_.clear();
+        send_pending();
+    }
+
+    void MarketDataFeed::finish_packet(MarketID market_id, MarketState &state)
+    {
+        FeedPacketHeader header = make_header(market_id, state.first_sequence, 0);
+        header.length = static_cast<std::uint16_t>(state.fill);
+        header.count = state.count;
+        std::memcpy(state.packet.data(), &header, sizeof(header));
+
+        char *stored;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::size_t index = history_stored_++ % config_.history_packets;
+            stored = history_.data() + index * config_.max_packet;
+            std::memcpy(stored, state.packet.data(), state.fill);
+            history_lengths_[index] = static_cast<std::uint16_t>(state.fill);
+            state.published_sequence = state.next_sequence;
+            state.published = state.stats;
+            state.last_sent = Clock::now();
+        }
+
+#ifdef __linux__
+        // Sent from the history slot, which cannot be reused before the
+        // burst goes out: the history holds at least two bursts.
+        pending_iov_[pending_count_] = {stored, state.fill};
+        ++pending_count_;
+#endif
+        packets_sent_.add();
+        messages_sent_.add(state.count);
+        state.count = 0;
+        state.fill = 0;
+        if (pending_count_ == kSendBurst)
+            send_pending();
+    }
+
+    void MarketDataFeed::send_pending()
+    {
+#ifdef __linux__
+        std::size_t sent = 0;
+        while (sent < pending_count_)
+        {
+            int n = ::sendmmsg(udp_fd_, pending_.data() + sent, static_cast<unsigned>(pending_count_ - sent), 0);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                // Receivers recover whatever was lost from the history.
+                send_errors_.add(pending_count_ - sent);
+                break;
+            }
+            sent += static_cast<std::size_t>(n);
+        }
+#endif
+        pending_count_ = 0;
+    }
+
+#ifdef __linux__
+
+    void MarketDataFeed::open_sockets()
+    {
+        sockaddr_in dest{};
+        dest.sin_family = AF_INET;
+        dest.sin_port = htons(config_.port);
+        if (::inet_pton(AF_INET, config_.address.c_str(), &dest.sin_addr) != 1)
+            throw std::invalid_argument("MarketDataFeed address is not IPv4: " + config_.address);
+        sockaddr_in recovery{};
+        recovery.sin_family = AF_INET;
+        recovery.sin_port = htons(config_.recovery_port);
+        if (::inet_pton(AF_INET, config_.recovery_address.c_str(), &recovery.sin_addr) != 1)
+            throw std::invalid_argument("MarketDataFeed recovery address is not IPv4: " + config_.recovery_address);
+
+        int udp = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        int tcp = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        auto fail = [&](const std::string &what)
+        {
+            int err = errno;
+            if (udp >= 0)
+                ::close(udp);
+            if (tcp >= 0)
+                ::close(tcp);
+            throw std::runtime_error("Feed " + what + ": " + std::strerror(err));
+        };
+        if (udp < 0 || tcp < 0)
+            fail("socket");
+
+        int sndbuf = 4 << 20;
+        ::setsockopt(udp, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+        if (IN_MULTICAST(ntohl(dest.sin_addr.s_addr)))
+        {
+            in_addr iface{};
+            if (::inet_pton(AF_INET, config_.interface.c_str(), &iface) != 1)
+            {
+                errno = EINVAL;
+                fail("interface " + config_.interface);
+            }
+            unsigned char ttl = static_cast<unsigned char>(config_.ttl);
+            unsigned char loop = 1;
+            if (::setsockopt(udp, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface)) != 0 ||
+                ::setsockopt(udp, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) != 0 ||
+                ::setsockopt(udp, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) != 0)
+                fail("multicast options");
+        }
+
+        int one = 1;
+        ::setsockopt(tcp, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        socklen_t len = sizeof(recovery);
+        if (::bind(tcp, reinterpret_cast<sockaddr *>(&recovery), sizeof(recovery)) != 0 || ::listen(tcp, 64) != 0 ||
+            ::getsockname(tcp, reinterpret_cast<sockaddr *>(&recovery), &len) != 0)
+            fail("recovery " + config_.recovery_address + ":" + std::to_string(config_.recovery_port));
+
+        destination_.assign(reinterpret_cast<const char *>(&dest), reinterpret_cast<const char *>(&dest) + sizeof(dest));
+        pending_.assign(kSendBurst, mmsghdr{});
+        pending_iov_.assign(kSendBurst, iovec{});
+        for (std::size_t i = 0; i < kSendBurst; ++i)
+        {
+            pending_[i].msg_hdr.msg_name = destination_.data();
+            pending_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            pending_[i].msg_hdr.msg_iov = &pending_iov_[i];
+            pending_[i].msg_hdr.msg_iovlen = 1;
+        }
+        udp_fd_ = udp;
+        listen_fd_ = tcp;
+        recovery_port_ = ntohs(recovery.sin_port);
+    }
+
+    void MarketDataFeed::run_recovery()
+    {
+        apply_thread_placement(config_.placement, "mx-feed");
+
+        std::vector<std::unique_ptr<RecoveryClient>> clients;
+        std::vector<pollfd> fds;
+        auto next_heartbeat = Clock::now() + config_.heartbeat;
+        while (running_.load(std::memory_order_acquire))
+        {
+            fds.clear();
+            fds.push_back({listen_fd_, POLLIN, 0});
+            for (auto &client : clients)
+                fds.push_back({client->fd, POLLIN, 0});
+
+            int timeout_ms = 100;
+            if (config_.heartbeat.count() > 0)
+            {
+                auto until = std::chrono::duration_cast<std::chrono::milliseconds>(next_heartbeat - Clock::now());
+                timeout_ms = static_cast<int>(std::clamp<std::int64_t>(until.count(), 0, timeout_ms));
+            }
+            if (::poll(fds.data(), fds.size(), timeout_ms) < 0 && errno != EINTR)
+            {
+                std::cerr << "[Feed] poll: " << std::strerror(errno) << std::endl;
+                break;
+            }
+
+            // Clients first: fds[i + 1] still lines up with clients[i].
+            for (std::size_t i = clients.size(); i-- > 0;)
+            {
+                if (fds[i + 1].revents == 0)
+                    continue;
+                if (!serve(*clients[i]))
+                {
+                    ::close(clients[i]->fd);
+                    clients.erase(clients.begin() + static_cast<std::ptrdiff_t>(i));
+                }
+            }
+            if (fds[0].revents & POLLIN)
+            {
+                for (;;)
+                {
+                    int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+                    if (fd < 0)
+                        break;
+                    // Responses are written blocking; a receiver that stops
+                    // reading for a second is dropped.
+                    timeval timeout{1, 0};
+                    int one = 1;
+                    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                    auto client = std::make_unique<RecoveryClient>();
+                    client->fd = fd;
+                    clients.push_back(std::move(client));
+                }
+            }
+
+            if (config_.heartbeat.count() > 0 && Clock::now() >= next_heartbeat)
+            {
+                send_heartbeats();
+                next_heartbeat = Clock::now() + config_.heartbeat;
+            }
+        }
+
+        for (auto &client : clients)
+            ::close(client->fd);
+    }
+
+    void MarketDataFeed::send_heartbeats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = Clock::now();
+        for (MarketID market_id : active_)
+        {
+            MarketState &state = *markets_[market_id];
+            if (now - state.last_sent < config_.heartbeat)
+                continue;
+            FeedPacketHeader header = make_header(market_id, state.published_sequence, 0);
+            ::sendto(udp_fd_, &header, sizeof(header), 0, reinterpret_cast<const sockaddr *>(destination_.data()),
+                     sizeof(sockaddr_in));
+            state.last_sent = now;
+        }
+    }
+
+    bool MarketDataFeed::serve(RecoveryClient &client)
+    {
+        ssize_t n = ::recv(client.fd, client.rx.data() + client.fill, client.rx.size() - client.fill, 0);
+        if (n <= 0)
+            return n < 0 && errno == EINTR;
+        client.fill += static_cast<std::size_t>(n);
+
+        std::vector<char> out;
+        std::size_t used = 0;
+        for (; client.fill - used >= sizeof(FeedRequest); used += sizeof(FeedRequest))
+        {
+            FeedRequest request;
+            std::memcpy(&request, client.rx.data() + used, sizeof(request));
+            if (request.length != sizeof(FeedRequest) || request.version != kFeedVersion ||
+                (request.type != FeedRequestType::Retransmit && request.type != FeedRequestType::Snapshot))
+                return false;
+            recovery_requests_.add();
+            respond(request, out);
+        }
+        std::memmove(client.rx.data(), client.rx.data() + used, client.fill - used);
+        client.fill -= used;
+
+        for (std::size_t sent = 0; sent < out.size();)
+        {
+            ssize_t w = ::send(client.fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+            if (w < 0 && errno == EINTR)
+                continue;
+            if (w <= 0)
+                return false;
+            sent += static_cast<std::size_t>(w);
+        }
+        return true;
+    }
+
+    void MarketDataFeed::respond(const FeedRequest &request, std::vector<char> &out)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const MarketState *state = markets_[request.market_id].get();
+        std::uint64_t next = state ? state->published_sequence : 1;
+
+        bool snapshot = request.type == FeedRequestType::Snapshot;
+        if (!snapshot && request.from_sequence < next)
+        {
+            std::uint64_t from = request.from_sequence;
+            std::uint64_t to = std::min<std::uint64_t>(next, from + std::max<std::uint16_t>(request.count, 1));
+            std::uint64_t held = std::min<std::uint64_t>(history_stored_, config_.history_packets);
+
+            // A market's packets leave the ring oldest first, so what is held
+            // of it is one unbroken range up to its latest packet.
+            bool first = true;
+            for (std::uint64_t n = history_stored_ - held; n < history_stored_; ++n)
+            {
+                std::size_t index = n % config_.history_packets;
+                const char *packet = history_.data() + index * config_.max_packet;
+                FeedPacketHeader header;
+                std::memcpy(&header, packet, sizeof(header));
+                if (header.market_id != request.market_id)
+                    continue;
+                if (first && from < header.sequence)
+                {
+                    snapshot = true;
+                    break;
+                }
+                first = false;
+                if (header.sequence >= to)
+                    break;
+                if (header.sequence + header.count <= from)
+                    continue;
+                header.flags |= FeedPacketHeader::kRetransmit;
+                append(out, &header, sizeof(header));
+                append(out, packet + sizeof(header), history_lengths_[index] - sizeof(header));
+            }
+            snapshot |= first;
+        }
+        if (snapshot)
+            append_snapshot(request.market_id, state, out);
+
+        FeedPacketHeader end =
+            make_header(request.market_id, next, FeedPacketHeader::kRetransmit | FeedPacketHeader::kEndOfResponse);
+        append(out, &end, sizeof(end));
+    }
+
+    void MarketDataFeed::append_snapshot(MarketID market_id, const MarketState *state, std::vector<char> &out)
+    {
+        FeedPacketHeader header = make_header(market_id, state ? state->published_sequence : 1,
+                                              FeedPacketHeader::kRetransmit | FeedPacketHeader::kSnapshot);
+        header.length = sizeof(FeedPacketHeader) + sizeof(FeedSnapshotMessage);
+        header.count = 1;
+        FeedSnapshotMessage msg = state ? state->published : FeedSnapshotMessage{};
+        msg.header.length = sizeof(FeedSnapshotMessage);
+        msg.header.type = FeedMessageType::Snapshot;
+        append(out, &header, sizeof(header));
+        append(out, &msg, sizeof(msg));
+        snapshots_sent_.add();
+    }
+
+#else
+
+    void MarketDataFeed::open_sockets() {}
+    void MarketDataFeed::run_recovery() {}
+
+#endif
+
+}
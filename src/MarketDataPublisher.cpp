@@ -1,24 +1,117 @@
 #include "MarketDataPublisher.hpp"
+#include <iterator>
 
 namespace MercEx {
 
-MarketDataPublisher::MarketDataPublisher() {
+EventBufferPool::EventBufferPool(std::size_t count, std::size_t capacity) {
+    for (std::size_t i = 0; i < count; ++i) {
+        std::vector<MarketEvent> buffer;
+        buffer.reserve(capacity);
+        free_.enqueue(std::move(buffer));
+    }
+}
+
+bool EventBufferPool::try_acquire(std::vector<MarketEvent>& buffer) {
+    return free_.try_dequeue(buffer);
+}
+
+void EventBufferPool::release(std::vector<MarketEvent>&& buffer) {
+    buffer.clear();
+    free_.enqueue(std::move(buffer));
+}
+
+MarketDataPublisher::MarketDataPublisher(ExecutionMode mode, ThreadPlacement placement)
+    : mode_(mode), placement_(placement) {
+    if (mode_ == ExecutionMode::Inline) {
+        return;
+    }
     running_.store(true);
     worker_ = std::thread(&MarketDataPublisher::run, this);
 }
 
 MarketDataPublisher::~MarketDataPublisher() {
+    if (mode_ == ExecutionMode::Inline) {
+        return;
+    }
     running_.store(false);
-    event_queue_.enqueue({}); 
+    event_queue_.enqueue(Batch{});
     if (worker_.joinable()) {
         worker_.join();
     }
 }
 
 void MarketDataPublisher::publish(const std::vector<MarketEvent>& events) {
-    if (!events.empty()) {
-        event_queue_.enqueue(events);
+    if (events.empty()) {
+        return;
+    }
+    if (mode_ == ExecutionMode::Inline) {
+        dispatch(events);
+        return;
+    }
+    event_queue_.enqueue(Batch{events, nullptr});
+}
+
+void MarketDataPublisher::publish(std::vector<MarketEvent>&& events, EventBufferPool* pool, PublishToken* token) {
+    if (events.empty()) {
+        return;
+    }
+    if (mode_ == ExecutionMode::Inline) {
+        dispatch(events);
+        events.clear();
+        return;
+    }
+    if (token) {
+        event_queue_.enqueue(*token, Batch{std::move(events), pool});
+    } else {
+        event_queue_.enqueue(Batch{std::move(events), pool});
+    }
+    events.clear(); // a moved-from vector is only valid-but-unspecified
+}
+
+std::vector<MarketEvent> MarketDataPublisher::acquire_buffer() {
+    std::vector<MarketEvent> buffer;
+    recycled_.try_dequeue(buffer);
+    return buffer;
+}
+
+bool MarketDataPublisher::prepare_producer(std::unique_ptr<PublishToken>& token, std::size_t batches,
+                                           std::chrono::milliseconds timeout) {
+    if (mode_ == ExecutionMode::Inline) {
+        return true;
+    }
+    // A token's sub-queue keeps the blocks it grows and reuses them once
+    // emptied. One bulk enqueue of the backlog, with two blocks of slack for
+    // a backlog that straddles block boundaries, grows it at once; the
+    // blocks are free for reuse when the last of those batches is dequeued.
+    // The flag is shared so a batch still queued after a timeout does not
+    // outlive it.
+    constexpr std::size_t kBlock = moodycamel::ConcurrentQueueDefaultTraits::BLOCK_SIZE;
+    token = std::make_unique<PublishToken>(event_queue_);
+    auto drained = std::make_shared<std::atomic<bool>>(false);
+    std::vector<Batch> empty(batches + 2 * kBlock);
+    empty.back().drained = drained;
+    event_queue_.enqueue_bulk(*token, std::make_move_iterator(empty.begin()), empty.size());
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!drained->load(std::memory_order_acquire)) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+void MarketDataPublisher::recycle(Batch&& batch) {
+    if (batch.pool) {
+        batch.pool->release(std::move(batch.events));
+        return;
     }
+    if (batch.events.capacity() == 0 || recycled_.size_approx() >= kMaxRecycledBuffers) {
+        return;
+    }
+    batch.events.clear();
+    recycled_.enqueue(std::move(batch.events));
 }
 
 void MarketDataPublisher::subscribe(IMarketDataListener* listener) {
@@ -28,19 +121,35 @@ void MarketDataPublisher::subscribe(IMarketDataListener* listener) {
 }
 
 void MarketDataPublisher::run() {
-    std::vector<MarketEvent> events_to_process;
+    apply_thread_placement(placement_, "mx-publisher");
+
+    Batch batch;
     while (running_.load()) {
-        event_queue_.wait_dequeue(events_to_process);
+        event_queue_.wait_dequeue(batch);
+        if (batch.drained) {
+            batch.drained->store(true, std::memory_order_release);
+        }
 
-        if (!running_.load() && events_to_process.empty()) {
+        if (!running_.load() && batch.events.empty()) {
             break;
         }
 
-        for (IMarketDataListener* listener : listeners_) {
-            listener->on_market_events(events_to_process);
+        // Empty batches only register a producer (see prepare_producer()).
+        if (!batch.events.empty()) {
+            dispatch(batch.events);
         }
-        events_to_process.clear();
+        recycle(std::move(batch));
+        batch = Batch{};
+    }
+}
+
+void MarketDataPublisher::dispatch(const std::vector<MarketEvent>& events) {
+    for (IMarketDataListener* listener : listeners_) {
+        listener->on_market_events(events);
     }
+    // Inline publishers dispatch on whichever thread publishes, so this is a
+    // real read-modify-write rather than a single-writer store.
+    dispatched_events_.fetch_add(events.size(), std::memory_order_relaxed);
 }
 
 }
\ No newline at end of file
@@ -1,11 +1,45 @@
 #include "../include/MarketProcessor.hpp"
+#include "StageTimer.hpp"
 #include <iostream>
 #include <chrono>
+#include <iterator>
 
 namespace MercEx
 {
-    MarketProcessor::MarketProcessor(std::unique_ptr<Market> m, MarketDataPublisher& publisher)
-        : market(std::move(m)), publisher_(publisher) {}
+    namespace
+    {
+        Quantity resting_leaves(const Order &match, const MarketEvent *trade, const std::vector<MarketEvent> &events)
+        {
+            // The published trade shows only what the resting order displays. Its
+            // leaves are what it has left now plus the fills after this one: an
+            // iceberg can be hit again by the same aggressor once it has
+            // replenished.
+            Quantity leaves = match.remaining;
+            if (match.is_iceberg())
+            {
+                for (const MarketEvent *ev = trade + 1; ev != events.data() + events.size(); ++ev)
+                {
+                    if (ev->type == MarketEventType::Trade && *ev->counterparty_id == match.id)
+                        leaves += *ev->executed_qty;
+                }
+            }
+            return leaves;
+        }
+    }
+
+    MarketProcessor::MarketProcessor(std::unique_ptr<Market> m, MarketDataPublisher& publisher,
+                                     ExecutionReportRouter* reports, ExecutionMode mode,
+                                     ThreadPlacement placement, std::unique_ptr<MarketMemory> memory,
+                                     const MarketCapacity &capacity)
+        : memory_(std::move(memory)), market(std::move(m)),
+          queue(capacity.queue_events ? capacity.queue_events : 32 * moodycamel::ConcurrentQueueDefaultTraits::BLOCK_SIZE),
+          orders_local_(resource()), stop_buy_orders_(resource()), stop_sell_orders_(resource()),
+          publisher_(publisher), reports_(reports), mode_(mode), placement_(placement), capacity_(capacity) {}
+
+    std::pmr::memory_resource *MarketProcessor::resource()
+    {
+        return memory_ ? memory_->resource() : std::pmr::get_default_resource();
+    }
 
     MarketProcessor::~MarketProcessor()
     {
@@ -17,7 +51,10 @@ namespace MercEx
     void MarketProcessor::start()
     {
         running.store(true, std::memory_order_release);
-        worker = std::thread(&MarketProcessor::run, this);
+        if (mode_ == ExecutionMode::Threaded)
+            worker = std::thread(&MarketProcessor::run, this);
+        else
+            warm_up(); // inline markets run on the caller's thread, which is never armed
     }
 
     void MarketProcessor::stop()
@@ -27,68 +64,185 @@ namespace MercEx
 
     void MarketProcessor::submit_event(const MarketEvent &ev)
     {
+        if (mode_ == ExecutionMode::Inline)
+        {
+            process(ev);
+            return;
+        }
+        MERCEX_TIME_SCOPE(Enqueue);
         queue.enqueue(ev);
     }
 
+    void MarketProcessor::submit_events(std::vector<MarketEvent> &events)
+    {
+        if (mode_ == ExecutionMode::Inline)
+        {
+            for (auto &ev : events)
+                process(ev);
+            return;
+        }
+        MERCEX_TIME_SCOPE(Enqueue);
+        if (!events.empty())
+            queue.enqueue_bulk(std::make_move_iterator(events.begin()), events.size());
+    }
+
     void MarketProcessor::run()
     {
+        // Placed before the first event, so the book and order map are
+        // allocated on this thread's NUMA node as they grow.
+        apply_thread_placement(placement_, "mx-" + market->get_symbol());
+        if (warm_up())
+            AllocationGuard::arm();
+
         MarketEvent ev;
         while (running.load(std::memory_order_acquire))
         {
+            MERCEX_TIME_BEGIN(dequeue_start);
             if (queue.try_dequeue(ev))
             {
-                try
-                {
-                    handle_event(ev);
-                }
-                catch (const std::exception &e)
-                {
-                    std::cerr << "[Worker Exception] " << e.what() << std::endl;
-                }
-                catch (...)
-                {
-                    std::cerr << "[Worker Exception] unknown" << std::endl;
-                }
+                MERCEX_TIME_END(Dequeue, dequeue_start);
+                process(ev);
             }
             else
             {
                 std::this_thread::sleep_for(std::chrono::nanoseconds(100));
             }
         }
+        AllocationGuard::disarm();
     }
 
-    void MarketProcessor::handle_event(MarketEvent &ev)
+    bool MarketProcessor::warm_up()
+    {
+        if (capacity_.empty())
+            return false;
+
+        StageTimings::prepare_thread();
+        // At most event_batches batches are in flight from this market. Only
+        // a market with its own thread publishes through a token: inline, any
+        // submitting thread may be the one publishing.
+        bool prepared = mode_ != ExecutionMode::Threaded ||
+                        publisher_.prepare_producer(publish_token_, capacity_.event_batches);
+        if (!prepared)
+            std::cerr << "[MarketProcessor] " << market->get_symbol()
+                      << ": publisher did not drain warm-up batches; allocation guard not armed" << std::endl;
+        if (mode_ == ExecutionMode::Threaded)
+        {
+            event_buffers_ = std::make_unique<EventBufferPool>(capacity_.event_batches, capacity_.events_per_batch);
+            if (reports_)
+                report_producer_ = reports_->register_producer();
+        }
+        events_.reserve(capacity_.events_per_batch);
+
+        // Grow every node-based container to its hinted size and clear it
+        // again: the buckets stay, and the freed nodes stay in the market's
+        // pool, where the steady state finds them.
+        orders_local_.reserve(capacity_.orders);
+        for (std::size_t i = 0; i < capacity_.orders; ++i)
+            orders_local_.try_emplace(static_cast<OrderID>(i));
+
+        auto &bids = market->get_buybook().get_orders();
+        auto &asks = market->get_sellbook().get_orders();
+        for (std::size_t i = 0; i < capacity_.price_levels; ++i)
+        {
+            Price price = static_cast<Price>(i);
+            bids[price];
+            asks[price];
+            stop_buy_orders_[price];
+            stop_sell_orders_[price];
+        }
+        if (!bids.empty())
+        {
+            OrderList &level = bids.begin()->second.orders;
+            for (auto &entry : orders_local_)
+                level.push_back(&entry.second);
+        }
+
+        bids.clear();
+        asks.clear();
+        stop_buy_orders_.clear();
+        stop_sell_orders_.clear();
+        orders_local_.clear();
+        return prepared;
+    }
+
+    void MarketProcessor::process(const MarketEvent &ev)
+    {
+        try
+        {
+            handle_event(ev);
+            update_depth_gauges();
+        }
+        // An event that threw partway through may have left events behind;
+        // they must not be published with the next event's batch.
+        catch (const std::exception &e)
+        {
+            events_.clear();
+            AllocationGuard::Permit permit;
+            std::cerr << "[Worker Exception] " << e.what() << std::endl;
+        }
+        catch (...)
+        {
+            events_.clear();
+            AllocationGuard::Permit permit;
+            std::cerr << "[Worker Exception] unknown" << std::endl;
+        }
+    }
+
+    bool MarketProcessor::is_well_formed(const MarketEvent &ev)
+    {
+        if (!ev.order_type || !ev.tif)
+            return false;
+        switch (*ev.order_type)
+        {
+        case OrderType::Limit:
+        case OrderType::Iceberg:
+            return ev.price.has_value();
+        case OrderType::Market:
+            return true;
+        case OrderType::Stop:
+            return ev.stop_price.has_value();
+        case OrderType::StopLimit:
+            return ev.price && ev.stop_price;
+        case OrderType::Pegged:
+            return ev.peg.has_value();
+        default:
+            return false;
+        }
+    }
+
+    void MarketProcessor::handle_event(const MarketEvent &ev)
     {
         auto submit_time = ev.timestamp;
         switch (ev.type)
         {
         case MarketEventType::AddOrder:
         {
-            std::unique_ptr<Order> order;
-            if (ev.order_type.value() == OrderType::Limit)
-            {
-                order = Order::make_limit_order(ev.order_id, ev.client_id, ev.symbol,
-                                                ev.quantity, ev.price.value(), ev.side, ev.tif.value());
-            }
-            else if (ev.order_type.value() == OrderType::Market)
-            {
-                order = Order::make_market_order(ev.order_id, ev.client_id, ev.symbol,
-                                                 ev.quantity, ev.side, ev.tif.value());
-            }
-            else if (ev.order_type.value() == OrderType::Stop)
+            // Events arrive validated and normalized by MatchingEngine's pre-trade stage.
+            // submit_event is public, though: one that skipped it and lacks a
+            // field the book dereferences is refused, not trusted.
+            MERCEX_TIME_BEGIN(construct_start);
+            metrics_.orders_in.add();
+            if (!is_well_formed(ev))
             {
-                order = Order::make_stop_order(ev.order_id, ev.client_id, ev.symbol,
-                                               ev.quantity, ev.stop_price.value(), ev.side, ev.tif.value());
+                metrics_.rejects.add();
+                report(ExecType::Rejected, ev.order_id, ev.client_id, RejectReason::InvalidOrder);
+                return;
             }
-            else if (ev.order_type.value() == OrderType::StopLimit)
+            // An ID already in use names an order the book and the peg index
+            // still point at; it is refused rather than overwritten.
+            OrderID id = ev.order_id;
+            auto slot = orders_local_.try_emplace(id, Order::make(id, ev.client_id, ev.symbol, ev.quantity, ev.price,
+                                                                  ev.stop_price, ev.side, *ev.order_type, *ev.tif));
+            if (!slot.second)
             {
-                order = Order::make_stop_limit_order(ev.order_id, ev.client_id, ev.symbol,
-                                                     ev.quantity, ev.price.value(), ev.stop_price.value(), ev.side, ev.tif.value());
+                metrics_.rejects.add();
+                report(ExecType::Rejected, id, ev.client_id, RejectReason::InvalidOrder);
+                return;
             }
-
-            OrderID id = order->id;
-            orders_local_[id] = std::move(order);
-            Order *ord_ptr = orders_local_[id].get();
+            Order *ord_ptr = &slot.first->second;
+            ord_ptr->display_qty = ev.display_qty;
+            ord_ptr->peg = ev.peg;
+            MERCEX_TIME_END(Construct, construct_start);
 
             if (ord_ptr->type == OrderType::Stop || ord_ptr->type == OrderType::StopLimit)
             {
@@ -100,22 +254,40 @@ namespace MercEx
                 {
                     stop_sell_orders_[*ord_ptr->stop_price].push_back(ord_ptr);
                 }
+                report(ExecType::New, *ord_ptr);
+                return;
+            }
+
+            if (!market->active())
+            {
+                metrics_.rejects.add();
+                report(ExecType::Rejected, *ord_ptr, RejectReason::MarketInactive);
+                orders_local_.erase(id);
+                return;
+            }
+
+            if (ord_ptr->type == OrderType::Pegged && !market->price_peg(*ord_ptr))
+            {
+                metrics_.rejects.add();
+                report(ExecType::Rejected, *ord_ptr, RejectReason::NoReferencePrice);
+                orders_local_.erase(id);
                 return;
             }
 
             Price prevltp = market->get_last_price().value_or(0.0);
-            auto events = market->process_order(*ord_ptr);
+            execute(*ord_ptr);
 
-            auto end = std::chrono::steady_clock::now();
+            auto end = EngineClock::now();
             auto latency_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - submit_time).count();
 
             total_latency_ns += latency_ns;
             processed_orders++;
 
-            handle_market_events(events);
+            handle_market_events();
 
             if (market->get_last_price().value_or(0.0) != prevltp)
             {
+                MERCEX_TIME_SCOPE(StopCheck);
                 check_stop_orders();
             }
             break;
@@ -123,18 +295,171 @@ namespace MercEx
 
         case MarketEventType::CancelOrder:
         {
+            // A cancel that names a client may only touch that client's
+            // orders; to anyone else the order does not exist.
             auto it = orders_local_.find(ev.order_id);
-            if (it != orders_local_.end())
+            if (it == orders_local_.end() || (ev.client_id != 0 && it->second.client_id != ev.client_id))
+            {
+                metrics_.cancel_rejects.add();
+                report(ExecType::CancelRejected, ev.order_id, ev.client_id, RejectReason::UnknownOrder);
+                break;
+            }
+
+            Order *ord = &it->second;
+            if (ord->status == OrderStatus::Filled || ord->status == OrderStatus::Canceled ||
+                ord->status == OrderStatus::Expired)
+            {
+                metrics_.cancel_rejects.add();
+                report(ExecType::CancelRejected, *ord, RejectReason::TooLateToCancel);
+                break;
+            }
+
+            bool canceled = (ord->type == OrderType::Stop || ord->type == OrderType::StopLimit)
+                                ? cancel_stop_order(ord)
+                                : market->cancel_order(ord);
+            if (!canceled)
+            {
+                metrics_.cancel_rejects.add();
+                report(ExecType::CancelRejected, *ord, RejectReason::TooLateToCancel);
+                break;
+            }
+            ord->status = OrderStatus::Canceled;
+            ord->remaining = 0;
+            metrics_.cancels.add();
+            report(ExecType::Canceled, *ord);
+            break;
+        }
+
+        case MarketEventType::ModifyOrder:
+        {
+            // Same ownership rule as a cancel.
+            auto it = orders_local_.find(ev.order_id);
+            if (it == orders_local_.end() || (ev.client_id != 0 && it->second.client_id != ev.client_id))
+            {
+                metrics_.modify_rejects.add();
+                report(ExecType::ReplaceRejected, ev.order_id, ev.client_id, RejectReason::UnknownOrder);
+                break;
+            }
+
+            Order *ord = &it->second;
+            RejectReason reason = check_modify(*ord, ev);
+            if (reason != RejectReason::None)
             {
-                Order *ord = it->second.get();
-                market->cancel_order(ord);
-                ord->status = OrderStatus::Canceled;
+                metrics_.modify_rejects.add();
+                report(ExecType::ReplaceRejected, *ord, reason);
+                break;
             }
+            metrics_.modifies.add();
+            modify(*ord, ev.quantity, ev.price);
+            break;
+        }
+
+        // Published by the market, never submitted to it.
+        case MarketEventType::FilledOrder:
+        case MarketEventType::Trade:
+        case MarketEventType::StopTriggered:
+        case MarketEventType::Replenish:
             break;
         }
+    }
+
+    RejectReason MarketProcessor::check_modify(const Order &order, const MarketEvent &ev) const
+    {
+        if (order.status == OrderStatus::Filled || order.status == OrderStatus::Canceled ||
+            order.status == OrderStatus::Expired)
+            return RejectReason::TooLateToCancel;
+        // Only limit prices can change; a pegged order's follows its peg.
+        if (ev.price && order.type != OrderType::Limit && order.type != OrderType::Iceberg &&
+            order.type != OrderType::StopLimit)
+            return RejectReason::UnexpectedPrice;
+        // The new quantity counts the fills: it has to leave something open.
+        Quantity remaining = ev.quantity - (order.quantity - order.remaining);
+        if (remaining <= 0)
+            return RejectReason::InvalidQuantity;
+        bool stop = order.type == OrderType::Stop || order.type == OrderType::StopLimit;
+        bool moves = (ev.price && *ev.price != *order.price) || remaining > order.remaining;
+        if (moves && !stop && !market->active())
+            return RejectReason::MarketInactive;
+        return RejectReason::None;
+    }
+
+    void MarketProcessor::modify(Order &order, Quantity quantity, std::optional<Price> price)
+    {
+        Quantity remaining = quantity - (order.quantity - order.remaining);
+
+        // A stop waits off the book, under a stop price a modify does not change.
+        if (order.type == OrderType::Stop || order.type == OrderType::StopLimit)
+        {
+            order.quantity = quantity;
+            order.remaining = remaining;
+            if (price)
+                order.price = price;
+            report(ExecType::Replaced, order);
+            return;
+        }
+
+        if ((!price || *price == *order.price) && remaining <= order.remaining)
+        {
+            market->reduce_order(order, quantity, remaining);
+            report(ExecType::Replaced, order);
+            return;
+        }
+
+        Price prevltp = market->get_last_price().value_or(0.0);
+        MERCEX_TIME_BEGIN(match_start);
+        market->replace_order(order, quantity, remaining, price, events_);
+        MERCEX_TIME_END(Match, match_start);
+        report_execution(order, ExecType::Replaced, remaining, events_);
+        handle_market_events();
+
+        if (market->get_last_price().value_or(0.0) != prevltp)
+        {
+            MERCEX_TIME_SCOPE(StopCheck);
+            check_stop_orders();
         }
     }
 
+    void MarketProcessor::execute(Order &order, bool acknowledge)
+    {
+        Quantity leaves_before = order.remaining;
+        MERCEX_TIME_BEGIN(match_start);
+        market->process_order(order, events_);
+        MERCEX_TIME_END(Match, match_start);
+
+        // Whatever did not fill and cannot rest (IOC, FOK, market) is done.
+        bool rests = (order.type == OrderType::Limit || order.type == OrderType::Iceberg ||
+                      order.type == OrderType::Pegged) &&
+                     (order.tif == TimeInForce::Day || order.tif == TimeInForce::GTC);
+        if (order.remaining > 0 && !rests)
+            order.status = OrderStatus::Expired;
+
+        report_execution(order, acknowledge ? std::optional<ExecType>(ExecType::New) : std::nullopt, leaves_before,
+                         events_);
+    }
+
+    bool MarketProcessor::cancel_stop_order(Order *order)
+    {
+        auto remove = [order](auto &stops)
+        {
+            auto level = stops.find(*order->stop_price);
+            if (level == stops.end())
+                return false;
+            auto &orders = level->second;
+            for (auto it = orders.begin(); it != orders.end(); ++it)
+            {
+                if (*it == order)
+                {
+                    orders.erase(it);
+                    if (orders.empty())
+                        stops.erase(level);
+                    return true;
+                }
+            }
+            return false;
+        };
+        return order->side == Side::Buy ? remove(stop_buy_orders_) : remove(stop_sell_orders_);
+    }
+
     void MarketProcessor::check_stop_orders()
     {
         auto ltp_opt = market->get_last_price();
@@ -148,8 +473,8 @@ namespace MercEx
             for (auto *ord : price_level->second)
             {
                 ord->type = (ord->type == OrderType::Stop) ? OrderType::Market : OrderType::Limit;
-                auto events = market->process_order(*ord);
-                handle_market_events(events);
+                execute(*ord, false);
+                handle_market_events();
             }
             stop_buy_orders_.erase(price_level);
         }
@@ -160,17 +485,161 @@ namespace MercEx
             for (auto *ord : price_level->second)
             {
                 ord->type = (ord->type == OrderType::Stop) ? OrderType::Market : OrderType::Limit;
-                auto events = market->process_order(*ord);
-                handle_market_events(events);
+                execute(*ord, false);
+                handle_market_events();
             }
             stop_sell_orders_.erase(price_level);
         }
     }
 
-    void MarketProcessor::handle_market_events(const std::vector<MarketEvent> &events)
+    void MarketProcessor::report(ExecType type, const Order &order, RejectReason reason)
+    {
+        if (!reports_)
+            return;
+        ExecutionReport r{};
+        r.type = type;
+        r.reason = reason;
+        r.side = order.side;
+        r.market_id = market->get_market_id();
+        r.client_id = order.client_id;
+        r.order_id = order.id;
+        r.leaves_qty = order.remaining;
+        r.timestamp = EngineClock::now();
+        reports_->deliver(r, report_producer_);
+    }
+
+    void MarketProcessor::report(ExecType type, OrderID order_id, ClientID client_id, RejectReason reason)
     {
-        if(!events.empty())
-            publisher_.publish(events);
+        if (!reports_)
+            return;
+        ExecutionReport r{};
+        r.type = type;
+        r.reason = reason;
+        r.market_id = market->get_market_id();
+        r.client_id = client_id;
+        r.order_id = order_id;
+        r.timestamp = EngineClock::now();
+        reports_->deliver(r, report_producer_);
+    }
+
+    void MarketProcessor::report_execution(const Order &order, std::optional<ExecType> acknowledge,
+                                           Quantity leaves_before, const std::vector<MarketEvent> &events)
+    {
+        if (!reports_)
+            return;
+
+        ExecutionReport r{};
+        r.market_id = market->get_market_id();
+        r.timestamp = EngineClock::now();
+
+        if (acknowledge)
+        {
+            r.type = *acknowledge;
+            r.side = order.side;
+            r.client_id = order.client_id;
+            r.order_id = order.id;
+            r.leaves_qty = leaves_before;
+            reports_->deliver(r, report_producer_);
+        }
+
+        Quantity leaves = leaves_before;
+        for (const auto &ev : events)
+        {
+            if (ev.type != MarketEventType::Trade)
+                continue;
+
+            leaves -= *ev.executed_qty;
+            r.side = order.side;
+            r.client_id = order.client_id;
+            r.order_id = order.id;
+            r.counterparty_id = *ev.counterparty_id;
+            r.last_qty = *ev.executed_qty;
+            r.last_price = *ev.executed_price;
+            r.leaves_qty = leaves;
+            r.type = leaves == 0 ? ExecType::Fill : ExecType::PartialFill;
+            reports_->deliver(r, report_producer_);
+
+            auto resting = orders_local_.find(*ev.counterparty_id);
+            if (resting != orders_local_.end())
+            {
+                const Order &match = resting->second;
+                r.side = match.side;
+                r.client_id = match.client_id;
+                r.order_id = match.id;
+                r.counterparty_id = order.id;
+                r.leaves_qty = resting_leaves(match, &ev, events);
+                r.type = r.leaves_qty == 0 ? ExecType::Fill : ExecType::PartialFill;
+                reports_->deliver(r, report_producer_);
+            }
+        }
+
+        if (order.status == OrderStatus::Expired)
+        {
+            r.side = order.side;
+            r.client_id = order.client_id;
+            r.order_id = order.id;
+            r.counterparty_id = 0;
+            r.last_qty = 0;
+            r.last_price = 0;
+            r.leaves_qty = 0;
+            r.type = ExecType::Canceled;
+            reports_->deliver(r, report_producer_);
+        }
+    }
+
+    void MarketProcessor::handle_market_events()
+    {
+        if(!events_.empty())
+        {
+            // Listeners key their per-market state on the market ID, which
+            // a trade cannot otherwise give them: it carries no symbol.
+            std::uint64_t trades = 0;
+            const MarketID market_id = market->get_market_id();
+            for (auto &ev : events_)
+            {
+                ev.market_id = market_id;
+                trades += ev.type == MarketEventType::Trade;
+            }
+            metrics_.trades.add(trades);
+
+            MERCEX_TIME_SCOPE(Publish);
+            publisher_.publish(std::move(events_), event_buffers_.get(), publish_token_.get());
+            if (events_.capacity() == 0)
+                next_event_buffer();
+        }
+    }
+
+    void MarketProcessor::next_event_buffer()
+    {
+        if (!event_buffers_)
+        {
+            events_ = publisher_.acquire_buffer();
+            return;
+        }
+        if (event_buffers_->try_acquire(events_))
+            return;
+
+        // Every buffer is in flight: the publisher is event_batches batches
+        // behind. Wait for it rather than allocate. A market being stopped
+        // may outlive the publisher's thread, so it takes a new buffer instead.
+        metrics_.publish_stalls.add();
+        while (!event_buffers_->try_acquire(events_))
+        {
+            if (!running.load(std::memory_order_acquire))
+            {
+                AllocationGuard::Permit permit;
+                events_.reserve(capacity_.events_per_batch);
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    void MarketProcessor::update_depth_gauges()
+    {
+        metrics_.bid_levels.store(market->get_buybook().get_orders().size(), std::memory_order_relaxed);
+        metrics_.ask_levels.store(market->get_sellbook().get_orders().size(), std::memory_order_relaxed);
+        metrics_.stop_levels.store(stop_buy_orders_.size() + stop_sell_orders_.size(), std::memory_order_relaxed);
     }
 
     Market &MarketProcessor::get_market()
@@ -178,6 +647,11 @@ namespace MercEx
         return *market;
     }
 
+    const Market &MarketProcessor::get_market() const
+    {
+        return *market;
+    }
+
     MarketID MarketProcessor::get_market_id() const
     {
         return market->get_market_id();
@@ -1,24 +1,58 @@
 #include "MarketRegistry.hpp"
+#include "OrderCapture.hpp"
 #include <iostream>
 #include <iomanip>
 
 namespace MercEx
 {
 
-    MarketRegistry::MarketRegistry(MarketDataPublisher& publisher) : publisher_(publisher) {}
+    MarketRegistry::MarketRegistry(MarketDataPublisher& publisher, ExecutionReportRouter* reports,
+                                   ExecutionMode mode)
+        : by_id_(new std::atomic<MarketProcessor *>[OrderIdGenerator::kMaxMarkets]()),
+          publisher_(publisher), reports_(reports), mode_(mode) {}
 
-    MarketProcessor &MarketRegistry::create_market(const std::string &symbol, double price_tick, uint16_t market_id)
+    MarketProcessor &MarketRegistry::create_market(const std::string &symbol, double price_tick, uint16_t market_id,
+                                                   const ThreadPlacement &placement, const ArenaConfig &memory,
+                                                   const MarketCapacity &capacity)
     {
         if (processors_.find(symbol) != processors_.end())
         {
             throw std::invalid_argument("Market with symbol already exists");
         }
+        // Capture records carry the symbol in a fixed field; checked here so
+        // capturing an order never has to refuse it.
+        if (symbol.size() > CaptureRecord::kSymbolSize)
+        {
+            throw std::invalid_argument("Market symbol longer than 16 bytes: " + symbol);
+        }
+        for (const auto &pair : processors_)
+        {
+            if (pair.second->get_market_id() == market_id)
+                throw std::invalid_argument("Market with ID already exists");
+        }
+
+        order_ids_.register_market(market_id);
+
+        std::unique_ptr<MarketMemory> market_memory;
+        if (memory.bytes > 0 || !capacity.empty())
+        {
+            ArenaConfig config = memory;
+            if (config.bytes == 0)
+                config.bytes = capacity.arena_bytes();
+            if (config.numa_node < 0)
+                config.numa_node = placement.numa_node >= 0 ? placement.numa_node : numa_node_of_cpu(placement.cpu);
+            market_memory = std::make_unique<MarketMemory>(config);
+        }
+        std::pmr::memory_resource *resource = market_memory ? market_memory->resource() : std::pmr::get_default_resource();
 
-        auto market = std::make_unique<Market>(symbol, price_tick);
-        auto processor = std::make_unique<MarketProcessor>(std::move(market), publisher_);
+        auto market = std::make_unique<Market>(symbol, price_tick, market_id, resource);
+        auto processor = std::make_unique<MarketProcessor>(std::move(market), publisher_, reports_, mode_, placement,
+                                                           std::move(market_memory), capacity);
+        MarketProcessor &created = *processor;
         processors_[symbol] = std::move(processor);
-        processors_[symbol]->start();
-        return *processors_[symbol];
+        created.start();
+        by_id_[market_id].store(&created, std::memory_order_release);
+        return created;
     }
 
     MarketProcessor *MarketRegistry::get_market_processor(const std::string &symbol)
@@ -27,11 +61,17 @@ namespace MercEx
         return it != processors_.end() ? it->second.get() : nullptr;
     }
 
+    MarketProcessor *MarketRegistry::get_market_processor(MarketID market_id)
+    {
+        return by_id_[market_id].load(std::memory_order_acquire);
+    }
+
     bool MarketRegistry::remove_market(const std::string &symbol)
     {
         auto it = processors_.find(symbol);
         if (it != processors_.end())
         {
+            by_id_[it->second->get_market_id()].store(nullptr, std::memory_order_release);
             it->second->stop(); // stop the processor thread
             processors_.erase(it);
             return true;
@@ -39,6 +79,12 @@ namespace MercEx
         return false;
     }
 
+    void MarketRegistry::for_each_market(const std::function<void(const MarketProcessor &)> &fn) const
+    {
+        for (const auto &pair : processors_)
+            fn(*pair.second);
+    }
+
     void MarketRegistry::print_markets() const
     {
         std::cout << "Market Symbol\tLast Price\tBid Price\tAsk Price\n";
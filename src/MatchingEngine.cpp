@@ -1,63 +1,370 @@
 #include "MatchingEngine.hpp"
-#include <stdexcept>
+#include "OrderValidator.hpp"
 #include <chrono>
+#include <iterator>
+#include <string>
 
 namespace MercEx {
 
 MatchingEngine::MatchingEngine(MarketRegistry& registry)
     : registry_(registry) {}
 
-OrderID MatchingEngine::submit_order(ClientID client_id,
-                                     const std::string& symbol,
-                                     Quantity quantity,
-                                     Side side,
-                                     std::optional<Price> price,
-                                     OrderType type,
-                                     TimeInForce tif,
-                                     std::optional<Price> stop_price)
+SubmitResult MatchingEngine::submit_order(ClientID client_id,
+                                          const std::string& symbol,
+                                          Quantity quantity,
+                                          Side side,
+                                          std::optional<Price> price,
+                                          OrderType type,
+                                          TimeInForce tif,
+                                          std::optional<Price> stop_price,
+                                          Quantity display_qty,
+                                          std::optional<Peg> peg)
 {
     auto* processor = registry_.get_market_processor(symbol);
     if (!processor) {
-        throw std::invalid_argument("Unknown market: " + symbol);
+        return {0, RejectReason::UnknownMarket};
     }
+    return submit_new(*processor, generate_order_id(processor->get_market_id()), client_id, quantity, side, price,
+                      type, tif, stop_price, display_qty, peg);
+}
+
+SubmitResult MatchingEngine::submit_order(OrderID id, const OrderRequest& request)
+{
+    auto* processor = registry_.get_market_processor(request.symbol);
+    if (!processor) {
+        return {id, RejectReason::UnknownMarket};
+    }
+    if (OrderIdGenerator::market_of(id) != processor->get_market_id() || !is_reserved(id, request.client_id)) {
+        return {id, RejectReason::InvalidOrder};
+    }
+    return submit_new(*processor, id, request.client_id, request.quantity, request.side, request.price,
+                      request.type, request.tif, request.stop_price, request.display_qty, request.peg);
+}
+
+SubmitResult MatchingEngine::replay_order(OrderID id, const OrderRequest& request)
+{
+    auto* processor = registry_.get_market_processor(request.symbol);
+    if (!processor) {
+        return {id, RejectReason::UnknownMarket};
+    }
+    if (OrderIdGenerator::market_of(id) != processor->get_market_id()) {
+        return {id, RejectReason::InvalidOrder};
+    }
+    registry_.order_ids().claim(id);
+    return submit_new(*processor, id, request.client_id, request.quantity, request.side, request.price,
+                      request.type, request.tif, request.stop_price, request.display_qty, request.peg);
+}
+
+bool MatchingEngine::cancel_order(OrderID id, const std::string& symbol, ClientID client_id) {
+    auto* processor = registry_.get_market_processor(symbol);
+    if (!processor) return false;
+    submit_cancel(*processor, id, client_id);
+    return true;
+}
+
+bool MatchingEngine::modify_order(OrderID id, const std::string& symbol, ClientID client_id, Quantity quantity,
+                                  std::optional<Price> price) {
+    auto* processor = registry_.get_market_processor(symbol);
+    if (!processor) return false;
+    submit_modify(*processor, id, client_id, quantity, price);
+    return true;
+}
+
+SubmitResult MatchingEngine::submit_order(MarketID market_id,
+                                          ClientID client_id,
+                                          Quantity quantity,
+                                          Side side,
+                                          std::optional<Price> price,
+                                          OrderType type,
+                                          TimeInForce tif,
+                                          std::optional<Price> stop_price,
+                                          Quantity display_qty,
+                                          std::optional<Peg> peg)
+{
+    auto* processor = registry_.get_market_processor(market_id);
+    if (!processor) {
+        return {0, RejectReason::UnknownMarket};
+    }
+    return submit_new(*processor, generate_order_id(market_id), client_id, quantity, side, price, type, tif,
+                      stop_price, display_qty, peg);
+}
 
-    MarketID market_id = processor->get_market_id();
-    OrderID id = generate_order_id(market_id);
+bool MatchingEngine::cancel_order(OrderID id, MarketID market_id, ClientID client_id) {
+    auto* processor = registry_.get_market_processor(market_id);
+    if (!processor) return false;
+    submit_cancel(*processor, id, client_id);
+    return true;
+}
 
+bool MatchingEngine::modify_order(OrderID id, MarketID market_id, ClientID client_id, Quantity quantity,
+                                  std::optional<Price> price) {
+    auto* processor = registry_.get_market_processor(market_id);
+    if (!processor) return false;
+    submit_modify(*processor, id, client_id, quantity, price);
+    return true;
+}
+
+SubmitResult MatchingEngine::submit_new(MarketProcessor& processor, OrderID id, ClientID client_id,
+                                        Quantity quantity, Side side, std::optional<Price> price, OrderType type,
+                                        TimeInForce tif, std::optional<Price> stop_price, Quantity display_qty,
+                                        std::optional<Peg> peg) {
     MarketEvent ev;
     ev.type = MarketEventType::AddOrder;
     ev.order_id = id;
     ev.client_id = client_id;
-    ev.symbol = symbol;
+    ev.symbol = processor.get_market().get_symbol();
     ev.quantity = quantity;
     ev.side = side;
     ev.price = price;
     ev.stop_price = stop_price;
     ev.order_type = type;
     ev.tif = tif;
-    ev.timestamp = std::chrono::steady_clock::now();
+    ev.display_qty = display_qty;
+    ev.peg = peg;
+    ev.timestamp = EngineClock::now();
 
-    processor->submit_event(ev);
-
-    return id;
+    capture(processor, ev);
+    if (pre_trade(processor, ev)) {
+        processor.submit_event(ev);
+    }
+    return {id, RejectReason::None};
 }
 
-bool MatchingEngine::cancel_order(OrderID id, const std::string& symbol) {
-    auto* processor = registry_.get_market_processor(symbol);
-    if (!processor) return false;
-
+void MatchingEngine::submit_cancel(MarketProcessor& processor, OrderID id, ClientID client_id) {
     MarketEvent ev;
     ev.type = MarketEventType::CancelOrder;
     ev.order_id = id;
-    ev.timestamp = std::chrono::steady_clock::now();
+    ev.client_id = client_id;
+    ev.symbol = processor.get_market().get_symbol();
+    ev.timestamp = EngineClock::now();
 
-    processor->submit_event(ev);
-    return true;
+    capture(processor, ev);
+    processor.submit_event(ev);
+}
+
+void MatchingEngine::submit_modify(MarketProcessor& processor, OrderID id, ClientID client_id, Quantity quantity,
+                                   std::optional<Price> price) {
+    MarketEvent ev;
+    ev.type = MarketEventType::ModifyOrder;
+    ev.order_id = id;
+    ev.client_id = client_id;
+    ev.symbol = processor.get_market().get_symbol();
+    ev.quantity = quantity;
+    ev.price = price;
+    ev.timestamp = EngineClock::now();
+
+    capture(processor, ev);
+    if (pre_trade(processor, ev)) {
+        processor.submit_event(ev);
+    }
+}
+
+std::vector<SubmitResult> MatchingEngine::submit_orders(const std::vector<OrderRequest>& requests)
+{
+    struct MarketBatch {
+        MarketProcessor* processor;
+        std::size_t count;
+        std::vector<MarketEvent> events;
+    };
+
+    // Resolve every market up front so each batch knows how many IDs to
+    // reserve. A request for an unknown market consumes no ID.
+    constexpr std::size_t kNoMarket = static_cast<std::size_t>(-1);
+    std::vector<MarketBatch> batches;
+    std::vector<std::size_t> batch_of(requests.size());
+    const std::string* last_symbol = nullptr;
+    std::size_t last_batch = 0;
+
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+        const std::string& symbol = requests[i].symbol;
+        if (!last_symbol || *last_symbol != symbol) {
+            last_symbol = &symbol;
+            auto* processor = registry_.get_market_processor(symbol);
+            last_batch = processor ? batches.size() : kNoMarket;
+            for (std::size_t b = 0; b < batches.size(); ++b) {
+                if (batches[b].processor == processor) {
+                    last_batch = b;
+                    break;
+                }
+            }
+            if (processor && last_batch == batches.size()) {
+                batches.push_back({processor, 0, {}});
+            }
+        }
+        batch_of[i] = last_batch;
+        if (last_batch == kNoMarket) {
+            continue;
+        }
+        ++batches[last_batch].count;
+    }
+
+    std::vector<OrderIdBlock> id_blocks(batches.size());
+    for (std::size_t b = 0; b < batches.size(); ++b) {
+        auto& batch = batches[b];
+        id_blocks[b] = registry_.order_ids().reserve(batch.processor->get_market_id(), batch.count);
+        batch.events.reserve(batch.count);
+    }
+
+    auto now = EngineClock::now();
+    std::vector<SubmitResult> results(requests.size());
+
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+        const OrderRequest& req = requests[i];
+        std::size_t b = batch_of[i];
+        if (b == kNoMarket) {
+            results[i].reason = RejectReason::UnknownMarket;
+            continue;
+        }
+        OrderID id = id_blocks[b].take();
+        results[i].order_id = id;
+
+        MarketEvent& ev = batches[b].events.emplace_back();
+        ev.type = MarketEventType::AddOrder;
+        ev.order_id = id;
+        ev.client_id = req.client_id;
+        ev.symbol = req.symbol;
+        ev.quantity = req.quantity;
+        ev.side = req.side;
+        ev.price = req.price;
+        ev.stop_price = req.stop_price;
+        ev.order_type = req.type;
+        ev.tif = req.tif;
+        ev.display_qty = req.display_qty;
+        ev.peg = req.peg;
+        ev.timestamp = now;
+
+        capture(*batches[b].processor, ev);
+        if (!pre_trade(*batches[b].processor, ev)) {
+            batches[b].events.pop_back();
+        }
+    }
+
+    for (auto& batch : batches) {
+        batch.processor->submit_events(batch.events);
+    }
+
+    return results;
+}
+
+std::size_t MatchingEngine::cancel_orders(const std::vector<CancelRequest>& requests)
+{
+    struct MarketBatch {
+        MarketProcessor* processor;
+        std::vector<MarketEvent> events;
+    };
+
+    std::vector<MarketBatch> batches;
+    auto now = EngineClock::now();
+    std::size_t accepted = 0;
+
+    for (const auto& req : requests) {
+        auto* processor = registry_.get_market_processor(req.symbol);
+        if (!processor) continue;
+
+        MarketBatch* batch = nullptr;
+        for (auto& b : batches) {
+            if (b.processor == processor) {
+                batch = &b;
+                break;
+            }
+        }
+        if (!batch) {
+            batch = &batches.emplace_back(MarketBatch{processor, {}});
+        }
+
+        MarketEvent& ev = batch->events.emplace_back();
+        ev.type = MarketEventType::CancelOrder;
+        ev.order_id = req.order_id;
+        ev.client_id = req.client_id;
+        ev.symbol = req.symbol;
+        ev.timestamp = now;
+        capture(*processor, ev);
+        ++accepted;
+    }
+
+    for (auto& batch : batches) {
+        batch.processor->submit_events(batch.events);
+    }
+
+    return accepted;
+}
+
+OrderIdBlock MatchingEngine::reserve_order_ids(const std::string& symbol, ClientID client_id, uint64_t count) {
+    auto* processor = registry_.get_market_processor(symbol);
+    if (!processor) {
+        return {};
+    }
+    std::unique_lock<std::shared_mutex> lock(blocks_mutex_);
+    OrderIdBlock block = registry_.order_ids().reserve(processor->get_market_id(), count);
+    if (block.empty()) {
+        return block;
+    }
+    auto prev = blocks_.lower_bound(block.next);
+    if (prev != blocks_.begin() && std::prev(prev)->second.end == block.next &&
+        std::prev(prev)->second.client_id == client_id) {
+        std::prev(prev)->second.end = block.end;
+    } else {
+        blocks_.emplace_hint(prev, block.next, ReservedBlock{block.end, client_id});
+    }
+    return block;
+}
+
+bool MatchingEngine::is_reserved(OrderID id, ClientID client_id) const {
+    std::shared_lock<std::shared_mutex> lock(blocks_mutex_);
+    auto it = blocks_.upper_bound(id);
+    if (it == blocks_.begin()) {
+        return false;
+    }
+    --it;
+    return id < it->second.end && it->second.client_id == client_id;
 }
 
 OrderID MatchingEngine::generate_order_id(MarketID market_id) {
-    uint64_t counter = market_counters_[market_id].fetch_add(1, std::memory_order_relaxed);
-    return (static_cast<OrderID>(market_id) << 48) | (counter & 0x0000FFFFFFFFFFFFULL);
+    return registry_.order_ids().next(market_id);
+}
+
+void MatchingEngine::capture(const MarketProcessor& processor, const MarketEvent& ev) {
+    if (capture_) {
+        capture_->record(ev, processor.get_market_id(), processor.get_market().get_price_tick());
+    }
+}
+
+bool MatchingEngine::pre_trade(MarketProcessor& processor, MarketEvent& ev) {
+    double tick = processor.get_market().get_price_tick();
+    if (ev.type == MarketEventType::ModifyOrder) {
+        // A refused modify leaves the order as it was: ReplaceRejected, and
+        // the order's side is not known here.
+        RejectReason reason = normalize_modify(ev, tick);
+        if (reason == RejectReason::None) {
+            return true;
+        }
+        reject(ev.order_id, ev.client_id, Side::Buy, reason, ExecType::ReplaceRejected);
+        return false;
+    }
+    RejectReason reason = normalize_order(ev, tick);
+    if (reason == RejectReason::None) {
+        return true;
+    }
+    reject(ev.order_id, ev.client_id, ev.side, reason);
+    return false;
+}
+
+void MatchingEngine::reject(OrderID id, ClientID client_id, Side side, RejectReason reason, ExecType type) {
+    if (type == ExecType::Rejected) {
+        rejected_orders_.value.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (auto* reports = registry_.get_report_router()) {
+        ExecutionReport r{};
+        r.type = type;
+        r.reason = reason;
+        r.side = side;
+        r.market_id = OrderIdGenerator::market_of(id);
+        r.client_id = client_id;
+        r.order_id = id;
+        r.timestamp = EngineClock::now();
+        reports->deliver(r);
+    }
 }
 
 } // namespace MercEx
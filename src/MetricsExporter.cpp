@@ -0,0 +1,164 @@
+#include "MetricsExporter.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace MercEx
+{
+
+    MetricsExporter::MetricsExporter(const MetricsRegistry &metrics, MetricsExporterConfig config)
+        : metrics_(metrics), config_(std::move(config))
+    {
+        if (config_.file_path.empty() && config_.socket_path.empty())
+            throw std::invalid_argument("MetricsExporter needs a file path or a socket path");
+        if (config_.interval <= std::chrono::milliseconds::zero())
+            throw std::invalid_argument("MetricsExporter interval must be positive");
+    }
+
+    MetricsExporter::~MetricsExporter()
+    {
+        stop();
+    }
+
+    void MetricsExporter::start()
+    {
+        if (running_.exchange(true))
+            return;
+        if (!config_.socket_path.empty())
+            open_socket();
+        worker_ = std::thread(&MetricsExporter::run, this);
+    }
+
+    void MetricsExporter::stop()
+    {
+        running_.store(false, std::memory_order_release);
+        if (worker_.joinable())
+            worker_.join();
+#ifndef _WIN32
+        if (listen_fd_ >= 0)
+        {
+            ::close(listen_fd_);
+            ::unlink(config_.socket_path.c_str());
+            listen_fd_ = -1;
+        }
+#endif
+    }
+
+    void MetricsExporter::run()
+    {
+        // Wake at least every 100ms so stop() is prompt even with long intervals.
+        const auto tick = std::min(config_.interval, std::chrono::milliseconds(100));
+        auto next_scrape = std::chrono::steady_clock::now();
+
+        while (running_.load(std::memory_order_acquire))
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= next_scrape)
+            {
+                if (!config_.file_path.empty())
+                    write_file(metrics_.scrape());
+                next_scrape = now + config_.interval;
+            }
+
+#ifndef _WIN32
+            if (listen_fd_ >= 0)
+            {
+                pollfd pfd{listen_fd_, POLLIN, 0};
+                if (::poll(&pfd, 1, static_cast<int>(tick.count())) > 0 && (pfd.revents & POLLIN))
+                {
+                    int client = ::accept(listen_fd_, nullptr, nullptr);
+                    if (client >= 0)
+                    {
+                        serve_client(client);
+                        ::close(client);
+                    }
+                }
+                continue;
+            }
+#endif
+            std::this_thread::sleep_for(tick);
+        }
+
+        // Leave the final values behind for short runs.
+        if (!config_.file_path.empty())
+            write_file(metrics_.scrape());
+    }
+
+    void MetricsExporter::write_file(const std::string &text) const
+    {
+        std::string tmp = config_.file_path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            if (!out)
+            {
+                std::cerr << "[Metrics] cannot write " << tmp << std::endl;
+                return;
+            }
+            out << text;
+        }
+        if (std::rename(tmp.c_str(), config_.file_path.c_str()) != 0)
+            std::cerr << "[Metrics] cannot replace " << config_.file_path << std::endl;
+    }
+
+    void MetricsExporter::open_socket()
+    {
+#ifdef _WIN32
+        throw std::runtime_error("MetricsExporter socket export is not supported on Windows");
+#else
+        sockaddr_un addr{};
+        if (config_.socket_path.size() >= sizeof(addr.sun_path))
+            throw std::invalid_argument("Metrics socket path too long: " + config_.socket_path);
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, config_.socket_path.c_str(), config_.socket_path.size() + 1);
+
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            throw std::runtime_error(std::string("Metrics socket: ") + std::strerror(errno));
+        ::unlink(config_.socket_path.c_str());
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(fd, 8) != 0)
+        {
+            int err = errno;
+            ::close(fd);
+            throw std::runtime_error("Metrics socket " + config_.socket_path + ": " + std::strerror(err));
+        }
+        listen_fd_ = fd;
+#endif
+    }
+
+    void MetricsExporter::serve_client(int client) const
+    {
+#ifndef _WIN32
+        // A stalled reader must not hold up the scrape loop.
+        timeval timeout{1, 0};
+        ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        std::string text = metrics_.scrape();
+        const char *data = text.data();
+        std::size_t left = text.size();
+        while (left > 0)
+        {
+            ssize_t n = ::send(client, data, left, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return;
+            data += n;
+            left -= static_cast<std::size_t>(n);
+        }
+#else
+        (void)client;
+#endif
+    }
+
+}
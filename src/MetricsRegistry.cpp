@@ -0,0 +1,140 @@
+#include "MetricsRegistry.hpp"
+#include "MarketRegistry.hpp"
+#include "MatchingEngine.hpp"
+#include "MarketDataPublisher.hpp"
+#include "ExecutionReportRouter.hpp"
+#include <limits>
+#include <sstream>
+
+namespace MercEx
+{
+
+    void MetricsWriter::family(const std::string &name, MetricType type, const std::string &help)
+    {
+        os_ << "# HELP " << name << " " << help << "\n"
+            << "# TYPE " << name << " " << (type == MetricType::Counter ? "counter" : "gauge") << "\n";
+    }
+
+    void MetricsWriter::write_name(const std::string &name, const std::string &labels)
+    {
+        os_ << name;
+        if (!labels.empty())
+            os_ << "{" << labels << "}";
+        os_ << " ";
+    }
+
+    void MetricsWriter::sample(const std::string &name, std::uint64_t value, const std::string &labels)
+    {
+        write_name(name, labels);
+        os_ << value << "\n";
+    }
+
+    void MetricsWriter::sample(const std::string &name, double value, const std::string &labels)
+    {
+        write_name(name, labels);
+        auto precision = os_.precision(std::numeric_limits<double>::max_digits10);
+        os_ << value << "\n";
+        os_.precision(precision);
+    }
+
+    void MetricsRegistry::add_collector(MetricsCollector collector)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        collectors_.push_back(std::move(collector));
+    }
+
+    void MetricsRegistry::collect(std::ostream &os) const
+    {
+        MetricsWriter writer(os);
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &collector : collectors_)
+            collector(writer);
+    }
+
+    std::string MetricsRegistry::scrape() const
+    {
+        std::ostringstream os;
+        collect(os);
+        return os.str();
+    }
+
+    namespace
+    {
+        std::string market_label(const MarketProcessor &p)
+        {
+            return "market=\"" + p.get_market().get_symbol() + "\"";
+        }
+
+        void market_counter(MetricsWriter &w, const MarketRegistry &markets, const std::string &name,
+                            const std::string &help, const SingleWriterCounter MarketMetrics::*counter)
+        {
+            w.family(name, MetricType::Counter, help);
+            markets.for_each_market([&](const MarketProcessor &p)
+                                    { w.sample(name, (p.metrics().*counter).value(), market_label(p)); });
+        }
+
+        void collect_markets(MetricsWriter &w, const MarketRegistry &markets)
+        {
+            market_counter(w, markets, "mercury_orders_in_total", "Orders processed by the market", &MarketMetrics::orders_in);
+            market_counter(w, markets, "mercury_trades_total", "Trades executed", &MarketMetrics::trades);
+            market_counter(w, markets, "mercury_cancels_total", "Orders canceled on request", &MarketMetrics::cancels);
+            market_counter(w, markets, "mercury_cancel_rejects_total", "Cancel requests rejected", &MarketMetrics::cancel_rejects);
+            market_counter(w, markets, "mercury_modifies_total", "Orders modified on request", &MarketMetrics::modifies);
+            market_counter(w, markets, "mercury_modify_rejects_total", "Modify requests rejected", &MarketMetrics::modify_rejects);
+            market_counter(w, markets, "mercury_market_rejects_total", "Orders rejected by the market", &MarketMetrics::rejects);
+            market_counter(w, markets, "mercury_publish_stalls_total", "Waits for a free market data batch buffer",
+                           &MarketMetrics::publish_stalls);
+
+            w.family("mercury_queue_depth", MetricType::Gauge, "Events waiting in the market queue");
+            markets.for_each_market([&](const MarketProcessor &p)
+                                    { w.sample("mercury_queue_depth", static_cast<std::uint64_t>(p.queue_depth()), market_label(p)); });
+
+            w.family("mercury_book_levels", MetricType::Gauge, "Price levels in the order book");
+            markets.for_each_market([&](const MarketProcessor &p)
+                                    {
+                                        const MarketMetrics &m = p.metrics();
+                                        std::string label = market_label(p);
+                                        w.sample("mercury_book_levels", m.bid_levels.load(std::memory_order_relaxed), label + ",side=\"bid\"");
+                                        w.sample("mercury_book_levels", m.ask_levels.load(std::memory_order_relaxed), label + ",side=\"ask\"");
+                                    });
+
+            w.family("mercury_stop_levels", MetricType::Gauge, "Stop price levels waiting to trigger");
+            markets.for_each_market([&](const MarketProcessor &p)
+                                    { w.sample("mercury_stop_levels", p.metrics().stop_levels.load(std::memory_order_relaxed), market_label(p)); });
+        }
+
+        void collect_engine(MetricsWriter &w, const MatchingEngine &engine)
+        {
+            w.family("mercury_pretrade_rejects_total", MetricType::Counter, "Orders rejected by pre-trade validation");
+            w.sample("mercury_pretrade_rejects_total", engine.rejected_orders());
+        }
+
+        void collect_publisher(MetricsWriter &w, const MarketDataPublisher &publisher)
+        {
+            w.family("mercury_publisher_pending_batches", MetricType::Gauge, "Event batches waiting for the market data publisher");
+            w.sample("mercury_publisher_pending_batches", static_cast<std::uint64_t>(publisher.pending_batches()));
+            w.family("mercury_publisher_events_total", MetricType::Counter, "Market data events dispatched to listeners");
+            w.sample("mercury_publisher_events_total", publisher.dispatched_events());
+        }
+
+        void collect_reports(MetricsWriter &w, const ExecutionReportRouter &reports)
+        {
+            w.family("mercury_reports_dropped_total", MetricType::Counter, "Execution reports dropped for clients without a session");
+            w.sample("mercury_reports_dropped_total", reports.dropped_reports());
+        }
+    }
+
+    void register_engine_metrics(MetricsRegistry &metrics, const MarketRegistry &markets,
+                                 const MatchingEngine *engine, const MarketDataPublisher *publisher,
+                                 const ExecutionReportRouter *reports)
+    {
+        metrics.add_collector([&markets](MetricsWriter &w) { collect_markets(w, markets); });
+        if (engine)
+            metrics.add_collector([engine](MetricsWriter &w) { collect_engine(w, *engine); });
+        if (publisher)
+            metrics.add_collector([publisher](MetricsWriter &w) { collect_publisher(w, *publisher); });
+        if (reports)
+            metrics.add_collector([reports](MetricsWriter &w) { collect_reports(w, *reports); });
+    }
+
+}
@@ -1,4 +1,5 @@
 #include "../include/Order.hpp"
+#include "../include/EngineClock.hpp"
 #include <stdexcept>
 #include <sstream>
 #include <chrono>
@@ -30,6 +31,10 @@ namespace MercEx
             return "Market";
         case OrderType::Stop:
             return "Stop";
+        case OrderType::Iceberg:
+            return "Iceberg";
+        case OrderType::Pegged:
+            return "Pegged";
         default:
             throw std::invalid_argument("Invalid OrderType value");
         }
@@ -52,6 +57,21 @@ namespace MercEx
         }
     }
 
+    std::string to_string(PegReference reference)
+    {
+        switch (reference)
+        {
+        case PegReference::BestBid:
+            return "BestBid";
+        case PegReference::BestAsk:
+            return "BestAsk";
+        case PegReference::Mid:
+            return "Mid";
+        default:
+            throw std::invalid_argument("Invalid PegReference value");
+        }
+    }
+
     std::string to_string(OrderStatus status)
     {
         switch (status)
@@ -66,6 +86,8 @@ namespace MercEx
             return "Canceled";
         case OrderStatus::Expired:
             return "Expired";
+        case OrderStatus::Rejected:
+            return "Rejected";
         default:
             throw std::invalid_argument("Invalid OrderStatus value");
         }
@@ -105,6 +127,10 @@ namespace MercEx
             return OrderType::Market;
         if (str == "Stop")
             return OrderType::Stop;
+        if (str == "Iceberg")
+            return OrderType::Iceberg;
+        if (str == "Pegged")
+            return OrderType::Pegged;
         throw std::invalid_argument("Invalid OrderType string");
     }
 
@@ -121,6 +147,34 @@ namespace MercEx
         throw std::invalid_argument("Invalid TimeInForce string");
     }
 
+    Order Order::make(OrderID id, ClientID client_id, const std::string &symbol,
+                      Quantity quantity, std::optional<Price> price, std::optional<Price> stop_price,
+                      Side side, OrderType type, TimeInForce tif)
+    {
+        Order o;
+        o.id = id;
+        o.client_id = client_id;
+        o.symbol = symbol;
+        o.timestamp = EngineClock::now();
+        o.quantity = quantity;
+        o.remaining = quantity;
+        o.price = price;
+        o.stop_price = stop_price;
+        o.side = side;
+        o.type = type;
+        o.tif = tif;
+        o.status = OrderStatus::New;
+        o.book_it = {};
+        return o;
+    }
+
+    std::unique_ptr<Order> Order::make_order(OrderID id, ClientID client_id, const std::string &symbol,
+                                             Quantity quantity, std::optional<Price> price, std::optional<Price> stop_price,
+                                             Side side, OrderType type, TimeInForce tif)
+    {
+        return std::make_unique<Order>(make(id, client_id, symbol, quantity, price, stop_price, side, type, tif));
+    }
+
     std::unique_ptr<Order> Order::make_limit_order(OrderID id, ClientID client_id, const std::string &symbol,
                                   Quantity quantity, Price price, Side side, TimeInForce tif)
     {
@@ -128,7 +182,7 @@ namespace MercEx
         o->id = id;
         o->client_id = client_id;
         o->symbol = symbol;
-        o->timestamp = Clock::now();
+        o->timestamp = EngineClock::now();
         o->quantity = quantity;
         o->remaining = quantity;
         o->price = price;
@@ -149,7 +203,7 @@ namespace MercEx
         o->id = id;
         o->client_id = client_id;
         o->symbol = symbol;
-        o->timestamp = Clock::now();
+        o->timestamp = EngineClock::now();
         o->quantity = quantity;
         o->remaining = quantity;
         o->price = std::nullopt;
@@ -170,7 +224,7 @@ namespace MercEx
         o->id = id;
         o->client_id = client_id;
         o->symbol = symbol;
-        o->timestamp = Clock::now();
+        o->timestamp = EngineClock::now();
         o->quantity = quantity;
         o->remaining = quantity;
         o->price = price;
@@ -191,7 +245,7 @@ namespace MercEx
         o->id = id;
         o->client_id = client_id;
         o->symbol = symbol;
-        o->timestamp = Clock::now();
+        o->timestamp = EngineClock::now();
         o->quantity = quantity;
         o->remaining = quantity;
         o->price = std::nullopt;
@@ -204,20 +258,32 @@ namespace MercEx
         o->validate();
         return o;
     }
-    void Order::validate() const
+    RejectReason Order::check() const noexcept
     {
         if (symbol.empty())
-            throw std::invalid_argument("Order.symbol empty");
+            return RejectReason::InvalidOrder;
         if (quantity <= 0)
-            throw std::invalid_argument("Order.quantity must be > 0");
+            return RejectReason::InvalidQuantity;
         if (remaining < 0 || remaining > quantity)
-            throw std::invalid_argument("Order.remaining out of range");
-        if (type == OrderType::Limit && !price.has_value())
-            throw std::invalid_argument("Limit order must have price");
+            return RejectReason::InvalidQuantity;
+        if ((type == OrderType::Limit || type == OrderType::Iceberg) && !price.has_value())
+            return RejectReason::MissingPrice;
+        if (type == OrderType::Iceberg && (display_qty <= 0 || display_qty > quantity))
+            return RejectReason::InvalidDisplayQuantity;
+        if (type == OrderType::Pegged && !peg.has_value())
+            return RejectReason::InvalidOrder;
         if (type == OrderType::Market && price.has_value())
-            throw std::invalid_argument("Market order must not have price");
+            return RejectReason::UnexpectedPrice;
         if (price.has_value() && *price <= 0)
-            throw std::invalid_argument("Order.price must be > 0");
+            return RejectReason::InvalidPrice;
+        return RejectReason::None;
+    }
+
+    void Order::validate() const
+    {
+        RejectReason reason = check();
+        if (reason != RejectReason::None)
+            throw std::invalid_argument("Invalid order: " + to_string(reason));
     }
 
 }
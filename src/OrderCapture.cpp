@@ -0,0 +1,297 @@
+#include "OrderCapture.hpp"
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include "UringJournal.hpp"
+#else
+namespace MercEx
+{
+    // Only named by CaptureWriter's members; never constructed off Linux.
+    class UringJournal {};
+}
+#endif
+
+namespace MercEx
+{
+
+    namespace
+    {
+        std::int64_t to_ns(TimePoint ts)
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(ts.time_since_epoch()).count();
+        }
+    }
+
+    std::string CaptureRecord::get_symbol() const
+    {
+        return std::string(symbol, strnlen(symbol, kSymbolSize));
+    }
+
+    bool CaptureRecord::to_request(OrderRequest &req) const
+    {
+        req = OrderRequest{};
+        req.client_id = client_id;
+        req.symbol = get_symbol();
+        req.quantity = quantity;
+        req.side = side;
+        if (flags & kHasPeg)
+            req.peg = Peg{peg_reference, price};
+        else if (flags & kHasPrice)
+            req.price = price;
+        if (flags & kHasStopPrice)
+            req.stop_price = stop_price;
+        if (flags & kHasDisplayQty)
+        {
+            // Read back from a file, so range-checked before the conversion.
+            if (!(stop_price >= std::numeric_limits<Quantity>::min() &&
+                  stop_price <= std::numeric_limits<Quantity>::max()) ||
+                stop_price != std::trunc(stop_price))
+                return false;
+            req.display_qty = static_cast<Quantity>(stop_price);
+        }
+        req.type = order_type;
+        req.tif = tif;
+        return true;
+    }
+
+    CaptureRecord make_capture_record(CaptureRecordType type, OrderID id, MarketID market_id,
+                                      const std::string &symbol, TimePoint ts)
+    {
+        CaptureRecord r{};
+        r.timestamp_ns = to_ns(ts);
+        r.order_id = id;
+        r.market_id = market_id;
+        r.type = type;
+        std::memcpy(r.symbol, symbol.data(), std::min(symbol.size(), CaptureRecord::kSymbolSize));
+        return r;
+    }
+
+    CaptureWriter::CaptureWriter(const std::string &path, CaptureBackend backend)
+        : defined_(std::size_t(std::numeric_limits<MarketID>::max()) + 1)
+    {
+        CaptureFileHeader header{};
+        std::memcpy(header.magic, CaptureFileHeader::kMagic, sizeof(header.magic));
+        header.version = CaptureFileHeader::kVersion;
+        header.record_size = sizeof(CaptureRecord);
+
+        if (backend != CaptureBackend::Stdio)
+        {
+#ifdef __linux__
+            journal_ = std::make_unique<UringJournal>(path, backend == CaptureBackend::IoUringDurable);
+            journal_->append(&header, sizeof(header));
+            return;
+#else
+            throw std::runtime_error("io_uring capture requires Linux");
+#endif
+        }
+
+        file_ = std::fopen(path.c_str(), "wb");
+        if (!file_)
+            throw std::runtime_error("Cannot open capture file: " + path);
+        std::setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+        std::fwrite(&header, sizeof(header), 1, file_);
+    }
+
+    CaptureWriter::~CaptureWriter()
+    {
+        if (file_)
+            std::fclose(file_);
+    }
+
+    void CaptureWriter::define_market_locked(MarketID market_id, double price_tick, const std::string &symbol, TimePoint ts)
+    {
+        if (defined_[market_id])
+            return;
+        CaptureRecord r = make_capture_record(CaptureRecordType::DefineMarket, 0, market_id, symbol, ts);
+        r.price = price_tick;
+        write_locked(r);
+        defined_[market_id] = true;
+    }
+
+    void CaptureWriter::write_locked(const CaptureRecord &record)
+    {
+#ifdef __linux__
+        if (journal_)
+        {
+            journal_->append(&record, sizeof(record));
+            ++records_;
+            return;
+        }
+#endif
+        if (std::fwrite(&record, sizeof(record), 1, file_) != 1)
+            throw std::runtime_error("Capture write failed");
+        ++records_;
+    }
+
+    void CaptureWriter::record(const MarketEvent &ev, MarketID market_id, double price_tick)
+    {
+        CaptureRecordType type;
+        switch (ev.type)
+        {
+        case MarketEventType::AddOrder:
+            type = CaptureRecordType::Submit;
+            break;
+        case MarketEventType::CancelOrder:
+            type = CaptureRecordType::Cancel;
+            break;
+        case MarketEventType::ModifyOrder:
+            type = CaptureRecordType::Modify;
+            break;
+        default:
+            return;
+        }
+
+        CaptureRecord r = make_capture_record(type, ev.order_id, market_id, ev.symbol, ev.timestamp);
+        r.client_id = ev.client_id;
+        if (type == CaptureRecordType::Modify)
+        {
+            r.quantity = ev.quantity;
+            if (ev.price)
+            {
+                r.price = *ev.price;
+                r.flags |= CaptureRecord::kHasPrice;
+            }
+        }
+        else if (type == CaptureRecordType::Submit)
+        {
+            r.quantity = ev.quantity;
+            r.side = ev.side;
+            r.order_type = ev.order_type.value_or(OrderType::Limit);
+            r.tif = ev.tif.value_or(TimeInForce::Day);
+            // Pegged orders take no price, so the slot carries the offset.
+            if (r.order_type == OrderType::Pegged && ev.peg && !ev.price)
+            {
+                r.price = ev.peg->offset;
+                r.peg_reference = ev.peg->reference;
+                r.flags |= CaptureRecord::kHasPeg;
+            }
+            else if (ev.price)
+            {
+                r.price = *ev.price;
+                r.flags |= CaptureRecord::kHasPrice;
+            }
+            // Icebergs take no stop price (pre-trade drops one), so the slot
+            // carries their display quantity and the record keeps its size.
+            if (r.order_type == OrderType::Iceberg)
+            {
+                r.stop_price = ev.display_qty;
+                r.flags |= CaptureRecord::kHasDisplayQty;
+            }
+            else if (ev.stop_price)
+            {
+                r.stop_price = *ev.stop_price;
+                r.flags |= CaptureRecord::kHasStopPrice;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        define_market_locked(market_id, price_tick, ev.symbol, ev.timestamp);
+        write_locked(r);
+    }
+
+    void CaptureWriter::append(const CaptureRecord &record)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (record.type == CaptureRecordType::DefineMarket)
+            defined_[record.market_id] = true;
+        write_locked(record);
+    }
+
+    void CaptureWriter::flush()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+#ifdef __linux__
+        if (journal_)
+        {
+            journal_->flush();
+            return;
+        }
+#endif
+        std::fflush(file_);
+    }
+
+    CaptureReader::CaptureReader(const std::string &path)
+    {
+        const unsigned char *data = nullptr;
+        std::size_t size = 0;
+
+#if !defined(_WIN32)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Cannot open capture file: " + path);
+        struct stat st{};
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat capture file: " + path);
+        }
+        size = static_cast<std::size_t>(st.st_size);
+        if (size > 0)
+        {
+            mapping_ = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            if (mapping_ == MAP_FAILED)
+            {
+                mapping_ = nullptr;
+                ::close(fd);
+                throw std::runtime_error("Cannot map capture file: " + path);
+            }
+            ::madvise(mapping_, size, MADV_SEQUENTIAL);
+            mapping_size_ = size;
+            data = static_cast<const unsigned char *>(mapping_);
+        }
+        ::close(fd);
+#else
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            throw std::runtime_error("Cannot open capture file: " + path);
+        buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        data = buffer_.data();
+        size = buffer_.size();
+#endif
+
+        // The destructor does not run for a constructor that throws, so the
+        // mapping is released here.
+        auto reject = [&](const char *what)
+        {
+#if !defined(_WIN32)
+            if (mapping_)
+                ::munmap(mapping_, mapping_size_);
+            mapping_ = nullptr;
+#endif
+            throw std::runtime_error(what + path);
+        };
+
+        CaptureFileHeader header{};
+        if (size < sizeof(header))
+            reject("Capture file too short: ");
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, CaptureFileHeader::kMagic, sizeof(header.magic)) != 0)
+            reject("Not a capture file: ");
+        if (header.version != CaptureFileHeader::kVersion || header.record_size != sizeof(CaptureRecord))
+            reject("Unsupported capture file version: ");
+
+        records_ = reinterpret_cast<const CaptureRecord *>(data + sizeof(header));
+        count_ = (size - sizeof(header)) / sizeof(CaptureRecord);
+    }
+
+    CaptureReader::~CaptureReader()
+    {
+#if !defined(_WIN32)
+        if (mapping_)
+            ::munmap(mapping_, mapping_size_);
+#endif
+    }
+
+}
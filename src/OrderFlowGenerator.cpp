@@ -0,0 +1,265 @@
+#include "OrderFlowGenerator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace MercEx
+{
+
+    namespace
+    {
+        // Decisions compare a 16-bit random field against p scaled to 2^16.
+        std::uint32_t probability_threshold(double p)
+        {
+            return static_cast<std::uint32_t>(std::clamp(p, 0.0, 1.0) * 65536.0);
+        }
+    }
+
+    OrderFlowGenerator::OrderFlowGenerator(OrderFlowConfig config)
+        : config_(std::move(config)), rng_(config_.seed ? config_.seed : 1), now_ns_(static_cast<double>(config_.start_ns))
+    {
+        if (config_.symbols.empty())
+            throw std::invalid_argument("OrderFlowGenerator needs at least one symbol");
+        if (config_.orders_per_second <= 0)
+            throw std::invalid_argument("orders_per_second must be positive");
+
+        double total_weight = 0;
+        for (const auto &sym : config_.symbols)
+            total_weight += sym.weight;
+
+        if (config_.symbols.size() > kTableSize)
+            throw std::invalid_argument("OrderFlowGenerator supports at most 4096 symbols");
+        for (const auto &sym : config_.symbols)
+        {
+            if (sym.symbol.size() > CaptureRecord::kSymbolSize)
+                throw std::invalid_argument("Symbol longer than 16 bytes: " + sym.symbol);
+        }
+
+        std::vector<double> cumulative;
+        double running = 0;
+        for (const auto &sym : config_.symbols)
+        {
+            SymbolState s;
+            s.prototype = make_capture_record(CaptureRecordType::Submit, 0, sym.market_id, sym.symbol, TimePoint{});
+            s.price_tick = sym.price_tick;
+            double per_unit = std::round(1.0 / sym.price_tick);
+            s.ticks_per_unit = (per_unit >= 1.0 && std::fabs(per_unit * sym.price_tick - 1.0) <= 1e-12) ? per_unit : 0.0;
+            s.mid_ticks = std::llround(sym.mid_price / sym.price_tick);
+            s.live.resize(kLiveOrders);
+            symbols_.push_back(std::move(s));
+
+            running += sym.weight / total_weight;
+            cumulative.push_back(running);
+        }
+
+        // Symbol choice is a table lookup rather than a search, so the
+        // random symbol sequence costs no branch mispredictions. Weights
+        // resolve to 1/kTableSize of the aggregate rate.
+        std::size_t sym = 0;
+        for (std::size_t i = 0; i < kTableSize; ++i)
+        {
+            double u = (i + 0.5) / kTableSize;
+            while (sym + 1 < cumulative.size() && u >= cumulative[sym])
+                ++sym;
+            symbol_table_[i] = static_cast<std::uint16_t>(sym);
+        }
+
+        // Inverse-CDF tables sampled at bucket midpoints: exponential
+        // inter-arrival gaps with mean 1 and geometric passive depths.
+        double p_step = config_.depth_ticks > 1.0 ? 1.0 / config_.depth_ticks : 1.0;
+        for (std::size_t i = 0; i < kTableSize; ++i)
+        {
+            double u = (i + 0.5) / kTableSize;
+            exponential_[i] = -std::log(u);
+            double depth = p_step >= 1.0 ? 1.0 : std::ceil(std::log(u) / std::log(1.0 - p_step));
+            depth_[i] = static_cast<std::uint16_t>(std::clamp(depth, 1.0, 65535.0));
+        }
+
+        double requests = 1.0 + config_.cancel_to_add + config_.modify_to_add;
+        cancel_threshold_ = probability_threshold(config_.cancel_to_add / requests);
+        modify_threshold_ = probability_threshold((config_.cancel_to_add + config_.modify_to_add) / requests);
+        const FlowMix &mix = config_.mix;
+        double mix_total = mix.limit + mix.market + mix.stop + mix.stop_limit;
+        type_thresholds_[0] = probability_threshold(mix.limit / mix_total);
+        type_thresholds_[1] = probability_threshold((mix.limit + mix.market) / mix_total);
+        type_thresholds_[2] = probability_threshold((mix.limit + mix.market + mix.stop) / mix_total);
+        aggressive_threshold_ = probability_threshold(config_.aggressive_fraction);
+        mid_move_threshold_ = probability_threshold(config_.mid_move_probability);
+        burst_threshold_ = probability_threshold(config_.burst_probability);
+        mean_gap_ns_ = 1e9 / config_.orders_per_second;
+        burst_gap_ns_ = mean_gap_ns_ / std::max(config_.burst_rate_multiplier, 1.0);
+    }
+
+    std::vector<CaptureRecord> OrderFlowGenerator::market_definitions() const
+    {
+        std::vector<CaptureRecord> defs;
+        for (std::size_t i = 0; i < symbols_.size(); ++i)
+        {
+            CaptureRecord r = symbols_[i].prototype;
+            r.type = CaptureRecordType::DefineMarket;
+            r.timestamp_ns = config_.start_ns;
+            r.price = config_.symbols[i].price_tick;
+            defs.push_back(r);
+        }
+        return defs;
+    }
+
+    std::uint64_t OrderFlowGenerator::next_random(std::uint64_t &state)
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    }
+
+    double OrderFlowGenerator::price_of(const SymbolState &s, std::int64_t ticks) const
+    {
+        ticks = std::max<std::int64_t>(ticks, 1);
+        return s.ticks_per_unit > 0 ? ticks / s.ticks_per_unit : ticks * s.price_tick;
+    }
+
+    void OrderFlowGenerator::make_add(SymbolState &s, CaptureRecord &r, std::uint64_t bits, std::uint64_t aux)
+    {
+        // bits: [0,16) type, 16 side, [17,29) depth, [29,45) aggressive, [48,64) quantity
+        std::uint32_t type_draw = bits & 0xFFFF;
+        bool buy = (bits >> 16) & 1;
+        std::int64_t depth = depth_[(bits >> 17) & (kTableSize - 1)];
+        bool aggressive = ((bits >> 29) & 0xFFFF) < aggressive_threshold_;
+
+        r.type = CaptureRecordType::Submit;
+        r.order_id = (static_cast<OrderID>(r.market_id) << OrderIdGenerator::kSequenceBits) | s.next_seq++;
+        r.side = buy ? Side::Buy : Side::Sell;
+        r.quantity = 1 + static_cast<Quantity>(((bits >> 48) * config_.max_quantity) >> 16);
+        r.client_id = 1 + static_cast<ClientID>(((aux >> 32) * config_.clients) >> 32);
+        r.flags = 0;
+
+        std::int64_t sign = buy ? 1 : -1;
+        bool cancellable = true;
+        if (type_draw < type_thresholds_[0])
+        {
+            r.order_type = OrderType::Limit;
+            std::int64_t offset = aggressive ? std::min<std::int64_t>(depth, 3) : -depth;
+            r.price = price_of(s, s.mid_ticks + sign * offset);
+            r.flags = CaptureRecord::kHasPrice;
+            r.tif = aggressive ? TimeInForce::IOC : TimeInForce::GTC;
+            cancellable = !aggressive;
+        }
+        else if (type_draw < type_thresholds_[1])
+        {
+            r.order_type = OrderType::Market;
+            r.tif = TimeInForce::IOC;
+            cancellable = false;
+        }
+        else
+        {
+            // Stops sit beyond the touch on the side a move would trigger.
+            r.order_type = type_draw < type_thresholds_[2] ? OrderType::Stop : OrderType::StopLimit;
+            r.stop_price = price_of(s, s.mid_ticks + sign * depth);
+            r.flags = CaptureRecord::kHasStopPrice;
+            if (r.order_type == OrderType::StopLimit)
+            {
+                r.price = price_of(s, s.mid_ticks + sign * (depth + 2));
+                r.flags |= CaptureRecord::kHasPrice;
+            }
+            r.tif = TimeInForce::GTC;
+        }
+
+        if (cancellable)
+        {
+            if (s.live_count < kLiveOrders)
+                s.live[s.live_count++] = {r.order_id, r.client_id, r.side};
+            else
+                s.live[(aux >> 17) & (kLiveOrders - 1)] = {r.order_id, r.client_id, r.side};
+        }
+    }
+
+    bool OrderFlowGenerator::make_cancel(SymbolState &s, CaptureRecord &r, std::uint64_t bits)
+    {
+        if (s.live_count == 0)
+            return false;
+        std::size_t pick = static_cast<std::size_t>(((bits >> 32) * s.live_count) >> 32);
+        r.type = CaptureRecordType::Cancel;
+        r.order_id = s.live[pick].order_id;
+        r.client_id = s.live[pick].client_id;
+        s.live[pick] = s.live[--s.live_count];
+        return true;
+    }
+
+    bool OrderFlowGenerator::make_modify(SymbolState &s, CaptureRecord &r, std::uint64_t bits)
+    {
+        // bits: [0,16) quantity, 16 reprice, [17,29) depth, [32,64) pick
+        if (s.live_count == 0)
+            return false;
+        std::size_t pick = static_cast<std::size_t>(((bits >> 32) * s.live_count) >> 32);
+        const LiveOrder &order = s.live[pick];
+        r.type = CaptureRecordType::Modify;
+        r.order_id = order.order_id;
+        r.client_id = order.client_id;
+        r.quantity = 1 + static_cast<Quantity>(((bits & 0xFFFF) * config_.max_quantity) >> 16);
+        r.flags = 0;
+        if ((bits >> 16) & 1)
+        {
+            std::int64_t depth = depth_[(bits >> 17) & (kTableSize - 1)];
+            r.price = price_of(s, s.mid_ticks - (order.side == Side::Buy ? depth : -depth));
+            r.flags = CaptureRecord::kHasPrice;
+        }
+        return true;
+    }
+
+    void OrderFlowGenerator::generate(CaptureRecord *out, std::size_t count)
+    {
+        // The stream state lives in locals for the loop. As members, every
+        // record written through out (a char array inside may alias anything)
+        // forced the RNG state and clock back to memory, putting a
+        // store-to-load round trip on each of the three dependent draws.
+        std::uint64_t rng = rng_;
+        double now_ns = now_ns_;
+        std::uint32_t burst_remaining = burst_remaining_;
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            // bits: [0,12) gap, [12,24) symbol, [28,44) cancel/modify, [44,60) burst,
+            // 60 mid move direction
+            std::uint64_t bits = next_random(rng);
+
+            double gap = exponential_[bits & (kTableSize - 1)];
+            if (burst_remaining)
+            {
+                now_ns += gap * burst_gap_ns_;
+                --burst_remaining;
+            }
+            else
+            {
+                now_ns += gap * mean_gap_ns_;
+                if (((bits >> 44) & 0xFFFF) < burst_threshold_)
+                    burst_remaining = config_.burst_length;
+            }
+
+            SymbolState &s = symbols_[symbol_table_[(bits >> 12) & (kTableSize - 1)]];
+
+            CaptureRecord &r = out[i];
+            r = s.prototype;
+            r.timestamp_ns = static_cast<std::int64_t>(now_ns);
+
+            // aux: [0,16) mid move, [17,33) live slot, [32,64) client
+            std::uint64_t aux = next_random(rng);
+            if ((aux & 0xFFFF) < mid_move_threshold_)
+                s.mid_ticks = std::max<std::int64_t>(s.mid_ticks + ((bits >> 60) & 1 ? 1 : -1), 2);
+
+            std::uint64_t order_bits = next_random(rng);
+            std::uint32_t request = (bits >> 28) & 0xFFFF;
+            bool done = false;
+            if (request < cancel_threshold_)
+                done = make_cancel(s, r, order_bits);
+            else if (request < modify_threshold_)
+                done = make_modify(s, r, order_bits);
+            if (!done)
+                make_add(s, r, order_bits, aux);
+        }
+
+        rng_ = rng;
+        now_ns_ = now_ns;
+        burst_remaining_ = burst_remaining;
+    }
+
+}
@@ -0,0 +1,62 @@
+#include "OrderIdGenerator.hpp"
+#include <stdexcept>
+#include <string>
+
+namespace MercEx
+{
+
+    OrderIdGenerator::OrderIdGenerator() : counters_(new std::atomic<Counter *>[kMaxMarkets]())
+    {
+    }
+
+    OrderIdGenerator::~OrderIdGenerator()
+    {
+        for (std::size_t i = 0; i < kMaxMarkets; ++i)
+            delete counters_[i].load(std::memory_order_relaxed);
+    }
+
+    void OrderIdGenerator::register_market(MarketID market_id)
+    {
+        // Counters survive market removal so a re-created market never reissues IDs.
+        if (!counters_[market_id].load(std::memory_order_relaxed))
+            counters_[market_id].store(new Counter, std::memory_order_release);
+    }
+
+    bool OrderIdGenerator::is_registered(MarketID market_id) const
+    {
+        return counters_[market_id].load(std::memory_order_acquire) != nullptr;
+    }
+
+    OrderIdGenerator::Counter &OrderIdGenerator::counter(MarketID market_id)
+    {
+        Counter *c = counters_[market_id].load(std::memory_order_acquire);
+        if (!c)
+            throw std::invalid_argument("Market ID not registered: " + std::to_string(market_id));
+        return *c;
+    }
+
+    OrderID OrderIdGenerator::next(MarketID market_id)
+    {
+        return reserve(market_id, 1).next;
+    }
+
+    OrderIdBlock OrderIdGenerator::reserve(MarketID market_id, std::uint64_t count)
+    {
+        std::uint64_t first = counter(market_id).value.fetch_add(count, std::memory_order_relaxed);
+        if (first + count > kSequenceMask + 1)
+            throw std::overflow_error("Order ID space exhausted for market " + std::to_string(market_id));
+
+        OrderID base = static_cast<OrderID>(market_id) << kSequenceBits;
+        return {base | first, (base | first) + count};
+    }
+
+    void OrderIdGenerator::claim(OrderID id)
+    {
+        std::atomic<std::uint64_t> &value = counter(market_of(id)).value;
+        std::uint64_t next = (id & kSequenceMask) + 1;
+        std::uint64_t current = value.load(std::memory_order_relaxed);
+        while (current < next && !value.compare_exchange_weak(current, next, std::memory_order_relaxed))
+            ;
+    }
+
+} // namespace MercEx
@@ -0,0 +1,170 @@
+#include "OrderValidator.hpp"
+#include <cmath>
+#include <stdexcept>
+
+namespace MercEx
+{
+
+    std::string to_string(RejectReason reason)
+    {
+        switch (reason)
+        {
+        case RejectReason::None:
+            return "None";
+        case RejectReason::InvalidOrder:
+            return "InvalidOrder";
+        case RejectReason::UnknownMarket:
+            return "UnknownMarket";
+        case RejectReason::MarketInactive:
+            return "MarketInactive";
+        case RejectReason::InvalidQuantity:
+            return "InvalidQuantity";
+        case RejectReason::MissingPrice:
+            return "MissingPrice";
+        case RejectReason::UnexpectedPrice:
+            return "UnexpectedPrice";
+        case RejectReason::InvalidPrice:
+            return "InvalidPrice";
+        case RejectReason::OffTickPrice:
+            return "OffTickPrice";
+        case RejectReason::MissingStopPrice:
+            return "MissingStopPrice";
+        case RejectReason::InvalidStopPrice:
+            return "InvalidStopPrice";
+        case RejectReason::UnknownOrder:
+            return "UnknownOrder";
+        case RejectReason::TooLateToCancel:
+            return "TooLateToCancel";
+        case RejectReason::InvalidDisplayQuantity:
+            return "InvalidDisplayQuantity";
+        case RejectReason::InvalidPegOffset:
+            return "InvalidPegOffset";
+        case RejectReason::NoReferencePrice:
+            return "NoReferencePrice";
+        default:
+            throw std::invalid_argument("Invalid RejectReason value");
+        }
+    }
+
+    bool is_on_tick(Price price, double price_tick) noexcept
+    {
+        // Compare in tick units with a relative tolerance so binary rounding of
+        // decimal prices (0.07 / 0.01 = 7.000000000000001) is not an off-tick.
+        double ticks = price / price_tick;
+        return std::fabs(ticks - std::round(ticks)) <= 1e-9 * std::fmax(1.0, std::fabs(ticks));
+    }
+
+    Price snap_to_tick(Price price, double price_tick) noexcept
+    {
+        double ticks = std::round(price / price_tick);
+        // Dividing by an integral ticks-per-unit gives the correctly rounded
+        // decimal (3 / 10 == 0.3, whereas 3 * 0.1 == 0.30000000000000004).
+        double per_unit = std::round(1.0 / price_tick);
+        if (per_unit >= 1.0 && std::fabs(per_unit * price_tick - 1.0) <= 1e-12)
+            return ticks / per_unit;
+        return ticks * price_tick;
+    }
+
+    RejectReason check_order(Quantity quantity, std::optional<Price> price, std::optional<Price> stop_price,
+                             OrderType type, double price_tick, Quantity display_qty,
+                             const std::optional<Peg> &peg) noexcept
+    {
+        if (quantity <= 0)
+            return RejectReason::InvalidQuantity;
+
+        switch (type)
+        {
+        case OrderType::Limit:
+        case OrderType::StopLimit:
+            if (!price)
+                return RejectReason::MissingPrice;
+            break;
+        case OrderType::Iceberg:
+            if (!price)
+                return RejectReason::MissingPrice;
+            if (display_qty <= 0 || display_qty > quantity)
+                return RejectReason::InvalidDisplayQuantity;
+            break;
+        case OrderType::Pegged:
+            if (price)
+                return RejectReason::UnexpectedPrice;
+            if (!peg || static_cast<std::uint8_t>(peg->reference) > static_cast<std::uint8_t>(PegReference::Mid))
+                return RejectReason::InvalidOrder;
+            if (!std::isfinite(peg->offset) || !is_on_tick(peg->offset, price_tick))
+                return RejectReason::InvalidPegOffset;
+            break;
+        case OrderType::Market:
+        case OrderType::Stop:
+            if (price)
+                return RejectReason::UnexpectedPrice;
+            break;
+        default:
+            return RejectReason::InvalidOrder;
+        }
+
+        if (price)
+        {
+            if (!(*price > 0) || !std::isfinite(*price))
+                return RejectReason::InvalidPrice;
+            if (!is_on_tick(*price, price_tick))
+                return RejectReason::OffTickPrice;
+        }
+
+        if (type == OrderType::Stop || type == OrderType::StopLimit)
+        {
+            if (!stop_price)
+                return RejectReason::MissingStopPrice;
+            if (!(*stop_price > 0) || !std::isfinite(*stop_price) || !is_on_tick(*stop_price, price_tick))
+                return RejectReason::InvalidStopPrice;
+        }
+
+        return RejectReason::None;
+    }
+
+    RejectReason normalize_order(MarketEvent &ev, double price_tick) noexcept
+    {
+        OrderType type = ev.order_type.value_or(OrderType::Limit);
+        RejectReason reason = check_order(ev.quantity, ev.price, ev.stop_price, type, price_tick, ev.display_qty, ev.peg);
+        if (reason != RejectReason::None)
+            return reason;
+        if (type == OrderType::Pegged && (ev.tif == TimeInForce::IOC || ev.tif == TimeInForce::FOK))
+            return RejectReason::InvalidOrder;
+
+        ev.order_type = type;
+        if (ev.price)
+            ev.price = snap_to_tick(*ev.price, price_tick);
+        if (type != OrderType::Stop && type != OrderType::StopLimit)
+            ev.stop_price.reset();
+        else
+            ev.stop_price = snap_to_tick(*ev.stop_price, price_tick);
+        if (type != OrderType::Iceberg)
+            ev.display_qty = 0;
+        if (type == OrderType::Pegged)
+            ev.peg->offset = snap_to_tick(ev.peg->offset, price_tick);
+        else
+            ev.peg.reset();
+
+        TimeInForce tif = ev.tif.value_or(TimeInForce::Day);
+        if (type == OrderType::Market && (tif == TimeInForce::Day || tif == TimeInForce::GTC))
+            tif = TimeInForce::IOC;
+        ev.tif = tif;
+
+        return RejectReason::None;
+    }
+
+    RejectReason normalize_modify(MarketEvent &ev, double price_tick) noexcept
+    {
+        if (ev.quantity <= 0)
+            return RejectReason::InvalidQuantity;
+        if (ev.price)
+        {
+            if (!(*ev.price > 0) || !std::isfinite(*ev.price))
+                return RejectReason::InvalidPrice;
+            if (!is_on_tick(*ev.price, price_tick))
+                return RejectReason::OffTickPrice;
+            ev.price = snap_to_tick(*ev.price, price_tick);
+        }
+        return RejectReason::None;
+    }
+
+}
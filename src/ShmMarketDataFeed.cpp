@@ -0,0 +1,139 @@
+#include "ShmMarketDataFeed.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace MercEx
+{
+
+    namespace
+    {
+        std::int64_t to_ns(TimePoint ts)
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(ts.time_since_epoch()).count();
+        }
+
+        std::size_t round_up_pow2(std::size_t n)
+        {
+            std::size_t p = 64;
+            while (p < n)
+                p <<= 1;
+            return p;
+        }
+    }
+
+#ifdef __linux__
+
+    ShmMarketDataFeed::ShmMarketDataFeed(ShmMarketDataFeedConfig config)
+        : config_(std::move(config)), capacity_(round_up_pow2(config_.capacity))
+    {
+        map_size_ = sizeof(mx_shm_header) + capacity_ * sizeof(mx_shm_event);
+
+        // A fresh object every time: readers of a previous run still hold
+        // the old one mapped and must not see it rewound.
+        ::shm_unlink(config_.name.c_str());
+        int fd = ::shm_open(config_.name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd < 0)
+            throw std::runtime_error("ShmMarketDataFeed shm_open " + config_.name + ": " + std::strerror(errno));
+        if (::ftruncate(fd, static_cast<off_t>(map_size_)) != 0)
+        {
+            int err = errno;
+            ::close(fd);
+            ::shm_unlink(config_.name.c_str());
+            throw std::runtime_error("ShmMarketDataFeed ftruncate: " + std::string(std::strerror(err)));
+        }
+        void *p = ::mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+        int err = errno;
+        ::close(fd);
+        if (p == MAP_FAILED)
+        {
+            ::shm_unlink(config_.name.c_str());
+            throw std::runtime_error("ShmMarketDataFeed mmap: " + std::string(std::strerror(err)));
+        }
+
+        map_ = p;
+        header_ = static_cast<mx_shm_header *>(p);
+        slots_ = reinterpret_cast<mx_shm_event *>(static_cast<char *>(p) + sizeof(mx_shm_header));
+        header_->version = MX_SHM_VERSION;
+        header_->slot_size = sizeof(mx_shm_event);
+        header_->capacity = capacity_;
+        header_->header_size = sizeof(mx_shm_header);
+        header_->created_ns = to_ns(Clock::now());
+        // Readers check the magic first: it goes in last.
+        __atomic_store_n(&header_->magic, MX_SHM_MAGIC, __ATOMIC_RELEASE);
+    }
+
+    ShmMarketDataFeed::~ShmMarketDataFeed()
+    {
+        if (map_)
+            ::munmap(map_, map_size_);
+        if (config_.unlink_on_close)
+            ::shm_unlink(config_.name.c_str());
+    }
+
+    void ShmMarketDataFeed::on_market_events(const std::vector<MarketEvent> &events)
+    {
+        const std::int64_t publish_ns = to_ns(Clock::now());
+        const std::uint64_t mask = capacity_ - 1;
+        mx_shm_event ev{};
+        ev.publish_ns = publish_ns;
+
+        for (const auto &e : events)
+        {
+            ev.timestamp_ns = to_ns(e.timestamp);
+            ev.order_id = e.order_id;
+            ev.client_id = e.client_id;
+            ev.market_id = e.market_id;
+            ev.type = static_cast<std::uint8_t>(e.type);
+            ev.side = static_cast<std::uint8_t>(e.side);
+            ev.order_type = static_cast<std::uint8_t>(e.order_type.value_or(OrderType::Limit));
+            ev.tif = static_cast<std::uint8_t>(e.tif.value_or(TimeInForce::Day));
+            if (e.type == MarketEventType::Trade)
+            {
+                ev.u.counterparty_id = e.counterparty_id.value_or(0);
+                ev.price = e.executed_price.value_or(0.0);
+                ev.quantity = e.executed_qty.value_or(0);
+            }
+            else
+            {
+                ev.u.stop_price = e.stop_price.value_or(0.0);
+                ev.price = e.price.value_or(0.0);
+                ev.quantity = e.display_qty ? e.display_qty : e.quantity; // an iceberg shows one slice
+            }
+
+            // Seqlock write: odd stamp, payload, even stamp.
+            const std::uint64_t n = next_++;
+            mx_shm_event &slot = slots_[n & mask];
+            __atomic_store_n(&slot.stamp, 2 * n + 1, __ATOMIC_RELAXED);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(reinterpret_cast<char *>(&slot) + sizeof(slot.stamp),
+                        reinterpret_cast<const char *>(&ev) + sizeof(ev.stamp), sizeof(ev) - sizeof(ev.stamp));
+            __atomic_store_n(&slot.stamp, 2 * n + 2, __ATOMIC_RELEASE);
+        }
+
+        __atomic_store_n(&header_->write_seq, next_, __ATOMIC_RELEASE);
+        events_written_.add(events.size());
+    }
+
+#else
+
+    ShmMarketDataFeed::ShmMarketDataFeed(ShmMarketDataFeedConfig config) : config_(std::move(config))
+    {
+        throw std::runtime_error("ShmMarketDataFeed requires Linux");
+    }
+
+    ShmMarketDataFeed::~ShmMarketDataFeed() = default;
+
+    void ShmMarketDataFeed::on_market_events(const std::vector<MarketEvent> &) {}
+
+#endif
+
+}
@@ -0,0 +1,95 @@
+#include "ShmOrderChannel.hpp"
+#include <stdexcept>
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace MercEx
+{
+
+    ShmOrderClient::~ShmOrderClient()
+    {
+        detach();
+    }
+
+#ifdef __linux__
+
+    void ShmOrderClient::attach(ClientID client_id, const std::string &prefix, bool take_over)
+    {
+        if (map_)
+            throw std::logic_error("ShmOrderClient is already attached");
+
+        std::string name = shm_order_channel_name(prefix, client_id);
+        int fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+        if (fd < 0)
+            throw std::runtime_error("ShmOrderClient " + name + ": " + std::strerror(errno));
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(ShmOrderChannelHeader))
+        {
+            ::close(fd);
+            throw std::runtime_error("ShmOrderClient " + name + ": not an order channel");
+        }
+        std::size_t size = static_cast<std::size_t>(st.st_size);
+        void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+        int err = errno;
+        ::close(fd);
+        if (p == MAP_FAILED)
+            throw std::runtime_error("ShmOrderClient mmap " + name + ": " + std::strerror(err));
+
+        auto *header = static_cast<ShmOrderChannelHeader *>(p);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        std::uint64_t capacity = header->capacity;
+        if (header->magic != kShmOrderMagic || header->version != kShmOrderVersion ||
+            header->slot_size != kShmOrderSlot || header->client_id != client_id || capacity == 0 ||
+            (capacity & (capacity - 1)) != 0 || shm_order_channel_size(capacity) > size)
+        {
+            ::munmap(p, size);
+            throw std::runtime_error("ShmOrderClient " + name + ": not an order channel of this version");
+        }
+        std::uint32_t free = 0;
+        if (!header->attached.compare_exchange_strong(free, 1) && !take_over)
+        {
+            ::munmap(p, size);
+            throw std::runtime_error("ShmOrderClient " + name + ": another process is attached");
+        }
+        header->attached.store(1);
+
+        char *slots = static_cast<char *>(p) + sizeof(ShmOrderChannelHeader);
+        header_ = header;
+        map_ = p;
+        map_size_ = size;
+        requests_ = ShmSpscRing(&header->request_head, &header->request_tail, slots, capacity);
+        responses_ = ShmSpscRing(&header->response_head, &header->response_tail, slots + capacity * kShmOrderSlot,
+                                 capacity);
+    }
+
+    void ShmOrderClient::detach()
+    {
+        if (!map_)
+            return;
+        header_->attached.store(0);
+        ::munmap(map_, map_size_);
+        header_ = nullptr;
+        map_ = nullptr;
+        map_size_ = 0;
+        requests_ = ShmSpscRing();
+        responses_ = ShmSpscRing();
+    }
+
+#else
+
+    void ShmOrderClient::attach(ClientID, const std::string &, bool)
+    {
+        throw std::runtime_error("ShmOrderClient requires Linux");
+    }
+
+    void ShmOrderClient::detach() {}
+
+#endif
+
+}
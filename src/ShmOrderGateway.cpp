@@ -0,0 +1,260 @@
+#include "ShmOrderGateway.hpp"
+#include "BinaryOrderEntry.hpp"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace MercEx
+{
+
+    namespace
+    {
+        // Requests taken from one client before moving to the next.
+        constexpr std::size_t kRequestBatch = 64;
+        constexpr std::size_t kReportBatch = 64;
+
+        std::size_t round_up_pow2(std::size_t n)
+        {
+            std::size_t p = 64;
+            while (p < n)
+                p <<= 1;
+            return p;
+        }
+    }
+
+    struct ShmOrderGateway::Channel
+    {
+        ClientID client_id = 0;
+        std::string name;
+        void *map = nullptr;
+        std::size_t map_size = 0;
+        ShmSpscRing requests;  // consumer side
+        ShmSpscRing responses; // producer side
+        ExecutionReportChannel *reports = nullptr;
+        bool cut_off = false;
+    };
+
+    ShmOrderGateway::ShmOrderGateway(MatchingEngine &engine, ExecutionReportRouter &reports,
+                                     ShmOrderGatewayConfig config)
+        : engine_(engine), reports_(reports), config_(std::move(config)), capacity_(round_up_pow2(config_.capacity))
+    {
+    }
+
+    ShmOrderGateway::~ShmOrderGateway()
+    {
+        stop();
+#ifdef __linux__
+        for (auto &channel : channels_)
+        {
+            reports_.close_session(channel->client_id);
+            ::munmap(channel->map, channel->map_size);
+            if (config_.unlink_on_close)
+                ::shm_unlink(channel->name.c_str());
+        }
+#endif
+    }
+
+#ifdef __linux__
+
+    std::string ShmOrderGateway::add_client(ClientID client_id)
+    {
+        if (running_.load(std::memory_order_acquire))
+            throw std::logic_error("ShmOrderGateway clients are added before start()");
+        if (client_id == 0)
+            throw std::invalid_argument("ShmOrderGateway client 0 is not a client");
+        for (const auto &channel : channels_)
+        {
+            if (channel->client_id == client_id)
+                throw std::invalid_argument("ShmOrderGateway client " + std::to_string(client_id) + " already added");
+        }
+
+        auto channel = std::make_unique<Channel>();
+        channel->client_id = client_id;
+        channel->name = shm_order_channel_name(config_.prefix, client_id);
+        channel->map_size = shm_order_channel_size(capacity_);
+
+        // A fresh object every time, so a client still mapping an old one
+        // cannot write into the new session.
+        ::shm_unlink(channel->name.c_str());
+        int fd = ::shm_open(channel->name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (fd < 0)
+            throw std::runtime_error("ShmOrderGateway shm_open " + channel->name + ": " + std::strerror(errno));
+        if (::ftruncate(fd, static_cast<off_t>(channel->map_size)) != 0)
+        {
+            int err = errno;
+            ::close(fd);
+            ::shm_unlink(channel->name.c_str());
+            throw std::runtime_error("ShmOrderGateway ftruncate: " + std::string(std::strerror(err)));
+        }
+        void *p = ::mmap(nullptr, channel->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+        int err = errno;
+        ::close(fd);
+        if (p == MAP_FAILED)
+        {
+            ::shm_unlink(channel->name.c_str());
+            throw std::runtime_error("ShmOrderGateway mmap: " + std::string(std::strerror(err)));
+        }
+        channel->map = p;
+
+        try
+        {
+            channel->reports = &reports_.open_session(client_id);
+        }
+        catch (const std::out_of_range &)
+        {
+            ::munmap(p, channel->map_size);
+            ::shm_unlink(channel->name.c_str());
+            throw std::invalid_argument("ShmOrderGateway client " + std::to_string(client_id) +
+                                        " is beyond the report router's capacity");
+        }
+
+        auto *header = new (p) ShmOrderChannelHeader{};
+        header->version = kShmOrderVersion;
+        header->slot_size = kShmOrderSlot;
+        header->capacity = capacity_;
+        header->client_id = client_id;
+        // Clients check the magic first: it goes in last.
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = kShmOrderMagic;
+
+        char *slots = static_cast<char *>(p) + sizeof(ShmOrderChannelHeader);
+        channel->requests = ShmSpscRing(&header->request_head, &header->request_tail, slots, capacity_);
+        channel->responses = ShmSpscRing(&header->response_head, &header->response_tail,
+                                         slots + capacity_ * kShmOrderSlot, capacity_);
+        std::string name = channel->name;
+        channels_.push_back(std::move(channel));
+        return name;
+    }
+
+    void ShmOrderGateway::start()
+    {
+        if (running_.load(std::memory_order_acquire))
+            return;
+        running_.store(true, std::memory_order_release);
+        worker_ = std::thread(&ShmOrderGateway::run, this);
+    }
+
+#else
+
+    std::string ShmOrderGateway::add_client(ClientID)
+    {
+        throw std::runtime_error("ShmOrderGateway requires Linux");
+    }
+
+    void ShmOrderGateway::start()
+    {
+        throw std::runtime_error("ShmOrderGateway requires Linux");
+    }
+
+#endif
+
+    void ShmOrderGateway::stop()
+    {
+        running_.store(false, std::memory_order_release);
+        if (worker_.joinable())
+            worker_.join();
+    }
+
+    void ShmOrderGateway::run()
+    {
+        apply_thread_placement(config_.placement, "mx-shm-gw");
+
+        while (running_.load(std::memory_order_acquire))
+        {
+            bool busy = false;
+            for (auto &channel : channels_)
+            {
+                if (!channel->cut_off)
+                    busy |= serve(*channel);
+            }
+            if (!busy && config_.idle_sleep.count() > 0)
+                std::this_thread::sleep_for(config_.idle_sleep);
+        }
+    }
+
+    bool ShmOrderGateway::serve(Channel &channel)
+    {
+        bool busy = false;
+        alignas(8) char slot[kShmOrderSlot];
+        // Every request owes at most one response: take one only when it fits.
+        for (std::size_t n = 0; n < kRequestBatch && !channel.responses.full() && channel.requests.pop(slot); ++n)
+        {
+            busy = true;
+            messages_in_.add();
+            if (!handle_request(channel, *reinterpret_cast<const MessageHeader *>(slot)))
+            {
+                // Counted in protocol_errors(), like TcpGateway's closed sessions.
+                channel.cut_off = true;
+                reports_.close_session(channel.client_id);
+                protocol_errors_.add();
+                return true;
+            }
+        }
+        busy |= drain_reports(channel);
+        return busy;
+    }
+
+    bool ShmOrderGateway::handle_request(Channel &channel, const MessageHeader &header)
+    {
+        if (header.version != kProtocolVersion || header.length != message_size(header.type))
+            return false;
+
+        ExecutionMessage reject;
+        switch (header.type)
+        {
+        case MessageType::NewOrder:
+            respond(channel, submit_new_order(engine_, channel.client_id,
+                                              reinterpret_cast<const NewOrderMessage &>(header)));
+            return true;
+        case MessageType::Cancel:
+            if (!submit_cancel(engine_, channel.client_id, reinterpret_cast<const CancelMessage &>(header), reject))
+                respond(channel, reject);
+            return true;
+        case MessageType::Modify:
+            if (!submit_modify(engine_, channel.client_id, reinterpret_cast<const ModifyMessage &>(header), reject))
+                respond(channel, reject);
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool ShmOrderGateway::drain_reports(Channel &channel)
+    {
+        ExecutionReport batch[kReportBatch];
+        bool drained = false;
+        for (;;)
+        {
+            std::size_t room = static_cast<std::size_t>(std::min<std::uint64_t>(channel.responses.space(), kReportBatch));
+            if (room == 0)
+                return drained;
+            std::size_t n = channel.reports->poll(batch, room);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                ExecutionMessage msg;
+                encode(batch[i], msg);
+                respond(channel, msg);
+            }
+            drained |= n > 0;
+            if (n < room)
+                return drained;
+        }
+    }
+
+    template <typename T>
+    void ShmOrderGateway::respond(Channel &channel, const T &msg)
+    {
+        // Callers make room before producing a response.
+        if (channel.responses.push(msg))
+            messages_out_.add();
+    }
+
+}
@@ -0,0 +1,170 @@
+#include "StageTimer.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace MercEx
+{
+
+    const char *to_string(TimingStage stage)
+    {
+        switch (stage)
+        {
+        case TimingStage::Enqueue:
+            return "enqueue";
+        case TimingStage::Dequeue:
+            return "dequeue";
+        case TimingStage::Construct:
+            return "construct";
+        case TimingStage::Match:
+            return "match";
+        case TimingStage::StopCheck:
+            return "stop_check";
+        case TimingStage::Publish:
+            return "publish";
+        }
+        return "unknown";
+    }
+
+    namespace
+    {
+        using StageHistograms = std::array<LatencyHistogram, kTimingStages>;
+
+        double g_ns_per_tick = 1.0;
+
+        // Live per-thread histograms plus those of threads that have exited.
+        struct TimingRegistry
+        {
+            std::mutex mutex;
+            std::vector<StageHistograms *> live;
+            StageHistograms retired;
+        };
+
+        TimingRegistry &registry()
+        {
+            static TimingRegistry r;
+            return r;
+        }
+
+        struct ThreadTimings
+        {
+            std::unique_ptr<StageHistograms> histograms = std::make_unique<StageHistograms>();
+
+            ThreadTimings()
+            {
+                auto &r = registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                r.live.push_back(histograms.get());
+            }
+
+            ~ThreadTimings()
+            {
+                auto &r = registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                for (std::size_t i = 0; i < kTimingStages; ++i)
+                    r.retired[i].merge((*histograms)[i]);
+                r.live.erase(std::find(r.live.begin(), r.live.end(), histograms.get()));
+            }
+        };
+
+        ThreadTimings &thread_timings()
+        {
+            thread_local ThreadTimings timings;
+            return timings;
+        }
+
+#if MERCEX_ENABLE_TIMING
+        const bool g_calibrated = (Tsc::calibrate(), true);
+#endif
+    }
+
+    double Tsc::ns_per_tick()
+    {
+        return g_ns_per_tick;
+    }
+
+    double Tsc::calibrate(std::chrono::milliseconds window)
+    {
+#ifdef MERCEX_HAS_RDTSC
+        auto wall_start = std::chrono::steady_clock::now();
+        std::uint64_t tsc_start = now();
+        while (std::chrono::steady_clock::now() - wall_start < window)
+            ;
+        std::uint64_t tsc_end = now();
+        auto wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - wall_start).count();
+        if (tsc_end > tsc_start)
+            g_ns_per_tick = static_cast<double>(wall_ns) / static_cast<double>(tsc_end - tsc_start);
+#else
+        (void)window;
+#endif
+        return g_ns_per_tick;
+    }
+
+    void StageTimings::record(TimingStage stage, std::uint64_t start_tick) noexcept
+    {
+        std::uint64_t ticks = Tsc::now() - start_tick;
+        (*thread_timings().histograms)[static_cast<std::size_t>(stage)].record(static_cast<std::uint64_t>(ticks * g_ns_per_tick));
+    }
+
+    void StageTimings::prepare_thread()
+    {
+        if (enabled)
+            thread_timings();
+    }
+
+    std::array<LatencyHistogram, kTimingStages> StageTimings::collect()
+    {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        StageHistograms merged = r.retired;
+        for (const StageHistograms *thread : r.live)
+            for (std::size_t i = 0; i < kTimingStages; ++i)
+                merged[i].merge((*thread)[i]);
+        return merged;
+    }
+
+    void StageTimings::reset()
+    {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (auto &h : r.retired)
+            h.reset();
+        for (StageHistograms *thread : r.live)
+            for (auto &h : *thread)
+                h.reset();
+    }
+
+    void StageTimings::print_summary(std::ostream &os)
+    {
+        if (!enabled)
+        {
+            os << "stage timing not compiled in (configure with -DMERCEX_ENABLE_TIMING=ON)\n";
+            return;
+        }
+        auto stages = collect();
+        for (std::size_t i = 0; i < kTimingStages; ++i)
+            stages[i].print_summary(os, to_string(static_cast<TimingStage>(i)));
+    }
+
+    void StageTimings::print_json(std::ostream &os)
+    {
+        auto flags = os.flags();
+        auto precision = os.precision();
+        os << "{\"enabled\":" << (enabled ? "true" : "false")
+           << ",\"ns_per_tick\":" << std::setprecision(6) << Tsc::ns_per_tick() << ",\"stages\":{";
+        os.flags(flags);
+        os.precision(precision);
+
+        auto stages = collect();
+        for (std::size_t i = 0; i < kTimingStages; ++i)
+        {
+            os << (i ? "," : "") << "\"" << to_string(static_cast<TimingStage>(i)) << "\":";
+            stages[i].print_json(os);
+        }
+        os << "}}";
+    }
+
+}
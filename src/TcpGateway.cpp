@@ -0,0 +1,880 @@
+#include "TcpGateway.hpp"
+#include "BinaryOrderEntry.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "IoUring.hpp"
+#else
+namespace MercEx
+{
+    // Only named by the members of TcpGateway; never constructed off Linux.
+    class IoUring {};
+    class ProvidedBuffers {};
+}
+#endif
+
+namespace MercEx
+{
+
+    namespace
+    {
+        constexpr std::uint64_t kListenerTag = ~std::uint64_t(0);
+        constexpr int kMaxEpollEvents = 256;
+        constexpr std::size_t kReportBatch = 64;
+
+        // io_uring backend: submission queue depth, and the receive buffers
+        // every session's multishot recv draws from.
+        constexpr unsigned kRingEntries = 1024;
+        constexpr unsigned kRecvBuffers = 512;
+        constexpr std::size_t kRecvBufferSize = 16 << 10;
+        constexpr std::uint16_t kRecvGroup = 0;
+
+        // user_data of a request: what it is in the high word, the session
+        // slot in the low one.
+        enum class Op : std::uint64_t
+        {
+            Accept = 1,
+            Recv = 2,
+            Send = 3,
+            Cancel = 4,
+            Provide = 5
+        };
+
+        constexpr std::uint64_t tag(Op op, std::uint32_t slot)
+        {
+            return static_cast<std::uint64_t>(op) << 32 | slot;
+        }
+    }
+
+    struct TcpGateway::Session
+    {
+        Session(std::uint32_t slot, std::size_t receive_bytes, std::size_t send_bytes)
+            : slot(slot), rx_words((receive_bytes + 7) / 8), tx(send_bytes) {}
+
+        void reset(int socket)
+        {
+            fd = socket;
+            client_id = 0;
+            channel = nullptr;
+            rx_begin = rx_end = 0;
+            tx_head = tx_size = 0;
+            writable = true;
+            read_blocked = false;
+            closing = false;
+            recv_armed = false;
+            recv_cancelled = false;
+            shut_down = false;
+            sends_in_flight = 0;
+        }
+
+        char *rx() { return reinterpret_cast<char *>(rx_words.data()); }
+        std::size_t rx_capacity() const { return rx_words.size() * sizeof(std::uint64_t); }
+        std::size_t tx_free() const { return tx.size() - tx_size; }
+
+        std::uint32_t slot;
+        int fd = -1;
+        ClientID client_id = 0;
+        ExecutionReportChannel *channel = nullptr; // set once logged in
+
+        // Unparsed bytes are [rx_begin, rx_end). The io_uring backend only
+        // keeps what a completion could not parse in place: a message split
+        // across two completions, or everything after a pause.
+        std::vector<std::uint64_t> rx_words;
+        std::size_t rx_begin = 0;
+        std::size_t rx_end = 0;
+
+        // Send ring: tx_size bytes pending from tx_head, possibly wrapping.
+        std::vector<char> tx;
+        std::size_t tx_head = 0;
+        std::size_t tx_size = 0;
+
+        bool writable = true;      // false from EAGAIN until the next EPOLLOUT
+        bool read_blocked = false; // parsing paused until the send ring drains
+        bool closing = false;      // closed at the end of the loop iteration
+
+        // io_uring backend only.
+        bool recv_armed = false;     // a multishot recv is outstanding
+        bool recv_cancelled = false; // and an async cancel for it has been queued
+        bool shut_down = false;      // closing: shutdown(2) issued, waiting on requests
+        unsigned sends_in_flight = 0;
+    };
+
+    TcpGateway::TcpGateway(MatchingEngine &engine, ExecutionReportRouter &reports, TcpGatewayConfig config)
+        : engine_(engine), reports_(reports), config_(std::move(config))
+    {
+        if (config_.max_sessions == 0)
+            throw std::invalid_argument("TcpGateway needs at least one session");
+        if (config_.receive_buffer < 2 * kMaxMessageSize || config_.send_buffer < 2 * kMaxMessageSize)
+            throw std::invalid_argument("TcpGateway buffers must hold at least two messages");
+    }
+
+    TcpGateway::~TcpGateway()
+    {
+        stop();
+    }
+
+    void TcpGateway::start()
+    {
+#ifndef __linux__
+        throw std::runtime_error("TcpGateway requires Linux epoll or io_uring");
+#else
+        if (running_.load(std::memory_order_acquire))
+            return;
+        open_listener();
+        if (config_.backend == GatewayBackend::IoUring)
+        {
+            try
+            {
+                open_uring();
+            }
+            catch (...)
+            {
+                ::close(listen_fd_);
+                listen_fd_ = -1;
+                throw;
+            }
+        }
+        running_.store(true, std::memory_order_release);
+        worker_ = std::thread(config_.backend == GatewayBackend::IoUring ? &TcpGateway::run_uring
+                                                                         : &TcpGateway::run_epoll,
+                              this);
+#endif
+    }
+
+    void TcpGateway::stop()
+    {
+        running_.store(false, std::memory_order_release);
+        if (worker_.joinable())
+            worker_.join();
+#ifdef __linux__
+        for (Session *session : live_)
+            close_session(*session);
+        live_.clear();
+        session_count_.store(0, std::memory_order_relaxed);
+        // The worker that owned the ring's requests has exited, which
+        // cancels them.
+        recv_buffers_.reset();
+        ring_.reset();
+        if (epoll_fd_ >= 0)
+            ::close(epoll_fd_);
+        if (listen_fd_ >= 0)
+            ::close(listen_fd_);
+        epoll_fd_ = listen_fd_ = -1;
+#endif
+    }
+
+#ifdef __linux__
+
+    void TcpGateway::open_listener()
+    {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(config_.port);
+        if (::inet_pton(AF_INET, config_.address.c_str(), &addr.sin_addr) != 1)
+            throw std::invalid_argument("TcpGateway address is not IPv4: " + config_.address);
+
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            throw std::runtime_error(std::string("Gateway socket: ") + std::strerror(errno));
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        socklen_t len = sizeof(addr);
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+            ::listen(fd, config_.backlog) != 0 ||
+            ::getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) != 0)
+        {
+            int err = errno;
+            ::close(fd);
+            throw std::runtime_error("Gateway " + config_.address + ":" + std::to_string(config_.port) + ": " +
+                                     std::strerror(err));
+        }
+        listen_fd_ = fd;
+        port_ = ntohs(addr.sin_port);
+        if (config_.backend != GatewayBackend::Epoll)
+            return;
+
+        int ep = ::epoll_create1(EPOLL_CLOEXEC);
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.u64 = kListenerTag;
+        if (ep < 0 || ::epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev) != 0)
+        {
+            int err = errno;
+            if (ep >= 0)
+                ::close(ep);
+            ::close(fd);
+            listen_fd_ = -1;
+            throw std::runtime_error(std::string("Gateway epoll: ") + std::strerror(err));
+        }
+        epoll_fd_ = ep;
+    }
+
+    TcpGateway::Session &TcpGateway::open_slot(int fd)
+    {
+        std::uint32_t slot;
+        if (!free_slots_.empty())
+        {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+        }
+        else
+        {
+            slot = static_cast<std::uint32_t>(sessions_.size());
+            sessions_.push_back(std::make_unique<Session>(slot, config_.receive_buffer, config_.send_buffer));
+            if (ring_)
+                ring_->update_buffer(slot, sessions_.back()->tx.data(), sessions_.back()->tx.size());
+        }
+        Session &session = *sessions_[slot];
+        session.reset(fd);
+        return session;
+    }
+
+    std::size_t TcpGateway::parse_messages(Session &session, const char *data, std::size_t size)
+    {
+        std::size_t consumed = 0;
+        while (size - consumed >= sizeof(MessageHeader))
+        {
+            const auto &header = *reinterpret_cast<const MessageHeader *>(data + consumed);
+            std::size_t length = message_size(header.type);
+            if (length == 0 || header.length != length)
+            {
+                protocol_errors_.add();
+                session.closing = true;
+                break;
+            }
+            if (size - consumed < length)
+                break;
+            // Every inbound message is answered by at most one message.
+            if (session.tx_free() < kMaxMessageSize)
+            {
+                session.read_blocked = true;
+                break;
+            }
+            if (!handle_message(session, header))
+            {
+                protocol_errors_.add();
+                session.closing = true;
+                break;
+            }
+            consumed += length;
+            messages_in_.add();
+        }
+        return consumed;
+    }
+
+    void TcpGateway::stash(Session &session, const char *data, std::size_t size)
+    {
+        if (size == 0)
+            return;
+        if (session.rx_begin == session.rx_end)
+            session.rx_begin = session.rx_end = 0;
+        if (session.rx_capacity() - session.rx_end < size)
+        {
+            std::memmove(session.rx(), session.rx() + session.rx_begin, session.rx_end - session.rx_begin);
+            session.rx_end -= session.rx_begin;
+            session.rx_begin = 0;
+            // Only a paused session outgrows its buffer: its multishot recv
+            // keeps delivering until the cancel lands.
+            if (session.rx_capacity() - session.rx_end < size)
+                session.rx_words.resize((session.rx_end + size + 7) / 8);
+        }
+        std::memcpy(session.rx() + session.rx_end, data, size);
+        session.rx_end += size;
+    }
+
+    void TcpGateway::run_epoll()
+    {
+        apply_thread_placement(config_.placement, "mx-gateway");
+
+        epoll_event events[kMaxEpollEvents];
+        bool busy = false;
+        while (running_.load(std::memory_order_acquire))
+        {
+            // Reports arrive without waking epoll, so block only while no
+            // session is open; otherwise poll like the market workers do.
+            int n = ::epoll_wait(epoll_fd_, events, kMaxEpollEvents, busy || !live_.empty() ? 0 : 1);
+            busy = n > 0;
+
+            for (int i = 0; i < n; ++i)
+            {
+                if (events[i].data.u64 == kListenerTag)
+                {
+                    accept_sessions();
+                    continue;
+                }
+                Session &session = *sessions_[events[i].data.u64];
+                if (session.closing)
+                    continue;
+                std::uint32_t flags = events[i].events;
+                if (flags & (EPOLLERR | EPOLLHUP))
+                {
+                    session.closing = true;
+                    continue;
+                }
+                if (flags & EPOLLOUT)
+                    session.writable = true;
+                if (flags & (EPOLLIN | EPOLLRDHUP))
+                    read_session(session);
+            }
+
+            // Everything owed to a session this iteration goes out in one write.
+            for (std::size_t i = 0; i < live_.size();)
+            {
+                Session &session = *live_[i];
+                if (!session.closing)
+                {
+                    if (session.read_blocked && session.tx_free() >= kMaxMessageSize)
+                        busy |= read_session(session);
+                    if (session.channel)
+                        busy |= drain_reports(session);
+                    if (session.tx_size > 0 && session.writable)
+                        flush(session);
+                }
+                if (session.closing)
+                {
+                    close_session(session);
+                    live_[i] = live_.back();
+                    live_.pop_back();
+                    session_count_.store(live_.size(), std::memory_order_relaxed);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+
+            if (!busy && !live_.empty())
+                std::this_thread::sleep_for(std::chrono::nanoseconds(100));
+        }
+    }
+
+    bool TcpGateway::accept_sessions()
+    {
+        bool accepted = false;
+        for (;;)
+        {
+            int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    std::cerr << "[Gateway] accept: " << std::strerror(errno) << std::endl;
+                return accepted;
+            }
+            if (live_.size() >= config_.max_sessions)
+            {
+                ::close(fd);
+                continue;
+            }
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            Session &session = open_slot(fd);
+
+            // Registered for both directions once: with edge triggering there
+            // is nothing to re-arm as the send ring fills and drains.
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            ev.data.u64 = session.slot;
+            if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0)
+            {
+                std::cerr << "[Gateway] epoll_ctl: " << std::strerror(errno) << std::endl;
+                ::close(fd);
+                session.fd = -1;
+                free_slots_.push_back(session.slot);
+                continue;
+            }
+            live_.push_back(&session);
+            session_count_.store(live_.size(), std::memory_order_relaxed);
+            accepted = true;
+        }
+    }
+
+    bool TcpGateway::read_session(Session &session)
+    {
+        session.read_blocked = false;
+        bool progressed = false;
+        for (;;)
+        {
+            // Parse every complete message already buffered, in place.
+            std::size_t consumed = parse_messages(session, session.rx() + session.rx_begin,
+                                                  session.rx_end - session.rx_begin);
+            session.rx_begin += consumed;
+            progressed |= consumed > 0;
+            if (session.closing || session.read_blocked)
+                return progressed;
+
+            // Keep room for a whole message behind whatever partial one is left.
+            if (session.rx_begin == session.rx_end)
+            {
+                session.rx_begin = session.rx_end = 0;
+            }
+            else if (session.rx_capacity() - session.rx_end < kMaxMessageSize)
+            {
+                std::memmove(session.rx(), session.rx() + session.rx_begin, session.rx_end - session.rx_begin);
+                session.rx_end -= session.rx_begin;
+                session.rx_begin = 0;
+            }
+
+            ssize_t n = ::recv(session.fd, session.rx() + session.rx_end, session.rx_capacity() - session.rx_end, 0);
+            if (n > 0)
+            {
+                session.rx_end += static_cast<std::size_t>(n);
+                progressed = true;
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            // Drained (the edge is consumed), or the peer is gone.
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                session.closing = true;
+            return progressed;
+        }
+    }
+
+    bool TcpGateway::handle_message(Session &session, const MessageHeader &header)
+    {
+        // The header is the first member of every message, so the message
+        // itself starts at the same address.
+        switch (header.type)
+        {
+        case MessageType::Login:
+            if (session.channel)
+                return false;
+            handle_login(session, reinterpret_cast<const LoginMessage &>(header));
+            return true;
+        case MessageType::NewOrder:
+            if (!session.channel)
+                return false;
+            handle_new_order(session, reinterpret_cast<const NewOrderMessage &>(header));
+            return true;
+        case MessageType::Cancel:
+            if (!session.channel)
+                return false;
+            handle_cancel(session, reinterpret_cast<const CancelMessage &>(header));
+            return true;
+        case MessageType::Modify:
+            if (!session.channel)
+                return false;
+            handle_modify(session, reinterpret_cast<const ModifyMessage &>(header));
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    void TcpGateway::handle_login(Session &session, const LoginMessage &msg)
+    {
+        auto response = make_message<LoginResponseMessage>(MessageType::LoginResponse);
+        ClientID client_id = msg.client_id; // copied: packed fields do not bind to references
+        if (client_id == 0)
+        {
+            response.status = LoginResponseMessage::InvalidClient;
+        }
+        else if (logged_in_.count(client_id))
+        {
+            response.status = LoginResponseMessage::AlreadyLoggedIn;
+        }
+        else
+        {
+            try
+            {
+                session.channel = &reports_.open_session(client_id);
+                session.client_id = client_id;
+                logged_in_.insert(client_id);
+                response.status = LoginResponseMessage::Accepted;
+            }
+            catch (const std::out_of_range &)
+            {
+                response.status = LoginResponseMessage::InvalidClient;
+            }
+        }
+        send(session, response);
+    }
+
+    void TcpGateway::handle_new_order(Session &session, const NewOrderMessage &msg)
+    {
+        send(session, submit_new_order(engine_, session.client_id, msg));
+    }
+
+    void TcpGateway::handle_cancel(Session &session, const CancelMessage &msg)
+    {
+        ExecutionMessage reject;
+        if (!submit_cancel(engine_, session.client_id, msg, reject))
+            send(session, reject);
+    }
+
+    void TcpGateway::handle_modify(Session &session, const ModifyMessage &msg)
+    {
+        ExecutionMessage reject;
+        if (!submit_modify(engine_, session.client_id, msg, reject))
+            send(session, reject);
+    }
+
+    bool TcpGateway::drain_reports(Session &session)
+    {
+        ExecutionReport batch[kReportBatch];
+        bool drained = false;
+        for (;;)
+        {
+            std::size_t room = std::min(session.tx_free() / sizeof(ExecutionMessage), kReportBatch);
+            if (room == 0)
+                return drained;
+            std::size_t n = session.channel->poll(batch, room);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                ExecutionMessage msg;
+                encode(batch[i], msg);
+                send(session, msg);
+            }
+            drained |= n > 0;
+            if (n < room)
+                return drained;
+        }
+    }
+
+    template <typename T>
+    void TcpGateway::send(Session &session, const T &msg)
+    {
+        // Callers reserve room before producing a message.
+        if (session.tx_free() < sizeof(T))
+        {
+            session.closing = true;
+            return;
+        }
+        const char *bytes = reinterpret_cast<const char *>(&msg);
+        std::size_t tail = (session.tx_head + session.tx_size) % session.tx.size();
+        std::size_t first = std::min(sizeof(T), session.tx.size() - tail);
+        std::memcpy(session.tx.data() + tail, bytes, first);
+        std::memcpy(session.tx.data(), bytes + first, sizeof(T) - first);
+        session.tx_size += sizeof(T);
+        messages_out_.add();
+    }
+
+    void TcpGateway::flush(Session &session)
+    {
+        while (session.tx_size > 0)
+        {
+            // The ring is at most two runs: head to the end, then the wrap.
+            iovec iov[2];
+            std::size_t first = std::min(session.tx_size, session.tx.size() - session.tx_head);
+            iov[0] = {session.tx.data() + session.tx_head, first};
+            iov[1] = {session.tx.data(), session.tx_size - first};
+
+            msghdr mh{};
+            mh.msg_iov = iov;
+            mh.msg_iovlen = first < session.tx_size ? 2 : 1;
+            ssize_t n = ::sendmsg(session.fd, &mh, MSG_NOSIGNAL);
+            if (n > 0)
+            {
+                session.tx_head = (session.tx_head + static_cast<std::size_t>(n)) % session.tx.size();
+                session.tx_size -= static_cast<std::size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                session.writable = false;
+            else
+                session.closing = true;
+            return;
+        }
+        session.tx_head = 0;
+    }
+
+    void TcpGateway::close_session(Session &session)
+    {
+        if (epoll_fd_ >= 0)
+            ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, session.fd, nullptr);
+        ::close(session.fd);
+        session.fd = -1;
+        if (session.channel)
+        {
+            reports_.close_session(session.client_id);
+            logged_in_.erase(session.client_id);
+            session.channel = nullptr;
+        }
+        free_slots_.push_back(session.slot);
+    }
+
+    void TcpGateway::open_uring()
+    {
+        ring_ = std::make_unique<IoUring>(kRingEntries);
+        recv_buffers_ = std::make_unique<ProvidedBuffers>(*ring_, kRecvGroup, kRecvBuffers, kRecvBufferSize,
+                                                          tag(Op::Provide, 0));
+        // One registered send buffer per slot; slots never outnumber
+        // max_sessions because the io_uring loop keeps a closing session live
+        // until its requests are done.
+        ring_->register_sparse_buffers(static_cast<unsigned>(config_.max_sessions));
+        for (auto &session : sessions_)
+            ring_->update_buffer(session->slot, session->tx.data(), session->tx.size());
+        fixed_sends_ = true;
+    }
+
+    void TcpGateway::run_uring()
+    {
+        apply_thread_placement(config_.placement, "mx-gateway");
+
+        arm_accept();
+        bool busy = false;
+        while (running_.load(std::memory_order_acquire))
+        {
+            // One io_uring_enter hands over everything queued in the last
+            // iteration. As with epoll, block only while no session is open.
+            int ret = ring_->submit(busy || !live_.empty() ? 0 : 1, std::chrono::milliseconds(1));
+            if (ret < 0 && ret != -EBUSY && ret != -EAGAIN)
+                std::cerr << "[Gateway] io_uring_enter: " << std::strerror(-ret) << std::endl;
+            busy = ring_->drain_completions([this](const io_uring_cqe &cqe) { on_completion(cqe); }) > 0;
+
+            for (std::size_t i = 0; i < live_.size();)
+            {
+                Session &session = *live_[i];
+                if (!session.closing)
+                {
+                    if (session.read_blocked && session.tx_free() >= kMaxMessageSize)
+                        busy |= resume_session(session);
+                    if (session.channel)
+                        busy |= drain_reports(session);
+                    if (session.tx_size > 0 && session.sends_in_flight == 0)
+                        submit_send(session);
+                }
+                if (session.closing && !session.shut_down)
+                {
+                    // Fails any send stuck on a full socket and ends the recv.
+                    ::shutdown(session.fd, SHUT_RDWR);
+                    session.shut_down = true;
+                }
+                if ((session.read_blocked || session.closing) && session.recv_armed && !session.recv_cancelled)
+                    cancel_recv(session);
+
+                if (session.closing && !session.recv_armed && session.sends_in_flight == 0)
+                {
+                    close_session(session);
+                    live_[i] = live_.back();
+                    live_.pop_back();
+                    session_count_.store(live_.size(), std::memory_order_relaxed);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+
+            if (!busy && !live_.empty())
+                std::this_thread::sleep_for(std::chrono::nanoseconds(100));
+        }
+    }
+
+    void TcpGateway::on_completion(const io_uring_cqe &cqe)
+    {
+        auto op = static_cast<Op>(cqe.user_data >> 32);
+        bool more = cqe.flags & IORING_CQE_F_MORE;
+
+        if (op == Op::Accept)
+        {
+            if (cqe.res >= 0)
+            {
+                if (live_.size() >= config_.max_sessions)
+                {
+                    ::close(cqe.res);
+                }
+                else
+                {
+                    int one = 1;
+                    ::setsockopt(cqe.res, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                    Session &session = open_slot(cqe.res);
+                    live_.push_back(&session);
+                    session_count_.store(live_.size(), std::memory_order_relaxed);
+                    arm_recv(session);
+                }
+            }
+            else if (cqe.res != -ECANCELED)
+            {
+                std::cerr << "[Gateway] accept: " << std::strerror(-cqe.res) << std::endl;
+            }
+            if (!more && running_.load(std::memory_order_relaxed))
+                arm_accept();
+            return;
+        }
+        if (op == Op::Cancel)
+            return;
+        if (op == Op::Provide)
+        {
+            if (cqe.res < 0)
+                std::cerr << "[Gateway] provide buffers: " << std::strerror(-cqe.res) << std::endl;
+            return;
+        }
+
+        Session &session = *sessions_[static_cast<std::uint32_t>(cqe.user_data)];
+        if (op == Op::Recv)
+        {
+            if (!more)
+                session.recv_armed = false;
+            if (cqe.res > 0)
+            {
+                unsigned id = ProvidedBuffers::buffer_id(cqe);
+                if (!session.closing)
+                    on_data(session, recv_buffers_->buffer(id), static_cast<std::size_t>(cqe.res));
+                recv_buffers_->recycle(id);
+            }
+            else if (cqe.res == 0 || (cqe.res != -ENOBUFS && cqe.res != -ECANCELED))
+            {
+                // End of stream or a socket error. ENOBUFS only means every
+                // provided buffer was in use; the recv is re-armed below.
+                session.closing = true;
+            }
+            if (!session.recv_armed && !session.closing && !session.read_blocked)
+                arm_recv(session);
+        }
+        else if (op == Op::Send)
+        {
+            --session.sends_in_flight;
+            if (cqe.res > 0)
+            {
+                session.tx_head = (session.tx_head + static_cast<std::size_t>(cqe.res)) % session.tx.size();
+                session.tx_size -= static_cast<std::size_t>(cqe.res);
+            }
+            else if (cqe.res == -EINVAL && fixed_sends_)
+            {
+                // Kernels before registered-buffer sends: the bytes are
+                // still queued and go out as plain sends next time.
+                fixed_sends_ = false;
+            }
+            else if (cqe.res < 0 && cqe.res != -ECANCELED)
+            {
+                session.closing = true;
+            }
+            if (session.tx_size == 0 && session.sends_in_flight == 0)
+                session.tx_head = 0;
+        }
+    }
+
+    void TcpGateway::on_data(Session &session, const char *data, std::size_t size)
+    {
+        if (session.rx_end > session.rx_begin)
+        {
+            // Complete the message left over from the previous completion,
+            // copying only the bytes it is missing, and parse it from rx.
+            for (std::size_t want = sizeof(MessageHeader); size > 0;)
+            {
+                std::size_t have = session.rx_end - session.rx_begin;
+                if (have >= sizeof(MessageHeader))
+                    want = message_size(reinterpret_cast<const MessageHeader *>(session.rx() + session.rx_begin)->type);
+                if (have >= want)
+                    break;
+                std::size_t take = std::min(want - have, size);
+                stash(session, data, take);
+                data += take;
+                size -= take;
+            }
+            session.rx_begin += parse_messages(session, session.rx() + session.rx_begin,
+                                               session.rx_end - session.rx_begin);
+            if (session.rx_begin < session.rx_end)
+            {
+                // Paused, or rx held more than one message: the rest of this
+                // completion queues up behind it.
+                stash(session, data, size);
+                if (!session.closing)
+                    session.rx_begin += parse_messages(session, session.rx() + session.rx_begin,
+                                                       session.rx_end - session.rx_begin);
+                return;
+            }
+            session.rx_begin = session.rx_end = 0;
+        }
+
+        // Common case: whole messages parsed where the kernel put them.
+        std::size_t consumed = parse_messages(session, data, size);
+        if (!session.closing)
+            stash(session, data + consumed, size - consumed);
+    }
+
+    bool TcpGateway::resume_session(Session &session)
+    {
+        session.read_blocked = false;
+        std::size_t consumed = parse_messages(session, session.rx() + session.rx_begin,
+                                              session.rx_end - session.rx_begin);
+        session.rx_begin += consumed;
+        if (session.rx_begin == session.rx_end)
+            session.rx_begin = session.rx_end = 0;
+        if (!session.closing && !session.read_blocked && !session.recv_armed)
+            arm_recv(session);
+        return consumed > 0;
+    }
+
+    void TcpGateway::arm_accept()
+    {
+        io_uring_sqe &sqe = ring_->next_sqe();
+        sqe.opcode = IORING_OP_ACCEPT;
+        sqe.fd = listen_fd_;
+        sqe.accept_flags = SOCK_CLOEXEC;
+        sqe.ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe.user_data = tag(Op::Accept, 0);
+    }
+
+    void TcpGateway::arm_recv(Session &session)
+    {
+        io_uring_sqe &sqe = ring_->next_sqe();
+        sqe.opcode = IORING_OP_RECV;
+        sqe.fd = session.fd;
+        sqe.flags = IOSQE_BUFFER_SELECT;
+        sqe.buf_group = recv_buffers_->group();
+        sqe.ioprio = IORING_RECV_MULTISHOT;
+        sqe.user_data = tag(Op::Recv, session.slot);
+        session.recv_armed = true;
+        session.recv_cancelled = false;
+    }
+
+    void TcpGateway::cancel_recv(Session &session)
+    {
+        io_uring_sqe &sqe = ring_->next_sqe();
+        sqe.opcode = IORING_OP_ASYNC_CANCEL;
+        sqe.addr = tag(Op::Recv, session.slot);
+        sqe.user_data = tag(Op::Cancel, session.slot);
+        session.recv_cancelled = true;
+    }
+
+    void TcpGateway::submit_send(Session &session)
+    {
+        // The pending bytes stay put until the sends complete: send() only
+        // appends behind them. A wrapped ring goes out as two linked sends,
+        // in order; MSG_WAITALL has the kernel finish each one.
+        std::size_t first = std::min(session.tx_size, session.tx.size() - session.tx_head);
+        std::size_t runs[2][2] = {{session.tx_head, first}, {0, session.tx_size - first}};
+        unsigned count = first < session.tx_size ? 2 : 1;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            io_uring_sqe &sqe = ring_->next_sqe();
+            sqe.opcode = IORING_OP_SEND;
+            sqe.fd = session.fd;
+            sqe.addr = reinterpret_cast<std::uint64_t>(session.tx.data() + runs[i][0]);
+            sqe.len = static_cast<std::uint32_t>(runs[i][1]);
+            sqe.msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+            if (fixed_sends_)
+            {
+                sqe.ioprio = IORING_RECVSEND_FIXED_BUF;
+                sqe.buf_index = static_cast<std::uint16_t>(session.slot);
+            }
+            if (i + 1 < count)
+                sqe.flags = IOSQE_IO_LINK;
+            sqe.user_data = tag(Op::Send, session.slot);
+        }
+        session.sends_in_flight = count;
+    }
+
+#endif
+
+}
@@ -0,0 +1,482 @@
+#include "TextKernels.hpp"
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define MERCEX_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace MercEx
+{
+
+    namespace
+    {
+        constexpr std::uint64_t kPow10[] = {1ULL,
+                                            10ULL,
+                                            100ULL,
+                                            1000ULL,
+                                            10000ULL,
+                                            100000ULL,
+                                            1000000ULL,
+                                            10000000ULL,
+                                            100000000ULL,
+                                            1000000000ULL,
+                                            10000000000ULL,
+                                            100000000000ULL,
+                                            1000000000000ULL,
+                                            10000000000000ULL,
+                                            100000000000000ULL,
+                                            1000000000000000ULL,
+                                            10000000000000000ULL,
+                                            100000000000000000ULL,
+                                            1000000000000000000ULL};
+
+        // One set of kernels. digits16 takes 1 to 16 digits; the public
+        // functions split longer numbers.
+        struct Kernels
+        {
+            const char *(*scan_byte)(const char *p, const char *end, char c);
+            const char *(*scan_any)(const char *p, const char *end, const char *set, std::size_t set_size);
+            std::size_t (*index_byte)(const char *p, std::size_t size, char c, std::uint32_t *out, std::size_t max);
+            std::uint8_t (*checksum)(const char *p, std::size_t size);
+            bool (*digits16)(const char *p, std::size_t size, std::uint64_t &out);
+            std::size_t (*digit_run)(const char *p, const char *end); // capped at 20
+        };
+
+        bool is_digit(char c)
+        {
+            return static_cast<unsigned char>(c - '0') < 10;
+        }
+
+        // Scalar: byte at a time, and the reference the others are checked
+        // and benchmarked against.
+
+        const char *scan_byte_scalar(const char *p, const char *end, char c)
+        {
+            while (p != end && *p != c)
+                ++p;
+            return p;
+        }
+
+        const char *scan_any_scalar(const char *p, const char *end, const char *set, std::size_t set_size)
+        {
+            for (; p != end; ++p)
+            {
+                for (std::size_t i = 0; i < set_size; ++i)
+                {
+                    if (*p == set[i])
+                        return p;
+                }
+            }
+            return p;
+        }
+
+        // Continues an index from offset i with n offsets already written.
+        std::size_t index_tail(const char *p, std::size_t i, std::size_t size, char c, std::uint32_t *out,
+                               std::size_t n, std::size_t max)
+        {
+            for (; i < size && n < max; ++i)
+            {
+                if (p[i] == c)
+                    out[n++] = static_cast<std::uint32_t>(i);
+            }
+            return n;
+        }
+
+        std::size_t index_byte_scalar(const char *p, std::size_t size, char c, std::uint32_t *out, std::size_t max)
+        {
+            return index_tail(p, 0, size, c, out, 0, max);
+        }
+
+        std::uint8_t checksum_scalar(const char *p, std::size_t size)
+        {
+            unsigned sum = 0;
+            for (std::size_t i = 0; i < size; ++i)
+                sum += static_cast<unsigned char>(p[i]);
+            return static_cast<std::uint8_t>(sum);
+        }
+
+        bool digits16_scalar(const char *p, std::size_t size, std::uint64_t &out)
+        {
+            std::uint64_t value = 0;
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                if (!is_digit(p[i]))
+                    return false;
+                value = value * 10 + static_cast<std::uint64_t>(p[i] - '0');
+            }
+            out = value;
+            return true;
+        }
+
+        std::size_t digit_run_scalar(const char *p, const char *end)
+        {
+            std::size_t n = 0;
+            while (p + n != end && n < 20 && is_digit(p[n]))
+                ++n;
+            return n;
+        }
+
+        constexpr Kernels kScalar = {scan_byte_scalar, scan_any_scalar, index_byte_scalar,
+                                     checksum_scalar,  digits16_scalar, digit_run_scalar};
+
+#ifdef MERCEX_X86_KERNELS
+
+        // pshufb controls that move the first n bytes of a register to its
+        // top n lanes and zero the rest: digits become right-aligned, with
+        // leading zeros, for the multiply-add reduction.
+        struct AlignTable
+        {
+            alignas(16) std::uint8_t masks[17][16];
+
+            constexpr AlignTable() : masks()
+            {
+                for (int n = 0; n <= 16; ++n)
+                {
+                    for (int i = 0; i < 16; ++i)
+                        masks[n][i] = i >= 16 - n ? static_cast<std::uint8_t>(i - (16 - n)) : 0x80;
+                }
+            }
+        };
+        constexpr AlignTable kAlign;
+
+        // Bytes [p, p + size), size <= 16, in a register; the bytes past size
+        // are unspecified. Reads whole sixteen bytes only when that cannot
+        // fault, i.e. when they do not reach into the next page.
+        __attribute__((target("sse4.2"))) __m128i load_partial(const char *p, std::size_t size)
+        {
+            if (size == 16 || (reinterpret_cast<std::uintptr_t>(p) & 4095) <= 4096 - 16)
+                return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            alignas(16) char tmp[16] = {};
+            std::memcpy(tmp, p, size);
+            return _mm_load_si128(reinterpret_cast<const __m128i *>(tmp));
+        }
+
+        // Lanes of v (already minus '0') that hold a digit.
+        __attribute__((target("sse4.2"))) unsigned digit_lanes(__m128i v)
+        {
+            const __m128i nine = _mm_set1_epi8(9);
+            return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, nine), nine)));
+        }
+
+        __attribute__((target("sse4.2"))) std::uint64_t sum_lanes(__m128i v)
+        {
+            alignas(16) std::uint64_t lanes[2];
+            _mm_store_si128(reinterpret_cast<__m128i *>(lanes), v);
+            return lanes[0] + lanes[1];
+        }
+
+        __attribute__((target("sse4.2"))) const char *scan_byte_sse42(const char *p, const char *end, char c)
+        {
+            const __m128i needle = _mm_set1_epi8(c);
+            for (; end - p >= 16; p += 16)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+                if (mask)
+                    return p + __builtin_ctz(mask);
+            }
+            return scan_byte_scalar(p, end, c);
+        }
+
+        __attribute__((target("sse4.2"))) const char *scan_any_sse42(const char *p, const char *end, const char *set,
+                                                                      std::size_t set_size)
+        {
+            // pcmpestri in "equal any" mode: the set is the first operand.
+            alignas(16) char set_bytes[16] = {};
+            std::memcpy(set_bytes, set, set_size);
+            const __m128i needles = _mm_load_si128(reinterpret_cast<const __m128i *>(set_bytes));
+            const int n = static_cast<int>(set_size);
+            for (; end - p >= 16; p += 16)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                int i = _mm_cmpestri(needles, n, block, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY);
+                if (i < 16)
+                    return p + i;
+            }
+            return scan_any_scalar(p, end, set, set_size);
+        }
+
+        __attribute__((target("sse4.2"))) std::size_t index_byte_sse42(const char *p, std::size_t size, char c,
+                                                                        std::uint32_t *out, std::size_t max)
+        {
+            const __m128i needle = _mm_set1_epi8(c);
+            std::size_t n = 0, i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+                for (; mask; mask &= mask - 1)
+                {
+                    if (n == max)
+                        return n;
+                    out[n++] = static_cast<std::uint32_t>(i + __builtin_ctz(mask));
+                }
+            }
+            return index_tail(p, i, size, c, out, n, max);
+        }
+
+        __attribute__((target("sse4.2"))) std::uint8_t checksum_sse42(const char *p, std::size_t size)
+        {
+            // psadbw against zero sums eight bytes into each 64-bit lane.
+            const __m128i zero = _mm_setzero_si128();
+            __m128i acc = zero;
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+                acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i)), zero));
+            return static_cast<std::uint8_t>(sum_lanes(acc) + checksum_scalar(p + i, size - i));
+        }
+
+        __attribute__((target("sse4.2"))) bool digits16_sse42(const char *p, std::size_t size, std::uint64_t &out)
+        {
+            __m128i v = _mm_sub_epi8(load_partial(p, size), _mm_set1_epi8('0'));
+            unsigned want = size == 16 ? 0xffffu : (1u << size) - 1;
+            if ((digit_lanes(v) & want) != want)
+                return false;
+            v = _mm_shuffle_epi8(v, _mm_load_si128(reinterpret_cast<const __m128i *>(kAlign.masks[size])));
+            // 16 digits -> 8 of two digits -> 4 of four -> 2 of eight.
+            __m128i pairs = _mm_maddubs_epi16(v, _mm_set1_epi16(0x010a));
+            __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00010064));
+            quads = _mm_packus_epi32(quads, quads);
+            __m128i octs = _mm_madd_epi16(quads, _mm_set1_epi32(0x00012710));
+            std::uint64_t high = static_cast<std::uint32_t>(_mm_cvtsi128_si32(octs));
+            std::uint64_t low = static_cast<std::uint32_t>(_mm_extract_epi32(octs, 1));
+            out = high * 100000000ULL + low;
+            return true;
+        }
+
+        __attribute__((target("sse4.2"))) std::size_t digit_run_sse42(const char *p, const char *end)
+        {
+            // Digits that run past 20 are too many for any caller; two blocks
+            // settle it.
+            std::size_t n = 0;
+            while (n < 20)
+            {
+                std::size_t avail = static_cast<std::size_t>(end - p) - n;
+                std::size_t size = avail < 16 ? avail : 16;
+                if (size == 0)
+                    break;
+                __m128i v = _mm_sub_epi8(load_partial(p + n, size), _mm_set1_epi8('0'));
+                unsigned stop = ~digit_lanes(v) | (1u << size);
+                std::size_t k = static_cast<std::size_t>(__builtin_ctz(stop));
+                n += k;
+                if (k < 16)
+                    break;
+            }
+            return n < 20 ? n : 20;
+        }
+
+        __attribute__((target("avx2"))) const char *scan_byte_avx2(const char *p, const char *end, char c)
+        {
+            const __m256i needle = _mm256_set1_epi8(c);
+            for (; end - p >= 32; p += 32)
+            {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+                if (mask)
+                    return p + __builtin_ctz(mask);
+            }
+            return scan_byte_sse42(p, end, c);
+        }
+
+        __attribute__((target("avx2"))) const char *scan_any_avx2(const char *p, const char *end, const char *set,
+                                                                   std::size_t set_size)
+        {
+            // One compare per set byte beats pcmpestri for the few delimiters
+            // a text format has.
+            for (; end - p >= 32; p += 32)
+            {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                __m256i hits = _mm256_setzero_si256();
+                for (std::size_t i = 0; i < set_size; ++i)
+                    hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(set[i])));
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+                if (mask)
+                    return p + __builtin_ctz(mask);
+            }
+            return scan_any_sse42(p, end, set, set_size);
+        }
+
+        __attribute__((target("avx2"))) std::size_t index_byte_avx2(const char *p, std::size_t size, char c,
+                                                                     std::uint32_t *out, std::size_t max)
+        {
+            // Under 32 bytes the SSE4.2 kernel is as fast; it has no 256-bit
+            // state to leave behind.
+            if (size < 32)
+                return index_byte_sse42(p, size, c, out, max);
+            // The last 1-31 bytes are a whole block ending at size, its bytes
+            // already seen shifted out of the mask, so every offset is written
+            // once and final: no narrower tail, no second pass over out.
+            const __m256i needle = _mm256_set1_epi8(c);
+            std::size_t n = 0;
+            for (std::size_t i = 0; i < size; i += 32)
+            {
+                std::size_t block = i + 32 <= size ? i : size - 32;
+                __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + block));
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, needle))) >>
+                                (i - block);
+                for (; mask; mask &= mask - 1)
+                {
+                    if (n == max)
+                        return n;
+                    out[n++] = static_cast<std::uint32_t>(i + __builtin_ctz(mask));
+                }
+            }
+            return n;
+        }
+
+        __attribute__((target("avx2"))) std::uint8_t checksum_avx2(const char *p, std::size_t size)
+        {
+            const __m256i zero = _mm256_setzero_si256();
+            __m256i acc = zero;
+            std::size_t i = 0;
+            for (; i + 32 <= size; i += 32)
+                acc = _mm256_add_epi64(acc,
+                                       _mm256_sad_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i)), zero));
+            __m128i half = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+            return static_cast<std::uint8_t>(sum_lanes(half) + checksum_sse42(p + i, size - i));
+        }
+
+        constexpr Kernels kSse42 = {scan_byte_sse42, scan_any_sse42, index_byte_sse42,
+                                    checksum_sse42,  digits16_sse42, digit_run_sse42};
+        constexpr Kernels kAvx2 = {scan_byte_avx2, scan_any_avx2,  index_byte_avx2,
+                                   checksum_avx2,  digits16_sse42, digit_run_sse42};
+
+#endif
+
+        const Kernels &kernels_for(SimdLevel level)
+        {
+#ifdef MERCEX_X86_KERNELS
+            if (level == SimdLevel::Avx2)
+                return kAvx2;
+            if (level == SimdLevel::Sse42)
+                return kSse42;
+#endif
+            (void)level;
+            return kScalar;
+        }
+
+        struct Active
+        {
+            SimdLevel level;
+            const Kernels *kernels;
+        };
+
+        Active &active()
+        {
+            static Active a{detected_simd_level(), &kernels_for(detected_simd_level())};
+            return a;
+        }
+    }
+
+    const char *simd_level_name(SimdLevel level)
+    {
+        switch (level)
+        {
+        case SimdLevel::Avx2:
+            return "avx2";
+        case SimdLevel::Sse42:
+            return "sse4.2";
+        default:
+            return "scalar";
+        }
+    }
+
+    SimdLevel detected_simd_level()
+    {
+#ifdef MERCEX_X86_KERNELS
+        // CPUID, and for AVX2 whether the OS saves the ymm registers.
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return SimdLevel::Avx2;
+        if (__builtin_cpu_supports("sse4.2"))
+            return SimdLevel::Sse42;
+#endif
+        return SimdLevel::Scalar;
+    }
+
+    SimdLevel active_simd_level()
+    {
+        return active().level;
+    }
+
+    SimdLevel set_simd_level(SimdLevel level)
+    {
+        SimdLevel detected = detected_simd_level();
+        if (static_cast<std::uint8_t>(level) > static_cast<std::uint8_t>(detected))
+            level = detected;
+        active() = {level, &kernels_for(level)};
+        return level;
+    }
+
+    const char *scan_byte(const char *p, const char *end, char c)
+    {
+        return active().kernels->scan_byte(p, end, c);
+    }
+
+    const char *scan_any(const char *p, const char *end, std::string_view set)
+    {
+        if (set.size() > 16)
+            set = set.substr(0, 16);
+        return active().kernels->scan_any(p, end, set.data(), set.size());
+    }
+
+    std::size_t index_byte(const char *p, std::size_t size, char c, std::uint32_t *out, std::size_t max)
+    {
+        return active().kernels->index_byte(p, size, c, out, max);
+    }
+
+    std::uint8_t text_checksum(const char *p, std::size_t size)
+    {
+        return active().kernels->checksum(p, size);
+    }
+
+    bool parse_digits(const char *p, std::size_t size, std::uint64_t &out)
+    {
+        if (size == 0 || size > 19)
+            return false;
+        const Kernels &k = *active().kernels;
+        if (size <= 16)
+            return k.digits16(p, size, out);
+        std::uint64_t high = 0, low = 0;
+        if (!k.digits16(p, size - 16, high) || !k.digits16(p + size - 16, 16, low))
+            return false;
+        out = high * kPow10[16] + low;
+        return true;
+    }
+
+    const char *parse_uint_prefix(const char *p, const char *end, std::uint64_t &out)
+    {
+        std::size_t n = active().kernels->digit_run(p, end);
+        if (n == 0 || n > 19 || !parse_digits(p, n, out))
+            return p;
+        return p + n;
+    }
+
+    bool parse_decimal(const char *p, std::size_t size, Decimal &out)
+    {
+        const char *end = p + size;
+        bool negative = p != end && *p == '-';
+        p += negative;
+        const char *point = scan_byte(p, end, '.');
+        std::size_t whole_size = static_cast<std::size_t>(point - p);
+        std::size_t frac_size = point == end ? 0 : static_cast<std::size_t>(end - point - 1);
+        if (whole_size + frac_size == 0 || whole_size + frac_size > 18)
+            return false;
+        std::uint64_t whole = 0, frac = 0;
+        if ((whole_size && !parse_digits(p, whole_size, whole)) || (frac_size && !parse_digits(point + 1, frac_size, frac)))
+            return false;
+        auto mantissa = static_cast<std::int64_t>(whole * kPow10[frac_size] + frac);
+        out.mantissa = negative ? -mantissa : mantissa;
+        out.decimals = static_cast<std::uint32_t>(frac_size);
+        return true;
+    }
+
+    double to_double(const Decimal &d)
+    {
+        // With fewer than 16 significant digits both operands are exact, so
+        // the quotient is the correctly rounded price.
+        return static_cast<double>(d.mantissa) / static_cast<double>(kPow10[d.decimals]);
+    }
+
+}
@@ -0,0 +1,101 @@
+#include "ThreadPlacement.hpp"
+#include <cstdlib>
+#include <iostream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace MercEx
+{
+
+    int numa_node_of_cpu(int cpu)
+    {
+#ifdef __linux__
+        if (cpu < 0)
+            return -1;
+        std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        DIR *d = ::opendir(dir.c_str());
+        if (!d)
+            return -1;
+        int node = -1;
+        while (dirent *entry = ::readdir(d))
+        {
+            if (std::strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9')
+            {
+                node = std::atoi(entry->d_name + 4);
+                break;
+            }
+        }
+        ::closedir(d);
+        return node;
+#else
+        (void)cpu;
+        return -1;
+#endif
+    }
+
+    bool apply_thread_placement(const ThreadPlacement &placement, const std::string &name)
+    {
+#ifdef __linux__
+        bool ok = true;
+        auto fail = [&](const char *what, int err)
+        {
+            std::cerr << "[Placement] " << name << ": " << what << " failed: " << std::strerror(err) << std::endl;
+            ok = false;
+        };
+
+        // Thread names are limited to 15 characters.
+        ::pthread_setname_np(::pthread_self(), name.substr(0, 15).c_str());
+
+        if (placement.cpu >= 0)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(placement.cpu, &set);
+            if (int err = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set))
+                fail("pinning to cpu", err);
+        }
+
+        int node = placement.numa_node >= 0 ? placement.numa_node : numa_node_of_cpu(placement.cpu);
+        if (node >= 0)
+        {
+            // MPOL_PREFERRED rather than MPOL_BIND: fall back to another node
+            // instead of failing allocations when the local one is full.
+            constexpr int kMaxNodes = 1024;
+            unsigned long mask[kMaxNodes / (8 * sizeof(unsigned long))] = {};
+            if (node < kMaxNodes)
+            {
+                mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+                if (::syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, kMaxNodes + 1) != 0)
+                    fail("setting memory policy", errno);
+            }
+            else
+            {
+                fail("setting memory policy", EINVAL);
+            }
+        }
+
+        if (placement.realtime_priority > 0)
+        {
+            sched_param param{};
+            param.sched_priority = placement.realtime_priority;
+            if (int err = ::pthread_setschedparam(::pthread_self(), SCHED_FIFO, &param))
+                fail("SCHED_FIFO", err);
+        }
+        return ok;
+#else
+        if (!placement.is_default())
+            std::cerr << "[Placement] " << name << ": thread placement is only supported on Linux" << std::endl;
+        return placement.is_default();
+#endif
+    }
+
+}
@@ -0,0 +1,154 @@
+#include "UringJournal.hpp"
+
+#ifdef __linux__
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace MercEx
+{
+
+    namespace
+    {
+        constexpr std::uint64_t kSyncFlag = std::uint64_t(1) << 32;
+    }
+
+    UringJournal::UringJournal(const std::string &path, bool durable, std::size_t buffer_size, unsigned buffers)
+        : ring_(buffers * 2), durable_(durable), buffer_size_(buffer_size), pending_(buffers), lengths_(buffers)
+    {
+        if (buffers < 2 || buffer_size == 0 || buffer_size > 0xffffffffu)
+            throw std::invalid_argument("UringJournal needs at least two buffers of a sane size");
+
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0)
+            throw std::runtime_error("Cannot open journal " + path + ": " + std::strerror(errno));
+
+        void *memory = ::mmap(nullptr, buffers * buffer_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+        {
+            ::close(fd_);
+            throw std::runtime_error("UringJournal: out of memory");
+        }
+        memory_ = static_cast<char *>(memory);
+
+        std::vector<iovec> iov(buffers);
+        for (unsigned i = 0; i < buffers; ++i)
+            iov[i] = {memory_ + i * buffer_size, buffer_size};
+        try
+        {
+            ring_.register_buffers(iov.data(), buffers);
+        }
+        catch (...)
+        {
+            ::munmap(memory_, buffers * buffer_size);
+            ::close(fd_);
+            throw;
+        }
+    }
+
+    UringJournal::~UringJournal()
+    {
+        try
+        {
+            flush();
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "[Journal] " << e.what() << std::endl;
+        }
+        ::munmap(memory_, pending_.size() * buffer_size_);
+        ::close(fd_);
+    }
+
+    void UringJournal::append(const void *data, std::size_t size)
+    {
+        if (error_)
+            throw std::runtime_error(std::string("Journal write failed: ") + std::strerror(error_));
+        const char *bytes = static_cast<const char *>(data);
+        while (size > 0)
+        {
+            if (fill_ == buffer_size_)
+                submit_current();
+            std::size_t n = std::min(size, buffer_size_ - fill_);
+            std::memcpy(memory_ + current_ * buffer_size_ + fill_, bytes, n);
+            fill_ += n;
+            bytes += n;
+            size -= n;
+        }
+    }
+
+    void UringJournal::flush()
+    {
+        submit_current();
+        while (std::any_of(pending_.begin(), pending_.end(), [](unsigned n) { return n > 0; }))
+            reap(true);
+        if (error_)
+            throw std::runtime_error(std::string("Journal write failed: ") + std::strerror(error_));
+    }
+
+    void UringJournal::submit_current()
+    {
+        if (fill_ == 0)
+            return;
+
+        io_uring_sqe &write = ring_.next_sqe();
+        write.opcode = IORING_OP_WRITE_FIXED;
+        write.fd = fd_;
+        write.addr = reinterpret_cast<std::uint64_t>(memory_ + current_ * buffer_size_);
+        write.len = static_cast<std::uint32_t>(fill_);
+        write.off = offset_;
+        write.buf_index = static_cast<std::uint16_t>(current_);
+        write.user_data = current_;
+        pending_[current_] = 1;
+        lengths_[current_] = fill_;
+        if (durable_)
+        {
+            // Linked: the sync starts once this write has completed, and is
+            // cancelled if it fails.
+            write.flags = IOSQE_IO_LINK;
+            io_uring_sqe &sync = ring_.next_sqe();
+            sync.opcode = IORING_OP_FSYNC;
+            sync.fd = fd_;
+            sync.fsync_flags = IORING_FSYNC_DATASYNC;
+            sync.user_data = kSyncFlag | current_;
+            pending_[current_] = 2;
+        }
+
+        offset_ += fill_;
+        fill_ = 0;
+        current_ = (current_ + 1) % pending_.size();
+        reap(false);
+        while (pending_[current_] > 0)
+            reap(true);
+    }
+
+    void UringJournal::reap(bool wait)
+    {
+        int ret = ring_.submit(wait ? 1 : 0);
+        if (ret < 0 && ret != -EBUSY && ret != -EAGAIN)
+            throw std::runtime_error(std::string("Journal io_uring_enter: ") + std::strerror(-ret));
+        ring_.drain_completions(
+            [this](const io_uring_cqe &cqe)
+            {
+                unsigned buffer = static_cast<unsigned>(cqe.user_data & 0xffffffffu);
+                --pending_[buffer];
+                bool sync = cqe.user_data & kSyncFlag;
+                int err = 0;
+                if (cqe.res < 0)
+                    err = -cqe.res;
+                else if (!sync && static_cast<std::size_t>(cqe.res) != lengths_[buffer])
+                    err = EIO; // a short write to a regular file: out of space
+                if (err && !error_)
+                    error_ = err;
+            });
+    }
+
+}
+
+#endif
@@ -0,0 +1,889 @@
+// Behaviour tests: the book's order types and modifies, ID handling and
+// batches, and the transports around the engine (FIX sessions, the network
+// and shared-memory feeds, shared-memory order entry). MarketTest runs one
+// market inline, so every engine call has matched, reported and published
+// by the time it returns; gateways and feeds run their own threads and are
+// waited on.
+#include "MatchingEngine.hpp"
+#include "MarketRegistry.hpp"
+#include "MarketDataPublisher.hpp"
+#include "ExecutionReportRouter.hpp"
+#include "BinaryOrderEntry.hpp"
+#include "OrderCapture.hpp"
+#include "EventDigest.hpp"
+#include "ShmMarketDataFeed.hpp"
+#include "ShmOrderGateway.hpp"
+#include "FixGateway.hpp"
+#include "MarketDataFeed.hpp"
+#include "FeedReceiver.hpp"
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace MercEx;
+
+namespace
+{
+    class EventRecorder : public IMarketDataListener
+    {
+    public:
+        void on_market_events(const std::vector<MarketEvent> &batch) override
+        {
+            events.insert(events.end(), batch.begin(), batch.end());
+        }
+
+        std::vector<MarketEvent> events;
+    };
+
+    // Holds the publisher thread in its first dispatch until released.
+    class StallingListener : public IMarketDataListener
+    {
+    public:
+        void on_market_events(const std::vector<MarketEvent> &) override
+        {
+            stalled = true;
+            while (!released.load())
+                std::this_thread::yield();
+        }
+
+        std::atomic<bool> stalled{false};
+        std::atomic<bool> released{false};
+    };
+
+    // A FIX counterparty on a blocking socket, for driving FixGateway.
+    class FixClient
+    {
+    public:
+        using Field = std::pair<int, std::string>;
+        using Message = std::map<int, std::string>;
+
+        explicit FixClient(std::uint16_t port)
+        {
+            fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            EXPECT_EQ(::connect(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+        }
+        ~FixClient() { ::close(fd_); }
+
+        void send(std::string_view msg_type, std::uint64_t seq_num, const std::vector<Field> &fields = {})
+        {
+            writer_.begin(msg_type);
+            writer_.field(FixTag::SenderCompID, std::string_view("CLIENT1"));
+            writer_.field(FixTag::TargetCompID, std::string_view("MERCURY"));
+            writer_.field(FixTag::MsgSeqNum, seq_num);
+            writer_.field(FixTag::SendingTime, std::string_view("20260101-00:00:00.000"));
+            for (const Field &f : fields)
+                writer_.field(f.first, std::string_view(f.second));
+            std::string_view out = writer_.finish();
+            ASSERT_EQ(::send(fd_, out.data(), out.size(), 0), static_cast<ssize_t>(out.size()));
+        }
+
+        // The next message from the gateway; empty if none comes in time.
+        Message receive(std::chrono::milliseconds timeout = std::chrono::seconds(2))
+        {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            for (;;)
+            {
+                FixMessage msg;
+                FixParseResult parsed = fix_parse(in_.data(), in_.size(), msg);
+                if (parsed.status == FixParseStatus::Complete)
+                {
+                    Message out;
+                    for (const FixField &f : msg)
+                        out.emplace(f.tag, in_.substr(f.offset, f.length));
+                    in_.erase(0, parsed.consumed);
+                    return out;
+                }
+                EXPECT_EQ(parsed.status, FixParseStatus::Incomplete);
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline -
+                                                                                  std::chrono::steady_clock::now());
+                pollfd pfd{fd_, POLLIN, 0};
+                if (parsed.status != FixParseStatus::Incomplete || left.count() <= 0 ||
+                    ::poll(&pfd, 1, static_cast<int>(left.count())) <= 0)
+                    return {};
+                char buf[4096];
+                ssize_t n = ::recv(fd_, buf, sizeof(buf), 0);
+                if (n <= 0)
+                    return {};
+                in_.append(buf, static_cast<std::size_t>(n));
+            }
+        }
+
+    private:
+        int fd_ = -1;
+        FixWriter writer_;
+        std::string in_;
+    };
+
+    class MarketTest : public ::testing::Test
+    {
+    protected:
+        static constexpr ClientID kBuyer = 1;
+        static constexpr ClientID kSeller = 2;
+
+        MarketTest() : publisher_(ExecutionMode::Inline), registry_(publisher_, &reports_, ExecutionMode::Inline),
+                       engine_(registry_)
+        {
+            publisher_.subscribe(&recorder_);
+            reports_.open_session(kBuyer);
+            reports_.open_session(kSeller);
+            market_ = &registry_.create_market("AAPL", 0.01, 1).get_market();
+        }
+
+        OrderID submit(ClientID client, Side side, Quantity quantity, std::optional<Price> price,
+                       OrderType type = OrderType::Limit, Quantity display_qty = 0,
+                       std::optional<Peg> peg = std::nullopt)
+        {
+            SubmitResult result = engine_.submit_order(client, "AAPL", quantity, side, price, type, TimeInForce::Day,
+                                                       std::nullopt, display_qty, peg);
+            EXPECT_EQ(result.reason, RejectReason::None);
+            return result.order_id;
+        }
+
+        OrderID limit(ClientID client, Side side, Quantity quantity, Price price)
+        {
+            return submit(client, side, quantity, price);
+        }
+
+        OrderID iceberg(ClientID client, Side side, Quantity quantity, Price price, Quantity display_qty)
+        {
+            return submit(client, side, quantity, price, OrderType::Iceberg, display_qty);
+        }
+
+        OrderID pegged(ClientID client, Side side, Quantity quantity, PegReference reference, Price offset)
+        {
+            return submit(client, side, quantity, std::nullopt, OrderType::Pegged, 0, Peg{reference, offset});
+        }
+
+        static OrderRequest limit_request(ClientID client, Side side, Quantity quantity, Price price)
+        {
+            return {client, "AAPL", quantity, side, price, OrderType::Limit, TimeInForce::Day, std::nullopt};
+        }
+
+        // The orders resting at one price, in queue order.
+        std::vector<OrderID> queue(Side side, Price price)
+        {
+            std::vector<OrderID> ids;
+            auto collect = [&](auto &levels)
+            {
+                auto level = levels.find(price);
+                if (level != levels.end())
+                {
+                    for (const Order *order : level->second.orders)
+                        ids.push_back(order->id);
+                }
+            };
+            if (side == Side::Buy)
+                collect(market_->get_buybook().get_orders());
+            else
+                collect(market_->get_sellbook().get_orders());
+            return ids;
+        }
+
+        std::vector<ExecutionReport> reports(ClientID client)
+        {
+            std::vector<ExecutionReport> out;
+            ExecutionReport r;
+            while (reports_.open_session(client).poll(r))
+                out.push_back(r);
+            return out;
+        }
+
+        ExecutionReportRouter reports_;
+        EventRecorder recorder_; // outlives the publisher's dispatching
+        MarketDataPublisher publisher_;
+        MarketRegistry registry_;
+        MatchingEngine engine_;
+        Market *market_ = nullptr;
+    };
+
+    // --- Batches and ID blocks ---
+
+    TEST_F(MarketTest, BatchGivesEachMarketAContiguousRangeAndAnswersInRequestOrder)
+    {
+        MarketID msft = registry_.create_market("MSFT", 0.01, 2).get_market_id();
+        auto request = [](const char *symbol, Price price)
+        {
+            return OrderRequest{kSeller, symbol, 10, Side::Sell, price, OrderType::Limit, TimeInForce::Day,
+                                std::nullopt};
+        };
+        std::vector<SubmitResult> results = engine_.submit_orders(
+            {request("AAPL", 100.00), request("MSFT", 50.00), request("XYZ", 1.00), request("AAPL", 100.00)});
+
+        ASSERT_EQ(results.size(), 4u);
+        EXPECT_EQ(results[0].reason, RejectReason::None);
+        EXPECT_EQ(results[1].reason, RejectReason::None);
+        EXPECT_EQ(results[2].reason, RejectReason::UnknownMarket);
+        EXPECT_EQ(results[3].reason, RejectReason::None);
+        EXPECT_EQ(results[3].order_id, results[0].order_id + 1);
+        EXPECT_EQ(OrderIdGenerator::market_of(results[0].order_id), 1);
+        EXPECT_EQ(OrderIdGenerator::market_of(results[1].order_id), msft);
+        EXPECT_EQ(queue(Side::Sell, 100.00), (std::vector<OrderID>{results[0].order_id, results[3].order_id}));
+
+        std::size_t queued = engine_.cancel_orders({{results[0].order_id, "AAPL", kSeller},
+                                                    {results[1].order_id, "XYZ", kSeller},
+                                                    {results[0].order_id + 100, "AAPL", kSeller}});
+        EXPECT_EQ(queued, 2u);
+        EXPECT_EQ(queue(Side::Sell, 100.00), std::vector<OrderID>{results[3].order_id});
+        auto r = reports(kSeller);
+        ASSERT_EQ(r.size(), 5u); // three News, then the cancel and the unknown ID's reject
+        EXPECT_EQ(r[3].type, ExecType::Canceled);
+        EXPECT_EQ(r[4].type, ExecType::CancelRejected);
+    }
+
+    TEST_F(MarketTest, ReservedBlockIsNeverIssuedByTheSharedCounter)
+    {
+        OrderID before = limit(kBuyer, Side::Buy, 1, 99.00);
+        OrderIdBlock block = engine_.reserve_order_ids("AAPL", kSeller, 3);
+        OrderID after = limit(kBuyer, Side::Buy, 1, 99.00);
+
+        ASSERT_EQ(block.size(), 3u);
+        EXPECT_EQ(OrderIdGenerator::market_of(block.next), 1);
+        EXPECT_GT(block.next, before);
+        EXPECT_GE(after, block.end);
+        while (!block.empty())
+            EXPECT_EQ(engine_.submit_order(block.take(), limit_request(kSeller, Side::Sell, 1, 100.00)).reason,
+                      RejectReason::None);
+        EXPECT_EQ(queue(Side::Sell, 100.00).size(), 3u);
+    }
+
+    // --- Caller-supplied IDs ---
+
+    TEST_F(MarketTest, DuplicateIdIsRejectedWithoutTouchingTheRestingOrder)
+    {
+        OrderID id = engine_.reserve_order_ids("AAPL", kSeller, 4).take();
+        ASSERT_EQ(engine_.submit_order(id, limit_request(kSeller, Side::Sell, 10, 100.00)).reason, RejectReason::None);
+        engine_.submit_order(id, limit_request(kSeller, Side::Sell, 7, 101.00));
+
+        auto r = reports(kSeller);
+        ASSERT_EQ(r.size(), 2u);
+        EXPECT_EQ(r[0].type, ExecType::New);
+        EXPECT_EQ(r[1].type, ExecType::Rejected);
+        EXPECT_EQ(r[1].reason, RejectReason::InvalidOrder);
+        EXPECT_EQ(r[1].order_id, id);
+        EXPECT_EQ(queue(Side::Sell, 100.00), std::vector<OrderID>{id});
+        EXPECT_TRUE(queue(Side::Sell, 101.00).empty());
+
+        // The resting order still trades as submitted.
+        limit(kBuyer, Side::Buy, 10, 100.00);
+        EXPECT_TRUE(queue(Side::Sell, 100.00).empty());
+        r = reports(kSeller);
+        ASSERT_EQ(r.size(), 1u);
+        EXPECT_EQ(r[0].type, ExecType::Fill);
+        EXPECT_EQ(r[0].last_qty, 10);
+    }
+
+    TEST_F(MarketTest, IdOutsideTheCallersBlockIsRejected)
+    {
+        OrderIdBlock block = engine_.reserve_order_ids("AAPL", kSeller, 2);
+        ASSERT_EQ(block.size(), 2u);
+        OrderID issued = limit(kBuyer, Side::Buy, 1, 99.00); // from the shared counter, never reserved
+
+        auto rejected = [&](OrderID id, ClientID client)
+        {
+            return engine_.submit_order(id, limit_request(client, Side::Sell, 10, 100.00)).reason ==
+                   RejectReason::InvalidOrder;
+        };
+        EXPECT_TRUE(rejected(block.next, kBuyer));
+        EXPECT_TRUE(rejected(block.end, kSeller));
+        EXPECT_TRUE(rejected(issued + 1000, kSeller));
+        EXPECT_TRUE(rejected(issued, kBuyer));
+        EXPECT_TRUE(queue(Side::Sell, 100.00).empty());
+
+        EXPECT_FALSE(rejected(block.next, kSeller));
+        EXPECT_FALSE(rejected(block.next + 1, kSeller));
+        EXPECT_EQ(queue(Side::Sell, 100.00).size(), 2u);
+    }
+
+    TEST_F(MarketTest, ConsecutiveReservationsByOneClientStayUsable)
+    {
+        OrderIdBlock first = engine_.reserve_order_ids("AAPL", kSeller, 1);
+        OrderIdBlock other = engine_.reserve_order_ids("AAPL", kBuyer, 1);
+        OrderIdBlock second = engine_.reserve_order_ids("AAPL", kSeller, 1);
+        OrderIdBlock third = engine_.reserve_order_ids("AAPL", kSeller, 1);
+        EXPECT_EQ(second.end, third.next);
+
+        for (OrderID id : {first.next, second.next, third.next})
+            EXPECT_EQ(engine_.submit_order(id, limit_request(kSeller, Side::Sell, 1, 100.00)).reason,
+                      RejectReason::None);
+        EXPECT_EQ(engine_.submit_order(other.next, limit_request(kSeller, Side::Sell, 1, 100.00)).reason,
+                  RejectReason::InvalidOrder);
+        EXPECT_TRUE(engine_.reserve_order_ids("MSFT", kSeller, 1).empty());
+    }
+
+    // --- Iceberg orders ---
+
+    TEST_F(MarketTest, IcebergShowsOnlyItsSlice)
+    {
+        iceberg(kSeller, Side::Sell, 100, 100.00, 10);
+        const PriceLevel &level = market_->get_sellbook().get_orders().at(100.00);
+        EXPECT_EQ(level.visible, 10);
+        EXPECT_EQ(level.hidden, 90);
+    }
+
+    TEST_F(MarketTest, ReplenishedIcebergGoesToTheBackOfItsLevel)
+    {
+        OrderID ice = iceberg(kSeller, Side::Sell, 30, 100.00, 10);
+        OrderID plain = limit(kSeller, Side::Sell, 5, 100.00);
+        limit(kBuyer, Side::Buy, 10, 100.00);
+
+        EXPECT_EQ(queue(Side::Sell, 100.00), (std::vector<OrderID>{plain, ice}));
+        const PriceLevel &level = market_->get_sellbook().get_orders().at(100.00);
+        EXPECT_EQ(level.visible, 15);
+        EXPECT_EQ(level.hidden, 10);
+    }
+
+    TEST_F(MarketTest, IcebergEventsPublishOnlyTradedAndDisplayedSizes)
+    {
+        OrderID ice = iceberg(kSeller, Side::Sell, 100, 100.00, 10);
+        OrderID plain = limit(kSeller, Side::Sell, 5, 100.00);
+        recorder_.events.clear();
+        OrderID buy = limit(kBuyer, Side::Buy, 18, 100.00);
+
+        // The slice trades, the next one shows at the back, the plain order
+        // fills, and the iceberg is hit again.
+        const auto &ev = recorder_.events;
+        ASSERT_EQ(ev.size(), 6u);
+        EXPECT_EQ(ev[0].type, MarketEventType::Trade);
+        EXPECT_EQ(*ev[0].counterparty_id, ice);
+        EXPECT_EQ(*ev[0].executed_qty, 10);
+        EXPECT_EQ(ev[0].quantity, 0);
+        EXPECT_EQ(ev[1].type, MarketEventType::Replenish);
+        EXPECT_EQ(ev[1].order_id, ice);
+        EXPECT_EQ(ev[1].quantity, 10);
+        EXPECT_EQ(ev[1].price, 100.00);
+        EXPECT_EQ(ev[2].type, MarketEventType::Trade);
+        EXPECT_EQ(*ev[2].counterparty_id, plain);
+        EXPECT_EQ(ev[3].type, MarketEventType::FilledOrder);
+        EXPECT_EQ(ev[3].order_id, plain);
+        EXPECT_EQ(ev[4].type, MarketEventType::Trade);
+        EXPECT_EQ(*ev[4].counterparty_id, ice);
+        EXPECT_EQ(*ev[4].executed_qty, 3);
+        EXPECT_EQ(ev[4].quantity, 7); // the slice left, not the 87 behind it
+        EXPECT_EQ(ev[5].type, MarketEventType::FilledOrder);
+        EXPECT_EQ(ev[5].order_id, buy);
+        for (const MarketEvent &e : ev)
+            EXPECT_LE(e.quantity, 10);
+    }
+
+    TEST_F(MarketTest, IcebergReportsCarryItsLeaves)
+    {
+        OrderID ice = iceberg(kSeller, Side::Sell, 100, 100.00, 10);
+        reports(kSeller);
+        // Alone at its level, the iceberg is hit once per slice.
+        limit(kBuyer, Side::Buy, 25, 100.00);
+
+        std::vector<Quantity> leaves;
+        for (const ExecutionReport &r : reports(kSeller))
+        {
+            EXPECT_EQ(r.order_id, ice);
+            EXPECT_EQ(r.type, ExecType::PartialFill);
+            leaves.push_back(r.leaves_qty);
+        }
+        EXPECT_EQ(leaves, (std::vector<Quantity>{90, 80, 75}));
+    }
+
+    // --- Pegged orders ---
+
+    TEST_F(MarketTest, PegFollowsItsReference)
+    {
+        limit(kBuyer, Side::Buy, 10, 100.00);
+        limit(kSeller, Side::Sell, 10, 101.00);
+        pegged(kBuyer, Side::Buy, 5, PegReference::BestBid, -0.02);
+        EXPECT_EQ(queue(Side::Buy, 99.98).size(), 1u);
+
+        limit(kBuyer, Side::Buy, 10, 100.50);
+        EXPECT_TRUE(queue(Side::Buy, 99.98).empty());
+        EXPECT_EQ(queue(Side::Buy, 100.48).size(), 1u);
+    }
+
+    TEST_F(MarketTest, PegIsCappedATickInsideTheOppositeBest)
+    {
+        limit(kBuyer, Side::Buy, 10, 100.00);
+        limit(kSeller, Side::Sell, 10, 100.02);
+        OrderID peg = pegged(kBuyer, Side::Buy, 5, PegReference::BestBid, 0.05);
+
+        EXPECT_EQ(queue(Side::Buy, 100.01), std::vector<OrderID>{peg});
+        EXPECT_EQ(market_->get_ask_price(), 100.02);
+    }
+
+    TEST_F(MarketTest, CappedPegMovesWhenTheOppositeBestMoves)
+    {
+        limit(kBuyer, Side::Buy, 10, 100.00);
+        OrderID ask = limit(kSeller, Side::Sell, 10, 100.02);
+        OrderID peg = pegged(kBuyer, Side::Buy, 5, PegReference::BestBid, 0.05);
+        ASSERT_EQ(queue(Side::Buy, 100.01), std::vector<OrderID>{peg});
+
+        // The bid, its reference, never moves: only the cap does.
+        ASSERT_TRUE(engine_.cancel_order(ask, "AAPL", kSeller));
+        limit(kSeller, Side::Sell, 10, 101.00);
+        EXPECT_TRUE(queue(Side::Buy, 100.01).empty());
+        EXPECT_EQ(queue(Side::Buy, 100.05), std::vector<OrderID>{peg});
+
+        // An ask just above the target does not cap it.
+        limit(kSeller, Side::Sell, 10, 100.06);
+        EXPECT_EQ(queue(Side::Buy, 100.05), std::vector<OrderID>{peg});
+    }
+
+    TEST_F(MarketTest, CappedSellPegMovesWhenTheBidMoves)
+    {
+        OrderID bid = limit(kBuyer, Side::Buy, 10, 100.00);
+        limit(kSeller, Side::Sell, 10, 100.10);
+        OrderID peg = pegged(kSeller, Side::Sell, 5, PegReference::BestAsk, -0.20);
+        ASSERT_EQ(queue(Side::Sell, 100.01), std::vector<OrderID>{peg});
+
+        ASSERT_TRUE(engine_.cancel_order(bid, "AAPL", kBuyer));
+        limit(kBuyer, Side::Buy, 10, 99.00);
+        EXPECT_TRUE(queue(Side::Sell, 100.01).empty());
+        EXPECT_EQ(queue(Side::Sell, 99.90), std::vector<OrderID>{peg});
+    }
+
+    // --- Modifies ---
+
+    TEST_F(MarketTest, ReducedOrderKeepsItsPriority)
+    {
+        OrderID a = limit(kSeller, Side::Sell, 10, 100.00);
+        OrderID b = limit(kSeller, Side::Sell, 10, 100.00);
+        reports(kSeller);
+
+        ASSERT_TRUE(engine_.modify_order(a, "AAPL", kSeller, 4));
+        EXPECT_EQ(queue(Side::Sell, 100.00), (std::vector<OrderID>{a, b}));
+        auto r = reports(kSeller);
+        ASSERT_EQ(r.size(), 1u);
+        EXPECT_EQ(r[0].type, ExecType::Replaced);
+        EXPECT_EQ(r[0].leaves_qty, 4);
+
+        // The fill goes to the reduced order first.
+        limit(kBuyer, Side::Buy, 4, 100.00);
+        EXPECT_EQ(queue(Side::Sell, 100.00), std::vector<OrderID>{b});
+    }
+
+    TEST_F(MarketTest, IncreasedOrderLosesItsPriority)
+    {
+        OrderID a = limit(kSeller, Side::Sell, 10, 100.00);
+        OrderID b = limit(kSeller, Side::Sell, 10, 100.00);
+
+        ASSERT_TRUE(engine_.modify_order(a, "AAPL", kSeller, 15));
+        EXPECT_EQ(queue(Side::Sell, 100.00), (std::vector<OrderID>{b, a}));
+        EXPECT_EQ(market_->get_sellbook().get_orders().at(100.00).visible, 25);
+    }
+
+    TEST_F(MarketTest, RepricedOrderMatchesWhatItCrosses)
+    {
+        limit(kBuyer, Side::Buy, 6, 99.00);
+        OrderID sell = limit(kSeller, Side::Sell, 10, 100.00);
+        reports(kSeller);
+
+        ASSERT_TRUE(engine_.modify_order(sell, "AAPL", kSeller, 10, 99.00));
+        EXPECT_TRUE(queue(Side::Sell, 100.00).empty());
+        EXPECT_TRUE(queue(Side::Buy, 99.00).empty());
+        EXPECT_EQ(queue(Side::Sell, 99.00), std::vector<OrderID>{sell});
+
+        auto r = reports(kSeller);
+        ASSERT_EQ(r.size(), 2u);
+        EXPECT_EQ(r[0].type, ExecType::Replaced);
+        EXPECT_EQ(r[1].type, ExecType::PartialFill);
+        EXPECT_EQ(r[1].last_qty, 6);
+        EXPECT_EQ(r[1].last_price, 99.00);
+        EXPECT_EQ(r[1].leaves_qty, 4);
+    }
+
+    TEST_F(MarketTest, ModifyBelowTheFilledQuantityIsRejected)
+    {
+        OrderID sell = limit(kSeller, Side::Sell, 10, 100.00);
+        limit(kBuyer, Side::Buy, 6, 100.00);
+        reports(kSeller);
+
+        // The new quantity counts the 6 already filled.
+        engine_.modify_order(sell, "AAPL", kSeller, 6);
+        auto r = reports(kSeller);
+        ASSERT_EQ(r.size(), 1u);
+        EXPECT_EQ(r[0].type, ExecType::ReplaceRejected);
+        EXPECT_EQ(r[0].reason, RejectReason::InvalidQuantity);
+        EXPECT_EQ(queue(Side::Sell, 100.00), std::vector<OrderID>{sell});
+        EXPECT_EQ(market_->get_sellbook().get_orders().at(100.00).visible, 4);
+
+        ASSERT_TRUE(engine_.modify_order(sell, "AAPL", kSeller, 8));
+        EXPECT_EQ(market_->get_sellbook().get_orders().at(100.00).visible, 2);
+    }
+
+    // --- Binary order entry ---
+
+    TEST_F(MarketTest, BinaryOrderCarriesDisplayQuantityAndPegInTheirOwnFields)
+    {
+        auto msg = make_message<NewOrderMessage>(MessageType::NewOrder);
+        msg.market_id = 1;
+        msg.side = Side::Sell;
+        msg.order_type = OrderType::Iceberg;
+        msg.tif = TimeInForce::Day;
+        msg.flags = NewOrderMessage::kHasPrice;
+        msg.quantity = 100;
+        msg.price = 100.00;
+        msg.stop_price = 1e300; // ignored without kHasStopPrice
+        msg.display_qty = 10;
+        OrderAckMessage ack = submit_new_order(engine_, kSeller, msg);
+        ASSERT_EQ(ack.reason, RejectReason::None);
+        EXPECT_EQ(market_->get_sellbook().get_orders().at(100.00).visible, 10);
+
+        msg.side = Side::Buy;
+        msg.order_type = OrderType::Pegged;
+        msg.flags = NewOrderMessage::kHasPeg;
+        msg.display_qty = 0;
+        msg.peg_reference = PegReference::BestAsk;
+        msg.peg_offset = -0.05;
+        ack = submit_new_order(engine_, kBuyer, msg);
+        ASSERT_EQ(ack.reason, RejectReason::None);
+        EXPECT_EQ(queue(Side::Buy, 99.95), std::vector<OrderID>{ack.order_id});
+    }
+
+    // --- Publisher ---
+
+    TEST(PublisherTest, PrepareProducerGivesUpOnAPublisherThatDoesNotDrain)
+    {
+        StallingListener listener;
+        MarketDataPublisher publisher(ExecutionMode::Threaded);
+        publisher.subscribe(&listener);
+        publisher.publish(std::vector<MarketEvent>(1));
+        while (!listener.stalled.load())
+            std::this_thread::yield();
+
+        std::unique_ptr<PublishToken> token;
+        EXPECT_FALSE(publisher.prepare_producer(token, 8, std::chrono::milliseconds(50)));
+        listener.released = true;
+        EXPECT_TRUE(publisher.prepare_producer(token, 8));
+    }
+
+    // --- Replay digest ---
+
+    TEST(DigestTest, DisplayQuantityAndPegAreDigested)
+    {
+        auto digest = [](Quantity display_qty, std::optional<Peg> peg)
+        {
+            MarketEvent ev = MarketEvent::make_add(1, 1, "AAPL", 100, Side::Buy, 100.00, std::nullopt,
+                                                   OrderType::Iceberg, TimeInForce::Day, display_qty);
+            ev.timestamp = TimePoint{};
+            ev.peg = peg;
+            EventDigest d;
+            d.on_market_events({ev});
+            return d.digest();
+        };
+        EXPECT_EQ(digest(10, std::nullopt), digest(10, std::nullopt));
+        EXPECT_NE(digest(10, std::nullopt), digest(20, std::nullopt));
+        EXPECT_NE(digest(10, std::nullopt), digest(10, Peg{PegReference::Mid, 0.0}));
+        EXPECT_NE(digest(10, Peg{PegReference::Mid, 0.0}), digest(10, Peg{PegReference::BestBid, 0.0}));
+        EXPECT_NE(digest(10, Peg{PegReference::Mid, 0.0}), digest(10, Peg{PegReference::Mid, 0.01}));
+    }
+
+    // --- Capture ---
+
+    TEST(CaptureTest, RejectedFileIsNotLeftMapped)
+    {
+        const std::string path = ::testing::TempDir() + "mercex_not_a_capture.bin";
+        std::ofstream(path, std::ios::binary) << std::string(256, 'x');
+
+        auto mappings = [&]
+        {
+            std::ifstream maps("/proc/self/maps");
+            std::string text((std::istreambuf_iterator<char>(maps)), std::istreambuf_iterator<char>());
+            std::size_t n = 0;
+            for (std::size_t at = text.find(path); at != std::string::npos; at = text.find(path, at + 1))
+                ++n;
+            return n;
+        };
+        EXPECT_THROW(CaptureReader reader(path), std::runtime_error);
+        EXPECT_EQ(mappings(), 0u);
+        std::remove(path.c_str());
+    }
+
+    TEST_F(MarketTest, SymbolLongerThanACaptureRecordHoldsIsRefusedAtRegistration)
+    {
+        EXPECT_THROW(registry_.create_market("ABCDEFGHIJKLMNOPQ", 0.01, 2), std::invalid_argument);
+        EXPECT_NO_THROW(registry_.create_market("ABCDEFGHIJKLMNOP", 0.01, 2));
+    }
+
+    // --- Shared-memory market data ---
+
+    TEST_F(MarketTest, ShmFeedTakesTheMarketIdFromThePublishingMarket)
+    {
+        ShmMarketDataFeedConfig config;
+        config.name = "/mercex-test-md-" + std::to_string(::getpid());
+        config.capacity = 64;
+        ShmMarketDataFeed feed(config);
+        publisher_.subscribe(&feed);
+
+        mx_shm_reader reader;
+        ASSERT_EQ(mx_shm_reader_open(&reader, config.name.c_str(), 1), 0);
+
+        // An ID whose top bits name another market, as a gateway numbering
+        // its own orders might send.
+        OrderID resting = limit(kSeller, Side::Sell, 10, 100.00);
+        OrderID foreign = (OrderID(7) << OrderIdGenerator::kSequenceBits) | 42;
+        registry_.get_market_processor("AAPL")->submit_event(
+            MarketEvent::make_add(foreign, kBuyer, "AAPL", 10, Side::Buy, 100.00));
+
+        mx_shm_event ev;
+        std::vector<mx_shm_event> events;
+        while (mx_shm_reader_poll(&reader, &ev) == MX_SHM_EVENT)
+            events.push_back(ev);
+        ASSERT_FALSE(events.empty());
+        bool traded = false;
+        for (const mx_shm_event &e : events)
+        {
+            EXPECT_EQ(e.market_id, 1);
+            traded |= e.type == MX_SHM_TRADE && e.order_id == foreign && e.u.counterparty_id == resting;
+        }
+        EXPECT_TRUE(traded);
+        mx_shm_reader_close(&reader);
+    }
+
+    // --- Shared-memory order entry ---
+
+    TEST(ShmRingTest, RingRefusesWhenFullAndWrapsInOrder)
+    {
+        std::atomic<std::uint64_t> head{0}, tail{0};
+        alignas(8) char slots[4 * kShmOrderSlot];
+        ShmSpscRing producer(&head, &tail, slots, 4);
+        ShmSpscRing consumer(&head, &tail, slots, 4);
+
+        alignas(8) char out[kShmOrderSlot];
+        std::uint64_t pushed = 0, popped = 0;
+        for (int lap = 0; lap < 5; ++lap)
+        {
+            while (producer.push(pushed))
+                ++pushed;
+            EXPECT_EQ(pushed - popped, 4u);
+            EXPECT_TRUE(producer.full());
+            EXPECT_EQ(producer.space(), 0u);
+
+            // Three out, so the next lap's pushes run past the end of the slots.
+            for (int i = 0; i < 3; ++i)
+            {
+                ASSERT_TRUE(consumer.pop(out));
+                std::uint64_t value;
+                std::memcpy(&value, out, sizeof(value));
+                EXPECT_EQ(value, popped++);
+            }
+            EXPECT_EQ(producer.space(), 3u);
+        }
+        while (consumer.pop(out))
+        {
+            std::uint64_t value;
+            std::memcpy(&value, out, sizeof(value));
+            EXPECT_EQ(value, popped++);
+        }
+        EXPECT_EQ(popped, pushed);
+    }
+
+    TEST_F(MarketTest, ShmGatewayHoldsRequestsWhileTheResponseRingIsFull)
+    {
+        ShmOrderGatewayConfig config;
+        config.prefix = "/mercex-test-oe-" + std::to_string(::getpid());
+        config.capacity = 64; // the smallest ring the gateway makes
+        ShmOrderGateway gateway(engine_, reports_, config);
+        gateway.add_client(kSeller);
+        ShmOrderClient client;
+        client.attach(kSeller, config.prefix);
+
+        auto msg = make_message<NewOrderMessage>(MessageType::NewOrder);
+        msg.market_id = 1;
+        msg.side = Side::Sell;
+        msg.order_type = OrderType::Limit;
+        msg.tif = TimeInForce::Day;
+        msg.flags = NewOrderMessage::kHasPrice;
+        msg.quantity = 1;
+        msg.price = 100.00;
+
+        // Nothing is taken before start(): the request ring fills and refuses.
+        constexpr std::uint64_t kOrders = 3 * 64;
+        std::uint64_t sent = 0;
+        while (client.submit(msg))
+            msg.client_ref = ++sent;
+        EXPECT_EQ(sent, 64u);
+        gateway.start();
+
+        // Each order owes an ack and a New report, six times what the
+        // response ring holds; none may be lost while it is full.
+        std::uint64_t acks = 0, news = 0;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while ((acks < kOrders || news < kOrders) && std::chrono::steady_clock::now() < deadline)
+        {
+            if (sent < kOrders && client.submit(msg))
+                msg.client_ref = ++sent;
+            client.poll([&](const MessageHeader &header)
+                        {
+                            if (header.type == MessageType::OrderAck)
+                            {
+                                auto &ack = reinterpret_cast<const OrderAckMessage &>(header);
+                                EXPECT_EQ(ack.reason, RejectReason::None);
+                                EXPECT_EQ(ack.client_ref, acks++);
+                            }
+                            else if (header.type == MessageType::Execution &&
+                                     reinterpret_cast<const ExecutionMessage &>(header).exec_type == ExecType::New)
+                                ++news;
+                        });
+        }
+        gateway.stop();
+        EXPECT_EQ(acks, kOrders);
+        EXPECT_EQ(news, kOrders);
+        EXPECT_EQ(queue(Side::Sell, 100.00).size(), kOrders);
+    }
+
+    // --- Network market data ---
+
+    TEST_F(MarketTest, FeedGapIsFilledFromTheRecoveryService)
+    {
+        // A free UDP port for the feed to send to.
+        int probe = ::socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(addr);
+        ASSERT_EQ(::bind(probe, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+        ASSERT_EQ(::getsockname(probe, reinterpret_cast<sockaddr *>(&addr), &length), 0);
+        ::close(probe);
+
+        MarketDataFeedConfig config;
+        config.address = "127.0.0.1";
+        config.port = ntohs(addr.sin_port);
+        MarketDataFeed feed(config);
+        feed.start();
+        publisher_.subscribe(&feed);
+
+        // Sent before the receiver is listening: lost to it.
+        limit(kSeller, Side::Sell, 10, 100.00);
+        limit(kBuyer, Side::Buy, 10, 100.00);
+        std::uint64_t missed = feed.messages_sent();
+        ASSERT_GT(missed, 0u);
+
+        FeedReceiverConfig receiver_config;
+        receiver_config.address = config.address;
+        receiver_config.port = config.port;
+        receiver_config.recovery_port = feed.recovery_port();
+        std::vector<std::uint64_t> sequences;
+        FeedReceiver receiver(receiver_config, [&](MarketID market_id, std::uint64_t sequence, const FeedMessageHeader &)
+                              {
+                                  EXPECT_EQ(market_id, 1);
+                                  sequences.push_back(sequence);
+                              });
+        receiver.open();
+
+        limit(kSeller, Side::Sell, 5, 101.00);
+        limit(kBuyer, Side::Buy, 5, 101.00);
+        std::uint64_t sent = feed.messages_sent();
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (sequences.size() < sent && std::chrono::steady_clock::now() < deadline)
+            receiver.poll(std::chrono::milliseconds(10));
+
+        EXPECT_EQ(receiver.stats().gaps, 1u);
+        EXPECT_EQ(receiver.stats().recovered, missed);
+        EXPECT_EQ(receiver.stats().lost, 0u);
+        EXPECT_EQ(feed.recovery_requests(), 1u);
+        ASSERT_EQ(sequences.size(), sent);
+        for (std::size_t i = 0; i < sequences.size(); ++i)
+            EXPECT_EQ(sequences[i], i + 1);
+    }
+
+    // --- FIX session ---
+
+    class FixSessionTest : public MarketTest
+    {
+    protected:
+        FixSessionTest() : gateway_(engine_, reports_, config())
+        {
+            gateway_.start();
+        }
+
+        static FixGatewayConfig config()
+        {
+            FixGatewayConfig config;
+            config.counterparties = {{"CLIENT1", kSeller}};
+            config.symbols = {{"AAPL", 1}};
+            return config;
+        }
+
+        static std::vector<FixClient::Field> sell(std::string cl_ord_id)
+        {
+            return {{FixTag::ClOrdID, std::move(cl_ord_id)}, {FixTag::Symbol, "AAPL"}, {FixTag::Side, "2"},
+                    {FixTag::OrderQty, "10"}, {FixTag::OrdType, "2"}, {FixTag::Price, "100"}};
+        }
+
+        // Logs on with ResetSeqNumFlag, so both sides start at 1.
+        void logon(FixClient &client)
+        {
+            client.send("A", 1, {{FixTag::EncryptMethod, "0"}, {FixTag::HeartBtInt, "30"},
+                                 {FixTag::ResetSeqNumFlag, "Y"}});
+            EXPECT_EQ(client.receive()[FixTag::MsgType], "A");
+        }
+
+        FixGateway gateway_;
+    };
+
+    TEST_F(FixSessionTest, InboundGapIsAskedForAndTheMessagesPastItWaitForTheResend)
+    {
+        FixClient client(gateway_.port());
+        logon(client);
+        client.send("D", 2, sell("o2"));
+        EXPECT_EQ(client.receive()[FixTag::ClOrdID], "o2");
+
+        // 3 is lost; 4 is answered with a ResendRequest and dropped.
+        client.send("D", 4, sell("o4"));
+        auto resend = client.receive();
+        EXPECT_EQ(resend[FixTag::MsgType], "2");
+        EXPECT_EQ(resend[FixTag::BeginSeqNo], "3");
+        EXPECT_EQ(resend[FixTag::EndSeqNo], "0");
+
+        auto resent = sell("o4");
+        resent.push_back({FixTag::PossDupFlag, "Y"});
+        client.send("D", 3, sell("o3"));
+        client.send("D", 4, resent);
+        auto o3 = client.receive();
+        auto o4 = client.receive();
+        EXPECT_EQ(o3[FixTag::MsgType], "8");
+        EXPECT_EQ(o3[FixTag::ClOrdID], "o3");
+        EXPECT_EQ(o4[FixTag::MsgType], "8");
+        EXPECT_EQ(o4[FixTag::ClOrdID], "o4");
+        EXPECT_EQ(queue(Side::Sell, 100.00).size(), 3u);
+    }
+
+    TEST_F(FixSessionTest, ResendRequestReplaysReportsAndGapFillsSessionMessages)
+    {
+        FixClient client(gateway_.port());
+        logon(client);
+        client.send("D", 2, sell("o2"));
+        auto report = client.receive();
+        ASSERT_EQ(report[FixTag::MsgSeqNum], "2");
+
+        client.send("2", 3, {{FixTag::BeginSeqNo, "1"}, {FixTag::EndSeqNo, "0"}});
+        // The Logon is not replayed: a gap fill stands in for it.
+        auto gap_fill = client.receive();
+        EXPECT_EQ(gap_fill[FixTag::MsgType], "4");
+        EXPECT_EQ(gap_fill[FixTag::MsgSeqNum], "1");
+        EXPECT_EQ(gap_fill[FixTag::GapFillFlag], "Y");
+        EXPECT_EQ(gap_fill[FixTag::NewSeqNo], "2");
+
+        auto replayed = client.receive();
+        EXPECT_EQ(replayed[FixTag::MsgType], "8");
+        EXPECT_EQ(replayed[FixTag::MsgSeqNum], "2");
+        EXPECT_EQ(replayed[FixTag::PossDupFlag], "Y");
+        EXPECT_EQ(replayed[FixTag::OrigSendingTime], report[FixTag::SendingTime]);
+        EXPECT_EQ(replayed[FixTag::ClOrdID], "o2");
+        EXPECT_EQ(replayed[FixTag::ExecID], report[FixTag::ExecID]);
+    }
+
+}
@@ -0,0 +1,288 @@
+// Order-entry gateway: a threaded engine behind a TcpGateway (see
+// TcpGateway.hpp and BinaryProtocol.hpp for the wire protocol).
+//
+// Usage: mercury_gateway [options]
+//
+//   --markets=LIST     SYM:ID:TICK,... (default AAPL:1:0.01,MSFT:2:0.01)
+//   --address=A        IPv4 address to listen on (default 127.0.0.1)
+//   --port=P           TCP port (default 9000; 0 picks a free one)
+//   --max-sessions=N   concurrent client sessions (default 1024)
+//   --pin=CPU          pin the gateway event loop thread
+//   --io-uring         drive the sockets with io_uring instead of epoll
+//   --journal=FILE     capture every inbound order to FILE through an
+//                      io_uring journal (replayable with mercury_replay)
+//   --durable          fdatasync each journal write before reusing its buffer
+//   --feed=ADDR:PORT   publish market data as a UDP feed (see MarketDataFeed.hpp)
+//   --feed-recovery=P  TCP port of the feed's recovery service (default: a free one)
+//   --shm[=NAME]       publish market data to a shared-memory ring (see
+//                      mercury_shm.h; default name /mercury-md)
+//   --shm-clients=LIST client IDs (1,2,...) that also get a shared-memory order
+//                      channel /mercury-oe-<id> (see ShmOrderChannel.hpp);
+//                      they must not log in over TCP as well
+//   --fix-port=P       also accept FIX 4.4 sessions on port P (see FixGateway.hpp);
+//                      symbols are those of --markets
+//   --fix-comp-id=ID   our CompID on FIX sessions (default MERCURY)
+//   --fix-clients=LIST SENDERCOMPID:CLIENTID,... allowed to log on over FIX
+//                      (default CLIENT1:1)
+//   --quiet            no per-second statistics
+//
+// Runs until SIGINT or SIGTERM.
+#include "TcpGateway.hpp"
+#include "MatchingEngine.hpp"
+#include "MarketRegistry.hpp"
+#include "MarketDataPublisher.hpp"
+#include "ExecutionReportRouter.hpp"
+#include "OrderCapture.hpp"
+#include "MarketDataFeed.hpp"
+#include "ShmMarketDataFeed.hpp"
+#include "ShmOrderGateway.hpp"
+#include "FixGateway.hpp"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace MercEx;
+
+namespace
+{
+    std::atomic<bool> g_stop{false};
+
+    void on_signal(int)
+    {
+        g_stop.store(true);
+    }
+
+    struct MarketSpec
+    {
+        std::string symbol;
+        MarketID id;
+        double tick;
+    };
+
+    std::vector<MarketSpec> parse_markets(const std::string &s)
+    {
+        std::vector<MarketSpec> out;
+        std::stringstream in(s);
+        std::string item;
+        while (std::getline(in, item, ','))
+        {
+            auto first = item.find(':');
+            auto second = first == std::string::npos ? first : item.find(':', first + 1);
+            if (second == std::string::npos)
+                throw std::invalid_argument("bad market spec: " + item);
+            out.push_back({item.substr(0, first),
+                           static_cast<MarketID>(std::atoi(item.c_str() + first + 1)),
+                           std::atof(item.c_str() + second + 1)});
+        }
+        return out;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string markets = "AAPL:1:0.01,MSFT:2:0.01";
+    TcpGatewayConfig config;
+    config.port = 9000;
+    bool quiet = false;
+    std::string journal_path;
+    bool durable = false;
+    MarketDataFeedConfig feed_config;
+    bool feed_enabled = false;
+    ShmMarketDataFeedConfig shm_config;
+    bool shm_enabled = false;
+    std::vector<ClientID> shm_clients;
+    FixGatewayConfig fix_config;
+    bool fix_enabled = false;
+    std::string fix_clients = "CLIENT1:1";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto value = [&](const char *key) -> const char *
+        {
+            std::size_t n = std::strlen(key);
+            return arg.compare(0, n, key) == 0 ? arg.c_str() + n : nullptr;
+        };
+        if (auto v = value("--markets="))
+            markets = v;
+        else if (auto v = value("--address="))
+            config.address = v;
+        else if (auto v = value("--port="))
+            config.port = static_cast<std::uint16_t>(std::atoi(v));
+        else if (auto v = value("--max-sessions="))
+            config.max_sessions = static_cast<std::size_t>(std::atoll(v));
+        else if (auto v = value("--pin="))
+            config.placement.cpu = std::atoi(v);
+        else if (arg == "--io-uring")
+            config.backend = GatewayBackend::IoUring;
+        else if (auto v = value("--journal="))
+            journal_path = v;
+        else if (arg == "--durable")
+            durable = true;
+        else if (auto v = value("--feed="))
+        {
+            const char *colon = std::strrchr(v, ':');
+            if (!colon)
+            {
+                std::cerr << "--feed wants ADDR:PORT\n";
+                return 2;
+            }
+            feed_config.address.assign(v, colon);
+            feed_config.port = static_cast<std::uint16_t>(std::atoi(colon + 1));
+            feed_enabled = true;
+        }
+        else if (auto v = value("--feed-recovery="))
+            feed_config.recovery_port = static_cast<std::uint16_t>(std::atoi(v));
+        else if (arg == "--shm")
+            shm_enabled = true;
+        else if (auto v = value("--shm="))
+        {
+            shm_config.name = v;
+            shm_enabled = true;
+        }
+        else if (auto v = value("--shm-clients="))
+        {
+            std::stringstream in(v);
+            std::string item;
+            while (std::getline(in, item, ','))
+                shm_clients.push_back(static_cast<ClientID>(std::atoll(item.c_str())));
+        }
+        else if (auto v = value("--fix-port="))
+        {
+            fix_config.port = static_cast<std::uint16_t>(std::atoi(v));
+            fix_enabled = true;
+        }
+        else if (auto v = value("--fix-comp-id="))
+            fix_config.comp_id = v;
+        else if (auto v = value("--fix-clients="))
+            fix_clients = v;
+        else if (arg == "--quiet")
+            quiet = true;
+        else
+        {
+            std::cerr << "unknown argument: " << arg << "\n";
+            return 2;
+        }
+    }
+
+    try
+    {
+        // Declared before the publisher so that they outlive its dispatching.
+        std::unique_ptr<MarketDataFeed> feed;
+        if (feed_enabled)
+        {
+            feed = std::make_unique<MarketDataFeed>(feed_config);
+            feed->start();
+            std::cout << "feed to " << feed_config.address << ":" << feed_config.port << ", recovery on port "
+                      << feed->recovery_port() << std::endl;
+        }
+        std::unique_ptr<ShmMarketDataFeed> shm;
+        if (shm_enabled)
+        {
+            shm = std::make_unique<ShmMarketDataFeed>(shm_config);
+            std::cout << "shared-memory ring " << shm->name() << ", " << shm->capacity() << " events" << std::endl;
+        }
+        MarketDataPublisher publisher;
+        if (feed)
+            publisher.subscribe(feed.get());
+        if (shm)
+            publisher.subscribe(shm.get());
+        ExecutionReportRouter reports;
+        MarketRegistry registry(publisher, &reports);
+        for (const auto &m : parse_markets(markets))
+        {
+            registry.create_market(m.symbol, m.tick, m.id);
+            fix_config.symbols.push_back({m.symbol, m.id});
+        }
+        MatchingEngine engine(registry);
+        std::unique_ptr<CaptureWriter> journal;
+        if (!journal_path.empty())
+        {
+            journal = std::make_unique<CaptureWriter>(
+                journal_path, durable ? CaptureBackend::IoUringDurable : CaptureBackend::IoUring);
+            engine.set_capture(journal.get());
+        }
+
+        TcpGateway gateway(engine, reports, config);
+        gateway.start();
+        std::unique_ptr<ShmOrderGateway> shm_gateway;
+        if (!shm_clients.empty())
+        {
+            shm_gateway = std::make_unique<ShmOrderGateway>(engine, reports);
+            for (ClientID client_id : shm_clients)
+                std::cout << "order channel " << shm_gateway->add_client(client_id) << std::endl;
+            shm_gateway->start();
+        }
+        std::unique_ptr<FixGateway> fix_gateway;
+        if (fix_enabled)
+        {
+            std::stringstream in(fix_clients);
+            std::string item;
+            while (std::getline(in, item, ','))
+            {
+                auto colon = item.find(':');
+                if (colon == std::string::npos)
+                    throw std::invalid_argument("bad FIX client: " + item);
+                fix_config.counterparties.push_back(
+                    {item.substr(0, colon), static_cast<ClientID>(std::atoll(item.c_str() + colon + 1))});
+            }
+            fix_config.address = config.address;
+            fix_gateway = std::make_unique<FixGateway>(engine, reports, fix_config);
+            fix_gateway->start();
+            std::cout << "FIX sessions on " << fix_config.address << ":" << fix_gateway->port() << " as "
+                      << fix_config.comp_id << std::endl;
+        }
+        std::cout << "listening on " << config.address << ":" << gateway.port() << std::endl;
+
+        std::signal(SIGINT, on_signal);
+        std::signal(SIGTERM, on_signal);
+
+        std::uint64_t last_in = 0, last_out = 0;
+        while (!g_stop.load())
+        {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            if (quiet)
+                continue;
+            std::uint64_t in = gateway.messages_in(), out = gateway.messages_out();
+            std::cout << "sessions " << gateway.sessions() << ", in " << (in - last_in) << " msg/s, out "
+                      << (out - last_out) << " msg/s, protocol errors " << gateway.protocol_errors() << std::endl;
+            last_in = in;
+            last_out = out;
+        }
+
+        gateway.stop();
+        if (fix_gateway)
+        {
+            fix_gateway->stop();
+            std::cout << "FIX messages in " << fix_gateway->messages_in() << ", out " << fix_gateway->messages_out()
+                      << ", protocol errors " << fix_gateway->protocol_errors() << "\n";
+        }
+        if (shm_gateway)
+        {
+            shm_gateway->stop();
+            std::cout << "shared-memory messages in " << shm_gateway->messages_in() << ", out "
+                      << shm_gateway->messages_out() << ", protocol errors " << shm_gateway->protocol_errors() << "\n";
+        }
+        if (journal)
+        {
+            journal->flush();
+            std::cout << "journaled " << journal->records_written() << " records to " << journal_path << "\n";
+        }
+        std::cout << "messages in " << gateway.messages_in() << ", out " << gateway.messages_out()
+                  << ", engine rejects " << engine.rejected_orders() << "\n";
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
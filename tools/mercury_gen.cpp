@@ -0,0 +1,232 @@
+// Synthetic order-flow generator (see OrderFlowGenerator.hpp).
+//
+// Usage: mercury_gen [options]
+//
+//   --count=N            records to generate (default 10000000)
+//   --symbols=LIST       SYM:MID:TICK[:WEIGHT],... (default AAPL:150:0.01,MSFT:300:0.01)
+//   --rate=R             mean aggregate arrival rate, orders/s (default 1000000)
+//   --mix=L,M,S,SL       limit/market/stop/stop-limit weights among adds
+//   --cancel-ratio=X     cancels per add (default 1)
+//   --modify-ratio=X     modifies per add (default 0)
+//   --aggressive=F       fraction of limits priced through the mid (default 0.1)
+//   --depth=T            mean passive distance from the mid in ticks (default 5)
+//   --burst=P,MULT,LEN   burst start probability, rate multiplier, length in orders
+//   --seed=S             RNG seed (default 1)
+//
+// Output, at most one of:
+//   --out=FILE           write a capture file replayable with mercury_replay
+//     --io-uring[=durable] write it through an io_uring journal; durable
+//                        fdatasyncs every write (see UringJournal.hpp)
+//   --engine[=inline]    feed the stream straight into a fresh MatchingEngine;
+//                        inline runs are deterministic for a given seed
+//   (none)               generate and discard, reporting generator throughput
+#include "OrderFlowGenerator.hpp"
+#include "OrderCapture.hpp"
+#include "MatchingEngine.hpp"
+#include "MarketRegistry.hpp"
+#include "MarketDataPublisher.hpp"
+#include "EventDigest.hpp"
+#include "EngineClock.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace MercEx;
+
+namespace
+{
+    std::vector<double> parse_list(const std::string &s, char sep)
+    {
+        std::vector<double> out;
+        std::stringstream in(s);
+        std::string item;
+        while (std::getline(in, item, sep))
+            out.push_back(std::atof(item.c_str()));
+        return out;
+    }
+
+    std::vector<SymbolFlow> parse_symbols(const std::string &s)
+    {
+        std::vector<SymbolFlow> out;
+        std::stringstream in(s);
+        std::string item;
+        MarketID next_id = 1;
+        while (std::getline(in, item, ','))
+        {
+            auto colon = item.find(':');
+            if (colon == std::string::npos)
+                throw std::invalid_argument("bad symbol spec: " + item);
+            auto fields = parse_list(item.substr(colon + 1), ':');
+            if (fields.size() < 2)
+                throw std::invalid_argument("bad symbol spec: " + item);
+            out.push_back({item.substr(0, colon), next_id++, fields[1], fields[0], fields.size() > 2 ? fields[2] : 1.0});
+        }
+        return out;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    OrderFlowConfig config;
+    std::uint64_t count = 10'000'000;
+    std::string symbols = "AAPL:150:0.01,MSFT:300:0.01";
+    std::string out_path;
+    CaptureBackend capture_backend = CaptureBackend::Stdio;
+    bool to_engine = false;
+    ExecutionMode mode = ExecutionMode::Threaded;
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            auto value = [&](const char *prefix) -> const char *
+            {
+                std::size_t n = std::char_traits<char>::length(prefix);
+                return arg.compare(0, n, prefix) == 0 ? arg.c_str() + n : nullptr;
+            };
+            if (auto v = value("--count="))
+                count = std::strtoull(v, nullptr, 10);
+            else if (auto v = value("--symbols="))
+                symbols = v;
+            else if (auto v = value("--rate="))
+                config.orders_per_second = std::atof(v);
+            else if (auto v = value("--mix="))
+            {
+                auto w = parse_list(v, ',');
+                if (w.size() != 4)
+                    throw std::invalid_argument("--mix needs four weights");
+                config.mix = {w[0], w[1], w[2], w[3]};
+            }
+            else if (auto v = value("--cancel-ratio="))
+                config.cancel_to_add = std::atof(v);
+            else if (auto v = value("--modify-ratio="))
+                config.modify_to_add = std::atof(v);
+            else if (auto v = value("--aggressive="))
+                config.aggressive_fraction = std::atof(v);
+            else if (auto v = value("--depth="))
+                config.depth_ticks = std::atof(v);
+            else if (auto v = value("--burst="))
+            {
+                auto b = parse_list(v, ',');
+                if (b.size() != 3)
+                    throw std::invalid_argument("--burst needs P,MULT,LEN");
+                config.burst_probability = b[0];
+                config.burst_rate_multiplier = b[1];
+                config.burst_length = static_cast<std::uint32_t>(b[2]);
+            }
+            else if (auto v = value("--seed="))
+                config.seed = std::strtoull(v, nullptr, 10);
+            else if (auto v = value("--out="))
+                out_path = v;
+            else if (arg == "--io-uring")
+                capture_backend = CaptureBackend::IoUring;
+            else if (arg == "--io-uring=durable")
+                capture_backend = CaptureBackend::IoUringDurable;
+            else if (arg == "--engine")
+                to_engine = true;
+            else if (arg == "--engine=inline")
+                to_engine = true, mode = ExecutionMode::Inline;
+            else
+                throw std::invalid_argument("unknown argument: " + arg);
+        }
+        if (to_engine && !out_path.empty())
+            throw std::invalid_argument("--out and --engine are exclusive");
+        if (capture_backend != CaptureBackend::Stdio && out_path.empty())
+            throw std::invalid_argument("--io-uring needs --out");
+        config.symbols = parse_symbols(symbols);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n";
+        return 2;
+    }
+
+    OrderFlowGenerator generator(config);
+    std::unique_ptr<CaptureWriter> writer;
+    std::unique_ptr<MarketDataPublisher> publisher;
+    std::unique_ptr<MarketRegistry> registry;
+    std::unique_ptr<MatchingEngine> engine;
+    EventDigest digest;
+    ManualClock clock;
+
+    auto definitions = generator.market_definitions();
+    if (!out_path.empty())
+    {
+        writer = std::make_unique<CaptureWriter>(out_path, capture_backend);
+        for (const auto &r : definitions)
+            writer->append(r);
+    }
+    else if (to_engine)
+    {
+        // Inline runs follow the generated timestamps, so a seed always
+        // reproduces the same event digest.
+        if (mode == ExecutionMode::Inline)
+            EngineClock::set_source(&clock);
+        publisher = std::make_unique<MarketDataPublisher>(mode);
+        publisher->subscribe(&digest);
+        registry = std::make_unique<MarketRegistry>(*publisher, nullptr, mode);
+        engine = std::make_unique<MatchingEngine>(*registry);
+        for (const auto &r : definitions)
+            registry->create_market(r.get_symbol(), r.price, r.market_id);
+    }
+
+    constexpr std::size_t kBatch = 4096;
+    std::vector<CaptureRecord> batch(kBatch);
+    OrderRequest request;
+    // Indexed by record type: a branch per record on a random type cost the
+    // discard run more than generating the record did.
+    std::uint64_t counts[256] = {};
+    const auto start = Clock::now();
+
+    for (std::uint64_t done = 0; done < count;)
+    {
+        std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(kBatch, count - done));
+        generator.generate(batch.data(), n);
+        for (std::size_t i = 0; i < n; ++i)
+            ++counts[static_cast<std::uint8_t>(batch[i].type)];
+        done += n;
+        if (!writer && !engine)
+            continue;
+
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const CaptureRecord &r = batch[i];
+            if (writer)
+                writer->append(r);
+            else
+            {
+                if (mode == ExecutionMode::Inline)
+                    clock.set(TimePoint(std::chrono::nanoseconds(r.timestamp_ns)));
+                if (r.type == CaptureRecordType::Cancel)
+                    engine->cancel_order(r.order_id, r.get_symbol(), r.client_id);
+                else if (r.type == CaptureRecordType::Modify)
+                    engine->modify_order(r.order_id, r.get_symbol(), r.client_id, r.quantity,
+                                         (r.flags & CaptureRecord::kHasPrice) ? std::optional<Price>(r.price) : std::nullopt);
+                else if (r.to_request(request))
+                    engine->replay_order(r.order_id, request);
+            }
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    if (writer)
+        writer->flush();
+    if (engine && mode == ExecutionMode::Threaded)
+        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // let workers and publisher drain
+
+    EngineClock::set_source(nullptr);
+
+    std::cout << "records " << count << " (submits " << counts[static_cast<std::uint8_t>(CaptureRecordType::Submit)]
+              << ", cancels " << counts[static_cast<std::uint8_t>(CaptureRecordType::Cancel)]
+              << ", modifies " << counts[static_cast<std::uint8_t>(CaptureRecordType::Modify)] << ")\n"
+              << "generated in " << elapsed << " s, " << (count / (elapsed > 0 ? elapsed : 1)) << " records/s\n";
+    if (engine)
+        std::cout << "events " << digest.event_count() << ", digest " << std::hex << digest.digest() << std::dec << "\n";
+    return 0;
+}
@@ -0,0 +1,240 @@
+// Replays an order-flow capture (see OrderCapture.hpp) into a fresh engine.
+//
+// Usage: mercury_replay <capture> [--speed=N | --max] [--inline]
+//                       [--metrics-file=PATH] [--metrics-socket=PATH] [--arena-mb=N]
+//                       [--feed=ADDR:PORT] [--feed-recovery=PORT] [--shm[=NAME]]
+//
+//   default     threaded engine, orders submitted at the recorded pace
+//   --speed=N   recorded pace scaled by N (2 = twice as fast)
+//   --max       no pacing: submit as fast as the engine accepts
+//   --inline    deterministic mode: markets are stepped on this thread and
+//               the engine clock follows the recorded timestamps, so the
+//               printed event digest is identical on every run (implies --max)
+//   --metrics-file=PATH, --metrics-socket=PATH
+//               export engine metrics in Prometheus text format while replaying
+//   --arena-mb=N  give each market an N MB huge-page arena (see HugePageArena.hpp)
+//   --feed=ADDR:PORT  publish market data as a UDP feed (see MarketDataFeed.hpp)
+//   --feed-recovery=PORT  TCP port of the feed's recovery service (default: a free one)
+//   --shm[=NAME]  publish market data to a shared-memory ring (see mercury_shm.h;
+//                 default name /mercury-md)
+//
+// Orders are resubmitted under their recorded IDs, so cancels and modifies in
+// the capture find the orders they referred to.
+#include "MatchingEngine.hpp"
+#include "MarketRegistry.hpp"
+#include "MarketDataPublisher.hpp"
+#include "EventDigest.hpp"
+#include "EngineClock.hpp"
+#include "OrderCapture.hpp"
+#include "MetricsExporter.hpp"
+#include "MarketDataFeed.hpp"
+#include "ShmMarketDataFeed.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace MercEx;
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <capture> [--speed=N | --max] [--inline]"
+                  << " [--metrics-file=PATH] [--metrics-socket=PATH] [--arena-mb=N]"
+                  << " [--feed=ADDR:PORT] [--feed-recovery=PORT] [--shm[=NAME]]\n";
+        return 2;
+    }
+
+    std::string path = argv[1];
+    double speed = 1.0;
+    bool paced = true;
+    ExecutionMode mode = ExecutionMode::Threaded;
+    MetricsExporterConfig metrics_config;
+    ArenaConfig arena;
+    MarketDataFeedConfig feed_config;
+    bool feed_enabled = false;
+    ShmMarketDataFeedConfig shm_config;
+    bool shm_enabled = false;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--speed=", 0) == 0)
+            speed = std::atof(arg.c_str() + 8);
+        else if (arg == "--max")
+            paced = false;
+        else if (arg == "--inline")
+            mode = ExecutionMode::Inline;
+        else if (arg.rfind("--metrics-file=", 0) == 0)
+            metrics_config.file_path = arg.substr(15);
+        else if (arg.rfind("--metrics-socket=", 0) == 0)
+            metrics_config.socket_path = arg.substr(17);
+        else if (arg.rfind("--arena-mb=", 0) == 0)
+            arena.bytes = static_cast<std::size_t>(std::atoll(arg.c_str() + 11)) << 20;
+        else if (arg.rfind("--feed=", 0) == 0)
+        {
+            auto colon = arg.rfind(':');
+            if (colon == std::string::npos || colon < 7)
+            {
+                std::cerr << "--feed wants ADDR:PORT\n";
+                return 2;
+            }
+            feed_config.address = arg.substr(7, colon - 7);
+            feed_config.port = static_cast<std::uint16_t>(std::atoi(arg.c_str() + colon + 1));
+            feed_enabled = true;
+        }
+        else if (arg.rfind("--feed-recovery=", 0) == 0)
+            feed_config.recovery_port = static_cast<std::uint16_t>(std::atoi(arg.c_str() + 16));
+        else if (arg == "--shm" || arg.rfind("--shm=", 0) == 0)
+        {
+            if (arg.size() > 6)
+                shm_config.name = arg.substr(6);
+            shm_enabled = true;
+        }
+        else
+        {
+            std::cerr << "unknown argument: " << arg << "\n";
+            return 2;
+        }
+    }
+    if (mode == ExecutionMode::Inline)
+        paced = false;
+    if (speed <= 0)
+    {
+        std::cerr << "--speed must be positive\n";
+        return 2;
+    }
+
+    CaptureReader capture(path);
+
+    ManualClock clock;
+    if (mode == ExecutionMode::Inline)
+        EngineClock::set_source(&clock);
+
+    // Declared before the publisher so that they outlive its dispatching.
+    std::unique_ptr<MarketDataFeed> feed;
+    if (feed_enabled)
+    {
+        feed = std::make_unique<MarketDataFeed>(feed_config);
+        feed->start();
+        std::cout << "feed to " << feed_config.address << ":" << feed_config.port << ", recovery on port "
+                  << feed->recovery_port() << std::endl;
+    }
+    std::unique_ptr<ShmMarketDataFeed> shm;
+    if (shm_enabled)
+    {
+        shm = std::make_unique<ShmMarketDataFeed>(shm_config);
+        std::cout << "shared-memory ring " << shm->name() << ", " << shm->capacity() << " events" << std::endl;
+    }
+
+    MarketDataPublisher publisher(mode);
+    EventDigest digest;
+    publisher.subscribe(&digest);
+    if (feed)
+        publisher.subscribe(feed.get());
+    if (shm)
+        publisher.subscribe(shm.get());
+    MarketRegistry registry(publisher, nullptr, mode);
+    MatchingEngine engine(registry);
+
+    // Markets are created up front: the capture defines each one lazily, but
+    // the registry must not change under a running metrics scraper.
+    for (const CaptureRecord &r : capture)
+    {
+        if (r.type == CaptureRecordType::DefineMarket && !registry.get_market_processor(r.get_symbol()))
+            registry.create_market(r.get_symbol(), r.price, r.market_id, {}, arena);
+    }
+
+    MetricsRegistry metrics;
+    std::unique_ptr<MetricsExporter> exporter;
+    if (!metrics_config.file_path.empty() || !metrics_config.socket_path.empty())
+    {
+        register_engine_metrics(metrics, registry, &engine, &publisher);
+        exporter = std::make_unique<MetricsExporter>(metrics, metrics_config);
+        exporter->start();
+    }
+
+    std::uint64_t submits = 0, cancels = 0, modifies = 0, errors = 0;
+    const std::int64_t first_ns = capture.size() ? capture.begin()->timestamp_ns : 0;
+    const auto wall_start = Clock::now();
+
+    for (const CaptureRecord &r : capture)
+    {
+        if (paced)
+        {
+            auto offset = std::chrono::nanoseconds(static_cast<std::int64_t>((r.timestamp_ns - first_ns) / speed));
+            auto target = wall_start + offset;
+            auto now = Clock::now();
+            if (target - now > std::chrono::microseconds(200))
+                std::this_thread::sleep_for(target - now - std::chrono::microseconds(100));
+            while (Clock::now() < target)
+                ;
+        }
+        else if (mode == ExecutionMode::Inline)
+        {
+            clock.set(TimePoint(std::chrono::nanoseconds(r.timestamp_ns)));
+        }
+
+        RejectReason failure = RejectReason::None;
+        try
+        {
+            switch (r.type)
+            {
+            case CaptureRecordType::DefineMarket:
+                break;
+            case CaptureRecordType::Submit:
+            {
+                OrderRequest request;
+                failure = r.to_request(request) ? engine.replay_order(r.order_id, request).reason
+                                                : RejectReason::InvalidOrder;
+                ++submits;
+                break;
+            }
+            case CaptureRecordType::Cancel:
+                if (!engine.cancel_order(r.order_id, r.get_symbol(), r.client_id))
+                    failure = RejectReason::UnknownMarket;
+                ++cancels;
+                break;
+            case CaptureRecordType::Modify:
+                if (!engine.modify_order(r.order_id, r.get_symbol(), r.client_id, r.quantity,
+                                         (r.flags & CaptureRecord::kHasPrice) ? std::optional<Price>(r.price)
+                                                                              : std::nullopt))
+                    failure = RejectReason::UnknownMarket;
+                ++modifies;
+                break;
+            default:
+                ++errors;
+                break;
+            }
+        }
+        catch (const std::exception &e)
+        {
+            if (errors++ < 10)
+                std::cerr << "record " << (&r - capture.begin()) << ": " << e.what() << "\n";
+        }
+        if (failure != RejectReason::None && errors++ < 10)
+            std::cerr << "record " << (&r - capture.begin()) << ": " << to_string(failure) << "\n";
+    }
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - wall_start).count();
+    if (mode == ExecutionMode::Threaded)
+        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // let workers and publisher drain
+
+    if (feed)
+        std::this_thread::sleep_for(2 * feed_config.heartbeat); // heartbeats let receivers recover the tail
+
+    EngineClock::set_source(nullptr);
+
+    std::cout << "records " << capture.size() << " (submits " << submits << ", cancels " << cancels
+              << ", modifies " << modifies << ", errors " << errors << ")\n"
+              << "replayed in " << elapsed << " s, " << (capture.size() / (elapsed > 0 ? elapsed : 1)) << " records/s\n"
+              << "events " << digest.event_count() << ", digest " << std::hex << digest.digest() << std::dec << "\n";
+    if (feed)
+        std::cout << "feed: " << feed->messages_sent() << " messages in " << feed->packets_sent() << " packets, "
+                  << feed->send_errors() << " send errors, " << feed->recovery_requests() << " recovery requests, "
+                  << feed->snapshots_sent() << " snapshots\n";
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Follows a shared-memory market data ring (see mercury_shm.h) from plain
+ * C, without mercury_core, and reports rates and publish-to-read latency.
+ *
+ * Usage: mercury_shm_tail [--name=/mercury-md] [--from-start] [--duration=S] [--print]
+ *
+ *   --name=N        shm_open name of the ring (default /mercury-md)
+ *   --from-start    begin at the oldest event still held instead of the next one
+ *   --duration=S    stop after S seconds (default: run until SIGINT)
+ *   --print         print every event
+ *
+ * Spins on the ring: give it a core of its own.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "mercury_shm.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    g_stop = 1;
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static const char *type_name(uint8_t type)
+{
+    switch (type)
+    {
+    case MX_SHM_ADD_ORDER:
+        return "add";
+    case MX_SHM_FILLED_ORDER:
+        return "filled";
+    case MX_SHM_CANCEL_ORDER:
+        return "cancel";
+    case MX_SHM_TRADE:
+        return "trade";
+    case MX_SHM_STOP_TRIGGERED:
+        return "stop";
+    case MX_SHM_REPLENISH:
+        return "replenish";
+    }
+    return "?";
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = "/mercury-md";
+    int from_start = 0;
+    int print = 0;
+    double duration = 0;
+    mx_shm_reader reader;
+    mx_shm_event ev;
+    int64_t start, next_report, deadline;
+    uint64_t events = 0, last_events = 0, lapped = 0, skipped = 0, trades = 0;
+    int64_t latency_sum = 0, latency_max = 0;
+    uint64_t latency_count = 0;
+    int i, rc;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (strncmp(argv[i], "--name=", 7) == 0)
+            name = argv[i] + 7;
+        else if (strcmp(argv[i], "--from-start") == 0)
+            from_start = 1;
+        else if (strncmp(argv[i], "--duration=", 11) == 0)
+            duration = atof(argv[i] + 11);
+        else if (strcmp(argv[i], "--print") == 0)
+            print = 1;
+        else
+        {
+            fprintf(stderr, "unknown argument: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    rc = mx_shm_reader_open(&reader, name, from_start);
+    if (rc != 0)
+    {
+        fprintf(stderr, "cannot attach to %s: %s\n", name, strerror(-rc));
+        return 1;
+    }
+    printf("attached to %s: %llu slots, cursor %llu\n", name, (unsigned long long)(reader.mask + 1),
+           (unsigned long long)reader.cursor);
+    fflush(stdout);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    start = now_ns();
+    next_report = start + 1000000000;
+    deadline = duration > 0 ? start + (int64_t)(duration * 1e9) : 0;
+    while (!g_stop)
+    {
+        rc = mx_shm_reader_poll(&reader, &ev);
+        if (rc == MX_SHM_EVENT)
+        {
+            int64_t latency = now_ns() - ev.publish_ns;
+            ++events;
+            if (ev.type == MX_SHM_TRADE)
+                ++trades;
+            /* Events read from the backlog say nothing about latency. */
+            if (latency < 1000000)
+            {
+                latency_sum += latency;
+                latency_count++;
+                if (latency > latency_max)
+                    latency_max = latency;
+            }
+            if (print)
+                printf("%llu %s market %u order %llu qty %d price %.4f\n", (unsigned long long)(reader.cursor - 1),
+                       type_name(ev.type), ev.market_id, (unsigned long long)ev.order_id, ev.quantity, ev.price);
+            continue;
+        }
+        if (rc == MX_SHM_LAPPED)
+        {
+            ++lapped;
+            skipped += mx_shm_reader_resync(&reader);
+            continue;
+        }
+
+        /* Idle: the clock is only read here, off the hot path. */
+        {
+            int64_t now = now_ns();
+            if (deadline && now >= deadline)
+                break;
+            if (now >= next_report)
+            {
+                next_report += 1000000000;
+                printf("events %llu/s, lapped %llu (%llu skipped), latency mean %lld ns, max %lld ns\n",
+                       (unsigned long long)(events - last_events), (unsigned long long)lapped,
+                       (unsigned long long)skipped,
+                       (long long)(latency_count ? latency_sum / (int64_t)latency_count : 0), (long long)latency_max);
+                fflush(stdout);
+                last_events = events;
+            }
+        }
+    }
+
+    printf("events %llu (%llu trades), lapped %llu, skipped %llu, latency mean %lld ns, max %lld ns\n",
+           (unsigned long long)events, (unsigned long long)trades, (unsigned long long)lapped,
+           (unsigned long long)skipped, (long long)(latency_count ? latency_sum / (int64_t)latency_count : 0),
+           (long long)latency_max);
+    mx_shm_reader_close(&reader);
+    return 0;
+}